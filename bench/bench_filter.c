@@ -0,0 +1,183 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "edge.h"
+#include "input.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#define FREQ 1000
+#define MINUTES 30
+
+/* Pseudo-random numbers which are identical for both filters */
+static unsigned
+xorshift(unsigned *state)
+{
+	unsigned x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+struct synth {
+	int minute[MINUTES][59];
+	long long second;
+	int phase;
+};
+
+static void
+init_synth(struct synth * const s)
+{
+	unsigned seed = 1;
+
+	memset(s, 0, sizeof(*s));
+	for (int m = 0; m < MINUTES; m++) {
+		for (int i = 0; i < 59; i++) {
+			s->minute[m][i] = xorshift(&seed) & 1;
+		}
+		s->minute[m][0] = 0;
+		s->minute[m][20] = 1;
+	}
+}
+
+/* Emit the edges of a DCF77-like signal with different bits each minute */
+static int
+next_edge(void *arg, struct edge *e)
+{
+	struct synth *s = arg;
+	int bitpos, m;
+
+	for (;;) {
+		bitpos = (int)(s->second % 60);
+		if (s->second >= MINUTES * 60) {
+			return -1;
+		}
+		if (bitpos == 59 || s->phase == 2) {
+			s->second++;
+			s->phase = 0;
+			continue;
+		}
+		break;
+	}
+	m = (int)(s->second / 60);
+	e->level = s->phase == 0 ? 1 : 0;
+	e->t = s->second * 1000000000LL + 300000000LL +
+	    (s->phase == 0 ? 0 : (s->minute[m][bitpos] + 1) * 100000000LL);
+	s->phase++;
+	return 0;
+}
+
+struct jitter {
+	/* one in this many samples is delayed */
+	unsigned every;
+	/* maximum delay in nanoseconds */
+	long long max;
+	unsigned seed;
+};
+
+/* Delay some samples, like a busy host would */
+static long long
+next_jitter(void *arg)
+{
+	struct jitter *j = arg;
+
+	if (j->every == 0 || xorshift(&j->seed) % j->every != 0) {
+		return 0;
+	}
+	return (long long)(xorshift(&j->seed) % 1000) * j->max / 1000;
+}
+
+/*
+ * Decode MINUTES minutes of signal with the given filter and jitter, and
+ * return the number of bits which were decoded wrongly or not at all, counted
+ * from the first minute marker on.
+ */
+static unsigned
+run(enum eGB_filter filter, struct jitter j, unsigned *nbits)
+{
+	struct GB_state gbs;
+	static struct synth s;
+	bool synced = false;
+	unsigned errors = 0;
+	int m = 0;
+
+	init_synth(&s);
+	init_input_state(&gbs);
+	if (set_mode_synthetic_r(&gbs, FREQ, false, next_edge, &s) != 0) {
+		exit(EX_SOFTWARE);
+	}
+	set_filter_r(&gbs, filter);
+	set_sample_jitter_r(&gbs, next_jitter, &j);
+
+	*nbits = 0;
+	for (;;) {
+		struct GB_result bit;
+		int bitpos;
+
+		bit = get_bit_live_r(&gbs);
+		if (bit.bad_io) {
+			break;
+		}
+		bitpos = get_bitpos_r(&gbs);
+		if (synced) {
+			(*nbits)++;
+			if (bit.hwstat != ehw_ok || bitpos > 58 ||
+			    m >= MINUTES ||
+			    bit.bitval != (s.minute[m][bitpos] == 1 ? ebv_1 :
+			    ebv_0) ||
+			    (bit.marker == emark_minute) != (bitpos == 58)) {
+				errors++;
+			}
+		}
+		if (bit.marker == emark_minute) {
+			synced = true;
+			m++;
+		}
+		(void)next_bit_r(&gbs);
+	}
+	cleanup_r(&gbs);
+	return errors;
+}
+
+/*
+ * Compare the bit error rates of the sample counting filter and the
+ * timestamp-aware filter when samples get delayed by scheduling jitter.
+ */
+int
+main(void)
+{
+	const struct jitter load[] = {
+		{ 0, 0, 1 },
+		{ 1000, 2000000, 1 },
+		{ 200, 5000000, 1 },
+		{ 100, 20000000, 1 },
+		{ 50, 50000000, 1 }
+	};
+
+	printf("%-24s %20s %20s\n", "jitter", "samples", "timestamps");
+	for (unsigned i = 0; i < sizeof(load) / sizeof(load[0]); i++) {
+		unsigned err[2], nbits[2];
+		char name[32];
+
+		err[0] = run(efilter_samples, load[i], &nbits[0]);
+		err[1] = run(efilter_timestamps, load[i], &nbits[1]);
+		if (load[i].every == 0) {
+			(void)snprintf(name, sizeof(name), "none");
+		} else {
+			(void)snprintf(name, sizeof(name), "1/%u up to %lli ms",
+			    load[i].every, load[i].max / 1000000);
+		}
+		printf("%-24s %5u/%5u %7.4f%% %5u/%5u %7.4f%%\n", name,
+		    err[0], nbits[0], nbits[0] == 0 ? 100.0 :
+		    100.0 * err[0] / nbits[0], err[1], nbits[1],
+		    nbits[1] == 0 ? 100.0 : 100.0 * err[1] / nbits[1]);
+	}
+	return EX_OK;
+}
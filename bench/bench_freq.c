@@ -0,0 +1,93 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "edge.h"
+#include "input.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+/* seconds of signal to decode per sample frequency */
+#define SECONDS 1200
+
+struct synth {
+	long long second;
+	int phase;
+};
+
+/* Emit the edges of a DCF77-like signal of alternating 0 and 1 bits */
+static int
+next_edge(void *arg, struct edge *e)
+{
+	struct synth *s = arg;
+	int bitpos;
+
+	for (;;) {
+		bitpos = (int)(s->second % 60);
+		if (s->second >= SECONDS) {
+			return -1;
+		}
+		if (bitpos == 59 || s->phase == 2) {
+			s->second++;
+			s->phase = 0;
+			continue;
+		}
+		break;
+	}
+	e->level = s->phase == 0 ? 1 : 0;
+	e->t = s->second * 1000000000LL + 300000000LL +
+	    (s->phase == 0 ? 0 : (bitpos % 2 + 1) * 100000000LL);
+	s->phase++;
+	return 0;
+}
+
+static long long
+cpu_time(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
+/*
+ * Decode a synthetic signal with the sampling loop and report the CPU time
+ * needed per second of signal for a few sample frequencies.
+ */
+int
+main(void)
+{
+	const unsigned freq[] = { 500, 1000, 2000, 10000 };
+
+	printf("%-8s %14s\n", "freq", "cpu/s");
+	for (unsigned i = 0; i < sizeof(freq) / sizeof(freq[0]); i++) {
+		struct GB_state gbs;
+		struct synth s;
+		long long cpu = 0;
+
+		memset(&s, 0, sizeof(s));
+		init_input_state(&gbs);
+		if (set_mode_synthetic_r(&gbs, freq[i], false, next_edge,
+		    &s) != 0) {
+			return EX_SOFTWARE;
+		}
+		for (;;) {
+			struct GB_result bit;
+			long long t0 = cpu_time();
+
+			bit = get_bit_live_r(&gbs);
+			cpu += cpu_time() - t0;
+			if (bit.bad_io) {
+				break;
+			}
+			(void)next_bit_r(&gbs);
+		}
+		/* microseconds of CPU time per second of signal */
+		printf("%-8u %11.1f us\n", freq[i], cpu / 1000.0 / SECONDS);
+		cleanup_r(&gbs);
+	}
+	return EX_OK;
+}
@@ -0,0 +1,164 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "binlog.h"
+#include "input.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+/* minutes in the generated log file, about 76 bytes each */
+#define MINUTES 500000
+
+static unsigned
+xorshift(unsigned *state)
+{
+	unsigned x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* Write a log file like dcf77pi does, with some reception errors */
+static long
+write_log(const char * const path)
+{
+	const char bad[] = "x_r#*";
+	unsigned seed = 1;
+	long size;
+	FILE *f;
+
+	f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "\n--new log--\n\n");
+	for (int m = 0; m < MINUTES; m++) {
+		for (int i = 0; i < 59; i++) {
+			unsigned r = xorshift(&seed);
+
+			if (r % 200 == 0) {
+				fputc(bad[r / 200 % 5], f);
+			} else {
+				fputc('0' + (int)(r >> 16 & 1), f);
+			}
+		}
+		fprintf(f, "a%uc%6.4f\n", 59990 + xorshift(&seed) % 40,
+		    1.99 + xorshift(&seed) % 200 / 10000.0);
+	}
+	size = ftell(f);
+	if (fclose(f) == EOF) {
+		perror(path);
+		return -1;
+	}
+	return size;
+}
+
+static double
+cpu_time(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_sec + tp.tv_nsec / 1e9;
+}
+
+/*
+ * Read the whole log file like mainloop() does, return the CPU time used
+ * and a checksum of everything that was read.
+ */
+static double
+run(const char * const path, bool stdio_only, unsigned long long *sum)
+{
+	struct GB_state gbs;
+	double t0;
+
+	init_input_state(&gbs);
+	set_stdio_only_r(&gbs, stdio_only);
+	if (set_mode_file_r(&gbs, path) != 0) {
+		exit(EX_SOFTWARE);
+	}
+	*sum = 0;
+	t0 = cpu_time();
+	for (;;) {
+		struct GB_result bit;
+
+		(void)get_bit_file_r(&gbs);
+		bit = next_bit_r(&gbs);
+		*sum = *sum * 31 + (unsigned)get_bitpos_r(&gbs) * 64 +
+		    bit.bitval * 16 + bit.marker * 4 + bit.hwstat +
+		    get_acc_minlen_r(&gbs) + (unsigned)get_cutoff_r(&gbs);
+		if (bit.done) {
+			break;
+		}
+	}
+	t0 = cpu_time() - t0;
+	cleanup_r(&gbs);
+	return t0;
+}
+
+/*
+ * Measure how fast a log file is parsed when it is memory-mapped, when stdio
+ * is used and when it is converted to a binary log file, and check that all
+ * give the same results.
+ */
+int
+main(void)
+{
+	char path[] = "/tmp/bench_logparse.XXXXXX";
+	char binpath[] = "/tmp/bench_logparse.XXXXXX";
+	unsigned long long sum[3];
+	double t[3] = { INFINITY, INFINITY, INFINITY };
+	struct stat st;
+	long size;
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd == -1) {
+		perror("mkstemp");
+		return EX_SOFTWARE;
+	}
+	(void)close(fd);
+	fd = mkstemp(binpath);
+	if (fd == -1) {
+		perror("mkstemp");
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+	(void)close(fd);
+	size = write_log(path);
+	if (size == -1 || convert_logfile(path, binpath) != 0 ||
+	    stat(binpath, &st) == -1) {
+		(void)unlink(path);
+		(void)unlink(binpath);
+		return EX_SOFTWARE;
+	}
+	/* the best of three, to reduce the noise of other load */
+	for (int i = 0; i < 3; i++) {
+		t[0] = fmin(t[0], run(path, false, &sum[0]));
+		t[1] = fmin(t[1], run(path, true, &sum[1]));
+		t[2] = fmin(t[2], run(binpath, false, &sum[2]));
+	}
+	(void)unlink(path);
+	(void)unlink(binpath);
+	if (sum[0] != sum[1] || sum[0] != sum[2]) {
+		printf("results differ\n");
+		return EX_SOFTWARE;
+	}
+	printf("%.1f MB: mmap %.1f MB/s, stdio %.1f MB/s, %.2fx\n", size / 1e6,
+	    size / 1e6 / t[0], size / 1e6 / t[1], t[1] / t[0]);
+	printf("binary %.1f MB (%.2fx smaller): %.2fx the time of mmap\n",
+	    st.st_size / 1e6, (double)size / st.st_size, t[2] / t[0]);
+	return EX_OK;
+}
@@ -0,0 +1,160 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "input.h"
+#include "rawcap.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FREQ 1000
+
+static unsigned
+xorshift(unsigned *state)
+{
+	unsigned x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* Bit i of minute m, bit 0 is always 0 and bit 20 always 1 */
+static int
+bitval(unsigned m, unsigned i)
+{
+	unsigned seed = m * 64 + i + 1;
+
+	if (i == 0) {
+		return 0;
+	}
+	if (i == 20) {
+		return 1;
+	}
+	(void)xorshift(&seed);
+	(void)xorshift(&seed);
+	return (int)(xorshift(&seed) >> 16 & 1);
+}
+
+/*
+ * Write a capture of a DCF77-like signal of the given number of minutes,
+ * with about one in 100 samples inverted as noise.
+ */
+static int
+write_capture(const char * const path, unsigned minutes)
+{
+	unsigned char signal[FREQ / 2];
+	struct rawcap rc;
+	unsigned seed = 1;
+
+	if (rawcap_open(&rc, path, (uint64_t)minutes * 60, FREQ) != 0) {
+		return -1;
+	}
+	for (unsigned m = 0; m < minutes; m++) {
+		for (unsigned i = 0; i < 59; i++) {
+			/* bit 58 takes two seconds, there is no bit 59 */
+			unsigned n = i == 58 ? FREQ * 2 : FREQ;
+			unsigned active = (unsigned)(bitval(m, i) + 1) * FREQ /
+			    10;
+
+			memset(signal, 0, sizeof(signal));
+			for (unsigned k = 0; k < n; k++) {
+				int p = k < active ? 1 : 0;
+
+				if (xorshift(&seed) % 100 == 0) {
+					p = 1 - p;
+				}
+				signal[k / 8] |= (unsigned char)(p << (k & 7));
+			}
+			rawcap_write(&rc, ((long long)m * 60 + i) * 1000000000,
+			    true, signal, n);
+		}
+	}
+	rawcap_close(&rc);
+	return 0;
+}
+
+static double
+cpu_time(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_sec + tp.tv_nsec / 1e9;
+}
+
+/*
+ * Replay a synthetic capture through the live decoder, count the bits after
+ * the first minute which are not decoded as written and report how much
+ * faster than real time this runs. The optional argument is the number of
+ * hours of signal, 24 by default.
+ *
+ * The minute markers are just long enough that noise sometimes makes them
+ * exceed the two second limit of the sampling loop, so some of them count as
+ * wrong. The other bits should all be right.
+ */
+int
+main(int argc, char *argv[])
+{
+	char path[] = "/tmp/bench_replay.XXXXXX";
+	struct GB_state gbs;
+	unsigned hours = 24, errors = 0, nbits = 0;
+	double t0;
+	int fd;
+
+	if (argc == 2) {
+		hours = (unsigned)atoi(argv[1]);
+	}
+	if (hours == 0) {
+		printf("usage: %s [hours]\n", argv[0]);
+		return EX_USAGE;
+	}
+	fd = mkstemp(path);
+	if (fd == -1) {
+		perror("mkstemp");
+		return EX_SOFTWARE;
+	}
+	(void)close(fd);
+	if (write_capture(path, hours * 60) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+
+	init_input_state(&gbs);
+	if (set_mode_replay_r(&gbs, path) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+	t0 = cpu_time();
+	for (;;) {
+		struct GB_result bit;
+
+		bit = get_bit_live_r(&gbs);
+		if (bit.done) {
+			break;
+		}
+		if (nbits >= 59 && (bit.bad_io ||
+		    bit.bitval != (bitval(nbits / 59, nbits % 59) == 0 ?
+		    ebv_0 : ebv_1))) {
+			errors++;
+		}
+		nbits++;
+		(void)next_bit_r(&gbs);
+	}
+	t0 = cpu_time() - t0;
+	cleanup_r(&gbs);
+	(void)unlink(path);
+
+	printf("%u h replayed in %.2f s CPU, %.0fx real time, %u of %u bits "
+	    "wrong\n", hours, t0, hours * 3600 / t0, errors, nbits);
+	/* the last bit ends with the capture */
+	return nbits == hours * 60 * 59 - 1 && errors < hours * 60 ? EX_OK :
+	    EX_SOFTWARE;
+}
@@ -0,0 +1,524 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "binlog.h"
+#include "calendar.h"
+#include "decode_alarm.h"
+#include "decode_time.h"
+#include "edge.h"
+#include "input.h"
+#include "mainloop.h"
+#include "synth.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Measure the hot paths with fixed inputs and write one JSON object per line,
+ * so that runs on the same hardware can be compared. Each value is the best
+ * of several runs, in operations per CPU second.
+ */
+
+/* samples per live decoder measurement */
+#define NSAMPLES 10000000LL
+/* minutes in the log files */
+#define LOGMINUTES 20000
+/* minutes for decode_time() and calls of the calendar functions */
+#define NDECODE 100000
+#define NCALENDAR 2000000
+
+struct result {
+	char name[64];
+	const char *unit;
+	double value;
+};
+
+static struct result results[32];
+static unsigned nresults;
+static int runs = 3;
+
+static double
+cpu_time(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_sec + tp.tv_nsec / 1e9;
+}
+
+static void
+add_result(const char * const name, const char * const unit, double value)
+{
+	if (nresults < sizeof(results) / sizeof(results[0])) {
+		(void)snprintf(results[nresults].name,
+		    sizeof(results[nresults].name), "%s", name);
+		results[nresults].unit = unit;
+		results[nresults].value = value;
+		nresults++;
+	}
+}
+
+static void
+set_start(struct synth_config * const cfg, unsigned long minutes)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->start.tm_year = 2026;
+	cfg->start.tm_mon = 3;
+	cfg->start.tm_mday = 28;
+	cfg->minutes = minutes;
+	cfg->seed = 1;
+	cfg->thirdparty = true;
+}
+
+struct live {
+	struct synth s;
+	long long last;
+};
+
+static int
+live_edge(void *arg, struct edge *e)
+{
+	struct live *l = arg;
+	int res;
+
+	res = synth_edge(&l->s, e);
+	if (res == 0) {
+		l->last = e->t;
+	}
+	return res;
+}
+
+/* Samples per CPU second through get_bit_live() */
+static double
+run_live(unsigned freq, enum eGB_filter filter)
+{
+	static struct live l;
+	struct synth_config cfg;
+	struct GB_state gbs;
+	double t;
+
+	set_start(&cfg, NSAMPLES / freq / 60 + 1);
+	(void)synth_init(&l.s, &cfg);
+	l.last = 0;
+	init_input_state(&gbs);
+	if (set_mode_synthetic_r(&gbs, freq, false, live_edge, &l) != 0) {
+		exit(EX_SOFTWARE);
+	}
+	set_filter_r(&gbs, filter);
+
+	t = cpu_time();
+	while (!get_bit_live_r(&gbs).bad_io) {
+		(void)next_bit_r(&gbs);
+	}
+	t = cpu_time() - t;
+	cleanup_r(&gbs);
+	return (double)l.last / 1e9 * freq / t;
+}
+
+static void
+bench_live(void)
+{
+	const unsigned freq[] = { 1000, 10000, 155000 };
+	const struct {
+		enum eGB_filter filter;
+		const char *name;
+	} filter[] = {
+		{ efilter_samples, "samples" },
+		{ efilter_timestamps, "timestamps" }
+	};
+
+	for (unsigned i = 0; i < sizeof(freq) / sizeof(freq[0]); i++) {
+		for (unsigned j = 0; j < sizeof(filter) / sizeof(filter[0]);
+		    j++) {
+			char name[64];
+			double best = 0;
+
+			for (int r = 0; r < runs; r++) {
+				best = fmax(best, run_live(freq[i],
+				    filter[j].filter));
+			}
+			(void)snprintf(name, sizeof(name),
+			    "get_bit_live/%s/%u", filter[j].name, freq[i]);
+			add_result(name, "samples/s", best);
+		}
+	}
+}
+
+static int nminutes;
+
+static void
+no_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+}
+
+static void
+no_output(struct ML_state *mls)
+{
+}
+
+static void
+no_minute(struct ML_state *mls, int minlen)
+{
+}
+
+static void
+no_alarm(struct ML_state *mls, struct alm alarm)
+{
+}
+
+static void
+count_time(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	nminutes++;
+}
+
+static void
+no_thirdparty_buffer(struct ML_state *mls, const unsigned tpbuf[])
+{
+}
+
+static const struct ML_callbacks cb = {
+	get_bit_file_r, no_bit, no_output, no_minute, no_alarm, no_output,
+	no_output, count_time, no_thirdparty_buffer
+};
+
+/* CPU time to decode the log file using the main loop without output */
+static double
+run_mainloop(const char * const path)
+{
+	struct ML_state mls;
+	double t;
+
+	nminutes = 0;
+	init_mainloop_state(&mls, stdout);
+	if (set_mode_file_r(&mls.gbs, path) != 0) {
+		exit(EX_SOFTWARE);
+	}
+	t = cpu_time();
+	while (!mainloop_step_r(&mls, &cb)) {
+		/* decode until the end */
+	}
+	t = cpu_time() - t;
+	cleanup_r(&mls.gbs);
+	return t;
+}
+
+static double
+child_time(void)
+{
+	struct rusage ru;
+
+	(void)getrusage(RUSAGE_CHILDREN, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+	    (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+/* CPU time of dcf77pi-analyze for the log file, or -1 if it failed */
+static double
+run_analyze(const char * const analyze, const char * const path)
+{
+	double t;
+	pid_t pid;
+	int status;
+
+	t = child_time();
+	pid = fork();
+	if (pid == -1) {
+		return -1;
+	}
+	if (pid == 0) {
+		if (freopen("/dev/null", "w", stdout) == NULL) {
+			_exit(EX_OSERR);
+		}
+		(void)execl(analyze, analyze, path, (char *)NULL);
+		_exit(EX_UNAVAILABLE);
+	}
+	if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != 0) {
+		return -1;
+	}
+	return child_time() - t;
+}
+
+/* Write a text log file of noisy minutes, return its size or -1 */
+static long
+write_log(const char * const path)
+{
+	struct synth_config cfg;
+	struct synth s;
+	char line[128];
+	long size;
+	FILE *f;
+
+	set_start(&cfg, LOGMINUTES);
+	cfg.noise.flip = 0.0005;
+	cfg.noise.dropout = 0.0002;
+	cfg.noise.dropout_len = 20;
+	cfg.noise.burst = 0.0002;
+	cfg.noise.burst_len = 5;
+	cfg.noise.jitter = 5000;
+	(void)synth_init(&s, &cfg);
+	f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	fputs("\n--new log--\n\n", f);
+	do {
+		fwrite(line, 1, synth_log_line(&s, line, sizeof(line)), f);
+	} while (synth_next(&s));
+	size = ftell(f);
+	if (fclose(f) == EOF) {
+		perror(path);
+		return -1;
+	}
+	return size;
+}
+
+static void
+bench_logfile(const char * const analyze)
+{
+	char path[2][32] = { "/tmp/bench_suite.XXXXXX",
+	    "/tmp/bench_suite.XXXXXX" };
+	const char * const format[2] = { "text", "binary" };
+	long size[2];
+	struct stat st;
+
+	for (int i = 0; i < 2; i++) {
+		int fd = mkstemp(path[i]);
+
+		if (fd == -1) {
+			perror("mkstemp");
+			exit(EX_SOFTWARE);
+		}
+		(void)close(fd);
+	}
+	size[0] = write_log(path[0]);
+	if (size[0] == -1 || convert_logfile(path[0], path[1]) != 0 ||
+	    stat(path[1], &st) == -1) {
+		(void)unlink(path[0]);
+		(void)unlink(path[1]);
+		exit(EX_SOFTWARE);
+	}
+	size[1] = (long)st.st_size;
+
+	for (int i = 0; i < 2; i++) {
+		char name[64];
+		double t = INFINITY, ta = INFINITY;
+
+		for (int r = 0; r < runs; r++) {
+			t = fmin(t, run_mainloop(path[i]));
+		}
+		(void)snprintf(name, sizeof(name), "mainloop/%s/bytes",
+		    format[i]);
+		add_result(name, "bytes/s", size[i] / t);
+		(void)snprintf(name, sizeof(name), "mainloop/%s/minutes",
+		    format[i]);
+		add_result(name, "minutes/s", nminutes / t);
+
+		if (analyze == NULL) {
+			continue;
+		}
+		for (int r = 0; r < runs && ta > 0; r++) {
+			double tr = run_analyze(analyze, path[i]);
+
+			ta = tr < 0 ? -1 : fmin(ta, tr);
+		}
+		if (ta <= 0) {
+			fprintf(stderr, "%s failed, skipped\n", analyze);
+			continue;
+		}
+		(void)snprintf(name, sizeof(name), "analyze/%s/bytes",
+		    format[i]);
+		add_result(name, "bytes/s", size[i] / ta);
+		(void)snprintf(name, sizeof(name), "analyze/%s/minutes",
+		    format[i]);
+		add_result(name, "minutes/s", nminutes / ta);
+	}
+	(void)unlink(path[0]);
+	(void)unlink(path[1]);
+}
+
+/* Calls per CPU second of decode_time() on consecutive minutes */
+static void
+bench_decode_time(void)
+{
+	static int bits[NDECODE][60];
+	static int minlen[NDECODE];
+	struct synth_config cfg;
+	struct synth s;
+	double best = INFINITY;
+
+	set_start(&cfg, NDECODE);
+	(void)synth_init(&s, &cfg);
+	for (int m = 0; m < NDECODE; m++) {
+		memcpy(bits[m], s.bits, sizeof(bits[m]));
+		minlen[m] = s.minlen;
+		(void)synth_next(&s);
+	}
+	for (int r = 0; r < runs; r++) {
+		struct DT_state dts;
+		struct tm time;
+		double t;
+
+		memset(&time, 0, sizeof(time));
+		init_time_state(&dts);
+		t = cpu_time();
+		for (int m = 0; m < NDECODE; m++) {
+			(void)decode_time_r(&dts, m < 2 ? 2 - m : 0,
+			    minlen[m], (unsigned)(minlen[m] + 1) * 1000,
+			    bits[m], &time);
+		}
+		best = fmin(best, cpu_time() - t);
+	}
+	add_result("decode_time", "calls/s", NDECODE / best);
+}
+
+/* Calls per CPU second of the calendar functions */
+static void
+bench_calendar(void)
+{
+	static struct tm times[1000];
+	struct synth_config cfg;
+	struct synth s;
+	double best[3] = { INFINITY, INFINITY, INFINITY };
+	long sum = 0;
+
+	/* times spread over more than a year, with summer time */
+	set_start(&cfg, 0);
+	(void)synth_init(&s, &cfg);
+	for (int i = 0; i < 1000; i++) {
+		times[i] = s.time;
+		for (int j = 0; j < 600; j++) {
+			(void)synth_next(&s);
+		}
+	}
+	for (int r = 0; r < runs; r++) {
+		struct tm time = times[0];
+		double t;
+
+		t = cpu_time();
+		for (int i = 0; i < NCALENDAR; i++) {
+			time = add_minute(time, false);
+		}
+		best[0] = fmin(best[0], cpu_time() - t);
+		sum += time.tm_min;
+
+		t = cpu_time();
+		for (int i = 0; i < NCALENDAR; i++) {
+			sum += get_utctime(times[i % 1000]).tm_hour;
+		}
+		best[1] = fmin(best[1], cpu_time() - t);
+
+		t = cpu_time();
+		for (int i = 0; i < NCALENDAR; i++) {
+			time = times[i % 1000];
+			time.tm_year %= 100;
+			sum += century_offset(time);
+		}
+		best[2] = fmin(best[2], cpu_time() - t);
+	}
+	/* keep the results alive */
+	if (sum == 42) {
+		fprintf(stderr, "%li\n", sum);
+	}
+	add_result("add_minute", "calls/s", NCALENDAR / best[0]);
+	add_result("get_utctime", "calls/s", NCALENDAR / best[1]);
+	add_result("century_offset", "calls/s", NCALENDAR / best[2]);
+}
+
+/* The value of the named result in a file written earlier, or -1 */
+static double
+baseline_value(FILE *f, const char * const name)
+{
+	char line[256], key[80];
+	double value = -1;
+
+	rewind(f);
+	(void)snprintf(key, sizeof(key), "\"name\":\"%s\"", name);
+	while (fgets(line, sizeof(line), f) != NULL) {
+		const char *v = strstr(line, "\"value\":");
+
+		if (strstr(line, key) != NULL && v != NULL &&
+		    sscanf(v, "\"value\":%lf", &value) == 1) {
+			break;
+		}
+	}
+	return value;
+}
+
+static void
+usage(const char * const progname)
+{
+	printf("usage: %s [-a analyze] [-c baseline] [-n runs]\n", progname);
+}
+
+/*
+ * Run all benchmarks. With -a, also run the given dcf77pi-analyze binary on
+ * the log files. With -c, add the ratio to the values in an earlier output.
+ */
+int
+main(int argc, char *argv[])
+{
+	const char *analyze = NULL;
+	FILE *baseline = NULL;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "a:c:n:")) != -1) {
+		switch (ch) {
+		case 'a':
+			analyze = optarg;
+			break;
+		case 'c':
+			baseline = fopen(optarg, "r");
+			if (baseline == NULL) {
+				perror(optarg);
+				return EX_NOINPUT;
+			}
+			break;
+		case 'n':
+			runs = atoi(optarg);
+			if (runs < 1) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return EX_USAGE;
+		}
+	}
+
+	bench_live();
+	bench_logfile(analyze);
+	bench_decode_time();
+	bench_calendar();
+
+	for (unsigned i = 0; i < nresults; i++) {
+		printf("{\"name\":\"%s\",\"unit\":\"%s\",\"value\":%.6g",
+		    results[i].name, results[i].unit, results[i].value);
+		if (baseline != NULL) {
+			double b = baseline_value(baseline, results[i].name);
+
+			if (b > 0) {
+				printf(",\"baseline\":%.6g,\"ratio\":%.4f", b,
+				    results[i].value / b);
+			}
+		}
+		printf("}\n");
+	}
+	if (baseline != NULL) {
+		(void)fclose(baseline);
+	}
+	return EX_OK;
+}
@@ -0,0 +1,628 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "binlog.h"
+
+#include "input.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* the usual values, which are stored as the difference to these */
+#define ACC_MINLEN_BASE 60000
+#define CUTOFF_BASE 20000
+
+/* an escape code followed by the token - ebl_restart */
+#define ESCAPE 0x1f
+
+/* room for the longest token and a sync frame */
+#define TOKEN_ROOM 32
+
+static const char restart_line[] = "--new log--";
+
+/* Codes and their lengths in bits of the tokens up to ebl_bitlen_reset */
+static const struct {
+	unsigned code, len;
+} codes[ebl_restart] = {
+	[ebl_0] = { 0x0, 2 }, [ebl_1] = { 0x1, 2 },
+	[ebl_none] = { 0x8, 4 }, [ebl_transmit] = { 0x9, 4 },
+	[ebl_receive] = { 0xa, 4 }, [ebl_random] = { 0xb, 4 },
+	[ebl_eom] = { 0x18, 5 }, [ebl_acc_minlen] = { 0x19, 5 },
+	[ebl_cutoff] = { 0x1a, 5 }, [ebl_bad_io] = { 0x1b, 5 },
+	[ebl_freq_low] = { 0x1c, 5 }, [ebl_freq_high] = { 0x1d, 5 },
+	[ebl_bitlen_reset] = { 0x1e, 5 }
+};
+
+/* Tokens of the 5-bit codes 11000 to 11110 */
+static const enum eBL_token long_tokens[7] = {
+	ebl_eom, ebl_acc_minlen, ebl_cutoff, ebl_bad_io, ebl_freq_low,
+	ebl_freq_high, ebl_bitlen_reset
+};
+
+uint32_t
+binlog_version(const unsigned char * const data, size_t size)
+{
+	struct binlog_file hdr;
+
+	if (size < sizeof(hdr)) {
+		return 0;
+	}
+	memcpy(&hdr, data, sizeof(hdr));
+	if (memcmp(hdr.magic, BINLOG_MAGIC, sizeof(hdr.magic)) != 0) {
+		return 0;
+	}
+	return hdr.version;
+}
+
+/* Read n <= 24 bits, the bits beyond the end of the file are 0 */
+static unsigned
+peek_bits(const unsigned char * const data, size_t size,
+    unsigned long long pos, unsigned n)
+{
+	size_t byte = (size_t)(pos / 8);
+	unsigned long v = 0;
+
+	if (byte + 4 <= size) {
+		v = (unsigned long)data[byte] << 24 |
+		    (unsigned long)data[byte + 1] << 16 |
+		    (unsigned long)data[byte + 2] << 8 | data[byte + 3];
+	} else {
+		for (size_t i = byte; i < byte + 4; i++) {
+			v = v << 8 | (i < size ? data[i] : 0);
+		}
+	}
+	return (unsigned)(v >> (32 - pos % 8 - n)) & ((1U << n) - 1);
+}
+
+/* Read a varint, returns false if it is incomplete or too long */
+static bool
+read_varint(const unsigned char * const data, size_t size,
+    unsigned long long *pos, long long *val)
+{
+	unsigned long long zz = 0;
+	unsigned group;
+
+	for (unsigned shift = 0; shift < 64; shift += 4) {
+		if (*pos + 5 > size * 8ULL) {
+			return false;
+		}
+		group = peek_bits(data, size, *pos, 5);
+		*pos += 5;
+		zz |= (unsigned long long)(group & 0xf) << shift;
+		if ((group & 0x10) == 0) {
+			*val = (long long)(zz >> 1) ^ -(long long)(zz & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+binlog_read_token(const unsigned char * const data, size_t size,
+    unsigned long long *pos, struct binlog_token * const tok)
+{
+	const unsigned long long end = size * 8ULL;
+	unsigned long long p = *pos;
+	unsigned code, len;
+
+	tok->value = 0;
+	tok->ok = true;
+	if (p >= end) {
+		tok->type = ebl_eof;
+		return;
+	}
+	code = peek_bits(data, size, p, 9);
+	if (code >> 8 == 0) {
+		tok->type = code >> 7 == 0 ? ebl_0 : ebl_1;
+		len = 2;
+	} else if (code >> 7 == 2) {
+		tok->type = ebl_none + (code >> 5 & 3);
+		len = 4;
+	} else if (code >> 4 != ESCAPE) {
+		tok->type = long_tokens[code >> 4 & 7];
+		len = 5;
+	} else {
+		if ((code & 0xf) > ebl_align - ebl_restart) {
+			tok->type = ebl_error;
+			return;
+		}
+		tok->type = ebl_restart + (code & 0xf);
+		len = 9;
+	}
+	if (p + len > end) {
+		tok->type = ebl_eof;
+		return;
+	}
+	p += len;
+
+	switch (tok->type) {
+	case ebl_acc_minlen:
+	case ebl_cutoff:
+		if (!read_varint(data, size, &p, &tok->value)) {
+			tok->type = ebl_eof;
+			return;
+		}
+		tok->value += tok->type == ebl_acc_minlen ? ACC_MINLEN_BASE :
+		    CUTOFF_BASE;
+		break;
+	case ebl_literal:
+		if (p + 8 > end) {
+			tok->type = ebl_eof;
+			return;
+		}
+		tok->value = peek_bits(data, size, p, 8);
+		p += 8;
+		break;
+	case ebl_raw_acc_minlen:
+	case ebl_raw_cutoff:
+		if (p + 1 > end) {
+			tok->type = ebl_eof;
+			return;
+		}
+		tok->ok = peek_bits(data, size, p, 1) == 1;
+		p++;
+		if (!read_varint(data, size, &p, &tok->value)) {
+			tok->type = ebl_eof;
+			return;
+		}
+		break;
+	case ebl_eom:
+	case ebl_align:
+		p = (p + 7) / 8 * 8;
+		break;
+	case ebl_sync:
+		p = (p + 7) / 8 * 8;
+		if (p + 32 > end) {
+			tok->type = ebl_eof;
+			return;
+		}
+		if (memcmp(data + p / 8, BINLOG_SYNC, 4) != 0) {
+			tok->type = ebl_error;
+			return;
+		}
+		p += 32;
+		break;
+	default:
+		break;
+	}
+	*pos = p;
+}
+
+size_t
+binlog_find_sync(const unsigned char * const data, size_t size, size_t from)
+{
+	for (size_t i = from; i + 4 <= size; i++) {
+		if (data[i] == (unsigned char)BINLOG_SYNC[0] &&
+		    memcmp(data + i, BINLOG_SYNC, 4) == 0) {
+			return i + 4;
+		}
+	}
+	return size;
+}
+
+static void
+put_bits(struct binlog_writer * const w, unsigned val, unsigned n)
+{
+	w->bits = w->bits << n | val;
+	w->nbits += n;
+	while (w->nbits >= 8) {
+		w->nbits -= 8;
+		w->buf[w->len++] = (unsigned char)(w->bits >> w->nbits);
+	}
+	w->bits &= (1U << w->nbits) - 1;
+}
+
+static void
+put_varint(struct binlog_writer * const w, long long val)
+{
+	unsigned long long zz = (unsigned long long)val << 1 ^
+	    (unsigned long long)-(val < 0);
+
+	do {
+		unsigned group = (unsigned)(zz & 0xf);
+
+		zz >>= 4;
+		put_bits(w, group | (zz != 0 ? 0x10 : 0), 5);
+	} while (zz != 0);
+}
+
+static void
+put_token(struct binlog_writer * const w, enum eBL_token type)
+{
+	if (type < ebl_restart) {
+		put_bits(w, codes[type].code, codes[type].len);
+	} else {
+		put_bits(w, ESCAPE << 4 | (type - ebl_restart), 9);
+	}
+}
+
+static void
+pad_to_byte(struct binlog_writer * const w)
+{
+	if (w->nbits > 0) {
+		put_bits(w, 0, 8 - w->nbits);
+	}
+}
+
+/* Write the buffer, which must end at a byte */
+static int
+flush_buffer(struct binlog_writer * const w)
+{
+	size_t len = w->len;
+
+	w->len = 0;
+	if (len > 0 && fwrite(w->buf, 1, len, w->file) != len) {
+		return errno != 0 ? errno : EIO;
+	}
+	return 0;
+}
+
+/* Keep room for the next token, padding the stream if needed */
+static int
+make_room(struct binlog_writer * const w)
+{
+	if (w->len <= BINLOG_BUFLEN - TOKEN_ROOM) {
+		return 0;
+	}
+	put_token(w, ebl_align);
+	pad_to_byte(w);
+	return flush_buffer(w);
+}
+
+static int
+put_literal(struct binlog_writer * const w, unsigned char ch)
+{
+	put_token(w, ebl_literal);
+	put_bits(w, ch, 8);
+	return make_room(w);
+}
+
+int
+binlog_open_writer(struct binlog_writer * const w, FILE *file)
+{
+	struct binlog_file hdr;
+	struct stat st;
+
+	memset(w, 0, sizeof(*w));
+	w->file = file;
+	if (fstat(fileno(file), &st) == -1) {
+		return errno;
+	}
+	if (st.st_size > 0) {
+		return 0;
+	}
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BINLOG_MAGIC, sizeof(hdr.magic));
+	hdr.version = BINLOG_VERSION;
+	return fwrite(&hdr, sizeof(hdr), 1, file) == 1 ? 0 : EIO;
+}
+
+/*
+ * Write the value after 'a', like get_bit_file_r() reads it. Unusual text is
+ * kept as literals after the value which was read from it.
+ */
+static int
+put_acc_minlen(struct binlog_writer * const w, struct logmap * const lm)
+{
+	const size_t start = lm->pos;
+	char usual[11];
+	unsigned val = 0;
+	bool ok;
+	int res = 0;
+
+	ok = scan_logmap_uint(lm, &val);
+	if (ok && lm->pos - start < sizeof(usual) &&
+	    (size_t)snprintf(usual, sizeof(usual), "%u", val) ==
+	    lm->pos - start &&
+	    memcmp(usual, lm->data + start, lm->pos - start) == 0) {
+		put_token(w, ebl_acc_minlen);
+		put_varint(w, (long long)val - ACC_MINLEN_BASE);
+		return 0;
+	}
+	put_token(w, ebl_raw_acc_minlen);
+	put_bits(w, ok ? 1 : 0, 1);
+	put_varint(w, ok ? val : 0);
+	for (size_t i = start; i < lm->pos && res == 0; i++) {
+		res = put_literal(w, lm->data[i]);
+	}
+	return res;
+}
+
+/* Write the 6 characters after 'c', like put_acc_minlen() */
+static int
+put_cutoff(struct binlog_writer * const w, struct logmap * const lm)
+{
+	const unsigned char * const co = lm->data + lm->pos;
+	char raw[7];
+	size_t n;
+	bool usual;
+	int res = 0;
+
+	n = lm->size - lm->pos < 6 ? lm->size - lm->pos : 6;
+	usual = n == 6 && co[1] == '.';
+	for (size_t i = 0; usual && i < 6; i++) {
+		usual = i == 1 || (co[i] >= '0' && co[i] <= '9');
+	}
+	lm->pos += n;
+	if (usual) {
+		put_token(w, ebl_cutoff);
+		put_varint(w, (co[0] - '0') * 10000 + (co[2] - '0') * 1000 +
+		    (co[3] - '0') * 100 + (co[4] - '0') * 10 + (co[5] - '0') -
+		    CUTOFF_BASE);
+		return 0;
+	}
+	/* the same as get_bit_file_r() */
+	memset(raw, 0, sizeof(raw));
+	memcpy(raw, co, n);
+	put_token(w, ebl_raw_cutoff);
+	if (n > 0 && raw[1] == '.') {
+		put_bits(w, 1, 1);
+		put_varint(w, (raw[0] - '0') * 10000 +
+		    (int)strtol(raw + 2, NULL, 10));
+	} else {
+		put_bits(w, 0, 1);
+		put_varint(w, n > 0 ? 1 : 0);
+	}
+	for (size_t i = 0; i < n && res == 0; i++) {
+		res = put_literal(w, co[i]);
+	}
+	return res;
+}
+
+int
+binlog_write_text(struct binlog_writer * const w,
+    const unsigned char * const text, size_t len)
+{
+	const size_t restart_len = sizeof(restart_line) - 1;
+	struct logmap lm;
+	int res = 0;
+
+	lm.data = text;
+	lm.size = len;
+	lm.pos = 0;
+	while (lm.pos < len && res == 0) {
+		const unsigned char ch = text[lm.pos++];
+
+		switch (ch) {
+		case '0':
+			put_token(w, ebl_0);
+			break;
+		case '1':
+			put_token(w, ebl_1);
+			break;
+		case '_':
+			put_token(w, ebl_none);
+			break;
+		case 'x':
+			put_token(w, ebl_transmit);
+			break;
+		case 'r':
+			put_token(w, ebl_receive);
+			break;
+		case '#':
+			put_token(w, ebl_random);
+			break;
+		case '*':
+			put_token(w, ebl_bad_io);
+			break;
+		case '<':
+			put_token(w, ebl_freq_low);
+			break;
+		case '>':
+			put_token(w, ebl_freq_high);
+			break;
+		case '!':
+			put_token(w, ebl_bitlen_reset);
+			break;
+		case '\0':
+			put_token(w, ebl_nul);
+			break;
+		case 'a':
+			res = put_acc_minlen(w, &lm);
+			break;
+		case 'c':
+			res = put_cutoff(w, &lm);
+			break;
+		case '\n':
+			put_token(w, ebl_eom);
+			pad_to_byte(w);
+			if (++w->minutes == BINLOG_SYNC_MINUTES) {
+				put_token(w, ebl_sync);
+				pad_to_byte(w);
+				memcpy(w->buf + w->len, BINLOG_SYNC, 4);
+				w->len += 4;
+				w->minutes = 0;
+			}
+			res = flush_buffer(w);
+			break;
+		case '\r':
+			if (lm.pos == len || text[lm.pos] != '\n') {
+				put_token(w, ebl_cr);
+				break;
+			}
+			res = put_literal(w, ch);
+			break;
+		case '-':
+			if (len - lm.pos >= restart_len - 1 &&
+			    memcmp(text + lm.pos, restart_line + 1,
+			    restart_len - 1) == 0) {
+				put_token(w, ebl_restart);
+				lm.pos += restart_len - 1;
+				break;
+			}
+			/* FALLTHROUGH */
+		default:
+			res = put_literal(w, ch);
+			break;
+		}
+		if (res == 0) {
+			/* there might be no end of minute for a long time */
+			res = make_room(w);
+		}
+	}
+	return res;
+}
+
+int
+binlog_close_writer(struct binlog_writer * const w)
+{
+	if (w->nbits > 0) {
+		put_token(w, ebl_align);
+		pad_to_byte(w);
+	}
+	return flush_buffer(w);
+}
+
+int
+binlog_to_text(const unsigned char * const data, size_t size, FILE *out)
+{
+	unsigned long long pos = sizeof(struct binlog_file) * 8ULL;
+	struct binlog_token tok;
+
+	for (;;) {
+		binlog_read_token(data, size, &pos, &tok);
+		switch (tok.type) {
+		case ebl_0:
+			(void)putc('0', out);
+			break;
+		case ebl_1:
+			(void)putc('1', out);
+			break;
+		case ebl_none:
+			(void)putc('_', out);
+			break;
+		case ebl_transmit:
+			(void)putc('x', out);
+			break;
+		case ebl_receive:
+			(void)putc('r', out);
+			break;
+		case ebl_random:
+			(void)putc('#', out);
+			break;
+		case ebl_bad_io:
+			(void)putc('*', out);
+			break;
+		case ebl_eom:
+			(void)putc('\n', out);
+			break;
+		case ebl_acc_minlen:
+			fprintf(out, "a%u", (unsigned)tok.value);
+			break;
+		case ebl_cutoff:
+			fprintf(out, "c%u.%04u", (unsigned)tok.value / 10000,
+			    (unsigned)tok.value % 10000);
+			break;
+		case ebl_freq_low:
+			(void)putc('<', out);
+			break;
+		case ebl_freq_high:
+			(void)putc('>', out);
+			break;
+		case ebl_bitlen_reset:
+			(void)putc('!', out);
+			break;
+		case ebl_restart:
+			fputs(restart_line, out);
+			break;
+		case ebl_literal:
+			(void)putc((int)tok.value, out);
+			break;
+		case ebl_raw_acc_minlen:
+			(void)putc('a', out);
+			break;
+		case ebl_raw_cutoff:
+			(void)putc('c', out);
+			break;
+		case ebl_nul:
+			(void)putc('\0', out);
+			break;
+		case ebl_cr:
+			(void)putc('\r', out);
+			break;
+		case ebl_sync:
+		case ebl_align:
+			break;
+		case ebl_eof:
+			return ferror(out) ? EIO : 0;
+		case ebl_error:
+			fprintf(stderr, "Invalid token at bit %llu\n", pos);
+			return EINVAL;
+		}
+	}
+}
+
+int
+convert_logfile(const char * const infilename,
+    const char * const outfilename)
+{
+	const unsigned char *data = NULL;
+	struct binlog_writer w;
+	struct stat st;
+	uint32_t version;
+	FILE *out;
+	int fd, res;
+
+	fd = open(infilename, O_RDONLY);
+	if (fd == -1) {
+		res = errno;
+		perror("open(logfile)");
+		return res;
+	}
+	if (fstat(fd, &st) == -1) {
+		res = errno;
+		(void)close(fd);
+		return res;
+	}
+	if (st.st_size > 0) {
+		void *map = mmap(NULL, (size_t)st.st_size, PROT_READ,
+		    MAP_PRIVATE, fd, 0);
+
+		if (map == MAP_FAILED) {
+			res = errno;
+			perror("mmap(logfile)");
+			(void)close(fd);
+			return res;
+		}
+		data = map;
+		(void)posix_madvise(map, (size_t)st.st_size,
+		    POSIX_MADV_SEQUENTIAL);
+	}
+	(void)close(fd);
+
+	out = fopen(outfilename, "w");
+	if (out == NULL) {
+		res = errno;
+		perror("fopen(outfile)");
+	} else {
+		version = binlog_version(data, (size_t)st.st_size);
+		if (version == BINLOG_VERSION) {
+			res = binlog_to_text(data, (size_t)st.st_size, out);
+		} else if (version != 0) {
+			fprintf(stderr, "Unsupported binary log version %u\n",
+			    version);
+			res = EINVAL;
+		} else {
+			res = binlog_open_writer(&w, out);
+			if (res == 0) {
+				res = binlog_write_text(&w, data,
+				    (size_t)st.st_size);
+			}
+			if (res == 0) {
+				res = binlog_close_writer(&w);
+			}
+		}
+		if (fclose(out) == EOF && res == 0) {
+			res = errno;
+		}
+	}
+	if (data != NULL) {
+		(void)munmap((void *)data, (size_t)st.st_size);
+	}
+	return res;
+}
@@ -0,0 +1,235 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_BINLOG_H
+#define DCF77PI_BINLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Magic bytes at the start of a binary log file */
+#define BINLOG_MAGIC "DCF77BIN"
+
+/** Version of the binary log file format */
+#define BINLOG_VERSION 1
+
+/** Bytes following a sync token, after padding to the next byte */
+#define BINLOG_SYNC "\xdc\xf7\x77\x5a"
+
+/** Number of minute markers between two sync frames */
+#define BINLOG_SYNC_MINUTES 60
+
+/** Size of the buffer of a writer, a minute normally takes about 20 bytes */
+#define BINLOG_BUFLEN 256
+
+/**
+ * Header of a binary log file, followed by a stream of tokens. The tokens
+ * are prefix codes of which the most significant bit is stored first:
+ *
+ * - 00 '0', 01 '1'
+ * - 1000 '_', 1001 'x', 1010 'r', 1011 '#'
+ * - 11000 end of minute ('\\n'), after which the stream is padded with 0 bits
+ *   to the next byte
+ * - 11001 'a' followed by acc_minlen - 60000 as varint
+ * - 11010 'c' followed by the cutoff (d.dddd as number) - 20000 as varint
+ * - 11011 '*', 11100 '<', 11101 '>', 11110 '!'
+ * - 11111 followed by 4 bits for the less common tokens of
+ *   {@link eBL_token}, starting at {@link eBL_token.ebl_restart}
+ *
+ * Varints are signed numbers in zigzag encoding, stored in groups of 5 bits
+ * with the least significant group first. The highest bit of a group is set
+ * when another group follows.
+ *
+ * All fields are in host byte order.
+ */
+struct binlog_file {
+	/** {@link BINLOG_MAGIC}, without the terminating NUL */
+	char magic[8];
+	/** {@link BINLOG_VERSION} */
+	uint32_t version;
+	/** reserved, 0 */
+	uint32_t reserved;
+};
+
+/**
+ * Tokens of a binary log file. Each token stands for some text of the text
+ * log file, the less common ones keep the conversion lossless.
+ */
+enum eBL_token {
+	/** '0' */
+	ebl_0,
+	/** '1' */
+	ebl_1,
+	/** '_' */
+	ebl_none,
+	/** 'x' */
+	ebl_transmit,
+	/** 'r' */
+	ebl_receive,
+	/** '#' */
+	ebl_random,
+	/** end of minute, '\\n' */
+	ebl_eom,
+	/** "a%u" */
+	ebl_acc_minlen,
+	/** "c%u.%04u" */
+	ebl_cutoff,
+	/** '*' */
+	ebl_bad_io,
+	/** '<' */
+	ebl_freq_low,
+	/** '>' */
+	ebl_freq_high,
+	/** '!' */
+	ebl_bitlen_reset,
+	/** "--new log--", the first escaped token */
+	ebl_restart,
+	/** any other character which the log file parser skips */
+	ebl_literal,
+	/**
+	 * 'a' followed by literal tokens with the text which was read for the
+	 * value, when that is not in the usual format
+	 */
+	ebl_raw_acc_minlen,
+	/** 'c' followed by literal tokens, like {@link ebl_raw_acc_minlen} */
+	ebl_raw_cutoff,
+	/** NUL character */
+	ebl_nul,
+	/** '\\r' which is not followed by '\\n', which reads as '\\n' */
+	ebl_cr,
+	/** padding to the next byte followed by {@link BINLOG_SYNC} */
+	ebl_sync,
+	/** padding to the next byte */
+	ebl_align,
+	/** end of the file, or an incomplete token at the end */
+	ebl_eof,
+	/** invalid token */
+	ebl_error
+};
+
+/** A token read from a binary log file */
+struct binlog_token {
+	/** the type of the token */
+	enum eBL_token type;
+	/**
+	 * acc_minlen or cutoff value, or the character of
+	 * {@link eBL_token.ebl_literal}
+	 */
+	long long value;
+	/**
+	 * for raw tokens, a value was read, otherwise the parser stops (value
+	 * is 0) or keeps the previous cutoff (value is 1)
+	 */
+	bool ok;
+};
+
+/** Writer of a binary log file */
+struct binlog_writer {
+	/** the file to write to, NULL if not opened */
+	FILE *file;
+	/**
+	 * bytes which are not written yet, so that the file always ends at a
+	 * complete token
+	 */
+	unsigned char buf[BINLOG_BUFLEN];
+	/** number of bytes in {@link binlog_writer.buf} */
+	size_t len;
+	/** bits which do not fill a byte yet, in the lowest bits */
+	unsigned bits;
+	/** number of bits in {@link binlog_writer.bits} */
+	unsigned nbits;
+	/** end of minute tokens since the last sync frame */
+	unsigned minutes;
+};
+
+/**
+ * Check if a file starts with the header of a binary log file.
+ *
+ * @param data The start of the file.
+ * @param size The size of the file in bytes.
+ * @return The version of the binary log file, or 0 if it is not one.
+ */
+uint32_t binlog_version(const unsigned char * const data, size_t size);
+
+/**
+ * Read a token from a binary log file.
+ *
+ * @param data The contents of the file.
+ * @param size The size of the file in bytes.
+ * @param pos The offset of the token in bits from the start of the file,
+ * updated to the offset of the next token.
+ * @param tok The token which was read.
+ */
+void binlog_read_token(const unsigned char * const data, size_t size,
+    unsigned long long *pos, struct binlog_token * const tok);
+
+/**
+ * Find the next sync frame in a binary log file. The offset might be part of
+ * a token which happens to look like a sync frame.
+ *
+ * @param data The contents of the file.
+ * @param size The size of the file in bytes.
+ * @param from The offset in bytes to start searching at.
+ * @return The offset in bytes just after the sync frame, or size if there is
+ * none.
+ */
+size_t binlog_find_sync(const unsigned char * const data, size_t size,
+    size_t from);
+
+/**
+ * Prepare to append to a binary log file, writing the header if the file is
+ * empty.
+ *
+ * @param w The writer.
+ * @param file The file, opened for appending.
+ * @return Success (0), or errno on error.
+ */
+int binlog_open_writer(struct binlog_writer * const w, FILE *file);
+
+/**
+ * Append text in the format of the text log file. Writing stops at the end of
+ * the text, so the text should not end in the middle of an acc_minlen or
+ * cutoff value.
+ *
+ * @param w The writer.
+ * @param text The text.
+ * @param len The length of the text in bytes.
+ * @return Success (0), or errno on error.
+ */
+int binlog_write_text(struct binlog_writer * const w,
+    const unsigned char * const text, size_t len);
+
+/**
+ * Write the tokens which are still buffered, padding the file to the next
+ * byte. The file itself is left open.
+ *
+ * @param w The writer.
+ * @return Success (0), or errno on error.
+ */
+int binlog_close_writer(struct binlog_writer * const w);
+
+/**
+ * Write a binary log file as a text log file.
+ *
+ * @param data The contents of the binary log file.
+ * @param size The size of the binary log file in bytes.
+ * @param out The file to write the text to.
+ * @return Success (0), or errno on error.
+ */
+int binlog_to_text(const unsigned char * const data, size_t size, FILE *out);
+
+/**
+ * Convert a text log file to a binary log file or the other way around,
+ * depending on the format of the input file. Converting the result back
+ * gives the original file.
+ *
+ * @param infilename The name of the log file to convert.
+ * @param outfilename The name of the file to write, which is overwritten.
+ * @return Success (0), or errno on error.
+ */
+int convert_logfile(const char * const infilename,
+    const char * const outfilename);
+
+#endif
@@ -1,47 +1,55 @@
-// Copyright 2014-2018 René Ladan
+// Copyright 2014-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "bits1to14.h"
 
 #include "input.h"
 
-static unsigned tpbuf[TPBUFLEN];
-static enum eTP tptype = eTP_unknown;
+#include <string.h>
+
+/* Default state for the non-reentrant functions */
+static struct TP_state tps_global;
 
 void
-fill_thirdparty_buffer(int minute, int bitpos, struct GB_result bit)
+init_thirdparty_state(struct TP_state * const tps)
 {
-	static unsigned tpstat;
+	memset(tps, 0, sizeof(*tps));
+	tps->tptype = eTP_unknown;
+}
 
+void
+fill_thirdparty_buffer_r(struct TP_state * const tps, int minute, int bitpos,
+    struct GB_result bit)
+{
 	switch (minute % 3) {
 	case 0:
 		/* copy third party data */
 		if (bitpos > 1 && bitpos < 8) {
-			tpbuf[bitpos - 2] = bit.bitval == ebv_1 ? 1 : 0;
+			tps->tpbuf[bitpos - 2] = bit.bitval == ebv_1 ? 1 : 0;
 			/* 2..7 -> 0..5 */
 		}
 		if (bitpos > 8 && bitpos < 15) {
-			tpbuf[bitpos - 3] = bit.bitval == ebv_1 ? 1 : 0;
+			tps->tpbuf[bitpos - 3] = bit.bitval == ebv_1 ? 1 : 0;
 			/* 9..14 -> 6..11 */
 		}
 
 		/* copy third party type */
 		if (bitpos == 1) {
-			tpstat = bit.bitval == ebv_1 ? 2 : 0;
+			tps->tpstat = bit.bitval == ebv_1 ? 2 : 0;
 		}
 		if (bitpos == 8) {
 			if (bit.bitval == ebv_1) {
-				tpstat++;
+				tps->tpstat++;
 			}
-			switch (tpstat) {
+			switch (tps->tpstat) {
 			case 0:
-				tptype = eTP_weather;
+				tps->tptype = eTP_weather;
 				break;
 			case 3:
-				tptype = eTP_alarm;
+				tps->tptype = eTP_alarm;
 				break;
 			default:
-				tptype = eTP_unknown;
+				tps->tptype = eTP_unknown;
 				break;
 			}
 		}
@@ -49,28 +57,54 @@ fill_thirdparty_buffer(int minute, int bitpos, struct GB_result bit)
 	case 1:
 		/* copy third party data */
 		if (bitpos > 0 && bitpos < 15) {
-			tpbuf[bitpos + 11] = bit.bitval == ebv_1 ? 1 : 0;
+			tps->tpbuf[bitpos + 11] = bit.bitval == ebv_1 ? 1 : 0;
 			/* 1..14 -> 12..25 */
 		}
 		break;
 	case 2:
 		/* copy third party data */
 		if (bitpos > 0 && bitpos < 15) {
-			tpbuf[bitpos + 25] = bit.bitval == ebv_1 ? 1 : 0;
+			tps->tpbuf[bitpos + 25] = bit.bitval == ebv_1 ? 1 : 0;
 			/* 1..14 -> 26..39 */
 		}
 		break;
 	}
 }
 
+const unsigned * const
+get_thirdparty_buffer_r(struct TP_state * const tps)
+{
+	return tps->tpbuf;
+}
+
+enum eTP
+get_thirdparty_type_r(struct TP_state * const tps)
+{
+	return tps->tptype;
+}
+
+bool
+equal_thirdparty_state(const struct TP_state * const a,
+    const struct TP_state * const b)
+{
+	return memcmp(a->tpbuf, b->tpbuf, sizeof(a->tpbuf)) == 0 &&
+	    a->tptype == b->tptype && a->tpstat == b->tpstat;
+}
+
+void
+fill_thirdparty_buffer(int minute, int bitpos, struct GB_result bit)
+{
+	fill_thirdparty_buffer_r(&tps_global, minute, bitpos, bit);
+}
+
 const unsigned * const
 get_thirdparty_buffer(void)
 {
-	return tpbuf;
+	return get_thirdparty_buffer_r(&tps_global);
 }
 
 enum eTP
 get_thirdparty_type(void)
 {
-	return tptype;
+	return get_thirdparty_type_r(&tps_global);
 }
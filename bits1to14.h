@@ -1,9 +1,11 @@
-// Copyright 2014-2018 René Ladan
+// Copyright 2014-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #ifndef DCF77PI_BITS1TO14_H
 #define DCF77PI_BITS1TO14_H
 
+#include <stdbool.h>
+
 /** Length of the third-party buffer in bits */
 #define TPBUFLEN 40
 
@@ -19,6 +21,28 @@ enum eTP {
 	eTP_alarm
 };
 
+/**
+ * State of the third party buffer, to be used with the reentrant (_r)
+ * functions. The fields should be considered private to bits1to14.c , the
+ * functions without the _r suffix use a single global instance.
+ */
+struct TP_state {
+	/** the third party buffer */
+	unsigned tpbuf[TPBUFLEN];
+	/** type of the third party contents */
+	enum eTP tptype;
+	/** bits 1 and 8 of the first minute, to determine the type */
+	unsigned tpstat;
+};
+
+/**
+ * Initialize the state of a third party buffer for use with the reentrant
+ * functions.
+ *
+ * @param tps The state to initialize.
+ */
+void init_thirdparty_state(struct TP_state * const tps);
+
 /**
  * Add the current bit value to the third party buffer.
  *
@@ -28,6 +52,14 @@ enum eTP {
  */
 void fill_thirdparty_buffer(int minute, int bitpos, struct GB_result bit);
 
+/**
+ * Reentrant version of {@link fill_thirdparty_buffer}.
+ *
+ * @param tps The third party buffer state.
+ */
+void fill_thirdparty_buffer_r(struct TP_state * const tps, int minute,
+    int bitpos, struct GB_result bit);
+
 /**
  * Retrieve the third party buffer.
  *
@@ -35,6 +67,13 @@ void fill_thirdparty_buffer(int minute, int bitpos, struct GB_result bit);
  */
 const unsigned * const get_thirdparty_buffer(void);
 
+/**
+ * Reentrant version of {@link get_thirdparty_buffer}.
+ *
+ * @param tps The third party buffer state.
+ */
+const unsigned * const get_thirdparty_buffer_r(struct TP_state * const tps);
+
 /**
  * Retrieve the type of the third party contents.
  *
@@ -42,4 +81,21 @@ const unsigned * const get_thirdparty_buffer(void);
  */
 enum eTP get_thirdparty_type(void);
 
+/**
+ * Reentrant version of {@link get_thirdparty_type}.
+ *
+ * @param tps The third party buffer state.
+ */
+enum eTP get_thirdparty_type_r(struct TP_state * const tps);
+
+/**
+ * Compare two third party buffer states.
+ *
+ * @param a The first third party buffer state.
+ * @param b The second third party buffer state.
+ * @return The states are equal.
+ */
+bool equal_thirdparty_state(const struct TP_state * const a,
+    const struct TP_state * const b);
+
 #endif
@@ -1,196 +1,740 @@
-// Copyright 2013-2018 René Ladan
+// Copyright 2013-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
+#include "binlog.h"
 #include "bits1to14.h"
 #include "calendar.h"
 #include "decode_alarm.h"
 #include "decode_time.h"
+#include "heatmap.h"
 #include "input.h"
+#include "logindex.h"
 #include "mainloop.h"
+#include "stats.h"
 
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
 #include <time.h>
+#include <unistd.h>
 
 static void
-display_bit(struct GB_result bit, int bitpos)
+display_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
 {
 	if (is_space_bit(bitpos)) {
-		printf(" ");
+		putc(' ', mls->out);
 	}
 	if (bit.hwstat == ehw_receive) {
-		printf("r");
+		putc('r', mls->out);
 	} else if (bit.hwstat == ehw_transmit) {
-		printf("x");
+		putc('x', mls->out);
 	} else if (bit.hwstat == ehw_random) {
-		printf("#");
+		putc('#', mls->out);
 	} else if (bit.bitval == ebv_none) {
-		printf("_");
+		putc('_', mls->out);
 	} else {
-		printf("%i", get_buffer()[bitpos]);
+		putc('0' + get_buffer_r(&mls->gbs)[bitpos], mls->out);
 	}
 }
 
 static void
-display_time(struct DT_result dt, struct tm time)
+display_time(struct ML_state *mls, struct DT_result dt, struct tm time)
 {
-	printf("%s %04d-%02d-%02d %s %02d:%02d\n",
+	fprintf(mls->out, "%s %04d-%02d-%02d %s %02d:%02d\n",
 	    time.tm_isdst == 1 ? "summer" : time.tm_isdst == 0 ? "winter" :
 	    "?     ",
 	    time.tm_year, time.tm_mon, time.tm_mday, weekday[time.tm_wday],
 	    time.tm_hour, time.tm_min);
 	if (dt.minute_length == emin_long) {
-		printf("Minute too long\n");
+		fprintf(mls->out, "Minute too long\n");
 	} else if (dt.minute_length == emin_short) {
-		printf("Minute too short\n");
+		fprintf(mls->out, "Minute too short\n");
 	}
 	if (dt.dst_status == eDST_error) {
-		printf("Time offset error\n");
+		fprintf(mls->out, "Time offset error\n");
 	} else if (dt.dst_status == eDST_jump) {
-		printf("Time offset jump (ignored)\n");
+		fprintf(mls->out, "Time offset jump (ignored)\n");
 	} else if (dt.dst_status == eDST_done) {
-		printf("Time offset changed\n");
+		fprintf(mls->out, "Time offset changed\n");
 	}
 	if (dt.minute_status == eval_parity) {
-		printf("Minute parity error\n");
+		fprintf(mls->out, "Minute parity error\n");
 	} else if (dt.minute_status == eval_bcd) {
-		printf("Minute value error\n");
+		fprintf(mls->out, "Minute value error\n");
 	} else if (dt.minute_status == eval_jump) {
-		printf("Minute value jump\n");
+		fprintf(mls->out, "Minute value jump\n");
 	}
 	if (dt.hour_status == eval_parity) {
-		printf("Hour parity error\n");
+		fprintf(mls->out, "Hour parity error\n");
 	} else if (dt.hour_status == eval_bcd) {
-		printf("Hour value error\n");
+		fprintf(mls->out, "Hour value error\n");
 	} else if (dt.hour_status == eval_jump) {
-		printf("Hour value jump\n");
+		fprintf(mls->out, "Hour value jump\n");
 	}
 	if (dt.mday_status == eval_parity) {
-		printf("Date parity error\n");
+		fprintf(mls->out, "Date parity error\n");
 	}
 	if (dt.wday_status == eval_bcd) {
-		printf("Day-of-week value error\n");
+		fprintf(mls->out, "Day-of-week value error\n");
 	} else if (dt.wday_status == eval_jump) {
-		printf("Day-of-week value jump\n");
+		fprintf(mls->out, "Day-of-week value jump\n");
 	}
 	if (dt.mday_status == eval_bcd) {
-		printf("Day-of-month value error\n");
+		fprintf(mls->out, "Day-of-month value error\n");
 	} else if (dt.mday_status == eval_jump) {
-		printf("Day-of-month value jump\n");
+		fprintf(mls->out, "Day-of-month value jump\n");
 	}
 	if (dt.month_status == eval_bcd) {
-		printf("Month value error\n");
+		fprintf(mls->out, "Month value error\n");
 	} else if (dt.month_status == eval_jump) {
-		printf("Month value jump\n");
+		fprintf(mls->out, "Month value jump\n");
 	}
 	if (dt.year_status == eval_bcd) {
-		printf("Year value error\n");
+		fprintf(mls->out, "Year value error\n");
 	} else if (dt.year_status == eval_jump) {
-		printf("Year value jump\n");
+		fprintf(mls->out, "Year value jump\n");
 	}
 	if (!dt.bit0_ok) {
-		printf("Minute marker error\n");
+		fprintf(mls->out, "Minute marker error\n");
 	}
 	if (!dt.bit20_ok) {
-		printf("Date/time start marker error\n");
+		fprintf(mls->out, "Date/time start marker error\n");
 	}
 	if (dt.transmit_call) {
-		printf("Transmitter call bit set\n");
+		fprintf(mls->out, "Transmitter call bit set\n");
 	}
 	if (dt.dst_announce) {
-		printf("Time offset change announced\n");
+		fprintf(mls->out, "Time offset change announced\n");
 	}
 	if (dt.leap_announce) {
-		printf("Leap second announced\n");
+		fprintf(mls->out, "Leap second announced\n");
 	}
 	if (dt.leapsecond_status == els_done) {
-		printf("Leap second processed\n");
+		fprintf(mls->out, "Leap second processed\n");
 	} else if (dt.leapsecond_status == els_one) {
-		printf("Leap second processed with value 1 instead of 0\n");
+		fprintf(mls->out,
+		    "Leap second processed with value 1 instead of 0\n");
 	}
-	printf("\n");
+	fprintf(mls->out, "\n");
 }
 
 static void
-display_alarm(struct alm alarm)
+display_alarm(struct ML_state *mls, struct alm alarm)
 {
-	printf("German civil warning for: %s\n", get_region_name(alarm));
+	fprintf(mls->out, "German civil warning for: %s\n",
+	    get_region_name(alarm));
 	for (unsigned i = 0; i < 2; i++) {
-		printf("%u Regions: %x %x %x %x parities %x %x\n", i,
+		fprintf(mls->out, "%u Regions: %x %x %x %x parities %x %x\n", i,
 		    alarm.region[i].r1, alarm.region[i].r2, alarm.region[i].r3,
 		    alarm.region[i].r4, alarm.parity[i].ps, alarm.parity[i].pl);
 	}
 }
 
 static void
-display_unknown(void)
+display_unknown(struct ML_state *mls)
 {
-	printf("Unknown third party contents\n");
+	fprintf(mls->out, "Unknown third party contents\n");
 }
 
 static void
-display_weather(void)
+display_weather(struct ML_state *mls)
 {
-	printf("Meteotime weather\n");
+	fprintf(mls->out, "Meteotime weather\n");
 }
 
 static void
-display_long_minute(void)
+display_long_minute(struct ML_state *mls)
 {
-	printf(" L ");
+	fprintf(mls->out, " L ");
 }
 
 static void
-display_minute(int minlen)
+display_minute(struct ML_state *mls, int minlen)
 {
 	int cutoff;
 
-	cutoff = get_cutoff();
-	printf(" (%u) %i ", get_acc_minlen(), minlen);
+	cutoff = get_cutoff_r(&mls->gbs);
+	fprintf(mls->out, " (%u) %i ", get_acc_minlen_r(&mls->gbs), minlen);
 	if (cutoff == -1) {
-		printf("?\n");
+		fprintf(mls->out, "?\n");
 	} else {
-		printf("%6.4f\n", cutoff / 1e4);
+		fprintf(mls->out, "%6.4f\n", cutoff / 1e4);
 	}
 }
 
 static void
-display_thirdparty_buffer(const unsigned tpbuf[])
+display_thirdparty_buffer(struct ML_state *mls, const unsigned tpbuf[])
 {
-	printf("Third party buffer: ");
+	fprintf(mls->out, "Third party buffer: ");
 	for (int i = 0; i < TPBUFLEN; i++) {
-		printf("%u", tpbuf[i]);
+		fprintf(mls->out, "%u", tpbuf[i]);
 	}
-	printf("\n");
+	fprintf(mls->out, "\n");
+}
+
+/* Structured output, one record per minute */
+
+/* size of the stdout buffer for the structured output formats */
+#define OUTBUFSIZE (1 << 20)
+
+enum eOutFormat {
+	eout_text,
+	eout_jsonl,
+	eout_csv,
+	eout_summary,
+	eout_summaryjson,
+	eout_heatmap,
+	eout_heatmapjson
+};
+
+static const char * const tval_name[] = { "ok", "bcd", "parity", "jump" };
+static const char * const length_name[] = { "ok", "short", "long" };
+static const char * const dst_name[] = { "ok", "error", "jump", "done" };
+static const char * const leap_name[] = { "none", "one", "done" };
+
+static const char * const csv_header =
+    "time,wday,isdst,minlen,acc_minlen,cutoff,bits,minute_length,bit0_ok,"
+    "transmit_call,bit20_ok,minute,hour,mday,wday_status,month,year,dst,"
+    "leapsecond,dst_announce,leap_announce\n";
+
+static void
+no_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+}
+
+static void
+no_output(struct ML_state *mls)
+{
+}
+
+static void
+no_minute(struct ML_state *mls, int minlen)
+{
+}
+
+static void
+no_alarm(struct ML_state *mls, struct alm alarm)
+{
+}
+
+static void
+no_thirdparty_buffer(struct ML_state *mls, const unsigned tpbuf[])
+{
+}
+
+/* The bits of the minute as a number, bit 0 being the least significant */
+static unsigned long long
+packed_minute(struct ML_state *mls)
+{
+	const int * const buffer = get_buffer_r(&mls->gbs);
+	unsigned long long bits = 0;
+	int len = mls->minlen < BUFLEN ? mls->minlen : BUFLEN;
+
+	for (int i = 0; i < len; i++) {
+		bits |= (unsigned long long)(buffer[i] & 1) << i;
+	}
+	return bits;
+}
+
+/* Format the cutoff value, empty for CSV or null for JSON if unknown */
+static const char *
+cutoff_text(struct ML_state *mls, char *buf, size_t len, bool json)
+{
+	int cutoff = get_cutoff_r(&mls->gbs);
+
+	if (cutoff == -1) {
+		return json ? "null" : "";
+	}
+	(void)snprintf(buf, len, "%6.4f", cutoff / 1e4);
+	return buf;
+}
+
+static const char *
+bool_text(bool b)
+{
+	return b ? "true" : "false";
+}
+
+static void
+record_jsonl(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	char cutoff[16];
+
+	fprintf(mls->out, "{\"time\":\"%04d-%02d-%02d %02d:%02d\",\"wday\":%d,"
+	    "\"isdst\":%d,\"minlen\":%d,\"acc_minlen\":%u,\"cutoff\":%s,"
+	    "\"bits\":\"%015llx\",\"minute_length\":\"%s\",\"bit0_ok\":%s,"
+	    "\"transmit_call\":%s,\"bit20_ok\":%s,\"minute\":\"%s\","
+	    "\"hour\":\"%s\",\"mday\":\"%s\",\"wday_status\":\"%s\","
+	    "\"month\":\"%s\",\"year\":\"%s\",\"dst\":\"%s\","
+	    "\"leapsecond\":\"%s\",\"dst_announce\":%s,"
+	    "\"leap_announce\":%s}\n",
+	    time.tm_year, time.tm_mon, time.tm_mday, time.tm_hour, time.tm_min,
+	    time.tm_wday, time.tm_isdst, mls->minlen,
+	    get_acc_minlen_r(&mls->gbs),
+	    cutoff_text(mls, cutoff, sizeof(cutoff), true),
+	    packed_minute(mls), length_name[dt.minute_length],
+	    bool_text(dt.bit0_ok), bool_text(dt.transmit_call),
+	    bool_text(dt.bit20_ok), tval_name[dt.minute_status],
+	    tval_name[dt.hour_status], tval_name[dt.mday_status],
+	    tval_name[dt.wday_status], tval_name[dt.month_status],
+	    tval_name[dt.year_status], dst_name[dt.dst_status],
+	    leap_name[dt.leapsecond_status], bool_text(dt.dst_announce),
+	    bool_text(dt.leap_announce));
+}
+
+static void
+record_csv(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	char cutoff[16];
+
+	fprintf(mls->out, "%04d-%02d-%02d %02d:%02d,%d,%d,%d,%u,%s,%015llx,"
+	    "%s,%d,%d,%d,%s,%s,%s,%s,%s,%s,%s,%s,%d,%d\n",
+	    time.tm_year, time.tm_mon, time.tm_mday, time.tm_hour, time.tm_min,
+	    time.tm_wday, time.tm_isdst, mls->minlen,
+	    get_acc_minlen_r(&mls->gbs),
+	    cutoff_text(mls, cutoff, sizeof(cutoff), false),
+	    packed_minute(mls), length_name[dt.minute_length], dt.bit0_ok,
+	    dt.transmit_call, dt.bit20_ok, tval_name[dt.minute_status],
+	    tval_name[dt.hour_status], tval_name[dt.mday_status],
+	    tval_name[dt.wday_status], tval_name[dt.month_status],
+	    tval_name[dt.year_status], dst_name[dt.dst_status],
+	    leap_name[dt.leapsecond_status], dt.dst_announce,
+	    dt.leap_announce);
+}
+
+static struct stats stats;
+static struct reset_counts last_resets;
+
+/*
+ * With --from, the minutes before the start are decoded with the output going
+ * to /dev/null , these are not counted.
+ */
+static bool
+counting(struct ML_state *mls)
+{
+	return mls->out == stdout;
+}
+
+static void
+stats_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+	if (counting(mls)) {
+		stats_add_bit(&stats, bit);
+	}
+}
+
+static void
+stats_long_minute(struct ML_state *mls)
+{
+	if (counting(mls)) {
+		stats_add_long_minute(&stats);
+	}
+}
+
+static void
+stats_time(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	struct reset_counts rc = get_reset_counts_r(&mls->gbs), delta;
+
+	delta.freq = rc.freq - last_resets.freq;
+	delta.bitlen = rc.bitlen - last_resets.bitlen;
+	last_resets = rc;
+	if (counting(mls)) {
+		stats_add_minute(&stats, dt, time, delta);
+	}
+}
+
+/* Error heatmaps, one per log file, which are decoded in parallel */
+
+struct receiver {
+	/* first, so that the callbacks find the receiver from their state */
+	struct ML_state mls;
+	struct heatmap hm;
+	const char *logfilename;
+	int res;
+};
+
+struct receivers {
+	struct receiver *rcv;
+	unsigned n;
+	/* next log file to decode */
+	unsigned next;
+	pthread_mutex_t mutex;
+};
+
+static void
+heatmap_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+	heatmap_add_bit(&((struct receiver *)mls)->hm, bit, bitpos);
+}
+
+static void
+heatmap_time(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	heatmap_add_minute(&((struct receiver *)mls)->hm, dt, time);
+}
+
+static const struct ML_callbacks cb_heatmap = {
+	get_bit_file_r, heatmap_bit, no_output, no_minute, no_alarm,
+	no_output, no_output, heatmap_time, no_thirdparty_buffer
+};
+
+static void *
+heatmap_worker(void *arg)
+{
+	struct receivers * const rs = arg;
+
+	for (;;) {
+		struct receiver *r;
+
+		(void)pthread_mutex_lock(&rs->mutex);
+		if (rs->next == rs->n) {
+			(void)pthread_mutex_unlock(&rs->mutex);
+			break;
+		}
+		r = &rs->rcv[rs->next++];
+		(void)pthread_mutex_unlock(&rs->mutex);
+
+		init_mainloop_state(&r->mls, NULL);
+		heatmap_init(&r->hm);
+		r->res = set_mode_file_r(&r->mls.gbs, r->logfilename);
+		if (r->res != 0) {
+			continue;
+		}
+		while (!mainloop_step_r(&r->mls, &cb_heatmap)) {
+			/* decode until the end */
+		}
+		cleanup_r(&r->mls.gbs);
+	}
+	return NULL;
+}
+
+static int
+run_heatmaps(char * const logfilenames[], unsigned nfiles, unsigned nthreads,
+    bool json)
+{
+	struct receivers rs;
+	pthread_t *thread;
+	unsigned nthr;
+	int res = 0;
+
+	rs.rcv = calloc(nfiles, sizeof(*rs.rcv));
+	thread = calloc(nthreads, sizeof(*thread));
+	if (rs.rcv == NULL || thread == NULL) {
+		res = errno;
+		free(rs.rcv);
+		free(thread);
+		return res;
+	}
+	for (unsigned i = 0; i < nfiles; i++) {
+		rs.rcv[i].logfilename = logfilenames[i];
+	}
+	rs.n = nfiles;
+	rs.next = 0;
+	(void)pthread_mutex_init(&rs.mutex, NULL);
+	/* this thread is one of them */
+	for (nthr = 0; nthr + 1 < nthreads && nthr + 1 < nfiles; nthr++) {
+		if (pthread_create(&thread[nthr], NULL, heatmap_worker, &rs) !=
+		    0) {
+			break;
+		}
+	}
+	(void)heatmap_worker(&rs);
+	for (unsigned i = 0; i < nthr; i++) {
+		(void)pthread_join(thread[i], NULL);
+	}
+	(void)pthread_mutex_destroy(&rs.mutex);
+
+	for (unsigned i = 0; i < nfiles; i++) {
+		if (rs.rcv[i].res != 0) {
+			fprintf(stderr, "%s: cannot decode\n",
+			    rs.rcv[i].logfilename);
+			if (res == 0) {
+				res = rs.rcv[i].res;
+			}
+			continue;
+		}
+		heatmap_print(&rs.rcv[i].hm, rs.rcv[i].logfilename, stdout,
+		    json);
+	}
+	free(rs.rcv);
+	free(thread);
+	return res;
+}
+
+static void
+usage(const char * const progname)
+{
+	printf("usage: %s [-f text|jsonl|csv|summary|summaryjson] "
+	    "[-b bucket]\n"
+	    "    [-j threads | -r [-o outfile] | -c outfile |\n"
+	    "    [--from \"YYYY-MM-DD hh:mm\"] [--to \"YYYY-MM-DD hh:mm\"]] "
+	    "infile\n"
+	    "       %s -f heatmap|heatmapjson [-j threads] infile ...\n",
+	    progname, progname);
+}
+
+/* Explain why the arguments are wrong, and show the usage */
+static void
+usage_error(const char * const progname, const char * const reason)
+{
+	fprintf(stderr, "%s: %s\n", progname, reason);
+	usage(progname);
+}
+
+/* Parse a time as displayed, return its minute key or -1 on error */
+static int64_t
+parse_time(const char * const str, struct tm * const time)
+{
+	char c;
+
+	(void)memset(time, 0, sizeof(*time));
+	if (sscanf(str, "%d-%d-%d%*[ T]%d:%d%c", &time->tm_year, &time->tm_mon,
+	    &time->tm_mday, &time->tm_hour, &time->tm_min, &c) != 5 ||
+	    time->tm_mon < 1 || time->tm_mon > 12 || time->tm_mday < 1 ||
+	    time->tm_mday > 31 || time->tm_hour < 0 || time->tm_hour > 23 ||
+	    time->tm_min < 0 || time->tm_min > 59) {
+		return -1;
+	}
+	return minute_key(*time);
 }
 
 int
 main(int argc, char *argv[])
 {
-	int res;
-	char *logfilename;
+	struct ML_callbacks cb = {
+		get_bit_file_r, display_bit, display_long_minute,
+		display_minute, display_alarm, display_unknown, display_weather,
+		display_time, display_thirdparty_buffer
+	};
+	const struct ML_callbacks cb_records = {
+		get_bit_file_r, no_bit, no_output, no_minute, no_alarm,
+		no_output, no_output, record_jsonl, no_thirdparty_buffer
+	};
+	const struct option longopts[] = {
+		{ "from", required_argument, NULL, 'F' },
+		{ "to", required_argument, NULL, 'T' },
+		{ NULL, 0, NULL, 0 }
+	};
+	struct ML_callbacks cb_replay;
+	struct ML_state mls;
+	struct tm time;
+	int ch, res;
+	char *logfilename, *outlogfilename = NULL, *indexfilename = NULL;
+	char *convfilename = NULL;
+	int64_t from = -1, to = -1;
+	unsigned nthreads = 1;
+	enum eOutFormat format = eout_text;
+	const char *bucket = NULL;
+	bool summary;
+	bool replay = false;
+	FILE *devnull = NULL;
 
-	if (argc == 2) {
-		logfilename = strdup(argv[1]);
-	} else {
-		printf("usage: %s infile\n", argv[0]);
+	while ((ch = getopt_long(argc, argv, "b:c:f:j:o:r", longopts, NULL)) !=
+	    -1) {
+		switch (ch) {
+		case 'b':
+			bucket = optarg;
+			break;
+		case 'c':
+			convfilename = optarg;
+			break;
+		case 'f':
+			if (strcmp(optarg, "text") == 0) {
+				format = eout_text;
+			} else if (strcmp(optarg, "jsonl") == 0) {
+				format = eout_jsonl;
+			} else if (strcmp(optarg, "csv") == 0) {
+				format = eout_csv;
+			} else if (strcmp(optarg, "summary") == 0) {
+				format = eout_summary;
+			} else if (strcmp(optarg, "summaryjson") == 0) {
+				format = eout_summaryjson;
+			} else if (strcmp(optarg, "heatmap") == 0) {
+				format = eout_heatmap;
+			} else if (strcmp(optarg, "heatmapjson") == 0) {
+				format = eout_heatmapjson;
+			} else {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			break;
+		case 'j':
+			nthreads = (unsigned)atoi(optarg);
+			if (nthreads < 1) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			break;
+		case 'o':
+			outlogfilename = optarg;
+			break;
+		case 'r':
+			replay = true;
+			break;
+		case 'F':
+			/* start printing after the minute before */
+			if (parse_time(optarg, &time) == -1) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			from = minute_key(substract_minute(time, false));
+			break;
+		case 'T':
+			to = parse_time(optarg, &time);
+			if (to == -1) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return EX_USAGE;
+		}
+	}
+	if (format == eout_heatmap || format == eout_heatmapjson) {
+		if (argc - optind < 1 || replay || outlogfilename != NULL ||
+		    convfilename != NULL || from != -1 || to != -1 ||
+		    bucket != NULL) {
+			usage(argv[0]);
+			return EX_USAGE;
+		}
+		(void)setvbuf(stdout, NULL, _IOFBF, OUTBUFSIZE);
+		return run_heatmaps(argv + optind, (unsigned)(argc - optind),
+		    nthreads, format == eout_heatmapjson);
+	}
+	summary = format == eout_summary || format == eout_summaryjson;
+	if (argc - optind != 1) {
+		usage(argv[0]);
+		return EX_USAGE;
+	}
+	if (outlogfilename != NULL && !replay) {
+		usage_error(argv[0], "-o needs -r");
+		return EX_USAGE;
+	}
+	if (replay && nthreads > 1) {
+		usage_error(argv[0], "-r and -j cannot be combined");
 		return EX_USAGE;
 	}
+	if ((from != -1 || to != -1) && (replay || nthreads > 1)) {
+		usage_error(argv[0], "--from and --to cannot be combined with "
+		    "-r or -j");
+		return EX_USAGE;
+	}
+	if (convfilename != NULL && (replay || nthreads > 1 || from != -1 ||
+	    to != -1)) {
+		usage_error(argv[0], "-c cannot be combined with -r, -j, "
+		    "--from or --to");
+		return EX_USAGE;
+	}
+	if (summary && nthreads > 1) {
+		usage_error(argv[0], "-f summary cannot be combined with -j");
+		return EX_USAGE;
+	}
+	if (!summary && bucket != NULL) {
+		usage_error(argv[0], "-b needs -f summary or summaryjson");
+		return EX_USAGE;
+	}
+	if (summary && stats_init(&stats, bucket != NULL ? bucket : "all",
+	    stdout, format == eout_summaryjson) != 0) {
+		fprintf(stderr, "%s: invalid bucket '%s', use all, year, "
+		    "month, day, hour or a number of minutes which divides a "
+		    "day\n", argv[0], bucket);
+		return EX_USAGE;
+	}
+	logfilename = strdup(argv[optind]);
+
+	if (convfilename != NULL) {
+		res = convert_logfile(logfilename, convfilename);
+		free(logfilename);
+		return res;
+	}
+
+	if (format != eout_text) {
+		/* one write per buffer instead of per few records */
+		(void)setvbuf(stdout, NULL, _IOFBF, OUTBUFSIZE);
+		cb = cb_records;
+		if (format == eout_csv) {
+			cb.display_time = record_csv;
+			fputs(csv_header, stdout);
+		} else if (summary) {
+			cb.display_bit = stats_bit;
+			cb.display_long_minute = stats_long_minute;
+			cb.display_time = stats_time;
+		}
+	}
+
+	if (nthreads > 1) {
+		res = mainloop_parallel(logfilename, nthreads, &cb, stdout);
+		free(logfilename);
+		return res;
+	}
 
-	res = set_mode_file(logfilename);
+	init_mainloop_state(&mls, stdout);
+	if (replay) {
+		cb_replay = cb;
+		cb_replay.get_bit = get_bit_live_r;
+		res = set_mode_replay_r(&mls.gbs, logfilename);
+		if (res == 0 && outlogfilename != NULL) {
+			res = append_logfile_r(&mls.gbs, outlogfilename);
+		}
+	} else {
+		res = set_mode_file_r(&mls.gbs, logfilename);
+	}
+	if (res == 0 && from != -1) {
+		/* the index lives next to the log file */
+		indexfilename = malloc(strlen(logfilename) + 5);
+		if (indexfilename == NULL) {
+			res = errno;
+		} else {
+			sprintf(indexfilename, "%s.idx", logfilename);
+			res = update_logindex(logfilename, indexfilename);
+		}
+		if (res == 0) {
+			res = seek_logindex(indexfilename, from, &mls);
+		}
+		if (res == 0) {
+			devnull = fopen("/dev/null", "w");
+			if (devnull == NULL) {
+				res = errno;
+			}
+			mls.out = devnull;
+		}
+	}
 	if (res != 0) {
 		/* something went wrong */
-		cleanup();
+		cleanup_r(&mls.gbs);
+		free(indexfilename);
 		free(logfilename);
 		return res;
 	}
 
-	mainloop(NULL, get_bit_file, display_bit, display_long_minute,
-	    display_minute, NULL, display_alarm, display_unknown,
-	    display_weather, display_time, display_thirdparty_buffer, NULL,
-	    NULL, NULL);
+	while (!mainloop_step_r(&mls, replay ? &cb_replay : &cb)) {
+		if ((from != -1 || to != -1) && mls.init_min == 0) {
+			int64_t key = minute_key(mls.curtime);
+
+			if (mls.out == devnull && key >= from) {
+				mls.out = stdout;
+			}
+			if (to != -1 && mls.out == stdout && key >= to) {
+				break;
+			}
+		}
+	}
+	cleanup_r(&mls.gbs);
+	if (devnull != NULL) {
+		(void)fclose(devnull);
+	}
+	if (summary) {
+		stats_finish(&stats);
+	}
+	free(indexfilename);
 	free(logfilename);
 	return res;
 }
@@ -0,0 +1,147 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "refclock.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+static void
+usage(const char * const progname)
+{
+	printf("usage: %s -s unit | -c socket [-n count]\n", progname);
+}
+
+static void
+print_sample(const struct refclock_sample * const sample)
+{
+	long long ns;
+
+	ns = (sample->clock.tv_sec - sample->receive.tv_sec) * 1000000000LL +
+	    sample->clock.tv_nsec - sample->receive.tv_nsec;
+	printf("clock %lli.%09li receive %lli.%09li offset %+.9f leap %i "
+	    "precision %i\n", (long long)sample->clock.tv_sec,
+	    sample->clock.tv_nsec, (long long)sample->receive.tv_sec,
+	    sample->receive.tv_nsec, ns / 1e9, sample->leap,
+	    sample->precision);
+	(void)fflush(stdout);
+}
+
+/* Poll the segment like ntpd and chronyd do, but more often */
+static int
+read_shm(int unit, unsigned long count)
+{
+	volatile struct shm_time *shm;
+	struct refclock_sample sample;
+	const struct timespec poll = { 0, 100000000 };
+
+	shm = refclock_shm_attach(unit, true);
+	if (shm == NULL) {
+		perror("shm");
+		return EX_OSERR;
+	}
+	for (unsigned long n = 0; count == 0 || n < count;) {
+		switch (refclock_shm_read(shm, &sample)) {
+		case 1:
+			print_sample(&sample);
+			n++;
+			break;
+		case -1:
+			printf("sample changed while reading, mode %i\n",
+			    shm->mode);
+			break;
+		default:
+			(void)nanosleep(&poll, NULL);
+			break;
+		}
+	}
+	return EX_OK;
+}
+
+/* Create the socket like chronyd does and wait for samples */
+static int
+read_sock(const char * const path, unsigned long count)
+{
+	struct sockaddr_un addr;
+	struct refclock_sample sample;
+	char buf[256];
+	ssize_t len;
+	int fd, res = EX_OK;
+
+	memset(&addr, 0, sizeof(addr));
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(ENAMETOOLONG));
+		return EX_USAGE;
+	}
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd == -1) {
+		perror("socket");
+		return EX_OSERR;
+	}
+	(void)unlink(path);
+	if (bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		perror("bind");
+		(void)close(fd);
+		return EX_OSERR;
+	}
+	for (unsigned long n = 0; count == 0 || n < count; n++) {
+		len = recv(fd, buf, sizeof(buf), 0);
+		if (len == -1) {
+			perror("recv");
+			res = EX_IOERR;
+			break;
+		}
+		if (refclock_sock_decode(buf, (size_t)len, &sample) != 0) {
+			printf("invalid sample of %zi bytes\n", len);
+			continue;
+		}
+		print_sample(&sample);
+	}
+	(void)close(fd);
+	(void)unlink(path);
+	return res;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *path = NULL;
+	unsigned long count = 0;
+	int ch, unit = -1;
+
+	while ((ch = getopt(argc, argv, "c:n:s:")) != -1) {
+		switch (ch) {
+		case 'c':
+			path = optarg;
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			unit = atoi(optarg);
+			if (unit < 0 || unit > 255) {
+				fprintf(stderr, "unit must be between 0 and "
+				    "255 inclusive\n");
+				return EX_USAGE;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return EX_USAGE;
+		}
+	}
+	if (argc != optind || (unit == -1) == (path == NULL)) {
+		usage(argv[0]);
+		return EX_USAGE;
+	}
+	return unit != -1 ? read_shm(unit, count) : read_sock(path, count);
+}
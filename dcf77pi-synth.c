@@ -0,0 +1,224 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "binlog.h"
+#include "rawcap.h"
+#include "synth.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+static void
+usage(const char * const progname)
+{
+	printf("usage: %s -f \"YYYY-MM-DD hh:mm\" -m minutes [-b | -r freq]\n"
+	    "    [-s seed] [-t] [-L YYYY-MM ...]\n"
+	    "    [-n flip=p,dropout=p:len,burst=p:len,jitter=us] outfile\n",
+	    progname);
+}
+
+/* Parse the noise model, return -1 on error */
+static int
+parse_noise(char *str, struct synth_noise * const n)
+{
+	char *opt, *last;
+
+	for (opt = strtok_r(str, ",", &last); opt != NULL;
+	    opt = strtok_r(NULL, ",", &last)) {
+		if (sscanf(opt, "flip=%lf", &n->flip) == 1) {
+			continue;
+		}
+		if (sscanf(opt, "dropout=%lf:%u", &n->dropout,
+		    &n->dropout_len) == 2) {
+			continue;
+		}
+		if (sscanf(opt, "burst=%lf:%u", &n->burst, &n->burst_len) ==
+		    2) {
+			continue;
+		}
+		if (sscanf(opt, "jitter=%u", &n->jitter) == 1) {
+			continue;
+		}
+		return -1;
+	}
+	return 0;
+}
+
+static int
+write_log(struct synth * const s, const char * const name, bool binary)
+{
+	struct binlog_writer w;
+	char line[128];
+	size_t len;
+	FILE *f;
+	int res = 0;
+
+	f = fopen(name, "w");
+	if (f == NULL) {
+		return errno;
+	}
+	if (binary) {
+		res = binlog_open_writer(&w, f);
+	}
+	if (res == 0) {
+		const char * const restart = "\n--new log--\n\n";
+
+		res = binary ? binlog_write_text(&w,
+		    (const unsigned char *)restart, strlen(restart)) :
+		    fputs(restart, f) == EOF ? errno : 0;
+	}
+	do {
+		len = synth_log_line(s, line, sizeof(line));
+		if (res == 0) {
+			res = binary ? binlog_write_text(&w,
+			    (const unsigned char *)line, len) :
+			    fwrite(line, 1, len, f) == len ? 0 : errno;
+		}
+	} while (res == 0 && synth_next(s));
+	if (binary && res == 0) {
+		res = binlog_close_writer(&w);
+	}
+	if (fclose(f) == EOF && res == 0) {
+		res = errno;
+	}
+	return res;
+}
+
+/*
+ * Sample the edges at freq Hz into a raw capture, one block per second. The
+ * generator has one minute more than requested, of which the first two
+ * seconds are included so that the last minute marker can be seen.
+ */
+static int
+write_rawcap(struct synth * const s, const char * const name, unsigned freq,
+    unsigned long minutes)
+{
+	struct rawcap rc;
+	struct edge e;
+	unsigned char *buf;
+	int level = 0, res;
+	bool end;
+
+	(void)unlink(name);
+	/* at most one leap second per minute, the first second is empty */
+	res = rawcap_open(&rc, name, (uint64_t)minutes * 61 + 3, freq);
+	if (res != 0) {
+		return res;
+	}
+	buf = malloc((freq + 7) / 8);
+	if (buf == NULL) {
+		rawcap_close(&rc);
+		return ENOMEM;
+	}
+	end = synth_edge(s, &e) != 0;
+	for (long long sec = 0; !end; sec++) {
+		memset(buf, 0, (freq + 7) / 8);
+		for (unsigned i = 0; i < freq; i++) {
+			long long t = sec * 1000000000LL +
+			    (long long)i * 1000000000LL / freq;
+
+			while (!end && e.t <= t) {
+				level = e.level;
+				end = synth_edge(s, &e) != 0;
+			}
+			buf[i / 8] |= (unsigned char)(level << (i & 7));
+		}
+		rawcap_write(&rc, sec * 1000000000LL, true, buf, freq);
+		if (s->minute == minutes &&
+		    sec * 1000000000LL >= s->t0 + 1000000000LL) {
+			break;
+		}
+	}
+	free(buf);
+	rawcap_close(&rc);
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct synth_config cfg;
+	struct synth s;
+	unsigned long minutes;
+	unsigned freq = 0;
+	bool binary = false, have_start = false;
+	char c;
+	int ch, res;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.seed = 1;
+	while ((ch = getopt(argc, argv, "bf:L:m:n:r:s:t")) != -1) {
+		switch (ch) {
+		case 'b':
+			binary = true;
+			break;
+		case 'f':
+			have_start = sscanf(optarg, "%d-%d-%d%*[ T]%d:%d%c",
+			    &cfg.start.tm_year, &cfg.start.tm_mon,
+			    &cfg.start.tm_mday, &cfg.start.tm_hour,
+			    &cfg.start.tm_min, &c) == 5;
+			break;
+		case 'L':
+			if (cfg.nleap == SYNTH_MAXLEAP || sscanf(optarg,
+			    "%d-%d%c", &cfg.leap[cfg.nleap].tm_year,
+			    &cfg.leap[cfg.nleap].tm_mon, &c) != 2) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			cfg.nleap++;
+			break;
+		case 'm':
+			cfg.minutes = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			if (parse_noise(optarg, &cfg.noise) != 0) {
+				usage(argv[0]);
+				return EX_USAGE;
+			}
+			break;
+		case 'r':
+			freq = (unsigned)atoi(optarg);
+			if (freq < 10 || freq > 155000 || (freq & 1) == 1) {
+				fprintf(stderr, "freq must be an even number "
+				    "between 10 and 155000 inclusive\n");
+				return EX_USAGE;
+			}
+			break;
+		case 's':
+			cfg.seed = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			cfg.thirdparty = true;
+			break;
+		default:
+			usage(argv[0]);
+			return EX_USAGE;
+		}
+	}
+	if (argc - optind != 1 || !have_start || cfg.minutes == 0 ||
+	    (binary && freq != 0)) {
+		usage(argv[0]);
+		return EX_USAGE;
+	}
+	minutes = cfg.minutes;
+	if (freq != 0) {
+		cfg.minutes++;
+	}
+	if (synth_init(&s, &cfg) != 0) {
+		fprintf(stderr, "Invalid start time or noise\n");
+		return EX_DATAERR;
+	}
+
+	res = freq != 0 ? write_rawcap(&s, argv[optind], freq, minutes) :
+	    write_log(&s, argv[optind], binary);
+	if (res != 0) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(res));
+		return EX_IOERR;
+	}
+	return EX_OK;
+}
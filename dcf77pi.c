@@ -1,4 +1,4 @@
-// Copyright 2013-2020 René Ladan
+// Copyright 2013-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "bits1to14.h"
@@ -7,6 +7,7 @@
 #include "decode_time.h"
 #include "input.h"
 #include "mainloop.h"
+#include "sampler.h"
 #include "setclock.h"
 
 #include "json_object.h"
@@ -31,6 +32,8 @@ static char keybuf[MAXBUF]; /* accumulator for string input */
 static bool show_utc;       /* show time in UTC */
 static bool set_time;       /* set host time, copy from mlr in [post_]process_input() */
 static bool toosmall;       /* terminal is less than 80x25 after a KEY_RESIZE */
+static bool use_sampler;    /* bits are read in a separate thread */
+static bool binary_log;     /* new log files are binary log files */
 
 static void
 statusbar(int bitpos, const char * const fmt, ...)
@@ -75,6 +78,9 @@ client_cleanup(const char * const reason)
 {
 	/* Caller is supposed to exit the program after this */
 	endwin();
+	stop_sampler();
+	close_clock_policy();
+	close_refclock_policy();
 	if (reason != NULL) {
 		printf("%s\n", reason);
 		cleanup();
@@ -165,6 +171,12 @@ display_bit(struct GB_result bit, int bitpos)
 	}
 
 	mvprintw(1, 29, "%10u", get_acc_minlen());
+	if (use_sampler) {
+		mvprintw(10, 0, "ring overruns %llu", get_sampler_overruns());
+	}
+	mvprintw(10, 30, "missed %5u late %8lli us", bitinf.missed,
+	    bitinf.lateness / 1000);
+	mvprintw(10, 62, "log drops %llu", get_logfile_overruns());
 	refresh();
 }
 
@@ -467,7 +479,9 @@ post_process_input(struct ML_result in_ml, int bitpos)
 				if (strlen(mlr.logfilename) > 0) {
 					int res;
 
-					res = append_logfile(mlr.logfilename);
+					res = binary_log ?
+					    append_binlog(mlr.logfilename) :
+					    append_logfile(mlr.logfilename);
 					if (res != 0) {
 						statusbar(bitpos,
 						    strerror(res));
@@ -559,6 +573,9 @@ process_setclock_result(struct ML_result in_ml, int bitpos)
 	case esc_ok:
 		statusbar(bitpos, "Time set");
 		break;
+	case esc_slewed:
+		statusbar(bitpos, "Time adjusted");
+		break;
 	}
 	return mlr;
 }
@@ -578,18 +595,45 @@ main(int argc, char *argv[])
 	if (json_object_object_get_ex(config, "outlogfile", &value)) {
 		logfilename = (char *)json_object_get_string(value);
 	}
+	if (json_object_object_get_ex(config, "outlogformat", &value)) {
+		binary_log = strcmp(json_object_get_string(value), "binary") ==
+		    0;
+	}
+	if (set_logfile_policy(config) != 0) {
+		client_cleanup(NULL);
+		return EX_CONFIG;
+	}
+	if (set_clock_policy(config) != 0) {
+		perror("set_clock_policy");
+		client_cleanup(NULL);
+		return EX_CONFIG;
+	}
+	if (set_refclock_policy(config) != 0) {
+		perror("set_refclock_policy");
+		client_cleanup(NULL);
+		return EX_CONFIG;
+	}
 	if (logfilename != NULL && strlen(logfilename) != 0) {
-		res = append_logfile(logfilename);
+		res = binary_log ? append_binlog(logfilename) :
+		    append_logfile(logfilename);
 		if (res != 0) {
 			perror("fopen(logfile)");
 			client_cleanup(NULL);
 			return res;
 		}
 	}
-	res = set_mode_live(config);
+	if (json_object_object_get_ex(config, "statefile", &value) &&
+	    strlen(json_object_get_string(value)) != 0) {
+		set_statefile(json_object_get_string(value));
+	}
+	if (json_object_object_get_ex(config, "samplethread", &value)) {
+		use_sampler = (bool)json_object_get_boolean(value);
+	}
+	res = use_sampler ? start_sampler(config) : set_mode_live(config);
 	if (res != 0) {
 		/* something went wrong */
-		client_cleanup("set_mode_live() failed");
+		client_cleanup(use_sampler ? "start_sampler() failed" :
+		    "set_mode_live() failed");
 		return res;
 	}
 
@@ -619,10 +663,11 @@ main(int argc, char *argv[])
 
 	draw_initial_screen();
 
-	mainloop(logfilename, get_bit_live, display_bit, display_long_minute,
-	    display_minute, wipe_input, display_alarm, display_unknown,
-	    display_weather, display_time, display_thirdparty_buffer,
-	    process_setclock_result, process_input, post_process_input);
+	mainloop(logfilename, use_sampler ? get_bit_sampler : get_bit_live,
+	    display_bit, display_long_minute, display_minute, wipe_input,
+	    display_alarm, display_unknown, display_weather, display_time,
+	    display_thirdparty_buffer, process_setclock_result, process_input,
+	    post_process_input);
 
 	client_cleanup(NULL);
 	return res;
@@ -0,0 +1,135 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "deadline.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#  include <sys/timerfd.h>
+#endif
+
+static long long
+mono_now(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
+int
+deadline_init(struct deadline * const dl, long long period,
+    bool use_timerfd)
+{
+	memset(dl, 0, sizeof(*dl));
+	dl->period = period;
+	if (use_timerfd) {
+#if defined(__linux__)
+		dl->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if (dl->tfd < 0) {
+			dl->tfd = 0;
+			perror("timerfd_create");
+			return errno;
+		}
+#else
+		fprintf(stderr, "timerfd is not supported\n");
+		return ENOTSUP;
+#endif
+	}
+	return 0;
+}
+
+void
+deadline_set_period(struct deadline * const dl, long long period)
+{
+	dl->period = period;
+}
+
+static int
+sleep_until(const struct deadline * const dl, long long t)
+{
+	struct timespec ts;
+
+	ts.tv_sec = t / 1000000000;
+	ts.tv_nsec = t % 1000000000;
+#if defined(__linux__)
+	if (dl->tfd > 0) {
+		struct itimerspec its;
+		uint64_t expirations;
+
+		memset(&its, 0, sizeof(its));
+		its.it_value = ts;
+		if (timerfd_settime(dl->tfd, TFD_TIMER_ABSTIME, &its, NULL) ==
+		    -1) {
+			return errno;
+		}
+		while (read(dl->tfd, &expirations, sizeof(expirations)) ==
+		    -1) {
+			if (errno != EINTR) {
+				return errno;
+			}
+		}
+		return 0;
+	}
+#endif
+#if defined(__APPLE__)
+	/* no clock_nanosleep(), fall back to a relative sleep */
+	t -= mono_now();
+	ts.tv_sec = t / 1000000000;
+	ts.tv_nsec = t % 1000000000;
+	while (t > 0 && nanosleep(&ts, &ts) == -1 && errno == EINTR)
+		; /* empty loop */
+	return 0;
+#else
+	int res;
+
+	while ((res = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+	    NULL)) == EINTR)
+		; /* empty loop */
+	return res;
+#endif
+}
+
+int
+deadline_wait(struct deadline * const dl)
+{
+	long long now;
+
+	now = mono_now();
+	if (dl->next == 0) {
+		dl->next = now + dl->period;
+	}
+	if (now >= dl->next) {
+		dl->missed++;
+		dl->lateness = now - dl->next;
+		if (dl->lateness >= dl->period) {
+			/* too late to catch up, start over */
+			dl->next = now;
+		}
+	} else {
+		int res;
+
+		res = sleep_until(dl, dl->next);
+		if (res != 0) {
+			return res;
+		}
+		dl->lateness = mono_now() - dl->next;
+	}
+	dl->next += dl->period;
+	return 0;
+}
+
+void
+deadline_close(struct deadline * const dl)
+{
+	if (dl->tfd > 0 && close(dl->tfd) == -1) {
+		perror("close(timerfd)");
+	}
+	dl->tfd = 0;
+}
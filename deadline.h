@@ -0,0 +1,67 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_DEADLINE_H
+#define DCF77PI_DEADLINE_H
+
+#include <stdbool.h>
+
+/**
+ * Periodic scheduler using absolute deadlines on CLOCK_MONOTONIC, so that
+ * oversleeping in one period does not delay the following ones. The fields
+ * should be considered private to deadline.c , except for reading the
+ * statistics.
+ */
+struct deadline {
+	/** next deadline in nanoseconds, 0 if not started yet */
+	long long next;
+	/** period in nanoseconds */
+	long long period;
+	/** lateness of the last wakeup in nanoseconds */
+	long long lateness;
+	/** number of deadlines which had already passed when waiting */
+	unsigned long long missed;
+	/** timerfd (Linux only), 0 to use clock_nanosleep() */
+	int tfd;
+};
+
+/**
+ * Initialize the scheduler. The first deadline is one period after the
+ * first call to {@link deadline_wait}.
+ *
+ * @param dl The scheduler to initialize.
+ * @param period The period in nanoseconds.
+ * @param use_timerfd Wait using a timerfd instead of clock_nanosleep()
+ * (Linux only).
+ * @return The scheduler was initialized succesfully (0), or errno on error.
+ */
+int deadline_init(struct deadline * const dl, long long period,
+    bool use_timerfd);
+
+/**
+ * Change the period, starting with the next deadline.
+ *
+ * @param dl The scheduler.
+ * @param period The new period in nanoseconds.
+ */
+void deadline_set_period(struct deadline * const dl, long long period);
+
+/**
+ * Wait until the next deadline and schedule the one after it. If the deadline
+ * has already passed, it counts as missed and there is no waiting. If it
+ * passed more than one period ago, the schedule restarts from the current
+ * time instead of catching up.
+ *
+ * @param dl The scheduler.
+ * @return 0 on success, or errno on error.
+ */
+int deadline_wait(struct deadline * const dl);
+
+/**
+ * Release the resources of the scheduler.
+ *
+ * @param dl The scheduler.
+ */
+void deadline_close(struct deadline * const dl);
+
+#endif
@@ -1,4 +1,4 @@
-// Copyright 2013-2018 René Ladan
+// Copyright 2013-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #ifndef DCF77PI_DECODE_TIME_H
@@ -90,6 +90,34 @@ struct DT_result {
 	bool leap_announce;
 };
 
+/**
+ * State of the time decoder, to be used with {@link decode_time_r} so that
+ * several receivers or log files can be decoded within one process. The fields
+ * should be considered private to decode_time.c , {@link decode_time} uses a
+ * single global instance.
+ */
+struct DT_state {
+	/** number of minutes in this hour with a DST announcement */
+	int dst_count;
+	/** number of minutes in this hour with a leap second announcement */
+	int leap_count;
+	/** number of correctly decoded minutes, wraps after one hour */
+	int minute_count;
+	/** results of the last decoded minute */
+	struct DT_result dt_res;
+	/** the last decoded minute contained an error */
+	bool olderr;
+	/** accumulated length of partial minutes in milliseconds */
+	unsigned acc_minlen_partial;
+};
+
+/**
+ * Initialize the state of a time decoder for use with {@link decode_time_r}.
+ *
+ * @param dts The state to initialize.
+ */
+void init_time_state(struct DT_state * const dts);
+
 /**
  * Decodes the current time from the internal bit buffer.
  *
@@ -113,4 +141,68 @@ struct DT_result {
 struct DT_result decode_time(unsigned init_min, int minlen, unsigned acc_minlen,
     const int buffer[], struct tm * const time);
 
+/**
+ * Reentrant version of {@link decode_time}.
+ *
+ * @param dts The time decoder state.
+ */
+struct DT_result decode_time_r(struct DT_state * const dts, unsigned init_min,
+    int minlen, unsigned acc_minlen, const int buffer[],
+    struct tm * const time);
+
+/**
+ * Compare two time decoder states, except for their number of correctly
+ * decoded minutes and their accumulated length of partial minutes. These only
+ * change the results in some minutes, see {@link time_history_used}.
+ *
+ * @param a The first time decoder state.
+ * @param b The second time decoder state.
+ * @return The states are equal apart from their history.
+ */
+bool equal_time_state(const struct DT_state * const a,
+    const struct DT_state * const b);
+
+/**
+ * Determine if decoding a minute could have had a different result for a
+ * different number of correctly decoded minutes (while a DST change or leap
+ * second announcement is being counted) or for a different accumulated
+ * length of partial minutes.
+ *
+ * @param before The time decoder state before decoding the minute.
+ * @param after The time decoder state after decoding the minute.
+ * @return The history was used.
+ */
+bool time_history_used(const struct DT_state * const before,
+    const struct DT_state * const after);
+
+/**
+ * Continue with the state of another time decoder which decoded the same
+ * minutes without using the history, see {@link time_history_used}. The
+ * number of correctly decoded minutes of dts is advanced by the number of
+ * minutes which the other decoder decoded in the meantime, its accumulated
+ * length of partial minutes is kept.
+ *
+ * @param dts The time decoder state, which must equal then according to
+ * {@link equal_time_state}.
+ * @param then The earlier state of the other decoder.
+ * @param now The current state of the other decoder.
+ */
+void adopt_time_state(struct DT_state * const dts,
+    const struct DT_state * const then, const struct DT_state * const now);
+
+/**
+ * Retrieve the state of the time decoder used by {@link decode_time}.
+ *
+ * @return The time decoder state.
+ */
+struct DT_state get_time_state(void);
+
+/**
+ * Continue with the given state in the time decoder used by
+ * {@link decode_time}, for example one saved by a previous run.
+ *
+ * @param dts The time decoder state.
+ */
+void set_time_state(const struct DT_state * const dts);
+
 #endif
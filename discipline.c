@@ -0,0 +1,365 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "discipline.h"
+
+#include "json_object.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timex.h>
+#include <time.h>
+
+/* write the drift file at most this often, in nanoseconds */
+#define SAVE_INTERVAL (3600 * 1000000000LL)
+
+static int
+kernel_set_freq(double freq)
+{
+	struct timex tx;
+
+	memset(&tx, 0, sizeof(tx));
+	tx.modes = MOD_FREQUENCY;
+	/* ppm with a 16 bit fraction */
+	tx.freq = (long)(freq * 65536.0);
+	return ntp_adjtime(&tx) == -1 ? -1 : 0;
+}
+
+static int
+kernel_step(long long offset)
+{
+	struct timespec ts;
+	long long ns;
+
+	if (clock_gettime(CLOCK_REALTIME, &ts) == -1) {
+		return -1;
+	}
+	ns = ts.tv_nsec + offset % 1000000000;
+	ts.tv_sec += offset / 1000000000 + ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	if (ts.tv_nsec < 0) {
+		ts.tv_sec--;
+		ts.tv_nsec += 1000000000;
+	}
+	return clock_settime(CLOCK_REALTIME, &ts);
+}
+
+static int
+dryrun_set_freq(double freq)
+{
+	return 0;
+}
+
+static int
+dryrun_step(long long offset)
+{
+	return 0;
+}
+
+const struct discipline_backend discipline_kernel = {
+	kernel_set_freq, kernel_step
+};
+
+const struct discipline_backend discipline_dryrun = {
+	dryrun_set_freq, dryrun_step
+};
+
+/* Copy an optional file name from the configuration, NULL if empty */
+static char *
+get_filename(struct json_object *config, const char * const key)
+{
+	struct json_object *value;
+	const char *str;
+
+	if (!json_object_object_get_ex(config, key, &value)) {
+		return NULL;
+	}
+	str = json_object_get_string(value);
+	return str == NULL || *str == '\0' ? NULL : strdup(str);
+}
+
+int
+discipline_policy(struct discipline_policy * const policy,
+    struct json_object *config)
+{
+	struct json_object *value;
+
+	policy->mode = edc_step;
+	policy->step_threshold = 128000000;
+	policy->time_constant = 16 * 60;
+	policy->driftfile = NULL;
+	policy->logfile = NULL;
+	if (config == NULL) {
+		return 0;
+	}
+	if (json_object_object_get_ex(config, "clockmode", &value)) {
+		const char *str = json_object_get_string(value);
+
+		if (strcmp(str, "slew") == 0) {
+			policy->mode = edc_slew;
+		} else if (strcmp(str, "dryrun") == 0) {
+			policy->mode = edc_dryrun;
+		} else if (strcmp(str, "step") != 0) {
+			fprintf(stderr, "clockmode must be \"step\", \"slew\" "
+			    "or \"dryrun\"\n");
+			return -1;
+		}
+	}
+	if (json_object_object_get_ex(config, "stepthreshold", &value)) {
+		int ms = json_object_get_int(value);
+
+		if (ms <= 0) {
+			fprintf(stderr, "stepthreshold must be positive\n");
+			return -1;
+		}
+		policy->step_threshold = ms * 1000000LL;
+	}
+	if (json_object_object_get_ex(config, "timeconstant", &value)) {
+		int min = json_object_get_int(value);
+
+		if (min <= 0 || min > 1440) {
+			fprintf(stderr, "timeconstant must be between 1 and "
+			    "1440 minutes\n");
+			return -1;
+		}
+		policy->time_constant = min * 60L;
+	}
+	policy->driftfile = get_filename(config, "driftfile");
+	policy->logfile = get_filename(config, "clocklog");
+	if (policy->mode == edc_dryrun && policy->logfile == NULL) {
+		fprintf(stderr, "clockmode \"dryrun\" requires clocklog\n");
+		discipline_free_policy(policy);
+		return -1;
+	}
+	return 0;
+}
+
+void
+discipline_free_policy(struct discipline_policy * const policy)
+{
+	free(policy->driftfile);
+	policy->driftfile = NULL;
+	free(policy->logfile);
+	policy->logfile = NULL;
+}
+
+static double
+clamp_freq(double freq)
+{
+	if (freq > DISCIPLINE_MAXFREQ) {
+		return DISCIPLINE_MAXFREQ;
+	}
+	if (freq < -DISCIPLINE_MAXFREQ) {
+		return -DISCIPLINE_MAXFREQ;
+	}
+	return freq;
+}
+
+/* Read the drift in ppm written by discipline_save() */
+static void
+read_driftfile(struct discipline * const dc)
+{
+	FILE *f;
+	double drift;
+
+	if (dc->policy.driftfile == NULL) {
+		return;
+	}
+	f = fopen(dc->policy.driftfile, "r");
+	if (f == NULL) {
+		/* not written yet */
+		return;
+	}
+	if (fscanf(f, "%lf", &drift) == 1 && drift >= -DISCIPLINE_MAXFREQ &&
+	    drift <= DISCIPLINE_MAXFREQ) {
+		dc->drift = drift;
+		dc->drift_known = true;
+	} else if (dc->log != NULL) {
+		fprintf(dc->log, "ignoring invalid drift file %s\n",
+		    dc->policy.driftfile);
+	}
+	(void)fclose(f);
+}
+
+int
+discipline_init(struct discipline * const dc,
+    struct discipline_policy * const policy,
+    const struct discipline_backend *backend)
+{
+	memset(dc, 0, sizeof(*dc));
+	dc->policy = *policy;
+	policy->driftfile = NULL;
+	policy->logfile = NULL;
+	dc->backend = backend != NULL ? backend :
+	    dc->policy.mode == edc_dryrun ? &discipline_dryrun :
+	    &discipline_kernel;
+	dc->last_mono = -1;
+	dc->fll_mono = -1;
+	dc->saved_mono = -1;
+	if (dc->policy.logfile != NULL) {
+		dc->log = fopen(dc->policy.logfile, "a");
+		if (dc->log == NULL) {
+			discipline_free_policy(&dc->policy);
+			return -1;
+		}
+		setvbuf(dc->log, NULL, _IOLBF, 0);
+	}
+	read_driftfile(dc);
+	if (dc->drift_known) {
+		dc->freq = dc->drift;
+		if (dc->log != NULL) {
+			fprintf(dc->log, "drift %+.3f ppm from %s\n", dc->drift,
+			    dc->policy.driftfile);
+		}
+		if (dc->backend->set_freq(dc->freq) == -1) {
+			discipline_close(dc);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Measure the drift from the offsets over at least one time constant,
+ * taking out the frequency corrections applied meanwhile.
+ */
+static void
+measure_drift(struct discipline * const dc, long long offset, long long mono)
+{
+	double span;
+
+	if (dc->fll_mono == -1) {
+		dc->fll_mono = mono;
+		dc->fll_offset = offset;
+		dc->fll_applied = 0;
+		return;
+	}
+	span = (mono - dc->fll_mono) / 1e9;
+	if (span < dc->policy.time_constant) {
+		return;
+	}
+	dc->drift = clamp_freq((offset - dc->fll_offset + dc->fll_applied) /
+	    span / 1000.0);
+	dc->drift_known = true;
+	dc->fll_mono = -1;
+}
+
+int
+discipline_update(struct discipline * const dc, long long offset,
+    long long mono)
+{
+	const double tc = dc->policy.time_constant;
+
+	if (offset > dc->policy.step_threshold ||
+	    offset < -dc->policy.step_threshold) {
+		if (dc->log != NULL) {
+			fprintf(dc->log, "%lli offset %+lli ns step\n",
+			    mono / 1000000000, offset);
+		}
+		if (dc->backend->step(offset) == -1) {
+			return -1;
+		}
+		dc->nstep++;
+		dc->last_mono = mono;
+		dc->last_offset = 0;
+		/* the offsets before the step cannot be compared anymore */
+		dc->fll_mono = -1;
+		return 1;
+	}
+
+	if (dc->last_mono != -1 && mono > dc->last_mono) {
+		double dt = (mono - dc->last_mono) / 1e9;
+
+		/* frequency correction applied since the previous update */
+		dc->fll_applied += dc->freq * dt * 1000.0;
+		if (!dc->drift_known) {
+			measure_drift(dc, offset, mono);
+		} else if (dt >= tc) {
+			/* long gap, a frequency measurement beats the PLL */
+			dc->drift = clamp_freq((dc->drift + dc->freq +
+			    (offset - dc->last_offset) / dt / 1000.0) / 2);
+		} else {
+			dc->drift = clamp_freq(dc->drift +
+			    offset * dt / (4 * tc * tc) / 1000.0);
+		}
+	} else if (!dc->drift_known) {
+		measure_drift(dc, offset, mono);
+	}
+	dc->freq = clamp_freq(dc->drift + offset / tc / 1000.0);
+	if (dc->log != NULL) {
+		fprintf(dc->log, "%lli offset %+lli ns freq %+.3f ppm drift "
+		    "%+.3f ppm%s\n", mono / 1000000000, offset, dc->freq,
+		    dc->drift, dc->drift_known ? "" : " (unknown)");
+	}
+	if (dc->backend->set_freq(dc->freq) == -1) {
+		return -1;
+	}
+	dc->nslew++;
+	dc->last_mono = mono;
+	dc->last_offset = offset;
+	if (dc->drift_known && (dc->saved_mono == -1 ||
+	    mono - dc->saved_mono >= SAVE_INTERVAL)) {
+		dc->saved_mono = mono;
+		if (discipline_save(dc) == -1 && dc->log != NULL) {
+			fprintf(dc->log, "writing %s failed: %s\n",
+			    dc->policy.driftfile, strerror(errno));
+		}
+	}
+	return 0;
+}
+
+int
+discipline_save(struct discipline * const dc)
+{
+	FILE *f;
+	char *tmp;
+	size_t len;
+	int res = 0;
+
+	/* a dry run does not correct the drift it measures */
+	if (dc->policy.driftfile == NULL || !dc->drift_known ||
+	    dc->policy.mode == edc_dryrun) {
+		return 0;
+	}
+	/* write a new file and rename it, so that it is never half-written */
+	len = strlen(dc->policy.driftfile) + sizeof(".tmp");
+	tmp = malloc(len);
+	if (tmp == NULL) {
+		return -1;
+	}
+	(void)snprintf(tmp, len, "%s.tmp", dc->policy.driftfile);
+	f = fopen(tmp, "w");
+	if (f == NULL) {
+		free(tmp);
+		return -1;
+	}
+	if (fprintf(f, "%.3f\n", dc->drift) < 0) {
+		res = -1;
+	}
+	if (fclose(f) == EOF) {
+		res = -1;
+	}
+	if (res == 0) {
+		res = rename(tmp, dc->policy.driftfile);
+	}
+	if (res == -1) {
+		(void)remove(tmp);
+	}
+	free(tmp);
+	return res;
+}
+
+void
+discipline_close(struct discipline * const dc)
+{
+	if (discipline_save(dc) == -1 && dc->log != NULL) {
+		fprintf(dc->log, "writing %s failed: %s\n",
+		    dc->policy.driftfile, strerror(errno));
+	}
+	if (dc->log != NULL) {
+		(void)fclose(dc->log);
+		dc->log = NULL;
+	}
+	discipline_free_policy(&dc->policy);
+}
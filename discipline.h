@@ -0,0 +1,178 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_DISCIPLINE_H
+#define DCF77PI_DISCIPLINE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+struct json_object;
+
+/** How the system clock is set */
+enum eDiscipline {
+	/** step the clock to each decoded minute using clock_settime() */
+	edc_step,
+	/** slew the clock using ntp_adjtime(), step only large offsets */
+	edc_slew,
+	/** like edc_slew, but only log the adjustments */
+	edc_dryrun
+};
+
+/** Largest frequency correction in ppm, the limit of the kernel */
+#define DISCIPLINE_MAXFREQ 500.0
+
+/**
+ * Configuration of the clock discipline.
+ */
+struct discipline_policy {
+	/** how the system clock is set */
+	enum eDiscipline mode;
+	/** step the clock instead when the offset is larger, in nanoseconds */
+	long long step_threshold;
+	/** time constant of the control loop in seconds */
+	long time_constant;
+	/** file to keep the frequency drift in across restarts, or NULL */
+	char *driftfile;
+	/** file to log the adjustments to, or NULL */
+	char *logfile;
+};
+
+/**
+ * Backend which applies the adjustments to a clock, so that the control loop
+ * can be tested without changing the system clock.
+ */
+struct discipline_backend {
+	/**
+	 * Set the frequency correction of the clock.
+	 *
+	 * @param freq The correction in ppm, positive to speed the clock up.
+	 * @return Success (0), or -1 with errno set.
+	 */
+	int (*set_freq)(double freq);
+	/**
+	 * Step the clock.
+	 *
+	 * @param offset The amount to add to the clock in nanoseconds.
+	 * @return Success (0), or -1 with errno set.
+	 */
+	int (*step)(long long offset);
+};
+
+/** Backend which adjusts the system clock using ntp_adjtime() */
+extern const struct discipline_backend discipline_kernel;
+
+/** Backend which leaves the clock alone, the adjustments are only logged */
+extern const struct discipline_backend discipline_dryrun;
+
+/**
+ * State of the control loop, a type II phase-locked loop which also measures
+ * the frequency directly (FLL) when it is not known yet or after a long gap.
+ * Each offset is corrected by a frequency of offset / time constant on top
+ * of the estimated drift of the clock, which itself integrates the offsets.
+ * The fields should be considered private to discipline.c .
+ */
+struct discipline {
+	/** the configuration */
+	struct discipline_policy policy;
+	/** the clock to adjust */
+	const struct discipline_backend *backend;
+	/** log of the adjustments, NULL if none */
+	FILE *log;
+	/** estimated frequency correction needed by the clock, in ppm */
+	double drift;
+	/** the drift is known, from the drift file or a measurement */
+	bool drift_known;
+	/** frequency correction currently applied, in ppm */
+	double freq;
+	/** monotonic time of the previous update in nanoseconds, -1 if none */
+	long long last_mono;
+	/** offset of the previous update, 0 after a step */
+	long long last_offset;
+	/** monotonic time the drift measurement started, -1 if none */
+	long long fll_mono;
+	/** offset when the drift measurement started */
+	long long fll_offset;
+	/** time corrected by the applied frequency since then, in ns */
+	double fll_applied;
+	/** monotonic time the drift file was written, -1 if never */
+	long long saved_mono;
+	/** number of updates which slewed the clock */
+	unsigned long nslew;
+	/** number of updates which stepped the clock */
+	unsigned long nstep;
+};
+
+/**
+ * Read the clock discipline from the configuration. The optional keys are
+ * "clockmode" ("step", "slew" or "dryrun", default "step"),
+ * "stepthreshold" (milliseconds, default 128), "timeconstant" (minutes,
+ * default 16), "driftfile" and "clocklog" (file names, default none).
+ * "dryrun" requires "clocklog".
+ *
+ * @param policy The policy to fill in, free it with
+ * {@link discipline_free_policy}.
+ * @param config The JSON object containing the parsed configuration from
+ * config.json , or NULL for the defaults.
+ * @return Success (0), or -1 if a value is invalid.
+ */
+int discipline_policy(struct discipline_policy * const policy,
+    struct json_object *config);
+
+/**
+ * Free the file names of a policy.
+ *
+ * @param policy The policy.
+ */
+void discipline_free_policy(struct discipline_policy * const policy);
+
+/**
+ * Initialize the control loop. The drift from the drift file, if any, is
+ * applied to the clock right away, so that the loop does not have to
+ * measure it again.
+ *
+ * @param dc The state to initialize.
+ * @param policy The configuration, copied into the state which then owns
+ * the file names.
+ * @param backend The clock to adjust, NULL to choose the backend from the
+ * mode of the policy.
+ * @return Success (0), or -1 if the log file cannot be opened or the clock
+ * cannot be adjusted.
+ */
+int discipline_init(struct discipline * const dc,
+    struct discipline_policy * const policy,
+    const struct discipline_backend *backend);
+
+/**
+ * Feed an offset measurement into the control loop and adjust the clock.
+ * Offsets larger than the step threshold are stepped away, smaller ones are
+ * slewed by changing the frequency of the clock until the next update. The
+ * drift file is written at most once per hour.
+ *
+ * @param dc The state of the control loop.
+ * @param offset The time of the reference minus the time of the clock at
+ * monotonic time mono, in nanoseconds.
+ * @param mono The monotonic time of the measurement in nanoseconds.
+ * @return 1 if the clock was stepped, 0 if it was slewed, or -1 with errno
+ * set if the adjustment failed.
+ */
+int discipline_update(struct discipline * const dc, long long offset,
+    long long mono);
+
+/**
+ * Write the drift file, if the drift is known and the clock is adjusted.
+ *
+ * @param dc The state of the control loop.
+ * @return Success (0), or -1 with errno set.
+ */
+int discipline_save(struct discipline * const dc);
+
+/**
+ * Write the drift file and free the state. The frequency correction stays
+ * in effect.
+ *
+ * @param dc The state of the control loop.
+ */
+void discipline_close(struct discipline * const dc);
+
+#endif
@@ -0,0 +1,282 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "edge.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#  include <linux/gpio.h>
+#  include <poll.h>
+#  include <sys/ioctl.h>
+#  if defined(GPIO_V2_GET_LINE_IOCTL)
+#    define HAVE_GPIOCHIP 1
+#  endif
+#endif
+
+static long long
+mono_now(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
+int
+edge_open_gpiochip(struct edge_source * const src, unsigned chip,
+    unsigned pin, bool active_high)
+{
+#if defined(HAVE_GPIOCHIP)
+	struct gpio_v2_line_request req;
+	struct gpio_v2_line_values val;
+	char buf[64];
+	int fd, res;
+
+	memset(src, 0, sizeof(*src));
+	src->fd = -1;
+	res = snprintf(buf, sizeof(buf), "/dev/gpiochip%u", chip);
+	if (res < 0 || res >= sizeof(buf)) {
+		fprintf(stderr, "hw.iodev too high? (%i)\n", res);
+		return EINVAL;
+	}
+	fd = open(buf, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "open %s: ", buf);
+		perror(NULL);
+		return errno;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.offsets[0] = pin;
+	req.num_lines = 1;
+	(void)strncpy(req.consumer, "dcf77pi", sizeof(req.consumer) - 1);
+	/* timestamps default to CLOCK_MONOTONIC */
+	req.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+	    GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	if (!active_high) {
+		/* let the kernel invert both the values and the edges */
+		req.config.flags |= GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+	}
+	if (ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+		res = errno;
+		perror("ioctl(GPIO_V2_GET_LINE_IOCTL)");
+		(void)close(fd);
+		return res;
+	}
+	(void)close(fd);
+	src->fd = req.fd;
+
+	memset(&val, 0, sizeof(val));
+	val.mask = 1;
+	if (ioctl(src->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &val) < 0) {
+		res = errno;
+		perror("ioctl(GPIO_V2_LINE_GET_VALUES_IOCTL)");
+		edge_close(src);
+		return res;
+	}
+	src->level = (int)(val.bits & 1);
+	src->known = mono_now();
+	src->type = ees_gpiochip;
+	return 0;
+#else
+	fprintf(stderr, "No GPIO character device support\n");
+	return ENOTSUP;
+#endif
+}
+
+void
+edge_open_synthetic(struct edge_source * const src, int level,
+    edge_cb next_cb, void *arg)
+{
+	memset(src, 0, sizeof(*src));
+	src->fd = -1;
+	src->type = ees_synthetic;
+	src->level = level;
+	src->next_cb = next_cb;
+	src->cb_arg = arg;
+}
+
+void
+edge_close(struct edge_source * const src)
+{
+	if (src->fd >= 0 && close(src->fd) == -1) {
+		perror("close(gpiochip line)");
+	}
+	src->fd = -1;
+	src->type = ees_none;
+}
+
+long long
+edge_now(const struct edge_source * const src)
+{
+	return (src->type == ees_gpiochip) ? mono_now() : src->known;
+}
+
+#if defined(HAVE_GPIOCHIP)
+static int
+read_gpiochip(struct edge_source * const src, long long until,
+    struct edge * const e)
+{
+	for (;;) {
+		struct gpio_v2_line_event ev;
+		struct pollfd pfd;
+		long long now;
+		int res, timeout;
+
+		now = mono_now();
+		/* round up, poll() has a resolution of 1 ms */
+		timeout = (now >= until) ? 0 :
+		    (int)((until - now + 999999) / 1000000);
+		pfd.fd = src->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		res = poll(&pfd, 1, timeout);
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		if (res == 0) {
+			now = mono_now();
+			if (now < until) {
+				continue;
+			}
+			if (now > src->known) {
+				src->known = now;
+			}
+			return 0;
+		}
+		if (read(src->fd, &ev, sizeof(ev)) != sizeof(ev)) {
+			return -1;
+		}
+		e->t = (long long)ev.timestamp_ns;
+		e->level = (ev.id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 0;
+		return 1;
+	}
+}
+#endif
+
+static int
+read_synthetic(struct edge_source * const src, long long until,
+    struct edge * const e)
+{
+	if (!src->have_synth) {
+		if (src->next_cb(src->cb_arg, &src->synth) != 0) {
+			return -1;
+		}
+		src->have_synth = true;
+	}
+	if (src->synth.t > until) {
+		if (until > src->known) {
+			src->known = until;
+		}
+		return 0;
+	}
+	*e = src->synth;
+	src->have_synth = false;
+	return 1;
+}
+
+int
+edge_read(struct edge_source * const src, long long until,
+    struct edge * const e)
+{
+	int res;
+
+	switch (src->type) {
+#if defined(HAVE_GPIOCHIP)
+	case ees_gpiochip:
+		res = read_gpiochip(src, until, e);
+		break;
+#endif
+	case ees_synthetic:
+		res = read_synthetic(src, until, e);
+		break;
+	default:
+		return -1;
+	}
+	if (res == 1) {
+		/*
+		 * An edge can become readable just after the poll() that
+		 * declared the level up to that moment known, move it to that
+		 * moment to keep the edges in order.
+		 */
+		if (e->t < src->known) {
+			e->t = src->known;
+		}
+		src->count++;
+	}
+	return res;
+}
+
+int
+edge_peek(struct edge_source * const src, long long until,
+    struct edge * const e)
+{
+	for (;;) {
+		if (src->have_next) {
+			if (src->next.t > until) {
+				return 0;
+			}
+			*e = src->next;
+			return 1;
+		}
+		if (src->known >= until) {
+			return 0;
+		}
+		switch (edge_read(src, until, &src->next)) {
+		case 1:
+			src->have_next = true;
+			src->known = src->next.t;
+			break;
+		case 0:
+			break;
+		default:
+			return -1;
+		}
+	}
+}
+
+void
+edge_apply(struct edge_source * const src)
+{
+	if (src->have_next) {
+		src->level = src->next.level;
+		src->have_next = false;
+	}
+}
+
+int
+edge_level_at(struct edge_source * const src, long long t, long long slack)
+{
+	for (;;) {
+		if (src->have_next) {
+			if (src->next.t > t) {
+				return src->level;
+			}
+			src->level = src->next.level;
+			src->have_next = false;
+			continue;
+		}
+		if (src->known >= t) {
+			return src->level;
+		}
+		switch (edge_read(src, t + slack, &src->next)) {
+		case 1:
+			src->have_next = true;
+			src->known = src->next.t;
+			break;
+		case 0:
+			break;
+		default:
+			return 2;
+		}
+	}
+}
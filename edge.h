@@ -0,0 +1,151 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_EDGE_H
+#define DCF77PI_EDGE_H
+
+#include <stdbool.h>
+
+/** A transition of the radio signal */
+struct edge {
+	/** time of the transition in nanoseconds */
+	long long t;
+	/** signal level after the transition, 1 is active and 0 is passive */
+	int level;
+};
+
+/** Type of the edge source */
+enum eES_type {
+	/** no edge source is opened */
+	ees_none,
+	/** Linux GPIO character device, timestamps from CLOCK_MONOTONIC */
+	ees_gpiochip,
+	/** edges from a callback, timestamps from a virtual clock */
+	ees_synthetic
+};
+
+/**
+ * Callback to obtain the next synthetic edge.
+ *
+ * @param arg The argument given to {@link edge_open_synthetic}.
+ * @param e The edge to fill in, edges must be in chronological order.
+ * @return 0 if an edge was filled in, -1 at the end of the stream.
+ */
+typedef int (*edge_cb)(void *arg, struct edge *e);
+
+/**
+ * State of an edge source. The fields should be considered private to
+ * edge.c
+ */
+struct edge_source {
+	/** type of this source */
+	enum eES_type type;
+	/** line event file descriptor (gpiochip only) */
+	int fd;
+	/** edge callback (synthetic only) */
+	edge_cb next_cb;
+	/** argument for the edge callback (synthetic only) */
+	void *cb_arg;
+	/** time in nanoseconds up to which the signal level is known */
+	long long known;
+	/** signal level at time {@link edge_source.known} */
+	int level;
+	/** edge which was read but which lies beyond the last query */
+	struct edge next;
+	/** {@link edge_source.next} is valid */
+	bool have_next;
+	/** synthetic edge obtained from the callback but not yet returned */
+	struct edge synth;
+	/** {@link edge_source.synth} is valid */
+	bool have_synth;
+	/** number of edges read so far */
+	unsigned long long count;
+};
+
+/**
+ * Open a GPIO line on the Linux GPIO character device for edge events.
+ *
+ * @param src The edge source to initialize.
+ * @param chip The number of the GPIO chip, as in /dev/gpiochipN .
+ * @param pin The line offset on the GPIO chip.
+ * @param active_high The signal is active when the pin value is high.
+ * @return The source was opened succesfully (0), or errno on error.
+ */
+int edge_open_gpiochip(struct edge_source * const src, unsigned chip,
+    unsigned pin, bool active_high);
+
+/**
+ * Open a synthetic edge source. Its virtual clock starts at time 0 with
+ * the given signal level and only advances through the queries made.
+ *
+ * @param src The edge source to initialize.
+ * @param level The initial signal level.
+ * @param next_cb The callback providing the edges.
+ * @param arg The argument to pass to the callback.
+ */
+void edge_open_synthetic(struct edge_source * const src, int level,
+    edge_cb next_cb, void *arg);
+
+/**
+ * Close the edge source.
+ *
+ * @param src The edge source to close.
+ */
+void edge_close(struct edge_source * const src);
+
+/**
+ * Retrieve the current time of the clock used by the edge source.
+ *
+ * @param src The edge source.
+ * @return The current time in nanoseconds.
+ */
+long long edge_now(const struct edge_source * const src);
+
+/**
+ * Wait for the next edge, but not past the given time.
+ *
+ * @param src The edge source.
+ * @param until The latest time to wait for, in nanoseconds.
+ * @param e The edge which was read, if any.
+ * @return 1 if an edge was read, 0 if none occurred before until, or -1 on
+ * error or at the end of the stream.
+ */
+int edge_read(struct edge_source * const src, long long until,
+    struct edge * const e);
+
+/**
+ * Look ahead for the next edge which is not applied yet, waiting for it until
+ * the given time at most.
+ *
+ * @param src The edge source.
+ * @param until The latest time to wait for, in nanoseconds.
+ * @param e The next edge, if it occurs no later than until.
+ * @return 1 if the next edge occurs no later than until, 0 if the signal level
+ * stays the same up to and including until, or -1 on error or at the end of
+ * the stream.
+ */
+int edge_peek(struct edge_source * const src, long long until,
+    struct edge * const e);
+
+/**
+ * Apply the edge found by {@link edge_peek}, which updates the current signal
+ * level.
+ *
+ * @param src The edge source.
+ */
+void edge_apply(struct edge_source * const src);
+
+/**
+ * Determine the signal level at the given time. If that level is not known
+ * yet, wait for the next edge or at most until t + slack, so that following
+ * queries up to that time do not have to wait again.
+ *
+ * @param src The edge source.
+ * @param t The time to query in nanoseconds.
+ * @param slack The extra time to wait for in nanoseconds.
+ * @return 0 or 1 for the signal level, or 2 if reading the edges failed.
+ */
+int edge_level_at(struct edge_source * const src, long long t,
+    long long slack);
+
+#endif
@@ -0,0 +1,159 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "heatmap.h"
+
+#include "calendar.h"
+
+#include <string.h>
+
+static const char * const kind_name[ehm_count] = {
+	"none", "receive", "transmit", "random", "parity"
+};
+
+void
+heatmap_init(struct heatmap * const hm)
+{
+	memset(hm, 0, sizeof(*hm));
+}
+
+void
+heatmap_add_bit(struct heatmap * const hm, struct GB_result bit, int bitpos)
+{
+	/* a new minute without a decoded time for the previous one */
+	if (bitpos <= hm->bitpos) {
+		memset(hm->pending, 0, sizeof(hm->pending));
+	}
+	hm->bitpos = bitpos;
+	if (bitpos < 0 || bitpos >= HEATMAP_NBITS) {
+		return;
+	}
+	switch (bit.hwstat) {
+	case ehw_receive:
+		hm->pending[bitpos] |= 1 << ehm_receive;
+		break;
+	case ehw_transmit:
+		hm->pending[bitpos] |= 1 << ehm_transmit;
+		break;
+	case ehw_random:
+		hm->pending[bitpos] |= 1 << ehm_random;
+		break;
+	default:
+		if (bit.bitval == ebv_none) {
+			hm->pending[bitpos] |= 1 << ehm_none;
+		}
+		break;
+	}
+}
+
+/* Mark the bits of a failed parity group, including the parity bit */
+static void
+mark_parity(struct heatmap * const hm, enum eDT_tval status, int start,
+    int stop)
+{
+	if (status == eval_parity) {
+		for (int i = start; i <= stop; i++) {
+			hm->pending[i] |= 1 << ehm_parity;
+		}
+	}
+}
+
+void
+heatmap_add_minute(struct heatmap * const hm, struct DT_result dt,
+    struct tm time)
+{
+	int hour;
+
+	if (time.tm_year != 0) {
+		mark_parity(hm, dt.minute_status, 21, 28);
+		mark_parity(hm, dt.hour_status, 29, 35);
+		mark_parity(hm, dt.mday_status, 36, 58);
+		hour = substract_minute(time, false).tm_hour;
+		hm->minutes[hour]++;
+		for (int i = 0; i < HEATMAP_NBITS; i++) {
+			for (int k = 0; hm->pending[i] != 0 && k < ehm_count;
+			    k++) {
+				hm->count[k][hour][i] +=
+				    (hm->pending[i] >> k) & 1;
+			}
+		}
+	}
+	memset(hm->pending, 0, sizeof(hm->pending));
+	hm->bitpos = HEATMAP_NBITS;
+}
+
+/* Write a string as a JSON string */
+static void
+print_json_string(FILE *out, const char * const str)
+{
+	putc('"', out);
+	for (const char *s = str; *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\') {
+			putc('\\', out);
+			putc(*s, out);
+		} else if ((unsigned char)*s < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned)*s);
+		} else {
+			putc(*s, out);
+		}
+	}
+	putc('"', out);
+}
+
+static void
+print_json(const struct heatmap * const hm, const char * const name,
+    FILE *out)
+{
+	fputs("{\"receiver\":", out);
+	print_json_string(out, name);
+	fputs(",\"minutes\":[", out);
+	for (int h = 0; h < 24; h++) {
+		fprintf(out, "%s%u", h == 0 ? "" : ",", hm->minutes[h]);
+	}
+	putc(']', out);
+	for (int k = 0; k < ehm_count; k++) {
+		fprintf(out, ",\"%s\":[", kind_name[k]);
+		for (int h = 0; h < 24; h++) {
+			fputs(h == 0 ? "[" : ",[", out);
+			for (int i = 0; i < HEATMAP_NBITS; i++) {
+				fprintf(out, "%s%u", i == 0 ? "" : ",",
+				    hm->count[k][h][i]);
+			}
+			putc(']', out);
+		}
+		putc(']', out);
+	}
+	fputs("}\n", out);
+}
+
+static void
+print_table(const struct heatmap * const hm, const char * const name,
+    FILE *out)
+{
+	fprintf(out, "receiver %s\n", name);
+	for (int k = 0; k < ehm_count; k++) {
+		fprintf(out, "%s\nhour minutes", kind_name[k]);
+		for (int i = 0; i < HEATMAP_NBITS; i++) {
+			fprintf(out, " %5d", i);
+		}
+		putc('\n', out);
+		for (int h = 0; h < 24; h++) {
+			fprintf(out, "%4d %7u", h, hm->minutes[h]);
+			for (int i = 0; i < HEATMAP_NBITS; i++) {
+				fprintf(out, " %5u", hm->count[k][h][i]);
+			}
+			putc('\n', out);
+		}
+	}
+}
+
+void
+heatmap_print(const struct heatmap * const hm, const char * const name,
+    FILE *out, bool json)
+{
+	if (json) {
+		print_json(hm, name, out);
+	} else {
+		print_table(hm, name, out);
+	}
+}
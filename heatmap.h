@@ -0,0 +1,93 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_HEATMAP_H
+#define DCF77PI_HEATMAP_H
+
+#include "decode_time.h"
+#include "input.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/** Number of bit positions counted, longer minutes are ignored */
+#define HEATMAP_NBITS 60
+
+/** Kinds of errors counted per bit position */
+enum eHeatmap {
+	/** no value ('_') */
+	ehm_none,
+	/** receiver error ('r') */
+	ehm_receive,
+	/** transmitter error ('x') */
+	ehm_transmit,
+	/** random error ('#') */
+	ehm_random,
+	/** part of a parity group (minute, hour or date) which failed */
+	ehm_parity,
+	/** number of kinds */
+	ehm_count
+};
+
+/**
+ * Errors per kind, hour of the day and bit position, counted over the
+ * minutes of a single receiver in the order they are decoded. The hour is the
+ * one during which the bits were received, which is the hour of the minute
+ * before the decoded time. The fields should be considered private to
+ * heatmap.c .
+ */
+struct heatmap {
+	/** errors by kind, hour and bit position */
+	uint32_t count[ehm_count][24][HEATMAP_NBITS];
+	/** decoded minutes by hour */
+	uint32_t minutes[24];
+	/** kinds of errors of the bits of the current minute, one bit each */
+	uint8_t pending[HEATMAP_NBITS];
+	/** position of the previous bit */
+	int bitpos;
+};
+
+/**
+ * Initialize the counters.
+ *
+ * @param hm The counters.
+ */
+void heatmap_init(struct heatmap * const hm);
+
+/**
+ * Count a bit of the current minute.
+ *
+ * @param hm The counters.
+ * @param bit The bit as returned by the bit reader.
+ * @param bitpos The position of the bit, as returned by get_bitpos().
+ */
+void heatmap_add_bit(struct heatmap * const hm, struct GB_result bit,
+    int bitpos);
+
+/**
+ * Count the bits of the current minute under the hour in which they were
+ * received. The bits are dropped if the minute has no decoded time yet
+ * (tm_year 0).
+ *
+ * @param hm The counters.
+ * @param dt The decoding result of the minute.
+ * @param time The decoded time of the minute.
+ */
+void heatmap_add_minute(struct heatmap * const hm, struct DT_result dt,
+    struct tm time);
+
+/**
+ * Write the counters as one 24 x 60 matrix (hours by bit positions) for each
+ * kind of error.
+ *
+ * @param hm The counters.
+ * @param name The name of the receiver, for example its log file.
+ * @param out The stream to write to.
+ * @param json Write one JSON object on a single line instead of a table.
+ */
+void heatmap_print(const struct heatmap * const hm, const char * const name,
+    FILE *out, bool json);
+
+#endif
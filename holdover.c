@@ -0,0 +1,199 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "holdover.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* edges further off a whole number of seconds start a new series, in ns */
+#define EDGE_TOLERANCE 50000000LL
+/* edges further apart start a new series, in seconds */
+#define EDGE_MAXGAP 60
+/* frequency error assumed before there is any estimate, ppm */
+#define MAXUNC 500.0
+/* minutes further apart than this are reconciled, in ns */
+#define GAP (120 * 1000000000LL)
+/* larger differences are not slewed but taken over directly, in ns */
+#define MAXRESIDUAL 1000000000LL
+
+void
+holdover_init(struct holdover * const ho, long long precision)
+{
+	memset(ho, 0, sizeof(*ho));
+	ho->precision = precision;
+	ho->unc = -1;
+}
+
+static const struct holdover_anchor *
+last_anchor(const struct holdover * const ho)
+{
+	return &ho->anchor[(ho->next + HOLDOVER_NANCHOR - 1) %
+	    HOLDOVER_NANCHOR];
+}
+
+static const struct holdover_anchor *
+last_edge(const struct holdover * const ho)
+{
+	return &ho->edge[(ho->nextedge + HOLDOVER_NEDGE - 1) % HOLDOVER_NEDGE];
+}
+
+/*
+ * Fit the difference between the local time and the decoded time of the
+ * anchors relative to ref, the slope is the frequency error.
+ */
+static bool
+fit_anchors(const struct holdover_anchor * const anchor, unsigned n,
+    const struct holdover_anchor * const ref, long long precision,
+    double * const freq, double * const unc)
+{
+	double sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0, span, slope, rms;
+	double tmin = 0;
+
+	if (n < 2) {
+		return false;
+	}
+	for (unsigned i = 0; i < n; i++) {
+		const struct holdover_anchor * const a = &anchor[i];
+		/* seconds, and the difference in ns, relative to ref */
+		const double x = (a->time - ref->time) / 1e9;
+		const double y = (double)((a->mono - ref->mono) -
+		    (a->time - ref->time));
+
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+		syy += y * y;
+		if (x < tmin) {
+			tmin = x;
+		}
+	}
+	span = -tmin;
+	if (span < 60 || n * sxx - sx * sx <= 0) {
+		return false;
+	}
+	slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+	/* scatter of the anchors around the fit */
+	rms = n > 2 ? sqrt(fmax(0, (syy - sy * sy / n - slope *
+	    (sxy - sx * sy / n)) / (n - 2))) : 0;
+	/* ns/s to ppm */
+	*freq = slope / 1000;
+	*unc = 2 * fmax((double)precision, rms) / span / 1000;
+	return true;
+}
+
+/* Combine both estimates, weighted by their inverse variance */
+static void
+update_estimate(struct holdover * const ho)
+{
+	double w = 0, wf = 0, f, u;
+
+	if (fit_anchors(ho->anchor, ho->nanchor, last_anchor(ho),
+	    ho->precision, &f, &u)) {
+		w += 1 / (u * u);
+		wf += f / (u * u);
+	}
+	if (fit_anchors(ho->edge, ho->nedge, last_edge(ho), ho->precision,
+	    &f, &u)) {
+		w += 1 / (u * u);
+		wf += f / (u * u);
+	}
+	if (w > 0) {
+		ho->freq = wf / w;
+		ho->unc = 1 / sqrt(w);
+	}
+}
+
+void
+holdover_add_edge(struct holdover * const ho, long long mono)
+{
+	long long d, k;
+
+	if (ho->nedge > 0) {
+		d = mono - last_edge(ho)->mono;
+		k = (d + 500000000) / 1000000000;
+		if (d <= 0 || k < 1 || k > EDGE_MAXGAP ||
+		    llabs(d - k * 1000000000) > EDGE_TOLERANCE) {
+			/* not a whole number of seconds later, start over */
+			ho->nedge = 0;
+			ho->nextedge = 0;
+			ho->edge_sec = 0;
+		} else {
+			ho->edge_sec += k;
+		}
+	}
+	ho->edge[ho->nextedge].mono = mono;
+	ho->edge[ho->nextedge].time = ho->edge_sec * 1000000000;
+	ho->nextedge = (ho->nextedge + 1) % HOLDOVER_NEDGE;
+	if (ho->nedge < HOLDOVER_NEDGE) {
+		ho->nedge++;
+	}
+	update_estimate(ho);
+}
+
+void
+holdover_add_minute(struct holdover * const ho, long long mono,
+    long long time)
+{
+	long long pred, err, diff;
+
+	if (ho->nanchor > 0) {
+		const struct holdover_anchor * const a = last_anchor(ho);
+
+		if (time <= a->time || mono <= a->mono) {
+			/* not a later minute, start over */
+			ho->nanchor = 0;
+			ho->next = 0;
+			ho->residual = 0;
+		} else if (time - a->time >= GAP &&
+		    holdover_time(ho, mono, &pred, &err) == 0) {
+			/* the time continues from the holdover */
+			diff = pred - time;
+			if (llabs(diff) > ho->precision &&
+			    llabs(diff) < MAXRESIDUAL) {
+				ho->residual = diff;
+				ho->residual_mono = mono;
+			} else {
+				ho->residual = 0;
+			}
+		}
+	}
+	ho->anchor[ho->next].mono = mono;
+	ho->anchor[ho->next].time = time;
+	ho->next = (ho->next + 1) % HOLDOVER_NANCHOR;
+	if (ho->nanchor < HOLDOVER_NANCHOR) {
+		ho->nanchor++;
+	}
+	update_estimate(ho);
+}
+
+int
+holdover_time(const struct holdover * const ho, long long mono,
+    long long * const time, long long * const err)
+{
+	const struct holdover_anchor *a;
+	double freq, unc, dt;
+	long long r;
+
+	if (ho->nanchor == 0) {
+		return -1;
+	}
+	a = last_anchor(ho);
+	freq = ho->unc < 0 ? 0 : ho->freq;
+	unc = ho->unc < 0 ? MAXUNC : ho->unc;
+	*time = a->time + llround((mono - a->mono) / (1 + freq / 1e6));
+	dt = fabs((double)(mono - a->mono)) / 1e9;
+	*err = ho->precision + llround(unc * 1000 * dt +
+	    0.5 * HOLDOVER_WANDER * dt * dt);
+
+	/* what is left of the difference found after the last holdover */
+	r = llabs(ho->residual) - llround(HOLDOVER_SLEW * 1000 *
+	    (mono > ho->residual_mono ? mono - ho->residual_mono : 0) / 1e9);
+	if (ho->residual != 0 && r > 0) {
+		*time += ho->residual > 0 ? r : -r;
+		*err += r;
+	}
+	return 0;
+}
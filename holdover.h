@@ -0,0 +1,119 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_HOLDOVER_H
+#define DCF77PI_HOLDOVER_H
+
+#include <stdbool.h>
+
+/** Number of decoded minutes kept to estimate the frequency error */
+#define HOLDOVER_NANCHOR 64
+
+/** Number of rising edges kept to estimate the frequency error */
+#define HOLDOVER_NEDGE 600
+
+/** Rate at which a difference found after a holdover is slewed away, ppm */
+#define HOLDOVER_SLEW 500
+
+/**
+ * Assumed change of the frequency error over time during a holdover, in
+ * ns/s^2 (0.1 ns/s^2 is 0.36 ppm per hour), for the error bound.
+ */
+#define HOLDOVER_WANDER 0.1
+
+/**
+ * The start of a decoded minute or of a second according to the local
+ * clock
+ */
+struct holdover_anchor {
+	/** local (monotonic) time of the start in ns */
+	long long mono;
+	/**
+	 * decoded time of the start of the minute in ns since the epoch, or
+	 * for an edge the number of whole seconds since the first edge in ns
+	 */
+	long long time;
+};
+
+/**
+ * Holdover timekeeping: when the reception fails, the time continues from
+ * the last decoded minute using the local clock, corrected for its
+ * estimated frequency error. The frequency error is fitted through the
+ * recently decoded minutes, and also through the rising edges of the last
+ * ten minutes or so which are known much sooner but span a shorter time.
+ * Both are combined according to their uncertainty. The fields should be
+ * considered private to holdover.c .
+ */
+struct holdover {
+	/** recently decoded minutes, oldest first once the ring is full */
+	struct holdover_anchor anchor[HOLDOVER_NANCHOR];
+	/** number of anchors */
+	unsigned nanchor;
+	/** index of the next anchor to write */
+	unsigned next;
+	/** uncertainty of a single anchor (edge timestamp) in ns */
+	long long precision;
+	/** recent rising edges, oldest first once the ring is full */
+	struct holdover_anchor edge[HOLDOVER_NEDGE];
+	/** number of edges */
+	unsigned nedge;
+	/** index of the next edge to write */
+	unsigned nextedge;
+	/** number of whole seconds since the first edge */
+	long long edge_sec;
+	/** estimated frequency error of the local clock, ppm, fast positive */
+	double freq;
+	/** uncertainty of freq, ppm, negative if there is no estimate */
+	double unc;
+	/** remaining difference at residual_mono being slewed away, ns */
+	long long residual;
+	/** local time at which residual was set */
+	long long residual_mono;
+};
+
+/**
+ * Initialize the holdover state.
+ *
+ * @param ho The state.
+ * @param precision The uncertainty of a single edge timestamp in ns, for
+ * example one sample period.
+ */
+void holdover_init(struct holdover * const ho, long long precision);
+
+/**
+ * Add the rising edge at the start of a second. The edges are counted in
+ * whole seconds, an edge which does not lie a whole number of seconds after
+ * the previous one starts a new series.
+ *
+ * @param ho The state.
+ * @param mono The local time of the edge in ns, see bitinfo.edge_mono .
+ */
+void holdover_add_edge(struct holdover * const ho, long long mono);
+
+/**
+ * Add a decoded minute. If the time predicted for it differs from the
+ * decoded time after a holdover, the difference is slewed away at
+ * {@link HOLDOVER_SLEW} ppm instead of being stepped.
+ *
+ * @param ho The state.
+ * @param mono The local time of the start of the minute in ns.
+ * @param time The decoded time of the start of the minute in ns since the
+ * epoch.
+ */
+void holdover_add_minute(struct holdover * const ho, long long mono,
+    long long time);
+
+/**
+ * Get the time at the given local time, and its error bound. The bound
+ * grows with the time since the last decoded minute.
+ *
+ * @param ho The state.
+ * @param mono The local time in ns.
+ * @param time The time in ns since the epoch.
+ * @param err The error bound of time in ns.
+ * @return Success (0), or -1 if no minute was decoded yet.
+ */
+int holdover_time(const struct holdover * const ho, long long mono,
+    long long * const time, long long * const err);
+
+#endif
@@ -1,17 +1,27 @@
-// Copyright 2013-2020 René Ladan and Udo Klein and "JsBergbau"
+// Copyright 2013-2026 René Ladan and Udo Klein and "JsBergbau"
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "input.h"
 
+#include "binlog.h"
+#include "deadline.h"
+#include "edge.h"
+#include "logwriter.h"
+#include "rawcap.h"
+#include "warmstart.h"
+
 #include "json_object.h"
 
 #include <errno.h>
 #include <fcntl.h>
 #include <math.h>
-#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sysexits.h>
 #include <time.h>
 #include <unistd.h>
@@ -32,7 +42,6 @@
 #elif defined(__APPLE__) && (defined(__OSX__) || defined(__MACH__))
 #  warning MacOS, GPIO support available but no port for Rapberry Pi
 #  define NOLIVE 1
-#  define MACOS 1
 #elif defined(__CYGWIN__)
 #  warning Cygwin, GPIO support not yet implemented
 #  define NOLIVE 1
@@ -42,49 +51,139 @@
 #  error Unsupported operating system, please send a patch to the author
 #endif
 
-/** maximum number of bits in a minute */
-#define BUFLEN 60
-
-static int bitpos;              /* second */
-static unsigned dec_bp;         /* bitpos decrease in file mode */
-static int buffer[BUFLEN];      /* wrap after BUFLEN positions */
-static FILE *logfile;           /* auto-appended in live mode */
-static int fd;                  /* gpio file */
-static struct hardware hw;
-static struct bitinfo bit;
-static unsigned acc_minlen;
-static int cutoff;
-static struct GB_result gb_res;
-static unsigned filemode = 0;   /* 0 = no file, 1 = input, 2 = output */
+/* offset of the tokens in a binary log file */
+#define BINLOG_DATA sizeof(struct binlog_file)
+
+/* Default state for the non-reentrant functions */
+static struct GB_state gbs_global = {
+	.init_bit = 2
+};
+
+void
+init_input_state(struct GB_state * const gbs)
+{
+	memset(gbs, 0, sizeof(*gbs));
+	gbs->init_bit = 2;
+}
+
+static bool
+check_freq(unsigned freq)
+{
+	if (freq < 10 || freq > 155000 || (freq & 1) == 1) {
+		fprintf(stderr, "hw.freq must be an even number between 10 and"
+		    "155000 inclusive\n");
+		return false;
+	}
+	return true;
+}
 
 int
-set_mode_file(const char * const infilename)
+set_mode_file_r(struct GB_state * const gbs, const char * const infilename)
 {
-	if (filemode == 1) {
+	if (gbs->filemode == 1) {
 		fprintf(stderr, "Already initialized to live mode.\n");
-		cleanup();
+		cleanup_r(gbs);
 		return -1;
 	}
 	if (infilename == NULL) {
 		fprintf(stderr, "infilename is NULL\n");
 		return -1;
 	}
-	logfile = fopen(infilename, "r");
-	if (logfile == NULL) {
+	if (!gbs->stdio_only) {
+		struct stat st;
+		void *map = MAP_FAILED;
+		int fd;
+
+		fd = open(infilename, O_RDONLY);
+		if (fd == -1) {
+			perror("open(logfile)");
+			return errno;
+		}
+		/* mmap() does not work on empty files or pipes */
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+		    st.st_size > 0) {
+			map = mmap(NULL, (size_t)st.st_size, PROT_READ,
+			    MAP_PRIVATE, fd, 0);
+		}
+		(void)close(fd);
+		if (map != MAP_FAILED) {
+			uint32_t version;
+
+			version = binlog_version(map, (size_t)st.st_size);
+			if (version != 0 && version != BINLOG_VERSION) {
+				fprintf(stderr, "Unsupported binary log "
+				    "version %u\n", version);
+				(void)munmap(map, (size_t)st.st_size);
+				return EINVAL;
+			}
+			(void)posix_madvise(map, (size_t)st.st_size,
+			    POSIX_MADV_SEQUENTIAL);
+			gbs->logmap.data = map;
+			gbs->logmap.size = (size_t)st.st_size;
+			gbs->logmap.pos = 0;
+			gbs->logmap.binary = version != 0;
+			gbs->filemode = 2;
+			return 0;
+		}
+	}
+	gbs->logfile = fopen(infilename, "r");
+	if (gbs->logfile == NULL) {
 		perror("fopen(logfile)");
 		return errno;
+	} else {
+		unsigned char hdr[BINLOG_DATA];
+		ssize_t n;
+
+		/* pread() leaves pipes alone */
+		n = pread(fileno(gbs->logfile), hdr, sizeof(hdr), 0);
+		if (n > 0 && binlog_version(hdr, (size_t)n) != 0) {
+			fprintf(stderr, "Binary log files must be mapped into "
+			    "memory\n");
+			(void)fclose(gbs->logfile);
+			gbs->logfile = NULL;
+			return EINVAL;
+		}
 	}
-	filemode = 2;
+	gbs->filemode = 2;
 	return 0;
 }
 
+#if !defined(NOLIVE)
+/*
+ * Continue with the bit lengths of a previous run from the state file, if it
+ * is recent enough. get_bit_live() then skips the reset to the nominal values
+ * but still does not learn from the first, partial, bit.
+ */
+static void
+read_warmstart(struct GB_state * const gbs, struct json_object *config)
+{
+	struct json_object *value;
+	struct warmstart ws;
+	struct timespec now;
+
+	if (!json_object_object_get_ex(config, "statefile", &value) ||
+	    warmstart_read(json_object_get_string(value), &ws) != 0) {
+		return;
+	}
+	(void)clock_gettime(CLOCK_REALTIME, &now);
+	if (!warmstart_check(&ws, gbs->hw.freq,
+	    now.tv_sec * 1000000000LL + now.tv_nsec)) {
+		return;
+	}
+	gbs->bit.realfreq = ws.realfreq;
+	gbs->bit.bit0 = ws.bit0;
+	gbs->bit.bit20 = ws.bit20;
+	gbs->init_bit = 1;
+}
+#endif
+
 int
-set_mode_live(struct json_object *config)
+set_mode_live_r(struct GB_state * const gbs, struct json_object *config)
 {
 #if defined(NOLIVE)
 	fprintf(stderr,
 	    "No GPIO interface available, disabling live decoding\n");
-	cleanup();
+	cleanup_r(gbs);
 	return -1;
 #else
 #if defined(__FreeBSD__)
@@ -94,161 +193,317 @@ set_mode_live(struct json_object *config)
 	struct json_object *value;
 	int res;
 
-	if (filemode == 2) {
+	if (gbs->filemode == 2) {
 		fprintf(stderr, "Already initialized to file mode.\n");
-		cleanup();
+		cleanup_r(gbs);
 		return -1;
 	}
 	/* fill hardware structure and initialize hardware */
 	if (json_object_object_get_ex(config, "pin", &value)) {
-		hw.pin = (unsigned)json_object_get_int(value);
+		gbs->hw.pin = (unsigned)json_object_get_int(value);
 	} else {
 		fprintf(stderr, "Key 'pin' not found\n");
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
 	if (json_object_object_get_ex(config, "activehigh", &value)) {
-		hw.active_high = (bool)json_object_get_boolean(value);
+		gbs->hw.active_high = (bool)json_object_get_boolean(value);
 	} else {
 		fprintf(stderr, "Key 'activehigh' not found\n");
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
 	if (json_object_object_get_ex(config, "freq", &value)) {
-		hw.freq = (unsigned)json_object_get_int(value);
+		gbs->hw.freq = (unsigned)json_object_get_int(value);
 	} else {
 		fprintf(stderr, "Key 'freq' not found\n");
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
-	if (hw.freq < 10 || hw.freq > 155000 || (hw.freq & 1) == 1) {
-		fprintf(stderr, "hw.freq must be an even number between 10 and"
-		    "155000 inclusive\n");
-		cleanup();
+	if (!check_freq(gbs->hw.freq)) {
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
-	bit.signal = malloc(hw.freq / 2);
+	if (json_object_object_get_ex(config, "filter", &value)) {
+		const char *filter = json_object_get_string(value);
+
+		if (strcmp(filter, "samples") == 0) {
+			gbs->hw.filter = efilter_samples;
+		} else if (strcmp(filter, "timestamps") == 0) {
+			gbs->hw.filter = efilter_timestamps;
+		} else {
+			fprintf(stderr, "Unknown filter '%s'\n", filter);
+			cleanup_r(gbs);
+			return EX_DATAERR;
+		}
+	}
+	if (json_object_object_get_ex(config, "groupdelay", &value)) {
+		gbs->hw.group_delay = json_object_get_int(value) * 1000LL;
+	}
+	read_warmstart(gbs, config);
+	gbs->bit.signal = malloc(gbs->hw.freq / 2);
+	if (json_object_object_get_ex(config, "rawcapture", &value)) {
+		struct json_object *hvalue;
+		int hours = 24;
+
+		if (json_object_object_get_ex(config, "rawcapturehours",
+		    &hvalue)) {
+			hours = json_object_get_int(hvalue);
+		}
+		if (hours < 1) {
+			fprintf(stderr, "rawcapturehours must be positive\n");
+			cleanup_r(gbs);
+			return EX_DATAERR;
+		}
+		res = rawcap_open(&gbs->rawcap, json_object_get_string(value),
+		    (uint64_t)hours * 3600, gbs->hw.freq);
+		if (res != 0) {
+			cleanup_r(gbs);
+			return res;
+		}
+	}
 #if defined(__FreeBSD__)
 	if (json_object_object_get_ex(config, "iodev", &value)) {
-		hw.iodev = (unsigned)json_object_get_int(value);
+		gbs->hw.iodev = (unsigned)json_object_get_int(value);
 	} else {
 		fprintf(stderr, "Key 'iodev' not found\n");
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
-	res = snprintf(buf, sizeof(buf), "/dev/gpioc%u", hw.iodev);
+	res = snprintf(buf, sizeof(buf), "/dev/gpioc%u", gbs->hw.iodev);
 	if (res < 0 || res >= sizeof(buf)) {
 		fprintf(stderr, "hw.iodev too high? (%i)\n", res);
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
-	fd = open(buf, O_RDWR);
-	if (fd < 0) {
+	gbs->fd = open(buf, O_RDWR);
+	if (gbs->fd < 0) {
 		fprintf(stderr, "open %s: ", buf);
 		perror(NULL);
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
 
-	pin.gp_pin = hw.pin;
+	pin.gp_pin = gbs->hw.pin;
 	pin.gp_flags = GPIO_PIN_INPUT;
-	if (ioctl(fd, GPIOSETCONFIG, &pin) < 0) {
+	if (ioctl(gbs->fd, GPIOSETCONFIG, &pin) < 0) {
 		perror("ioctl(GPIOSETCONFIG)");
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
 #elif defined(__linux__)
-	fd = open("/sys/class/gpio/export", O_WRONLY);
-	if (fd < 0) {
+	if (json_object_object_get_ex(config, "edges", &value)) {
+		gbs->hw.edges = (bool)json_object_get_boolean(value);
+	}
+	if (json_object_object_get_ex(config, "edgedecoder", &value)) {
+		gbs->hw.edge_decoder = (bool)json_object_get_boolean(value);
+	}
+	if (gbs->hw.edges) {
+		if (json_object_object_get_ex(config, "iodev", &value)) {
+			gbs->hw.iodev = (unsigned)json_object_get_int(value);
+		} else {
+			fprintf(stderr, "Key 'iodev' not found\n");
+			cleanup_r(gbs);
+			return EX_DATAERR;
+		}
+		res = edge_open_gpiochip(&gbs->esrc, gbs->hw.iodev, gbs->hw.pin,
+		    gbs->hw.active_high);
+		if (res != 0) {
+			cleanup_r(gbs);
+			return res;
+		}
+		gbs->tbase = gbs->esrc.known;
+		gbs->filemode = 1;
+		return 0;
+	}
+	if (json_object_object_get_ex(config, "timerfd", &value)) {
+		gbs->hw.timerfd = (bool)json_object_get_boolean(value);
+	}
+	gbs->fd = open("/sys/class/gpio/export", O_WRONLY);
+	if (gbs->fd < 0) {
 		perror("open(/sys/class/gpio/export)");
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
-	res = snprintf(buf, sizeof(buf), "%u", hw.pin);
+	res = snprintf(buf, sizeof(buf), "%u", gbs->hw.pin);
 	if (res < 0 || res >= sizeof(buf)) {
 		fprintf(stderr, "hw.pin too high? (%i)\n", res);
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
-	if (write(fd, buf, res) < 0) {
+	if (write(gbs->fd, buf, res) < 0) {
 		if (errno != EBUSY) {
 			perror("write(export)");
-			cleanup();
+			cleanup_r(gbs);
 			return errno; /* EBUSY -> pin already exported ? */
 		}
 	}
-	if (close(fd) == -1) {
+	if (close(gbs->fd) == -1) {
 		perror("close(export)");
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
 	res = snprintf(buf, sizeof(buf), "/sys/class/gpio/gpio%u/direction",
-	    hw.pin);
+	    gbs->hw.pin);
 	if (res < 0 || res >= sizeof(buf)) {
 		fprintf(stderr, "hw.pin too high? (%i)\n", res);
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
-	fd = open(buf, O_RDWR);
-	if (fd < 0) {
+	gbs->fd = open(buf, O_RDWR);
+	if (gbs->fd < 0) {
 		perror("open(direction)");
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
-	if (write(fd, "in", 3) < 0) {
+	if (write(gbs->fd, "in", 3) < 0) {
 		perror("write(in)");
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
-	if (close(fd) == -1) {
+	if (close(gbs->fd) == -1) {
 		perror("close(direction)");
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
 	res = snprintf(buf, sizeof(buf), "/sys/class/gpio/gpio%u/value",
-	    hw.pin);
+	    gbs->hw.pin);
 	if (res < 0 || res >= sizeof(buf)) {
 		fprintf(stderr, "hw.pin too high? (%i)\n", res);
-		cleanup();
+		cleanup_r(gbs);
 		return EX_DATAERR;
 	}
-	fd = open(buf, O_RDONLY | O_NONBLOCK);
-	if (fd < 0) {
+	gbs->fd = open(buf, O_RDONLY | O_NONBLOCK);
+	if (gbs->fd < 0) {
 		perror("open(value)");
-		cleanup();
+		cleanup_r(gbs);
 		return errno;
 	}
 #endif
-	filemode = 1;
+	res = deadline_init(&gbs->dl, 1000000000 / gbs->hw.freq,
+	    gbs->hw.timerfd);
+	if (res != 0) {
+		cleanup_r(gbs);
+		return res;
+	}
+	gbs->filemode = 1;
 	return 0;
 #endif
 }
 
+int
+set_mode_synthetic_r(struct GB_state * const gbs, unsigned freq,
+    bool edge_decoder, int (*next_cb)(void *, struct edge *), void *arg)
+{
+	if (gbs->filemode != 0) {
+		fprintf(stderr, "Already initialized.\n");
+		cleanup_r(gbs);
+		return -1;
+	}
+	if (!check_freq(freq)) {
+		return EX_DATAERR;
+	}
+	gbs->hw.freq = freq;
+	gbs->hw.active_high = true;
+	gbs->hw.edges = true;
+	gbs->hw.edge_decoder = edge_decoder;
+	gbs->bit.signal = malloc(gbs->hw.freq / 2);
+	edge_open_synthetic(&gbs->esrc, 0, next_cb, arg);
+	gbs->tbase = gbs->esrc.known;
+	gbs->filemode = 1;
+	return 0;
+}
+
+int
+set_mode_replay_r(struct GB_state * const gbs, const char * const filename)
+{
+	int res;
+
+	if (gbs->filemode != 0) {
+		fprintf(stderr, "Already initialized.\n");
+		cleanup_r(gbs);
+		return -1;
+	}
+	res = rawcap_open_read(&gbs->replay, filename);
+	if (res != 0) {
+		return res;
+	}
+	if (!check_freq(gbs->replay.file->freq)) {
+		cleanup_r(gbs);
+		return EX_DATAERR;
+	}
+	gbs->hw.freq = gbs->replay.file->freq;
+	gbs->hw.active_high = rawcap_block(&gbs->replay, gbs->replay.seq,
+	    gbs->replay.buf) != 0 || gbs->replay.buf->active_high == 1;
+	gbs->bit.signal = malloc(gbs->hw.freq / 2);
+	gbs->filemode = 1;
+	return 0;
+}
+
 void
-cleanup(void)
+set_filter_r(struct GB_state * const gbs, enum eGB_filter filter)
+{
+	gbs->hw.filter = filter;
+}
+
+void
+set_stdio_only_r(struct GB_state * const gbs, bool stdio_only)
+{
+	gbs->stdio_only = stdio_only;
+}
+
+void
+set_sample_jitter_r(struct GB_state * const gbs,
+    long long (*jitter_cb)(void *arg), void *arg)
+{
+	gbs->jitter_cb = jitter_cb;
+	gbs->jitter_arg = arg;
+}
+
+void
+cleanup_r(struct GB_state * const gbs)
 {
-	if (fd > 0 && close(fd) == -1) {
+	if (gbs->fd > 0 && close(gbs->fd) == -1) {
 #if defined(__FreeBSD__)
 		perror("close(/dev/gpioc*)");
 #elif defined(__linux__)
 		perror("close(/sys/class/gpio/*)");
 #endif
 	}
-	fd = 0;
-	if (logfile != NULL) {
-		if (fclose(logfile) == EOF) {
+	gbs->fd = 0;
+	deadline_close(&gbs->dl);
+	rawcap_close(&gbs->rawcap);
+	rawcap_close(&gbs->replay);
+	if (gbs->esrc.type != ees_none) {
+		edge_close(&gbs->esrc);
+	}
+	if (gbs->logw.running && logwriter_close(&gbs->logw) != 0) {
+		perror("write(logfile)");
+	}
+	if (gbs->logfile != NULL) {
+		if (fclose(gbs->logfile) == EOF) {
 			perror("fclose(logfile)");
 		} else {
-			logfile = NULL;
+			gbs->logfile = NULL;
+		}
+	}
+	if (gbs->logmap.data != NULL) {
+		if (munmap((void *)gbs->logmap.data, gbs->logmap.size) == -1) {
+			perror("munmap(logfile)");
 		}
+		gbs->logmap.data = NULL;
 	}
-	free(bit.signal);
+	free(gbs->bit.signal);
 }
 
 int
-get_pulse(void)
+get_pulse_r(struct GB_state * const gbs)
 {
 	int tmpch;
+
+	if (gbs->esrc.type != ees_none) {
+		return edge_level_at(&gbs->esrc, edge_now(&gbs->esrc), 0);
+	}
 #if defined(NOLIVE)
 	tmpch = 2;
 #else
@@ -256,68 +511,345 @@ get_pulse(void)
 #if defined(__FreeBSD__)
 	struct gpio_req req;
 
-	req.gp_pin = hw.pin;
-	count = ioctl(fd, GPIOGET, &req);
+	req.gp_pin = gbs->hw.pin;
+	count = ioctl(gbs->fd, GPIOGET, &req);
 	tmpch = (req.gp_value == GPIO_PIN_HIGH) ? 1 : 0;
 	if (count < 0) {
 #elif defined(__linux__)
-	count = read(fd, &tmpch, 1);
+	count = read(gbs->fd, &tmpch, 1);
 	tmpch -= '0';
-	if (lseek(fd, 0, SEEK_SET) == (off_t)-1)
+	if (lseek(gbs->fd, 0, SEEK_SET) == (off_t)-1)
 		return 2; /* rewind to prevent EBUSY/no read failed */
 	if (count != 1) {
 #endif
 		return 2; /* hardware failure? */
 	}
 
-	if (!hw.active_high) {
+	if (!gbs->hw.active_high) {
 		tmpch = 1 - tmpch;
 	}
 #endif
 	return tmpch;
 }
 
+static long long
+mono_now(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
+static long long
+real_now(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_REALTIME, &tp);
+	return tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
 /*
  * Clear the cutoff value and the state values, except emark_toolong and
  * emark_late to be able to determine if this flag can be cleared again.
  */
 static void
-set_new_state(void)
+set_new_state(struct GB_state * const gbs)
+{
+	if (!gbs->gb_res.skip) {
+		gbs->cutoff = -1;
+	}
+	gbs->gb_res.bad_io = false;
+	gbs->gb_res.bitval = ebv_none;
+	if (gbs->gb_res.marker != emark_toolong &&
+	    gbs->gb_res.marker != emark_late) {
+		gbs->gb_res.marker = emark_none;
+	}
+	gbs->gb_res.hwstat = ehw_ok;
+	gbs->gb_res.done = false;
+	gbs->gb_res.skip = false;
+}
+
+/*
+ * Time of sample k of the current bit when reading edges. The timestamps of
+ * the edges are exact, so there is no scheduling delay to compensate for using
+ * realfreq and the samples are taken at exactly hw.freq Hz.
+ */
+static long long
+sample_time(struct GB_state * const gbs, unsigned long long k)
+{
+	unsigned long long j = gbs->nsample + k;
+
+	return gbs->tbase + (long long)(j / gbs->hw.freq) * 1000000000 +
+	    (long long)(j % gbs->hw.freq) * 1000000000 / gbs->hw.freq;
+}
+
+/* Move the sample grid forward by n samples */
+static void
+advance_samples(struct GB_state * const gbs, unsigned long long n)
+{
+	n += gbs->nsample;
+	gbs->tbase += (long long)(n / gbs->hw.freq) * 1000000000;
+	gbs->nsample = (unsigned)(n % gbs->hw.freq);
+}
+
+static long long
+next_sample_time(struct GB_state * const gbs)
+{
+	long long t;
+
+	/* sample_time(gbs, 0) and advance_samples(gbs, 1), once per sample */
+	t = gbs->tbase + (long long)gbs->nsample * 1000000000 / gbs->hw.freq;
+	if (++gbs->nsample == gbs->hw.freq) {
+		gbs->nsample = 0;
+		gbs->tbase += 1000000000;
+	}
+	return t;
+}
+
+/*
+ * Time at which the last sample was taken, for the sampling loops which do
+ * not ask read_sample() for the time of each sample
+ */
+static long long
+last_sample_time(struct GB_state * const gbs)
+{
+	if (gbs->esrc.type != ees_none) {
+		/* next_sample_time() was called last */
+		return gbs->nsample == 0 ? gbs->tbase - 1000000000 +
+		    (long long)(gbs->hw.freq - 1) * 1000000000 / gbs->hw.freq :
+		    gbs->tbase + (long long)(gbs->nsample - 1) * 1000000000 /
+		    gbs->hw.freq;
+	}
+	if (gbs->replay.file != NULL) {
+		const struct rawcap_block * const blk = gbs->replay.blk;
+
+		return blk == NULL ? -1 : blk->t +
+		    (long long)(gbs->replay.pos - 1) * 1000000000 / blk->freq;
+	}
+	return mono_now();
+}
+
+/* First sample of the current bit taken at or after time tm */
+static unsigned long long
+first_sample_at(struct GB_state * const gbs, long long tm)
+{
+	long long k;
+
+	k = (tm - gbs->tbase) / 1000000000 * gbs->hw.freq +
+	    (tm - gbs->tbase) % 1000000000 * gbs->hw.freq / 1000000000 -
+	    gbs->nsample;
+	if (k < 0) {
+		k = 0;
+	}
+	while (sample_time(gbs, (unsigned long long)k) < tm) {
+		k++;
+	}
+	while (k > 0 && sample_time(gbs, (unsigned long long)k - 1) >= tm) {
+		k--;
+	}
+	return (unsigned long long)k;
+}
+
+/* Write text to the log file, if any, in its format */
+static void
+write_log_text(struct GB_state * const gbs, const char * const text)
+{
+	if (gbs->logw.running) {
+		logwriter_write(&gbs->logw, text, strlen(text));
+	}
+}
+
+/*
+ * Write to the log file, if any, and keep a copy of the text logged for the
+ * current bit for get_snapshot_r()
+ */
+static void
+write_log(struct GB_state * const gbs, const char * const fmt, ...)
+{
+	va_list ap;
+	size_t len;
+
+	len = strlen(gbs->logbuf);
+	va_start(ap, fmt);
+	(void)vsnprintf(gbs->logbuf + len, sizeof(gbs->logbuf) - len, fmt, ap);
+	va_end(ap);
+	write_log_text(gbs, gbs->logbuf + len);
+}
+
+static void
+reset_frequency(struct GB_state * const gbs)
+{
+	write_log(gbs, "%s",
+	    gbs->bit.realfreq <= gbs->hw.freq * 500000 ? "<" :
+	    gbs->bit.realfreq > gbs->hw.freq * 1000000 ? ">" : "");
+	gbs->bit.realfreq = gbs->hw.freq * 1000000;
+	gbs->bit.freq_reset = true;
+	gbs->resets.freq++;
+}
+
+static void
+reset_bitlen(struct GB_state * const gbs)
+{
+	write_log(gbs, "!");
+	gbs->bit.bit0 = gbs->bit.realfreq / 10;
+	gbs->bit.bit20 = gbs->bit.realfreq / 5;
+	gbs->bit.bitlen_reset = true;
+	gbs->resets.bitlen++;
+}
+
+/*
+ * Handle the end of the low part of the second, which is the start of the next
+ * second, after bit.t samples.
+ */
+static bool
+end_of_second(struct GB_state * const gbs, bool is_eom, bool *adj_freq)
 {
-	if (!gb_res.skip) {
-		cutoff = -1;
+	bool newminute;
+
+	newminute = gbs->bit.t * 2000000 > gbs->bit.realfreq * 3;
+	if (gbs->init_bit == 2) {
+		gbs->init_bit--;
+	}
+
+	if (newminute) {
+		/*
+		 * Reset the frequency and the EOM flag if two consecutive EOM
+		 * markers come in, which means something is wrong.
+		 */
+		if (is_eom) {
+			if (gbs->gb_res.marker == emark_minute) {
+				gbs->gb_res.marker = emark_none;
+			} else if (gbs->gb_res.marker == emark_late) {
+				gbs->gb_res.marker = emark_toolong;
+			}
+			reset_frequency(gbs);
+			*adj_freq = false;
+		} else {
+			if (gbs->gb_res.marker == emark_none) {
+				gbs->gb_res.marker = emark_minute;
+			} else if (gbs->gb_res.marker == emark_toolong) {
+				gbs->gb_res.marker = emark_late;
+			}
+		}
 	}
-	gb_res.bad_io = false;
-	gb_res.bitval = ebv_none;
-	if (gb_res.marker != emark_toolong && gb_res.marker != emark_late) {
-		gb_res.marker = emark_none;
+	return newminute;
+}
+
+static void
+set_timeout_state(struct GB_state * const gbs, char *outch)
+{
+	if (gbs->bit.tlow <= gbs->hw.freq / 20) {
+		gbs->gb_res.hwstat = ehw_receive;
+		*outch = 'r';
+	} else if (gbs->bit.tlow * 100 / gbs->bit.t >= 99) {
+		gbs->gb_res.hwstat = ehw_transmit;
+		*outch = 'x';
+	} else {
+		gbs->gb_res.hwstat = ehw_random;
+		*outch = '#';
 	}
-	gb_res.hwstat = ehw_ok;
-	gb_res.done = false;
-	gb_res.skip = false;
 }
 
+/* Store samples from up to (but not including) to in bit.signal */
 static void
-reset_frequency(void)
+fill_signal(struct GB_state * const gbs, unsigned long long from,
+    unsigned long long to, int p)
 {
-	if (logfile != NULL) {
-		fprintf(logfile, "%s",
-		    bit.realfreq <= hw.freq * 500000 ? "<" :
-		    bit.realfreq > hw.freq * 1000000 ? ">" : "");
+	if (gbs->bit.signal == NULL) {
+		return;
+	}
+	for (; from < to && (from & 7) != 0; from++) {
+		gbs->bit.signal[from / 8] |= p << (unsigned char)(from & 7);
+	}
+	if (to - from >= 8) {
+		memset(gbs->bit.signal + from / 8, p == 1 ? 0xff : 0,
+		    (to - from) / 8);
+		from += (to - from) & ~7ULL;
+	}
+	for (; from < to; from++) {
+		if ((from & 7) == 0) {
+			gbs->bit.signal[from / 8] = 0;
+		}
+		gbs->bit.signal[from / 8] |= p << (unsigned char)(from & 7);
 	}
-	bit.realfreq = hw.freq * 1000000;
-	bit.freq_reset = true;
 }
 
+/*
+ * Set up the filter, which reaches 50% after hw.freq/20 samples (i.e. 50 ms).
+ * This only depends on the sample frequency.
+ */
 static void
-reset_bitlen(void)
+set_coefficients(struct GB_state * const gbs)
+{
+	gbs->coef.freq = gbs->hw.freq;
+	gbs->coef.r = exp2(-20.0 / gbs->hw.freq);
+	gbs->coef.a = 1000000000 - (long long)(1000000000 * gbs->coef.r);
+}
+
+/*
+ * Read the next sample, either from the edges or by polling the pin. If ts is
+ * not NULL, it receives the time at which the sample was taken.
+ */
+static int
+read_sample(struct GB_state * const gbs, long long *ts)
+{
+	long long t;
+	int p;
+
+	if (gbs->esrc.type != ees_none) {
+		if (gbs->jitter_cb != NULL) {
+			gbs->tbase += gbs->jitter_cb(gbs->jitter_arg);
+		}
+		/*
+		 * Reconstruct the sample from the edges, waiting up to 50 ms
+		 * extra in one go when the signal is idle.
+		 */
+		t = next_sample_time(gbs);
+		p = edge_level_at(&gbs->esrc, t, 50000000);
+		if (p == 2 && gbs->esrc.type == ees_synthetic) {
+			/* like the end of a raw capture */
+			gbs->gb_res.done = true;
+		}
+	} else if (gbs->replay.file != NULL) {
+		/* the capture provides the time, no need to wait */
+		p = rawcap_read(&gbs->replay, ts);
+		if (p == -1) {
+			gbs->gb_res.done = true;
+			return 2;
+		}
+		return p;
+	} else {
+		p = get_pulse_r(gbs);
+		if (ts == NULL) {
+			return p;
+		}
+		t = mono_now();
+	}
+	if (ts != NULL) {
+		*ts = t;
+	}
+	return p;
+}
+
+/*
+ * Sleep until the absolute deadline of the next sample when polling, so that
+ * oversleeping does not accumulate. Returns false on error.
+ */
+static bool
+wait_sample(struct GB_state * const gbs)
 {
-	if (logfile != NULL) {
-		fprintf(logfile, "!");
+	if (gbs->esrc.type != ees_none || gbs->replay.file != NULL) {
+		return true; /* edge_level_at() did any waiting, if needed */
+	}
+	if (deadline_wait(&gbs->dl) != 0) {
+		return false;
+	}
+	if (gbs->dl.lateness > gbs->bit.lateness) {
+		gbs->bit.lateness = gbs->dl.lateness;
 	}
-	bit.bit0 = bit.realfreq / 10;
-	bit.bit20 = bit.realfreq / 5;
-	bit.bitlen_reset = true;
+	return true;
 }
 
 /*
@@ -326,96 +858,49 @@ reset_bitlen(void)
  * implementation for this come from Udo Klein, with permission.
  * http://blog.blinkenlight.net/experiments/dcf77/binary-clock/#comment-5916
  */
-struct GB_result
-get_bit_live(void)
+static bool
+sample_bit(struct GB_state * const gbs, bool is_eom, char *outch,
+    bool *adj_freq)
 {
-	char outch = '?';
-	bool adj_freq = true;
+	const long long a = gbs->coef.a;
+	const unsigned tmax = gbs->hw.freq * 2;
+	const unsigned long long timeout = gbs->bit.realfreq * 2500000;
 	bool newminute = false;
-	unsigned stv = 1;
-	struct timespec slp;
-#if !defined(MACOS)
-	struct timespec tp0, tp1;
-#endif
-	unsigned sec2;
-	long long a, y = 1000000000;
-	static int init_bit = 2;
-	bool is_eom = gb_res.marker == emark_minute ||
-	    gb_res.marker == emark_late;
-
-	bit.freq_reset = false;
-	bit.bitlen_reset = false;
-
-	set_new_state();
-
-	/*
-	 * One period is either 1000 ms or 2000 ms long (normal or padding for
-	 * last). The active part is either 100 ms ('0') or 200 ms ('1') long.
-	 * The maximum allowed values as percentage of the second length are
-	 * specified as half the value and the whole value of the lengths of
-	 * bit 0 and bit 20 respectively.
-	 *
-	 * ~A > 3/2 * realfreq: end-of-minute
-	 * ~A > 5/2 * realfreq: timeout
-	 */
+	unsigned stv = 1, t, n = 0;
+	unsigned long long missed = gbs->dl.missed;
+	long long y = 1000000000;
+	unsigned char sig = 0;
 
-	if (init_bit == 2) {
-		bit.realfreq = hw.freq * 1000000;
-		bit.bit0 = bit.realfreq / 10;
-		bit.bit20 = bit.realfreq / 5;
-	}
-	sec2 = 1000000000 / (hw.freq * hw.freq);
-	/* Set up filter, reach 50% after hw.freq/20 samples (i.e. 50 ms) */
-	a = 1000000000 - (long long)(1000000000 * exp2(-20.0 / hw.freq));
-	bit.tlow = -1;
-	bit.tlast0 = -1;
+	for (t = 0; t < tmax; t++) {
+		int p;
 
-	for (bit.t = 0; bit.t < hw.freq * 2; bit.t++) {
-#if !defined(MACOS)
-		(void)clock_gettime(CLOCK_MONOTONIC, &tp0);
-#endif
-		int p = get_pulse();
+		p = read_sample(gbs, NULL);
 		if (p == 2) {
-			gb_res.bad_io = true;
-			outch = '*';
+			gbs->gb_res.bad_io = true;
+			*outch = '*';
+			/* a truncated bit says nothing about the frequency */
+			*adj_freq = false;
 			break;
 		}
-		if (bit.signal != NULL) {
-			if ((bit.t & 7) == 0) {
-				bit.signal[bit.t / 8] = 0;
+		/* pack the samples into bit.signal a byte at a time */
+		if (t > 0 && (t & 7) == 0) {
+			if (gbs->bit.signal != NULL) {
+				gbs->bit.signal[t / 8 - 1] = sig;
 			}
-			/* clear data from previous second */
-			bit.signal[bit.t / 8] |=
-			    p << (unsigned char)(bit.t & 7);
+			sig = 0;
 		}
+		sig |= (unsigned char)(p << (t & 7));
+		n = t + 1;
 
 		if (y >= 0 && y < a / 2) {
-			bit.tlast0 = (int)bit.t;
+			gbs->bit.tlast0 = (int)t;
 		}
 		y += a * (p * 1000000000 - y) / 1000000000;
 
-		/*
-		 * Prevent algorithm collapse during thunderstorms or
-		 * scheduler abuse
-		 */
-		if (bit.realfreq <= hw.freq * 500000 ||
-		    bit.realfreq > hw.freq * 1000000) {
-			reset_frequency();
-			adj_freq = false;
-		}
-
-		if (bit.t > bit.realfreq * 2500000) {
-			if (bit.tlow <= hw.freq / 20) {
-				gb_res.hwstat = ehw_receive;
-				outch = 'r';
-			} else if (bit.tlow * 100 / bit.t >= 99) {
-				gb_res.hwstat = ehw_transmit;
-				outch = 'x';
-			} else {
-				gb_res.hwstat = ehw_random;
-				outch = '#';
-			}
-			adj_freq = false;
+		if (t > timeout) {
+			gbs->bit.t = t;
+			set_timeout_state(gbs, outch);
+			*adj_freq = false;
 			break; /* timeout */
 		}
 
@@ -427,154 +912,771 @@ get_bit_live(void)
 			/* end of high part of second */
 			y = 0;
 			stv = 0;
-			bit.tlow = (int)bit.t;
+			gbs->bit.tlow = (int)t;
 		}
 		if (y > 500000000 && stv == 0) {
 			/* end of low part of second */
-			newminute = bit.t * 2000000 > bit.realfreq * 3;
-			if (init_bit == 2) {
-				init_bit--;
-			}
-
-			if (newminute) {
-				/*
-				 * Reset the frequency and the EOM flag if two
-				 * consecutive EOM markers come in, which means
-				 * something is wrong.
-				 */
-				if (is_eom) {
-					if (gb_res.marker == emark_minute) {
-						gb_res.marker = emark_none;
-					} else if (gb_res.marker ==
-					    emark_late) {
-						gb_res.marker = emark_toolong;
-					}
-					reset_frequency();
-					adj_freq = false;
-				} else {
-					if (gb_res.marker == emark_none) {
-						gb_res.marker = emark_minute;
-					} else if (gb_res.marker ==
-					    emark_toolong) {
-						gb_res.marker = emark_late;
-					}
-				}
-			}
+			gbs->bit.t = t;
+			gbs->bit.edge_mono = last_sample_time(gbs);
+			newminute = end_of_second(gbs, is_eom, adj_freq);
 			break; /* start of new second */
 		}
-		long long twait = (long long)(sec2 * bit.realfreq / 1000000);
-#if !defined(MACOS)
-		(void)clock_gettime(CLOCK_MONOTONIC, &tp1);
-		twait = twait - (tp1.tv_sec - tp0.tv_sec) *
-		    1000000000 - (tp1.tv_nsec - tp0.tv_nsec);
-#endif
-		slp.tv_sec = twait / 1000000000;
-		slp.tv_nsec = twait % 1000000000;
-		while (twait > 0 && nanosleep(&slp, &slp) > 0)
-			; /* empty loop */
-	}
-	if (bit.t >= hw.freq * 2) {
-		/* this can actually happen */
-		if (gb_res.hwstat == ehw_ok) {
-			gb_res.hwstat = ehw_random;
-			outch = '#';
+		if (!wait_sample(gbs)) {
+			gbs->gb_res.bad_io = true;
+			*outch = '*';
+			*adj_freq = false;
+			break;
 		}
-		reset_frequency();
-		adj_freq = false;
 	}
-
-	if (!gb_res.bad_io && gb_res.hwstat == ehw_ok) {
-		if (2 * bit.realfreq * bit.tlow * (1 + (newminute ? 1 : 0)) <
-		    (bit.bit0 + bit.bit20) * bit.t) {
-			/* zero bit, ~100 ms active signal */
-			gb_res.bitval = ebv_0;
-			outch = '0';
-			buffer[bitpos] = 0;
-		} else if (bit.realfreq * bit.tlow * (1 + (newminute ? 1 : 0)) <
-		    (bit.bit0 + bit.bit20) * bit.t) {
-			/* one bit, ~200 ms active signal */
-			gb_res.bitval = ebv_1;
-			outch = '1';
-			buffer[bitpos] = 1;
-		} else {
-			/* bad radio signal, retain old value */
-			gb_res.bitval = ebv_none;
-			outch = '_';
-			adj_freq = false;
-		}
+	/* the last, possibly partial, byte */
+	if (gbs->bit.signal != NULL && n > 0) {
+		gbs->bit.signal[(n - 1) / 8] = sig;
 	}
+	gbs->bit.t = t;
+	gbs->bit.missed = (unsigned)(gbs->dl.missed - missed);
+	return newminute;
+}
 
-	if (!gb_res.bad_io) {
-		if (init_bit == 1) {
-			init_bit--;
-		} else if (gb_res.hwstat == ehw_ok &&
-		    gb_res.marker == emark_none) {
-			unsigned long long avg;
-			if (bitpos == 0 && gb_res.bitval == ebv_0) {
-				bit.bit0 +=
-				    ((long long)(bit.tlow * 1000000 -
-				    bit.bit0) / 2);
-			}
-			if (bitpos == 20 && gb_res.bitval == ebv_1) {
-				bit.bit20 +=
-				    ((long long)(bit.tlow * 1000000 -
-				    bit.bit20) / 2);
-			}
+/*
+ * Same as sample_bit(), but the position of each sample within the bit is
+ * derived from the time it was taken instead of from counting the samples.
+ * When samples are missed, the last level read is held for them and the
+ * filter takes all of them into account at once. Without missed or late
+ * samples, the results equal those of sample_bit().
+ */
+static bool
+sample_bit_timestamps(struct GB_state * const gbs, bool is_eom, char *outch,
+    bool *adj_freq)
+{
+	const double r = gbs->coef.r;
+	const long long a = gbs->coef.a;
+	const unsigned long long tmax = gbs->hw.freq * 2;
+	const unsigned long long timeout = gbs->bit.realfreq * 2500000;
+	/* allow the end of a 2 s bit to be seen late after a delayed sample */
+	const unsigned long long tlimit = tmax + gbs->hw.freq / 10;
+	bool newminute = false;
+	unsigned stv = 1;
+	unsigned long long missed = gbs->dl.missed;
+	unsigned long long k, kprev = 0;
+	long long y = 1000000000, t0 = -1;
+	int pprev = 1;
+
+	for (;;) {
+		long long ts;
+		int p;
+
+		p = read_sample(gbs, &ts);
+		if (p == 2) {
+			gbs->gb_res.bad_io = true;
+			*outch = '*';
+			/* a truncated bit says nothing about the frequency */
+			*adj_freq = false;
+			break;
+		}
+		if (t0 == -1) {
+			t0 = ts;
+		}
+		/* nearest sample on the nominal grid, never going back */
+		k = (unsigned long long)(((ts - t0) * gbs->hw.freq +
+		    500000000) / 1000000000);
+		if (k < kprev) {
+			k = kprev;
+		}
+		gbs->bit.t = (unsigned)k;
+		gbs->bit.t_ns = ts - t0;
+		if (k >= tlimit) {
+			/* stalled beyond the longest possible bit */
+			break;
+		}
+		if (k > kprev + 1) {
+			fill_signal(gbs, kprev + 1, k, pprev);
+			/* the held level for the samples in between */
+			y += (long long)(1000000000 * (1 - pow(r,
+			    (double)(k - kprev - 1)))) * (pprev * 1000000000 -
+			    y) / 1000000000;
+		}
+		fill_signal(gbs, k, k + 1, p);
+
+		if (k == 0 || k > kprev) {
+			if (y >= 0 && y < a / 2) {
+				gbs->bit.tlast0 = (int)k;
+			}
+			y += a * (p * 1000000000 - y) / 1000000000;
+		}
+		kprev = k;
+		pprev = p;
+
+		if (k > timeout) {
+			set_timeout_state(gbs, outch);
+			*adj_freq = false;
+			break; /* timeout */
+		}
+
+		if (y < 500000000 && stv == 1) {
+			/* end of high part of second */
+			y = 0;
+			stv = 0;
+			gbs->bit.tlow = (int)k;
+			gbs->bit.tlow_ns = ts - t0;
+		}
+		if (y > 500000000 && stv == 0) {
+			/* end of low part of second */
+			if (k >= tmax) {
+				gbs->bit.t = (unsigned)tmax - 1;
+			} else {
+				gbs->bit.edge_mono = ts;
+			}
+			newminute = end_of_second(gbs, is_eom, adj_freq);
+			break; /* start of new second */
+		}
+		if (!wait_sample(gbs)) {
+			gbs->gb_res.bad_io = true;
+			*outch = '*';
+			*adj_freq = false;
+			break;
+		}
+	}
+	gbs->bit.missed = (unsigned)(gbs->dl.missed - missed);
+	return newminute;
+}
+
+/*
+ * Number of samples at a constant level after which the output of the
+ * low-pass filter, starting at distance d from that level, is closer than 0.5
+ * to that level. Each sample multiplies the distance with r.
+ */
+static unsigned long long
+samples_to_half(double d, double r)
+{
+	double n;
+
+	if (d < 0.5) {
+		return 1;
+	}
+	n = floor(log(0.5 / d) / log(r)) + 1;
+	return n < 1 ? 1 : (unsigned long long)n;
+}
+
+/*
+ * Decode the bit directly from the edges instead of from individual samples.
+ * Between two edges the level is constant, so the output of the low-pass
+ * filter of sample_bit() follows a geometric series and the sample at which
+ * the Schmitt trigger fires can be calculated in closed form. Short pulses
+ * are rejected just like the filter does, and the results equal those of
+ * sample_bit() on the same grid except for rounding.
+ *
+ * Only the edges and the moments the Schmitt trigger is expected to fire need
+ * any work, there are no per-sample computations or wakeups.
+ */
+static bool
+decode_edges(struct GB_state * const gbs, bool is_eom, char *outch,
+    bool *adj_freq)
+{
+	const double r = gbs->coef.r;
+	const double a = 1 - r;
+	bool newminute = false, done = false;
+	unsigned long long k = 0, tmax, timeout;
+	unsigned stv = 1;
+	double y = 1;
+
+	tmax = gbs->hw.freq * 2;
+	/* the first sample for which sample_bit() would time out */
+	timeout = gbs->bit.realfreq * 2500000 + 1;
+	if (timeout < tmax) {
+		tmax = timeout;
+	}
+
+	while (!done && k < tmax) {
+		unsigned long long kev, last, len;
+		struct edge e;
+		bool bad = false;
+		int p, res;
+
+		/* the edges up to and including sample k set its level */
+		while ((res = edge_peek(&gbs->esrc, sample_time(gbs, k), &e)) ==
+		    1) {
+			edge_apply(&gbs->esrc);
+		}
+		if (res < 0) {
+			gbs->gb_res.bad_io = true;
+			gbs->gb_res.done = gbs->esrc.type == ees_synthetic;
+			*outch = '*';
+			*adj_freq = false;
+			gbs->bit.t = (unsigned)k++;
+			done = true;
+			break;
+		}
+		p = gbs->esrc.level;
+
+		/* sample at which the Schmitt trigger fires at this level */
+		if (stv == 1 && p == 0) {
+			kev = k + samples_to_half(y, r) - 1;
+		} else if (stv == 0 && p == 1) {
+			kev = k + samples_to_half(1 - y, r) - 1;
+		} else {
+			kev = tmax - 1;
+		}
+		last = (kev < tmax - 1) ? kev : tmax - 1;
+
+		/* wait for the next edge, up to the moment of interest */
+		res = edge_peek(&gbs->esrc, sample_time(gbs, last), &e);
+		if (res == 1) {
+			len = first_sample_at(gbs, e.t) - k;
+		} else if (res == 0) {
+			len = last - k + 1;
+		} else {
+			/* the samples up to the last known time are valid */
+			len = first_sample_at(gbs, gbs->esrc.known + 1);
+			len = (len > k) ? len - k : 0;
+			bad = true;
+		}
+
+		fill_signal(gbs, k, k + len, p);
+		if (stv == 1 && p == 0 && kev < k + len) {
+			/* end of high part of second */
+			gbs->bit.tlow = (int)kev;
+			stv = 0;
+			y = 0;
+			if (kev < k + len - 1) {
+				gbs->bit.tlast0 = (int)(k + len - 1);
+			}
+		} else if (stv == 0 && p == 1) {
+			if (y < a / 2) {
+				gbs->bit.tlast0 = (int)k;
+			}
+			if (kev < k + len) {
+				/* end of low part of second */
+				gbs->bit.t = (unsigned)kev;
+				gbs->bit.edge_mono = sample_time(gbs, kev);
+				newminute = end_of_second(gbs, is_eom,
+				    adj_freq);
+				k = kev + 1;
+				done = true;
+				break;
+			}
+			y = 1 - (1 - y) * pow(r, (double)len);
+		} else if (p == 0) {
+			/* y only drops below a / 2 when stv == 0 */
+			if (y < a / 2 || (y > 0 && log(a / 2 / y) / log(r) <
+			    len - 1)) {
+				gbs->bit.tlast0 = (int)(k + len - 1);
+			}
+			y *= pow(r, (double)len);
+		} else {
+			y = 1 - (1 - y) * pow(r, (double)len);
+		}
+		k += len;
+
+		if (bad) {
+			gbs->gb_res.bad_io = true;
+			*outch = '*';
+			*adj_freq = false;
+			gbs->bit.t = (unsigned)k++;
+			done = true;
+		}
+	}
+	if (!done) {
+		gbs->bit.t = (unsigned)k;
+		if (k < gbs->hw.freq * 2) {
+			set_timeout_state(gbs, outch);
+			*adj_freq = false;
+			k++;
+		}
+	}
+	advance_samples(gbs, k);
+	return newminute;
+}
+
+/*
+ * Move bit.edge_mono from the sample at which the Schmitt trigger fired back
+ * to the rising edge, which lies halfway between the last low sample and the
+ * first high one. The trigger fires after samples_to_half(1, r) high samples
+ * on a clean signal, the actual number is taken from the signal if it was
+ * kept.
+ */
+static void
+set_edge_time(struct GB_state * const gbs)
+{
+	const unsigned long long t = gbs->bit.t;
+	long long period;
+	unsigned long long n;
+
+	if (gbs->esrc.type != ees_none || gbs->replay.file != NULL ||
+	    gbs->hw.filter == efilter_timestamps) {
+		period = 1000000000 / gbs->hw.freq;
+	} else {
+		/* polling is scaled like deadline_set_period() */
+		period = (long long)(gbs->bit.realfreq * 1000 /
+		    ((unsigned long long)gbs->hw.freq * gbs->hw.freq));
+	}
+	if (gbs->bit.signal != NULL) {
+		for (n = 0; n <= t && ((gbs->bit.signal[(t - n) / 8] >>
+		    ((t - n) & 7)) & 1) == 1; n++) {
+			/* count the high samples up to the trigger */
+		}
+	} else {
+		n = samples_to_half(1, gbs->coef.r);
+	}
+	if (n == 0) {
+		n = 1;
+	}
+	gbs->bit.edge_mono -= (long long)(n - 1) * period + period / 2;
+	if (gbs->replay.file == NULL && gbs->esrc.type != ees_synthetic) {
+		gbs->bit.edge_real = real_now() - (mono_now() -
+		    gbs->bit.edge_mono);
+	}
+}
+
+struct GB_result
+get_bit_live_r(struct GB_state * const gbs)
+{
+	char outch = '?';
+	bool adj_freq = true;
+	bool newminute;
+	bool is_eom = gbs->gb_res.marker == emark_minute ||
+	    gbs->gb_res.marker == emark_late;
+	long long tstart = 0;
+
+	gbs->bit.freq_reset = false;
+	gbs->bit.bitlen_reset = false;
+	gbs->bit.missed = 0;
+	gbs->bit.lateness = 0;
+	gbs->logbuf[0] = '\0';
+
+	set_new_state(gbs);
+
+	/*
+	 * One period is either 1000 ms or 2000 ms long (normal or padding for
+	 * last). The active part is either 100 ms ('0') or 200 ms ('1') long.
+	 * The maximum allowed values as percentage of the second length are
+	 * specified as half the value and the whole value of the lengths of
+	 * bit 0 and bit 20 respectively.
+	 *
+	 * ~A > 3/2 * realfreq: end-of-minute
+	 * ~A > 5/2 * realfreq: timeout
+	 */
+
+	if (gbs->init_bit == 2) {
+		gbs->bit.realfreq = gbs->hw.freq * 1000000;
+		gbs->bit.bit0 = gbs->bit.realfreq / 10;
+		gbs->bit.bit20 = gbs->bit.realfreq / 5;
+	}
+	gbs->bit.tlow = -1;
+	gbs->bit.tlast0 = -1;
+	gbs->bit.tlow_ns = -1;
+	gbs->bit.t_ns = -1;
+	gbs->bit.edge_mono = -1;
+	gbs->bit.edge_real = -1;
+
+	if (gbs->coef.freq != gbs->hw.freq) {
+		set_coefficients(gbs);
+	}
+	/* Prevent algorithm collapse during thunderstorms or scheduler abuse */
+	if (gbs->bit.realfreq <= gbs->hw.freq * 500000 ||
+	    gbs->bit.realfreq > gbs->hw.freq * 1000000) {
+		reset_frequency(gbs);
+		adj_freq = false;
+	}
+	if (gbs->esrc.type == ees_none && gbs->replay.file == NULL) {
+		/*
+		 * One sample takes 1 / hw.freq seconds scaled by
+		 * realfreq / hw.freq
+		 */
+		deadline_set_period(&gbs->dl, (long long)(gbs->bit.realfreq *
+		    1000 / ((unsigned long long)gbs->hw.freq * gbs->hw.freq)));
+	}
+	if (gbs->rawcap.file != NULL) {
+		tstart = gbs->esrc.type != ees_none ? sample_time(gbs, 0) :
+		    mono_now();
+	}
+
+	if (gbs->esrc.type != ees_none && gbs->hw.edge_decoder) {
+		newminute = decode_edges(gbs, is_eom, &outch, &adj_freq);
+	} else if (gbs->hw.filter == efilter_timestamps) {
+		newminute = sample_bit_timestamps(gbs, is_eom, &outch,
+		    &adj_freq);
+	} else {
+		newminute = sample_bit(gbs, is_eom, &outch, &adj_freq);
+	}
+	if (gbs->bit.edge_mono != -1) {
+		set_edge_time(gbs);
+	}
+	if (gbs->rawcap.file != NULL && gbs->bit.signal != NULL) {
+		/* sample bit.t ended the bit, unless reading it failed */
+		unsigned n = gbs->bit.t + (gbs->gb_res.bad_io ? 0 : 1);
+
+		if (n > gbs->hw.freq * 2) {
+			n = gbs->hw.freq * 2;
+		}
+		rawcap_write(&gbs->rawcap, tstart, gbs->hw.active_high,
+		    gbs->bit.signal, n);
+	}
+	if (gbs->bit.t >= gbs->hw.freq * 2) {
+		/* this can actually happen */
+		if (gbs->gb_res.hwstat == ehw_ok) {
+			gbs->gb_res.hwstat = ehw_random;
+			outch = '#';
+		}
+		reset_frequency(gbs);
+		adj_freq = false;
+	}
+
+	if (!gbs->gb_res.bad_io && gbs->gb_res.hwstat == ehw_ok) {
+		if (2 * gbs->bit.realfreq * gbs->bit.tlow *
+		    (1 + (newminute ? 1 : 0)) <
+		    (gbs->bit.bit0 + gbs->bit.bit20) * gbs->bit.t) {
+			/* zero bit, ~100 ms active signal */
+			gbs->gb_res.bitval = ebv_0;
+			outch = '0';
+			gbs->buffer[gbs->bitpos] = 0;
+		} else if (gbs->bit.realfreq * gbs->bit.tlow *
+		    (1 + (newminute ? 1 : 0)) <
+		    (gbs->bit.bit0 + gbs->bit.bit20) * gbs->bit.t) {
+			/* one bit, ~200 ms active signal */
+			gbs->gb_res.bitval = ebv_1;
+			outch = '1';
+			gbs->buffer[gbs->bitpos] = 1;
+		} else {
+			/* bad radio signal, retain old value */
+			gbs->gb_res.bitval = ebv_none;
+			outch = '_';
+			adj_freq = false;
+		}
+	}
+
+	if (!gbs->gb_res.bad_io) {
+		if (gbs->init_bit == 1) {
+			gbs->init_bit--;
+		} else if (gbs->gb_res.hwstat == ehw_ok &&
+		    gbs->gb_res.marker == emark_none) {
+			unsigned long long avg;
+			if (gbs->bitpos == 0 && gbs->gb_res.bitval == ebv_0) {
+				gbs->bit.bit0 +=
+				    ((long long)(gbs->bit.tlow * 1000000 -
+				    gbs->bit.bit0) / 2);
+			}
+			if (gbs->bitpos == 20 && gbs->gb_res.bitval == ebv_1) {
+				gbs->bit.bit20 +=
+				    ((long long)(gbs->bit.tlow * 1000000 -
+				    gbs->bit.bit20) / 2);
+			}
 			/* Force sane values during e.g. a thunderstorm */
-			if (2 * bit.bit20 < bit.bit0 * 3 ||
-			    bit.bit20 > bit.bit0 * 3) {
-				reset_bitlen();
+			if (2 * gbs->bit.bit20 < gbs->bit.bit0 * 3 ||
+			    gbs->bit.bit20 > gbs->bit.bit0 * 3) {
+				reset_bitlen(gbs);
 				adj_freq = false;
 			}
-			avg = (bit.bit20 - bit.bit0) / 2;
-			if (bit.bit0 + avg < bit.realfreq / 10 ||
-			    bit.bit0 - avg > bit.realfreq / 10) {
-				reset_bitlen();
+			avg = (gbs->bit.bit20 - gbs->bit.bit0) / 2;
+			if (gbs->bit.bit0 + avg < gbs->bit.realfreq / 10 ||
+			    gbs->bit.bit0 - avg > gbs->bit.realfreq / 10) {
+				reset_bitlen(gbs);
 				adj_freq = false;
 			}
-			if (bit.bit20 + avg < bit.realfreq / 5 ||
-			    bit.bit20 - avg > bit.realfreq / 5) {
-				reset_bitlen();
+			if (gbs->bit.bit20 + avg < gbs->bit.realfreq / 5 ||
+			    gbs->bit.bit20 - avg > gbs->bit.realfreq / 5) {
+				reset_bitlen(gbs);
 				adj_freq = false;
 			}
 		}
 	}
 	if (adj_freq) {
 		if (newminute) {
-			bit.realfreq +=
-			    ((long long)(bit.t * 500000 - bit.realfreq) / 20);
+			gbs->bit.realfreq +=
+			    ((long long)(gbs->bit.t * 500000 -
+			    gbs->bit.realfreq) / 20);
 		} else {
-			bit.realfreq +=
-			    ((long long)(bit.t * 1000000 - bit.realfreq) / 20);
+			gbs->bit.realfreq +=
+			    ((long long)(gbs->bit.t * 1000000 -
+			    gbs->bit.realfreq) / 20);
 		}
 	}
-	acc_minlen += 1000000 * bit.t / (bit.realfreq / 1000);
-	if (logfile != NULL) {
-		fprintf(logfile, "%c", outch);
-		if (gb_res.marker == emark_minute ||
-		    gb_res.marker == emark_late) {
-			fprintf(logfile, "a%uc%6.4f\n", acc_minlen,
-			    (double)((bit.t * 1e6) / bit.realfreq));
+	gbs->acc_minlen += 1000000 * gbs->bit.t / (gbs->bit.realfreq / 1000);
+	write_log(gbs, "%c", outch);
+	if (gbs->gb_res.marker == emark_minute ||
+	    gbs->gb_res.marker == emark_late) {
+		write_log(gbs, "a%uc%6.4f\n", gbs->acc_minlen,
+		    (double)((gbs->bit.t * 1e6) / gbs->bit.realfreq));
+	}
+	if (gbs->gb_res.marker == emark_minute ||
+	    gbs->gb_res.marker == emark_late) {
+		gbs->cutoff = gbs->bit.t * 1000000 /
+		    (gbs->bit.realfreq / 10000);
+	}
+	return gbs->gb_res;
+}
+
+/*
+ * Character classes for parsing memory-mapped log files, CL_VALID marks the
+ * characters accepted by skip_invalid(). This includes NUL because strchr()
+ * finds the terminating NUL.
+ */
+#define CL_VALID 1
+#define CL_DIGIT 2
+#define CL_SPACE 4
+
+static const unsigned char char_class[256] = {
+	['\0'] = CL_VALID,
+	['\t'] = CL_SPACE, ['\n'] = CL_VALID | CL_SPACE, ['\v'] = CL_SPACE,
+	['\f'] = CL_SPACE, ['\r'] = CL_SPACE, [' '] = CL_SPACE,
+	['#'] = CL_VALID, ['*'] = CL_VALID, ['_'] = CL_VALID,
+	['a'] = CL_VALID, ['c'] = CL_VALID, ['r'] = CL_VALID, ['x'] = CL_VALID,
+	['0'] = CL_VALID | CL_DIGIT, ['1'] = CL_VALID | CL_DIGIT,
+	['2'] = CL_DIGIT, ['3'] = CL_DIGIT, ['4'] = CL_DIGIT, ['5'] = CL_DIGIT,
+	['6'] = CL_DIGIT, ['7'] = CL_DIGIT, ['8'] = CL_DIGIT, ['9'] = CL_DIGIT
+};
+
+/* Count the resets written by reset_frequency() and reset_bitlen() */
+static void
+count_reset(struct reset_counts * const rc, int inch)
+{
+	if (inch == '<' || inch == '>') {
+		rc->freq++;
+	} else if (inch == '!') {
+		rc->bitlen++;
+	}
+}
+
+/*
+ * Skip over invalid characters of a memory-mapped log file, the same way as
+ * skip_invalid() does. eof is set when the end of the file was reached, like
+ * feof(). The skipped resets are counted in rc unless it is NULL.
+ */
+static int
+map_skip_invalid(struct logmap * const lm, bool *eof,
+    struct reset_counts * const rc)
+{
+	*eof = false;
+	while (lm->pos < lm->size) {
+		unsigned char inch = lm->data[lm->pos++];
+
+		if ((char_class[inch] & CL_VALID) != 0) {
+			return inch;
+		}
+		if (rc != NULL) {
+			count_reset(rc, inch);
+		}
+		/* convert \r to \n unless it is followed by \n */
+		if (inch == '\r') {
+			if (lm->pos == lm->size) {
+				*eof = true;
+				return '\n';
+			}
+			if (lm->data[lm->pos] != '\n') {
+				return '\n';
+			}
+		}
+	}
+	*eof = true;
+	return EOF;
+}
+
+bool
+scan_logmap_uint(struct logmap * const lm, unsigned *val)
+{
+	unsigned long long v = 0;
+	size_t start;
+	int width = 10;
+	bool neg = false;
+
+	while (lm->pos < lm->size &&
+	    (char_class[lm->data[lm->pos]] & CL_SPACE) != 0) {
+		lm->pos++;
+	}
+	if (lm->pos < lm->size &&
+	    (lm->data[lm->pos] == '+' || lm->data[lm->pos] == '-')) {
+		neg = lm->data[lm->pos++] == '-';
+		width--;
+	}
+	start = lm->pos;
+	for (; width > 0 && lm->pos < lm->size &&
+	    (char_class[lm->data[lm->pos]] & CL_DIGIT) != 0; width--) {
+		v = v * 10 + (lm->data[lm->pos++] - '0');
+	}
+	if (lm->pos == start) {
+		return false;
+	}
+	*val = (unsigned)(neg ? -v : v);
+	return true;
+}
+
+/*
+ * Read the acc_minlen value after 'a', returns false on error. For binary log
+ * files, the value is in the token which was read.
+ */
+static bool
+scan_acc_minlen(struct GB_state * const gbs,
+    const struct binlog_token * const tok)
+{
+	if (gbs->logmap.binary) {
+		if (tok->ok) {
+			gbs->acc_minlen = (unsigned)tok->value;
+		}
+		return tok->ok;
+	}
+	if (gbs->logmap.data != NULL) {
+		return scan_logmap_uint(&gbs->logmap, &gbs->acc_minlen);
+	}
+	return fscanf(gbs->logfile, "%10u", &gbs->acc_minlen) == 1;
+}
+
+/*
+ * Read the cutoff after 'c' from up to 6 characters like fscanf("%6c"), which
+ * only fails at the end of the file
+ */
+static bool
+scan_cutoff(struct GB_state * const gbs,
+    const struct binlog_token * const tok)
+{
+	struct logmap * const lm = &gbs->logmap;
+	char co[7];
+	size_t n;
+
+	if (lm->binary) {
+		if (tok->ok) {
+			gbs->cutoff = (int)tok->value;
+		}
+		return tok->ok || tok->value != 0;
+	}
+	memset(co, 0, sizeof(co));
+	if (lm->data == NULL) {
+		if (fscanf(gbs->logfile, "%6c", co) != 1) {
+			return false;
+		}
+	} else {
+		n = lm->size - lm->pos < 6 ? lm->size - lm->pos : 6;
+		if (n == 0) {
+			return false;
 		}
+		memcpy(co, lm->data + lm->pos, n);
+		lm->pos += n;
 	}
-	if (gb_res.marker == emark_minute || gb_res.marker == emark_late) {
-		cutoff = bit.t * 1000000 / (bit.realfreq / 10000);
+	if (co[1] == '.') {
+		gbs->cutoff = (co[0] - '0') * 10000 +
+		    (int)strtol(co + 2, NULL, 10);
 	}
-	return gb_res;
+	return true;
+}
+
+/*
+ * Read the next character of a binary log file, which is the same as
+ * map_skip_invalid() reads from the text the file was converted from. The
+ * token is kept for the value after 'a' or 'c'. The skipped resets are
+ * counted in rc, only once because the character is kept in lm->last .
+ */
+static int
+binlog_getc(struct logmap * const lm, struct binlog_token * const tok,
+    bool *eof, struct reset_counts * const rc)
+{
+	const unsigned char * const data = lm->data + BINLOG_DATA;
+	const size_t size = lm->size - BINLOG_DATA;
+	unsigned long long pos = lm->pos;
+	int inch = EOF;
+
+	*eof = false;
+	/* the usual case, a '0' or '1' within the current byte */
+	if (pos % 8 <= 6 && pos / 8 < size) {
+		unsigned code = data[pos / 8] >> (6 - pos % 8) & 3;
+
+		if (code < 2) {
+			tok->type = code == 0 ? ebl_0 : ebl_1;
+			lm->pos += 2;
+			return '0' + (int)code;
+		}
+	}
+	if (lm->last.end != 0 && lm->last.pos == lm->pos) {
+		*tok = lm->last.tok;
+		*eof = lm->last.eof;
+		lm->pos = lm->last.end;
+		return lm->last.inch;
+	}
+	while (inch == EOF) {
+		binlog_read_token(data, size, &pos, tok);
+		switch (tok->type) {
+		case ebl_0:
+			inch = '0';
+			break;
+		case ebl_1:
+			inch = '1';
+			break;
+		case ebl_none:
+			inch = '_';
+			break;
+		case ebl_transmit:
+			inch = 'x';
+			break;
+		case ebl_receive:
+			inch = 'r';
+			break;
+		case ebl_random:
+			inch = '#';
+			break;
+		case ebl_bad_io:
+			inch = '*';
+			break;
+		case ebl_eom:
+			inch = '\n';
+			break;
+		case ebl_cr: {
+			/* a \r at the end of the file also ends it */
+			struct binlog_token next;
+			unsigned long long p = pos;
+
+			do {
+				binlog_read_token(data, size, &p, &next);
+			} while (next.type == ebl_align);
+			*eof = next.type == ebl_eof;
+			inch = '\n';
+			break;
+		}
+		case ebl_acc_minlen:
+		case ebl_raw_acc_minlen:
+			inch = 'a';
+			break;
+		case ebl_cutoff:
+		case ebl_raw_cutoff:
+			inch = 'c';
+			break;
+		case ebl_nul:
+			inch = '\0';
+			break;
+		case ebl_eof:
+		case ebl_error:
+			/* a damaged file ends at the damage */
+			*eof = true;
+			return EOF;
+		case ebl_freq_low:
+		case ebl_freq_high:
+			rc->freq++;
+			break;
+		case ebl_bitlen_reset:
+			rc->bitlen++;
+			break;
+		default:
+			/* skipped by the parser */
+			break;
+		}
+	}
+	lm->last.pos = lm->pos;
+	lm->last.end = (size_t)pos;
+	lm->last.inch = inch;
+	lm->last.eof = *eof;
+	lm->last.tok = *tok;
+	lm->pos = (size_t)pos;
+	return inch;
 }
 
 /* Skip over invalid characters */
 static int
-skip_invalid(void)
+skip_invalid(struct GB_state * const gbs)
 {
 	int inch = EOF;
 
 	do {
 		int oldinch = inch;
-		if (feof(logfile)) {
+		if (feof(gbs->logfile)) {
 			break;
 		}
-		inch = getc(logfile);
+		inch = getc(gbs->logfile);
 		/*
 		 * \r\n is implicitly converted because \r is invalid character
 		 * \n\r is implicitly converted because \n is found first
@@ -582,24 +1684,123 @@ skip_invalid(void)
 		 * convert \r to \n
 		 */
 		if (oldinch == '\r' && inch != '\n') {
-			ungetc(inch, logfile);
+			ungetc(inch, gbs->logfile);
 			inch = '\n';
+		} else {
+			count_reset(&gbs->resets, inch);
 		}
 	} while (strchr("01\nxr#*_ac", inch) == NULL);
 	return inch;
 }
 
+long
+get_file_offset_r(struct GB_state * const gbs)
+{
+	if (gbs->logmap.data != NULL) {
+		return (long)gbs->logmap.pos;
+	}
+	return ftell(gbs->logfile);
+}
+
+int
+set_file_offset_r(struct GB_state * const gbs, long offset)
+{
+	if (gbs->logmap.binary) {
+		if (offset < 0 || (unsigned long long)offset >
+		    (gbs->logmap.size - BINLOG_DATA) * 8ULL) {
+			return EINVAL;
+		}
+		gbs->logmap.pos = (size_t)offset;
+		return 0;
+	}
+	if (gbs->logmap.data != NULL) {
+		if (offset < 0 || (size_t)offset > gbs->logmap.size) {
+			return EINVAL;
+		}
+		gbs->logmap.pos = (size_t)offset;
+		return 0;
+	}
+	return fseek(gbs->logfile, offset, SEEK_SET) == -1 ? errno : 0;
+}
+
+bool
+equal_file_state_r(struct GB_state * const a, struct GB_state * const b)
+{
+	return a->bitpos == b->bitpos && a->dec_bp == b->dec_bp &&
+	    memcmp(a->buffer, b->buffer, sizeof(a->buffer)) == 0 &&
+	    a->acc_minlen == b->acc_minlen && a->cutoff == b->cutoff &&
+	    a->gb_res.bad_io == b->gb_res.bad_io &&
+	    a->gb_res.bitval == b->gb_res.bitval &&
+	    a->gb_res.marker == b->gb_res.marker &&
+	    a->gb_res.hwstat == b->gb_res.hwstat &&
+	    a->gb_res.done == b->gb_res.done &&
+	    a->gb_res.skip == b->gb_res.skip && a->bit.t == b->bit.t &&
+	    a->oldinch == b->oldinch &&
+	    a->read_acc_minlen == b->read_acc_minlen &&
+	    get_file_offset_r(a) == get_file_offset_r(b);
+}
+
+void
+get_file_state_r(struct GB_state * const gbs, struct GB_filestate * const fs)
+{
+	fs->offset = get_file_offset_r(gbs);
+	fs->bitpos = gbs->bitpos;
+	fs->dec_bp = gbs->dec_bp;
+	memcpy(fs->buffer, gbs->buffer, sizeof(fs->buffer));
+	fs->acc_minlen = gbs->acc_minlen;
+	fs->cutoff = gbs->cutoff;
+	fs->gb_res = gbs->gb_res;
+	fs->t = gbs->bit.t;
+	fs->oldinch = gbs->oldinch;
+	fs->read_acc_minlen = gbs->read_acc_minlen;
+}
+
+int
+set_file_state_r(struct GB_state * const gbs,
+    const struct GB_filestate * const fs)
+{
+	gbs->bitpos = fs->bitpos;
+	gbs->dec_bp = fs->dec_bp;
+	memcpy(gbs->buffer, fs->buffer, sizeof(gbs->buffer));
+	gbs->acc_minlen = fs->acc_minlen;
+	gbs->cutoff = fs->cutoff;
+	gbs->gb_res = fs->gb_res;
+	gbs->bit.t = fs->t;
+	gbs->oldinch = fs->oldinch;
+	gbs->read_acc_minlen = fs->read_acc_minlen;
+	return set_file_offset_r(gbs, (long)fs->offset);
+}
+
+int
+copy_file_state_r(struct GB_state * const gbs, struct GB_state * const src)
+{
+	struct GB_filestate fs;
+
+	get_file_state_r(src, &fs);
+	return set_file_state_r(gbs, &fs);
+}
+
 struct GB_result
-get_bit_file(void)
+get_bit_file_r(struct GB_state * const gbs)
 {
-	static int oldinch;
-	static bool read_acc_minlen;
+	struct logmap * const lm = &gbs->logmap;
+	struct binlog_token tok;
 	int inch;
-	char co[6];
+	bool eof;
 
-	set_new_state();
+	set_new_state(gbs);
 
-	inch = skip_invalid();
+	if (lm->binary) {
+		inch = binlog_getc(lm, &tok, &eof, &gbs->resets);
+	} else if (lm->pos < lm->size &&
+	    (char_class[lm->data[lm->pos]] & CL_VALID) != 0) {
+		/* the usual case, a valid character right away */
+		inch = lm->data[lm->pos++];
+	} else if (lm->data != NULL) {
+		inch = map_skip_invalid(lm, &eof, &gbs->resets);
+	} else {
+		inch = skip_invalid(gbs);
+	}
 	/*
 	 * bit.t is set to fake value for compatibility with old log files not
 	 * storing acc_minlen values or to increase time when mainloop() splits
@@ -608,13 +1809,13 @@ get_bit_file(void)
 
 	switch (inch) {
 	case EOF:
-		gb_res.done = true;
-		return gb_res;
+		gbs->gb_res.done = true;
+		return gbs->gb_res;
 	case '0':
 	case '1':
-		buffer[bitpos] = inch - (int)'0';
-		gb_res.bitval = (inch == (int)'0') ? ebv_0 : ebv_1;
-		bit.t = 1000;
+		gbs->buffer[gbs->bitpos] = inch - (int)'0';
+		gbs->gb_res.bitval = (inch == (int)'0') ? ebv_0 : ebv_1;
+		gbs->bit.t = 1000;
 		break;
 	case '\n':
 		/*
@@ -622,90 +1823,108 @@ get_bit_file(void)
 		 * impossible by the reset_minlen() invocation in
 		 * get_bit_live()
 		 */
-		gb_res.skip = true;
-		if (oldinch != '\n') {
-			bit.t = read_acc_minlen ? 0 : 1000;
-			read_acc_minlen = false;
+		gbs->gb_res.skip = true;
+		if (gbs->oldinch != '\n') {
+			gbs->bit.t = gbs->read_acc_minlen ? 0 : 1000;
+			gbs->read_acc_minlen = false;
 			/*
 			 * The marker checks must be inside the oldinch
 			 * check to prevent spurious emin_short errors.
 			 */
-			if (gb_res.marker == emark_none) {
-				gb_res.marker = emark_minute;
-			} else if (gb_res.marker == emark_toolong) {
-				gb_res.marker = emark_late;
+			if (gbs->gb_res.marker == emark_none) {
+				gbs->gb_res.marker = emark_minute;
+			} else if (gbs->gb_res.marker == emark_toolong) {
+				gbs->gb_res.marker = emark_late;
 			}
 		} else {
-			bit.t = 0;
+			gbs->bit.t = 0;
 		}
 		break;
 	case 'x':
-		gb_res.hwstat = ehw_transmit;
-		bit.t = 2500;
+		gbs->gb_res.hwstat = ehw_transmit;
+		gbs->bit.t = 2500;
 		break;
 	case 'r':
-		gb_res.hwstat = ehw_receive;
-		bit.t = 2500;
+		gbs->gb_res.hwstat = ehw_receive;
+		gbs->bit.t = 2500;
 		break;
 	case '#':
-		gb_res.hwstat = ehw_random;
-		bit.t = 2500;
+		gbs->gb_res.hwstat = ehw_random;
+		gbs->bit.t = 2500;
 		break;
 	case '*':
-		gb_res.bad_io = true;
-		bit.t = 0;
+		gbs->gb_res.bad_io = true;
+		gbs->bit.t = 0;
 		break;
 	case '_':
 		/* retain old value in buffer[bitpos] */
-		gb_res.bitval = ebv_none;
-		bit.t = 1000;
+		gbs->gb_res.bitval = ebv_none;
+		gbs->bit.t = 1000;
 		break;
 	case 'a':
 		/* acc_minlen, up to 2^32-1 ms */
-		gb_res.skip = true;
-		bit.t = 0;
-		if (fscanf(logfile, "%10u", &acc_minlen) != 1) {
-			gb_res.done = true;
+		gbs->gb_res.skip = true;
+		gbs->bit.t = 0;
+		if (!scan_acc_minlen(gbs, &tok)) {
+			gbs->gb_res.done = true;
 		}
-		read_acc_minlen = !gb_res.done;
+		gbs->read_acc_minlen = !gbs->gb_res.done;
 		break;
 	case 'c':
 		/* cutoff for newminute */
-		gb_res.skip = true;
-		bit.t = 0;
-		if (fscanf(logfile, "%6c", co) != 1) {
-			gb_res.done = true;
-		}
-		if (!gb_res.done && (co[1] == '.')) {
-			cutoff = (co[0] - '0') * 10000 +
-			    (int)strtol(co + 2, NULL, 10);
+		gbs->gb_res.skip = true;
+		gbs->bit.t = 0;
+		if (!scan_cutoff(gbs, &tok)) {
+			gbs->gb_res.done = true;
 		}
 		break;
 	default:
 		break;
 	}
 
-	if (!read_acc_minlen) {
-		acc_minlen += bit.t;
+	if (!gbs->read_acc_minlen) {
+		gbs->acc_minlen += gbs->bit.t;
 	}
 
 	/*
 	 * Read-ahead 1 character to check if a minute marker is coming. This
 	 * prevents emark_toolong or emark_late being set 1 bit early.
 	 */
-	oldinch = inch;
-	inch = skip_invalid();
-	if (!feof(logfile)) {
-		if (dec_bp == 0 && bitpos > 0 && oldinch != '\n' &&
+	gbs->oldinch = inch;
+	if (lm->binary) {
+		/* peek only, like below */
+		size_t pos = lm->pos;
+
+		inch = binlog_getc(lm, &tok, &eof, &gbs->resets);
+		lm->pos = pos;
+	} else if (lm->pos < lm->size &&
+	    (char_class[lm->data[lm->pos]] & CL_VALID) != 0) {
+		inch = lm->data[lm->pos];
+		eof = false;
+	} else if (lm->data != NULL) {
+		/* peek only, the next call skips the same characters again */
+		size_t pos = lm->pos;
+
+		inch = map_skip_invalid(lm, &eof, NULL);
+		lm->pos = pos;
+	} else {
+		inch = skip_invalid(gbs);
+		eof = feof(gbs->logfile) != 0;
+	}
+	if (!eof) {
+		if (gbs->dec_bp == 0 && gbs->bitpos > 0 &&
+		    gbs->oldinch != '\n' &&
 		    (inch == '\n' || inch == 'a' || inch == 'c')) {
-			dec_bp = 1;
+			gbs->dec_bp = 1;
 		}
 	} else {
-		gb_res.done = true;
+		gbs->gb_res.done = true;
+	}
+	if (lm->data == NULL) {
+		ungetc(inch, gbs->logfile);
 	}
-	ungetc(inch, logfile);
 
-	return gb_res;
+	return gbs->gb_res;
 }
 
 bool
@@ -719,106 +1938,352 @@ is_space_bit(int bitpos)
 }
 
 struct GB_result
-next_bit(void)
+next_bit_r(struct GB_state * const gbs)
 {
-	if (dec_bp == 1) {
-		bitpos--;
-		dec_bp = 2;
+	if (gbs->dec_bp == 1) {
+		gbs->bitpos--;
+		gbs->dec_bp = 2;
 	}
-	if (gb_res.marker == emark_minute || gb_res.marker == emark_late) {
-		bitpos = 0;
-		dec_bp = 0;
-	} else if (!gb_res.skip) {
-		bitpos++;
+	if (gbs->gb_res.marker == emark_minute ||
+	    gbs->gb_res.marker == emark_late) {
+		gbs->bitpos = 0;
+		gbs->dec_bp = 0;
+	} else if (!gbs->gb_res.skip) {
+		gbs->bitpos++;
 	}
-	if (bitpos == BUFLEN) {
-		gb_res.marker = emark_toolong;
-		bitpos = 0;
-		return gb_res;
+	if (gbs->bitpos == BUFLEN) {
+		gbs->gb_res.marker = emark_toolong;
+		gbs->bitpos = 0;
+		return gbs->gb_res;
 	}
-	if (gb_res.marker == emark_toolong) {
-		gb_res.marker = emark_none; /* fits again */
+	if (gbs->gb_res.marker == emark_toolong) {
+		gbs->gb_res.marker = emark_none; /* fits again */
 	}
-	else if (gb_res.marker == emark_late) {
-		gb_res.marker = emark_minute; /* cannot happen? */
+	else if (gbs->gb_res.marker == emark_late) {
+		gbs->gb_res.marker = emark_minute; /* cannot happen? */
 	}
-	return gb_res;
+	return gbs->gb_res;
 }
 
 int
-get_bitpos(void)
+get_bitpos_r(struct GB_state * const gbs)
 {
-	return bitpos;
+	return gbs->bitpos;
 }
 
 const int * const
-get_buffer(void)
+get_buffer_r(struct GB_state * const gbs)
 {
-	return buffer;
+	return gbs->buffer;
 }
 
 struct hardware
-get_hardware_parameters(void)
+get_hardware_parameters_r(struct GB_state * const gbs)
 {
-	return hw;
+	return gbs->hw;
 }
 
-void
-*flush_logfile(/*@unused@*/ void *arg)
+int
+set_logfile_policy_r(struct GB_state * const gbs,
+    struct json_object *config)
 {
-	for (;;)
-	{
-		fflush(logfile);
-		sleep(60);
-	}
+	return logwriter_policy(&gbs->logpolicy, config);
 }
 
-int
-append_logfile(const char * const logfilename)
+static int
+open_logfile(struct GB_state * const gbs, const char * const logfilename,
+    bool binary)
 {
-	pthread_t flush_thread;
+	int res;
 
 	if (logfilename == NULL) {
 		fprintf(stderr, "logfilename is NULL\n");
 		return -1;
 	}
-	logfile = fopen(logfilename, "a");
-	if (logfile == NULL) {
-		return errno;
+	res = logwriter_open(&gbs->logw, logfilename, binary, &gbs->logpolicy);
+	if (res == 0) {
+		write_log_text(gbs, "\n--new log--\n\n");
 	}
-	fprintf(logfile, "\n--new log--\n\n");
-	return pthread_create(&flush_thread, NULL, flush_logfile, NULL);
+	return res;
+}
+
+int
+append_logfile_r(struct GB_state * const gbs,
+    const char * const logfilename)
+{
+	return open_logfile(gbs, logfilename, false);
+}
+
+int
+append_binlog_r(struct GB_state * const gbs,
+    const char * const logfilename)
+{
+	return open_logfile(gbs, logfilename, true);
+}
+
+int
+close_logfile_r(struct GB_state * const gbs)
+{
+	return logwriter_close(&gbs->logw);
+}
+
+unsigned long long
+get_logfile_overruns_r(const struct GB_state * const gbs)
+{
+	return gbs->logw.running ? logwriter_overruns(&gbs->logw) : 0;
+}
+
+struct bitinfo
+get_bitinfo_r(struct GB_state * const gbs)
+{
+	return gbs->bit;
+}
+
+struct reset_counts
+get_reset_counts_r(struct GB_state * const gbs)
+{
+	return gbs->resets;
+}
+
+unsigned
+get_acc_minlen_r(struct GB_state * const gbs)
+{
+	return gbs->acc_minlen;
+}
+
+void
+reset_acc_minlen_r(struct GB_state * const gbs)
+{
+	gbs->acc_minlen = 0;
+}
+
+int
+get_cutoff_r(struct GB_state * const gbs)
+{
+	return gbs->cutoff;
+}
+
+int
+set_mode_snapshot_r(struct GB_state * const gbs, struct hardware hw)
+{
+	if (gbs->filemode != 0) {
+		fprintf(stderr, "Already initialized.\n");
+		cleanup_r(gbs);
+		return -1;
+	}
+	if (!check_freq(hw.freq)) {
+		return EX_DATAERR;
+	}
+	gbs->hw = hw;
+	gbs->bit.signal = malloc(gbs->hw.freq / 2);
+	gbs->filemode = 1;
+	return 0;
+}
+
+void
+get_snapshot_r(const struct GB_state * const gbs,
+    struct GB_snapshot * const snap)
+{
+	unsigned char *signal = snap->bit.signal;
+
+	snap->gb_res = gbs->gb_res;
+	snap->bit = gbs->bit;
+	snap->bit.signal = signal;
+	if (signal != NULL && gbs->bit.signal != NULL) {
+		memcpy(signal, gbs->bit.signal, gbs->hw.freq / 2);
+	}
+	snap->bitpos = gbs->bitpos;
+	memcpy(snap->buffer, gbs->buffer, sizeof(snap->buffer));
+	snap->acc_minlen = gbs->acc_minlen;
+	snap->cutoff = gbs->cutoff;
+	memcpy(snap->log, gbs->logbuf, sizeof(snap->log));
+	snap->dropped = 0;
+}
+
+void
+set_snapshot_r(struct GB_state * const gbs,
+    const struct GB_snapshot * const snap)
+{
+	unsigned char *signal = gbs->bit.signal;
+
+	gbs->gb_res = snap->gb_res;
+	gbs->bit = snap->bit;
+	gbs->bit.signal = signal;
+	if (signal != NULL && snap->bit.signal != NULL) {
+		memcpy(signal, snap->bit.signal, gbs->hw.freq / 2);
+	}
+	gbs->bitpos = snap->bitpos;
+	memcpy(gbs->buffer, snap->buffer, sizeof(gbs->buffer));
+	gbs->acc_minlen = snap->acc_minlen;
+	gbs->cutoff = snap->cutoff;
+	/* keep the length of the minute in the log file */
+	for (unsigned i = 0; i < snap->dropped; i++) {
+		write_log_text(gbs, "_");
+	}
+	memcpy(gbs->logbuf, snap->log, sizeof(gbs->logbuf));
+	write_log_text(gbs, gbs->logbuf);
+}
+
+int
+set_mode_file(const char * const infilename)
+{
+	return set_mode_file_r(&gbs_global, infilename);
+}
+
+int
+set_mode_live(struct json_object *config)
+{
+	return set_mode_live_r(&gbs_global, config);
+}
+
+int
+set_mode_synthetic(unsigned freq, bool edge_decoder,
+    int (*next_cb)(void *, struct edge *), void *arg)
+{
+	return set_mode_synthetic_r(&gbs_global, freq, edge_decoder, next_cb,
+	    arg);
+}
+
+int
+set_mode_replay(const char * const filename)
+{
+	return set_mode_replay_r(&gbs_global, filename);
+}
+
+void
+set_filter(enum eGB_filter filter)
+{
+	set_filter_r(&gbs_global, filter);
+}
+
+void
+set_stdio_only(bool stdio_only)
+{
+	set_stdio_only_r(&gbs_global, stdio_only);
+}
+
+void
+set_sample_jitter(long long (*jitter_cb)(void *arg), void *arg)
+{
+	set_sample_jitter_r(&gbs_global, jitter_cb, arg);
+}
+
+void
+cleanup(void)
+{
+	cleanup_r(&gbs_global);
+}
+
+int
+get_pulse(void)
+{
+	return get_pulse_r(&gbs_global);
+}
+
+struct GB_result
+get_bit_live(void)
+{
+	return get_bit_live_r(&gbs_global);
+}
+
+struct GB_result
+get_bit_file(void)
+{
+	return get_bit_file_r(&gbs_global);
+}
+
+struct GB_result
+next_bit(void)
+{
+	return next_bit_r(&gbs_global);
+}
+
+int
+get_bitpos(void)
+{
+	return get_bitpos_r(&gbs_global);
+}
+
+const int * const
+get_buffer(void)
+{
+	return get_buffer_r(&gbs_global);
+}
+
+struct hardware
+get_hardware_parameters(void)
+{
+	return get_hardware_parameters_r(&gbs_global);
+}
+
+int
+set_logfile_policy(struct json_object *config)
+{
+	return set_logfile_policy_r(&gbs_global, config);
+}
+
+int
+append_logfile(const char * const logfilename)
+{
+	return append_logfile_r(&gbs_global, logfilename);
+}
+
+int
+append_binlog(const char * const logfilename)
+{
+	return append_binlog_r(&gbs_global, logfilename);
 }
 
 int
 close_logfile(void)
 {
-	int f;
+	return close_logfile_r(&gbs_global);
+}
 
-	f = fclose(logfile);
-	return (f == EOF) ? errno : 0;
+unsigned long long
+get_logfile_overruns(void)
+{
+	return get_logfile_overruns_r(&gbs_global);
 }
 
 struct bitinfo
 get_bitinfo(void)
 {
-	return bit;
+	return get_bitinfo_r(&gbs_global);
+}
+
+struct reset_counts
+get_reset_counts(void)
+{
+	return get_reset_counts_r(&gbs_global);
 }
 
 unsigned
 get_acc_minlen(void)
 {
-	return acc_minlen;
+	return get_acc_minlen_r(&gbs_global);
 }
 
 void
 reset_acc_minlen(void)
 {
-	acc_minlen = 0;
+	reset_acc_minlen_r(&gbs_global);
 }
 
 int
 get_cutoff(void)
 {
-	return cutoff;
+	return get_cutoff_r(&gbs_global);
+}
+
+int
+set_mode_snapshot(struct hardware hw)
+{
+	return set_mode_snapshot_r(&gbs_global, hw);
+}
+
+void
+set_snapshot(const struct GB_snapshot * const snap)
+{
+	set_snapshot_r(&gbs_global, snap);
 }
@@ -1,13 +1,23 @@
-// Copyright 2013-2020 René Ladan and "JsBergbau"
+// Copyright 2013-2026 René Ladan and "JsBergbau"
 // SPDX-License-Identifier: BSD-2-Clause
 
 #ifndef DCF77PI_INPUT_H
 #define DCF77PI_INPUT_H
 
+#include "binlog.h"
+#include "deadline.h"
+#include "edge.h"
+#include "logwriter.h"
+#include "rawcap.h"
+
 #include <stdbool.h>
+#include <stdio.h>
 
 struct json_object;
 
+/** maximum number of bits in a minute */
+#define BUFLEN 60
+
 /** Value of the bit received by radio or log file */
 enum eGB_bitvalue {
 	/** this bit has value 0 */
@@ -58,18 +68,55 @@ struct GB_result {
 	bool skip;
 };
 
+/** Low-pass filter used to sample the bits */
+enum eGB_filter {
+	/** one filter step per sample, assuming evenly spaced samples */
+	efilter_samples,
+	/**
+	 * filter steps and bit lengths follow the time at which each sample
+	 * was taken, so that missed or late samples do not distort them
+	 */
+	efilter_timestamps
+};
+
 /**
  * Hardware parameters:
  */
 struct hardware {
 	/** sample frequency in Hz */
 	unsigned freq;
-	/** GPIO device number (FreeBSD only) */
+	/**
+	 * GPIO device number (FreeBSD, or Linux when {@link hardware.edges} is
+	 * set)
+	 */
 	unsigned iodev;
 	/** pin number to read from */
 	unsigned pin;
 	/** pin value is high (1) or low (0) for active signal */
 	bool active_high;
+	/**
+	 * read timestamped edges from the GPIO character device instead of
+	 * polling the pin (Linux only)
+	 */
+	bool edges;
+	/**
+	 * decode the bits directly from the edges instead of from samples
+	 * reconstructed from them, requires {@link hardware.edges}
+	 */
+	bool edge_decoder;
+	/**
+	 * wait for the next sample using a timerfd instead of
+	 * clock_nanosleep() (Linux only)
+	 */
+	bool timerfd;
+	/** low-pass filter to use, not used by the edge decoder */
+	enum eGB_filter filter;
+	/**
+	 * delay in nanoseconds between the start of a second as transmitted
+	 * and the rising edge at the pin, caused by the receiver and the
+	 * propagation of the signal
+	 */
+	long long group_delay;
 };
 
 /**
@@ -94,6 +141,16 @@ struct bitinfo {
 	int tlast0;
 	/** length of this bit in samples */
 	unsigned t;
+	/**
+	 * time in nanoseconds when the signal went low again, only measured
+	 * by {@link efilter_timestamps}, -1 otherwise
+	 */
+	long long tlow_ns;
+	/**
+	 * length of this bit in nanoseconds, only measured by
+	 * {@link efilter_timestamps}, -1 otherwise
+	 */
+	long long t_ns;
 	/**
 	 * the raw received radio signal, {@link hardware.freq} / 2 items,
 	 * with each item holding 8 bits
@@ -109,16 +166,240 @@ struct bitinfo {
 	 * the average length of the high part of bit 20 (a 1 bit) in samples
 	 */
 	unsigned long long bit20;
+	/** number of sample deadlines missed during this bit */
+	unsigned missed;
+	/** largest lateness of a sample of this bit in nanoseconds */
+	long long lateness;
+	/**
+	 * time in nanoseconds of the rising edge which ended this bit and
+	 * started the next second, corrected for the delay of the low-pass
+	 * filter, -1 if the bit did not end with an edge. This uses
+	 * CLOCK_MONOTONIC when reading the pin, or else the clock of the edge
+	 * source or the raw capture.
+	 */
+	long long edge_mono;
+	/**
+	 * CLOCK_REALTIME time in nanoseconds of the same edge, -1 if unknown or
+	 * if the samples are not read from the pin
+	 */
+	long long edge_real;
 };
 
+/** maximum length of the log file text of one bit */
+#define LOGBUFLEN 64
+
 /**
- * Prepare for input from a log file.
+ * Copy of the state of a bit reader after reading one bit, to pass the bits
+ * from the thread reading them to another thread.
+ */
+struct GB_snapshot {
+	/** state of the bit */
+	struct GB_result gb_res;
+	/**
+	 * information about the bit, the signal points to storage provided by
+	 * the owner of the snapshot
+	 */
+	struct bitinfo bit;
+	/** bit position of the bit */
+	int bitpos;
+	/** the bit buffer */
+	int buffer[BUFLEN];
+	/** accumulated minute length in milliseconds */
+	unsigned acc_minlen;
+	/** cutoff value written to the log file */
+	int cutoff;
+	/** text written to the log file for this bit */
+	char log[LOGBUFLEN];
+	/**
+	 * number of bits dropped just before this one, written to the log file
+	 * as '_'
+	 */
+	unsigned dropped;
+};
+
+/**
+ * State of a bit reader in file mode, which can be stored to continue reading
+ * the log file later.
+ */
+struct GB_filestate {
+	/** offset in the log file of the next character to read */
+	long long offset;
+	/** current bit position (second) */
+	int bitpos;
+	/** bitpos decrease in file mode */
+	unsigned dec_bp;
+	/** bit buffer */
+	int buffer[BUFLEN];
+	/** accumulated minute length in milliseconds */
+	unsigned acc_minlen;
+	/** cutoff value read from the log file */
+	int cutoff;
+	/** state of the current bit */
+	struct GB_result gb_res;
+	/** length of the current bit in samples */
+	unsigned t;
+	/** previous character read from the log file */
+	int oldinch;
+	/** acc_minlen was read from the log file for the current minute */
+	bool read_acc_minlen;
+};
+
+/**
+ * Character read from a binary log file at some offset, kept because the
+ * parser reads each character twice
+ */
+struct binlog_char {
+	/** offset of the character */
+	size_t pos;
+	/** offset after the character, 0 if none was read yet */
+	size_t end;
+	/** the character */
+	int inch;
+	/** the end of the file was reached */
+	bool eof;
+	/** the token of the character */
+	struct binlog_token tok;
+};
+
+/** Log file mapped into memory, which is parsed without stdio */
+struct logmap {
+	/** contents of the file, NULL if stdio is used */
+	const unsigned char *data;
+	/** size of the file in bytes */
+	size_t size;
+	/** offset of the next character to read, in bits for binary files */
+	size_t pos;
+	/** the file is a binary log file, see binlog.h */
+	bool binary;
+	/** the last character which was read from a binary log file */
+	struct binlog_char last;
+};
+
+/** Number of resets of the bit reader, see {@link get_reset_counts} */
+struct reset_counts {
+	/** resets of the sample frequency, '<' or '>' in a log file */
+	unsigned long freq;
+	/** resets of the bit lengths, '!' in a log file */
+	unsigned long bitlen;
+};
+
+/** Coefficients of the low-pass filter, computed once per sample frequency */
+struct filter_coef {
+	/** sample frequency of the coefficients, 0 if not computed yet */
+	unsigned freq;
+	/** factor by which the distance to the signal shrinks per sample */
+	double r;
+	/** 1 - r, scaled by 1e9 */
+	long long a;
+};
+
+/**
+ * State of the bit reader, to be used with the reentrant (_r) functions so
+ * that several receivers or log files can be decoded within one process. The
+ * fields should be considered private to input.c , the functions without the
+ * _r suffix use a single global instance.
+ */
+struct GB_state {
+	/** current bit position (second) */
+	int bitpos;
+	/** bitpos decrease in file mode */
+	unsigned dec_bp;
+	/** bit buffer, wraps after BUFLEN positions */
+	int buffer[BUFLEN];
+	/** input log file */
+	FILE *logfile;
+	/** input log file when it is memory-mapped instead of using logfile */
+	struct logmap logmap;
+	/** writer of the output log file which is auto-appended */
+	struct logwriter logw;
+	/** synchronization and rotation policy of the output log file */
+	struct logwriter_policy logpolicy;
+	/** always read the input log file using stdio */
+	bool stdio_only;
+	/** GPIO file */
+	int fd;
+	/** hardware parameters */
+	struct hardware hw;
+	/** information about the current bit */
+	struct bitinfo bit;
+	/** accumulated minute length in milliseconds */
+	unsigned acc_minlen;
+	/** cutoff value written to the log file */
+	int cutoff;
+	/** state of the current bit */
+	struct GB_result gb_res;
+	/** 0 = no file, 1 = live input, 2 = file input */
+	unsigned filemode;
+	/** edges instead of polling */
+	struct edge_source esrc;
+	/** sample scheduler when polling */
+	struct deadline dl;
+	/** capture of the raw samples, if enabled */
+	struct rawcap rawcap;
+	/** raw capture to read the samples from instead of the pin */
+	struct rawcap replay;
+	/** coefficients of the low-pass filter */
+	struct filter_coef coef;
+	/** delay to add before each sample of an edge source, for testing */
+	long long (*jitter_cb)(void *arg);
+	/** argument for {@link GB_state.jitter_cb} */
+	void *jitter_arg;
+	/** virtual sample clock for edges, tbase + nsample / hw.freq seconds */
+	long long tbase;
+	/** see {@link GB_state.tbase} */
+	unsigned nsample;
+	/** 2 = just starting, 1 = first bit seen */
+	int init_bit;
+	/** previous character read from the log file */
+	int oldinch;
+	/** acc_minlen was read from the log file for the current minute */
+	bool read_acc_minlen;
+	/** number of resets, see {@link get_reset_counts} */
+	struct reset_counts resets;
+	/** text written to the log file for the current bit */
+	char logbuf[LOGBUFLEN];
+};
+
+/**
+ * Initialize the state of a bit reader for use with the reentrant functions.
+ *
+ * @param gbs The state to initialize.
+ */
+void init_input_state(struct GB_state * const gbs);
+
+/**
+ * Prepare for input from a log file. Regular files are mapped into memory
+ * and parsed directly, other files (like pipes) are read using stdio. Both
+ * give the same results. Binary log files (see binlog.h) are recognized by
+ * their header, these must be regular files.
  *
  * @param infilename The name of the log file to use.
  * @return Preparation was succesful (0), -1 or errno otherwise.
  */
 int set_mode_file(const char * const infilename);
 
+/**
+ * Reentrant version of {@link set_mode_file}.
+ *
+ * @param gbs The bit reader state.
+ */
+int set_mode_file_r(struct GB_state * const gbs, const char * const infilename);
+
+/**
+ * Always read log files using stdio instead of mapping them into memory. This
+ * must be called before {@link set_mode_file}.
+ *
+ * @param stdio_only Always use stdio.
+ */
+void set_stdio_only(bool stdio_only);
+
+/**
+ * Reentrant version of {@link set_stdio_only}.
+ *
+ * @param gbs The bit reader state.
+ */
+void set_stdio_only_r(struct GB_state * const gbs, bool stdio_only);
+
 /**
  * Prepare for live input.
  *
@@ -131,6 +412,202 @@ int set_mode_file(const char * const infilename);
  */
 int set_mode_live(struct json_object *config);
 
+/**
+ * Reentrant version of {@link set_mode_live}.
+ *
+ * @param gbs The bit reader state.
+ */
+int set_mode_live_r(struct GB_state * const gbs, struct json_object *config);
+
+/**
+ * Prepare for live input from synthetic edges, for testing without hardware.
+ *
+ * The edges are sampled at {@link hardware.freq} Hz using a virtual clock
+ * which starts at 0 with a passive signal, so {@link get_bit_live} runs as
+ * fast as the edges can be generated.
+ *
+ * @param freq The sample frequency in Hz.
+ * @param edge_decoder Decode the bits directly from the edges, see
+ * {@link hardware.edge_decoder}.
+ * @param next_cb The callback providing the edges in chronological order, it
+ * returns 0 on success and -1 at the end of the stream, which sets
+ * {@link GB_result.done} .
+ * @param arg The argument to pass to next_cb.
+ * @return Preparation was succesful (0), -1 or EX_DATAERR otherwise.
+ */
+int set_mode_synthetic(unsigned freq, bool edge_decoder,
+    int (*next_cb)(void *, struct edge *), void *arg);
+
+/**
+ * Reentrant version of {@link set_mode_synthetic}.
+ *
+ * @param gbs The bit reader state.
+ */
+int set_mode_synthetic_r(struct GB_state * const gbs, unsigned freq,
+    bool edge_decoder, int (*next_cb)(void *, struct edge *), void *arg);
+
+/**
+ * Prepare for live input from a raw capture file as written using the
+ * "rawcapture" configuration key.
+ *
+ * The samples are fed to {@link get_bit_live} in the order in which they
+ * were captured, without waiting between them, so the capture is decoded as
+ * fast as possible. The result {@link GB_result.done} is set once all
+ * samples are read.
+ *
+ * @param filename The name of the raw capture file.
+ * @return Preparation was succesful (0), -1, EINVAL or errno otherwise.
+ */
+int set_mode_replay(const char * const filename);
+
+/**
+ * Reentrant version of {@link set_mode_replay}.
+ *
+ * @param gbs The bit reader state.
+ */
+int set_mode_replay_r(struct GB_state * const gbs,
+    const char * const filename);
+
+/**
+ * Select the low-pass filter for live input, overriding the "filter" key of
+ * the configuration.
+ *
+ * @param filter The filter to use, see {@link hardware.filter}.
+ */
+void set_filter(enum eGB_filter filter);
+
+/**
+ * Reentrant version of {@link set_filter}.
+ *
+ * @param gbs The bit reader state.
+ */
+void set_filter_r(struct GB_state * const gbs, enum eGB_filter filter);
+
+/**
+ * Delay the samples of synthetic or GPIO character device edges by the
+ * amount returned by a callback, to simulate scheduling delays. The delays
+ * accumulate and samples which would have been taken in the meantime are
+ * lost, just like when polling on a busy system.
+ *
+ * @param jitter_cb The callback returning the delay in nanoseconds before the
+ * next sample, or NULL to stop delaying.
+ * @param arg The argument to pass to jitter_cb.
+ */
+void set_sample_jitter(long long (*jitter_cb)(void *arg), void *arg);
+
+/**
+ * Reentrant version of {@link set_sample_jitter}.
+ *
+ * @param gbs The bit reader state.
+ */
+void set_sample_jitter_r(struct GB_state * const gbs,
+    long long (*jitter_cb)(void *arg), void *arg);
+
+/**
+ * Prepare for input from snapshots of another bit reader, which are loaded
+ * using {@link set_snapshot}.
+ *
+ * @param hw The hardware parameters of the other bit reader.
+ * @return Preparation was succesful (0), -1 or EX_DATAERR otherwise.
+ */
+int set_mode_snapshot(struct hardware hw);
+
+/**
+ * Reentrant version of {@link set_mode_snapshot}.
+ *
+ * @param gbs The bit reader state.
+ */
+int set_mode_snapshot_r(struct GB_state * const gbs, struct hardware hw);
+
+/**
+ * Take a snapshot of the bit reader after reading one bit with
+ * {@link get_bit_live_r} and before calling {@link next_bit_r}.
+ *
+ * @param gbs The bit reader state.
+ * @param snap The snapshot to fill in. If snap->bit.signal is not NULL, it
+ * must point to {@link hardware.freq} / 2 bytes to copy the signal to.
+ */
+void get_snapshot_r(const struct GB_state * const gbs,
+    struct GB_snapshot * const snap);
+
+/**
+ * Load a snapshot taken by {@link get_snapshot_r} as the current bit, so that
+ * {@link next_bit} and the functions retrieving the bit information work as if
+ * the bit was just read. The log text of the bit is appended to the log file,
+ * if any, preceded by a '_' for each bit dropped before it.
+ *
+ * @param snap The snapshot to load.
+ */
+void set_snapshot(const struct GB_snapshot * const snap);
+
+/**
+ * Reentrant version of {@link set_snapshot}.
+ *
+ * @param gbs The bit reader state.
+ */
+void set_snapshot_r(struct GB_state * const gbs,
+    const struct GB_snapshot * const snap);
+
+/**
+ * Retrieve the offset in the input log file of the next character to read.
+ *
+ * @param gbs The bit reader state, in file mode.
+ * @return The offset in bytes, or in bits for binary log files.
+ */
+long get_file_offset_r(struct GB_state * const gbs);
+
+/**
+ * Continue reading the input log file at the given offset, for example to
+ * decode only a part of it.
+ *
+ * @param gbs The bit reader state, in file mode.
+ * @param offset The offset in bytes, or in bits for binary log files.
+ * @return Success (0), or errno on error.
+ */
+int set_file_offset_r(struct GB_state * const gbs, long offset);
+
+/**
+ * Compare the states of two bit readers in file mode, including their offset
+ * in the input log file. Equal states give the same results from that point
+ * on.
+ *
+ * @param a The first bit reader state.
+ * @param b The second bit reader state.
+ * @return The states are equal.
+ */
+bool equal_file_state_r(struct GB_state * const a, struct GB_state * const b);
+
+/**
+ * Continue reading the input log file where another bit reader for the same
+ * file is, using the state of that reader.
+ *
+ * @param gbs The bit reader state, in file mode.
+ * @param src The other bit reader state.
+ * @return Success (0), or errno on error.
+ */
+int copy_file_state_r(struct GB_state * const gbs,
+    struct GB_state * const src);
+
+/**
+ * Retrieve the state of a bit reader in file mode.
+ *
+ * @param gbs The bit reader state, in file mode.
+ * @param fs The state to fill in.
+ */
+void get_file_state_r(struct GB_state * const gbs,
+    struct GB_filestate * const fs);
+
+/**
+ * Continue reading the input log file using a state retrieved earlier using
+ * {@link get_file_state_r}, possibly by another bit reader for the same file.
+ *
+ * @param gbs The bit reader state, in file mode.
+ * @param fs The state to continue with.
+ * @return Success (0), or errno on error.
+ */
+int set_file_state_r(struct GB_state * const gbs,
+    const struct GB_filestate * const fs);
+
 /**
  * Return the hardware parameters parsed from {@link set_mode_live}.
  *
@@ -138,12 +615,26 @@ int set_mode_live(struct json_object *config);
  */
 struct hardware get_hardware_parameters(void);
 
+/**
+ * Reentrant version of {@link get_hardware_parameters}.
+ *
+ * @param gbs The bit reader state.
+ */
+struct hardware get_hardware_parameters_r(struct GB_state * const gbs);
+
 /**
  * Clean up when closing the device or input logfile, and closing the output
  *log file if applicable.
  */
 void cleanup(void);
 
+/**
+ * Reentrant version of {@link cleanup}.
+ *
+ * @param gbs The bit reader state.
+ */
+void cleanup_r(struct GB_state * const gbs);
+
 /**
  * Retrieve one pulse from the hardware.
  *
@@ -152,6 +643,13 @@ void cleanup(void);
  */
 int get_pulse(void);
 
+/**
+ * Reentrant version of {@link get_pulse}.
+ *
+ * @param gbs The bit reader state.
+ */
+int get_pulse_r(struct GB_state * const gbs);
+
 /**
  * Retrieve one bit from the log file.
  *
@@ -159,6 +657,23 @@ int get_pulse(void);
  */
 struct GB_result get_bit_file(void);
 
+/**
+ * Reentrant version of {@link get_bit_file}.
+ *
+ * @param gbs The bit reader state.
+ */
+struct GB_result get_bit_file_r(struct GB_state * const gbs);
+
+/**
+ * Read an unsigned integer from a memory-mapped log file like
+ * fscanf("%10u") does, which is how values after 'a' are read.
+ *
+ * @param lm The log file, of which pos is updated.
+ * @param val The value which was read.
+ * @return A value was read.
+ */
+bool scan_logmap_uint(struct logmap * const lm, unsigned *val);
+
 /**
  * Retrieve one live bit from the hardware. This function determines several
  * values which can be retrieved using {@link get_bitinfo}.
@@ -167,6 +682,13 @@ struct GB_result get_bit_file(void);
  */
 struct GB_result get_bit_live(void);
 
+/**
+ * Reentrant version of {@link get_bit_live}.
+ *
+ * @param gbs The bit reader state.
+ */
+struct GB_result get_bit_live_r(struct GB_state * const gbs);
+
 /**
  * Prepare for the next bit: update the bit position or wrap it around.
  *
@@ -175,6 +697,13 @@ struct GB_result get_bit_live(void);
  */
 struct GB_result next_bit(void);
 
+/**
+ * Reentrant version of {@link next_bit}.
+ *
+ * @param gbs The bit reader state.
+ */
+struct GB_result next_bit_r(struct GB_state * const gbs);
+
 /**
  * Retrieve the current bit position.
  *
@@ -182,6 +711,13 @@ struct GB_result next_bit(void);
  */
 int get_bitpos(void);
 
+/**
+ * Reentrant version of {@link get_bitpos}.
+ *
+ * @param gbs The bit reader state.
+ */
+int get_bitpos_r(struct GB_state * const gbs);
+
 /**
  * Retrieve the current bit buffer.
  *
@@ -189,6 +725,13 @@ int get_bitpos(void);
  */
 const int * const get_buffer(void);
 
+/**
+ * Reentrant version of {@link get_buffer}.
+ *
+ * @param gbs The bit reader state.
+ */
+const int * const get_buffer_r(struct GB_state * const gbs);
+
 /**
  * Determine if there should be a space between the last bit and the current
  * bit when displaying the bit buffer.
@@ -198,7 +741,28 @@ const int * const get_buffer(void);
 bool is_space_bit(int bitpos);
 
 /**
- * Open the log file and append a "new log" marker to it.
+ * Set when the output log file is synchronized to storage and rotated, see
+ * {@link logwriter_policy} for the configuration keys. The policy applies to
+ * log files opened afterwards.
+ *
+ * @param config The JSON object containing the parsed configuration from
+ * config.json
+ * @return Success (0), or -1 if a value is invalid.
+ */
+int set_logfile_policy(struct json_object *config);
+
+/**
+ * Reentrant version of {@link set_logfile_policy}.
+ *
+ * @param gbs The bit reader state.
+ */
+int set_logfile_policy_r(struct GB_state * const gbs,
+    struct json_object *config);
+
+/**
+ * Open the log file and append a "new log" marker to it. A log file which
+ * starts with the header of a binary log file is appended to as such. The
+ * log file is written by a separate thread, see logwriter.h .
  *
  * @param logfilename The name of the log file to use.
  * @return The log file was opened succesfully (0), or errno on error.
@@ -206,12 +770,48 @@ bool is_space_bit(int bitpos);
 int append_logfile(const char * const logfilename);
 
 /**
- * Close the currently opened log file.
+ * Reentrant version of {@link append_logfile}.
+ *
+ * @param gbs The bit reader state.
+ */
+int append_logfile_r(struct GB_state * const gbs,
+    const char * const logfilename);
+
+/**
+ * Open the log file and append a "new log" marker to it, like
+ * {@link append_logfile}. A new or empty log file becomes a binary log file
+ * (see binlog.h), of which each minute is written at once so that the file
+ * does not end in the middle of a token. An existing text log file is
+ * appended to as such.
+ *
+ * @param logfilename The name of the log file to use.
+ * @return The log file was opened succesfully (0), or errno on error.
+ */
+int append_binlog(const char * const logfilename);
+
+/**
+ * Reentrant version of {@link append_binlog}.
+ *
+ * @param gbs The bit reader state.
+ */
+int append_binlog_r(struct GB_state * const gbs,
+    const char * const logfilename);
+
+/**
+ * Close the currently opened log file, after writing all text which is still
+ * queued.
  *
  * @return The log file was closed successfully (0), or errno otherwise.
  */
 int close_logfile(void);
 
+/**
+ * Reentrant version of {@link close_logfile}.
+ *
+ * @param gbs The bit reader state.
+ */
+int close_logfile_r(struct GB_state * const gbs);
+
 /**
  * Retrieve "internal" information about the currently received bit.
  *
@@ -219,6 +819,30 @@ int close_logfile(void);
  */
 struct bitinfo get_bitinfo(void);
 
+/**
+ * Reentrant version of {@link get_bitinfo}.
+ *
+ * @param gbs The bit reader state.
+ */
+struct bitinfo get_bitinfo_r(struct GB_state * const gbs);
+
+/**
+ * Retrieve the number of resets of the sample frequency and of the bit
+ * lengths since the bit reader was initialized. In live mode these are the
+ * resets done by the bit reader, in file mode the ones recorded in the log
+ * file.
+ *
+ * @return The number of resets.
+ */
+struct reset_counts get_reset_counts(void);
+
+/**
+ * Reentrant version of {@link get_reset_counts}.
+ *
+ * @param gbs The bit reader state.
+ */
+struct reset_counts get_reset_counts_r(struct GB_state * const gbs);
+
 /**
  * Retrieve the accumulated minute length in milliseconds.
  *
@@ -226,11 +850,25 @@ struct bitinfo get_bitinfo(void);
  */
 unsigned get_acc_minlen(void);
 
+/**
+ * Reentrant version of {@link get_acc_minlen}.
+ *
+ * @param gbs The bit reader state.
+ */
+unsigned get_acc_minlen_r(struct GB_state * const gbs);
+
 /**
  * Reset the accumulated minute length.
  */
 void reset_acc_minlen(void);
 
+/**
+ * Reentrant version of {@link reset_acc_minlen}.
+ *
+ * @param gbs The bit reader state.
+ */
+void reset_acc_minlen_r(struct GB_state * const gbs);
+
 /**
  * Retrieve the cutoff value written to the log file.
  *
@@ -239,10 +877,25 @@ void reset_acc_minlen(void);
 int get_cutoff(void);
 
 /**
- * Flush the current log file to its storage location.
+ * Reentrant version of {@link get_cutoff}.
+ *
+ * @param gbs The bit reader state.
+ */
+int get_cutoff_r(struct GB_state * const gbs);
+
+/**
+ * Retrieve the number of chunks of the output log file which were dropped
+ * because writing it did not keep up.
+ *
+ * @return The number of log writer overruns.
+ */
+unsigned long long get_logfile_overruns(void);
+
+/**
+ * Reentrant version of {@link get_logfile_overruns}.
  *
- * @param arg Unused argument because of pthread_create()
+ * @param gbs The bit reader state.
  */
-void *flush_logfile(/*@unused*/ void *arg);
+unsigned long long get_logfile_overruns_r(const struct GB_state * const gbs);
 
 #endif
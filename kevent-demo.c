@@ -1,11 +1,15 @@
-// Copyright 2013-2020 René Ladan
+// Copyright 2013-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "input.h"
 #include "json_util.h"
 
-#include <sys/types.h> /* FreeBSD < 12.0 */
-#include <sys/event.h>
+#if defined(__FreeBSD__)
+#  include <sys/types.h> /* FreeBSD < 12.0 */
+#  include <sys/event.h>
+#else
+#  include "deadline.h"
+#endif
 #include <sys/time.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -19,12 +23,18 @@ static struct json_object *config;
 
 int main(void)
 {
+#if defined(__FreeBSD__)
 	struct kevent change;	 /* event we want to monitor */
 	struct kevent event;	  /* event that was triggered */
+	int kq;
+	long long corr;
+#else
+	struct deadline dl;
+#endif
 	struct timespec ts, oldts;
 	struct hardware hw;
-	int kq, count, res;
-	long long diff, corr, diffsum;
+	int count, res;
+	long long diff, diffsum;
 	bool first_time = true;
 
 	config = json_object_from_file(ETCDIR "/config.json");
@@ -41,6 +51,7 @@ int main(void)
 	}
 	hw = get_hardware_parameters();
 
+#if defined(__FreeBSD__)
 	/* create a new kernel event queue */
 	if ((kq = kqueue()) == -1) {
 		perror("kqueue()");
@@ -90,6 +101,47 @@ int main(void)
 	}
 
 	close(kq);
+#else
+	/* absolute deadlines, so no drift from oversleeping */
+	res = deadline_init(&dl, 1000000000 / hw.freq, true);
+	if (res != 0) {
+		cleanup();
+		free(config);
+		exit(EX_UNAVAILABLE);
+	}
+
+	clock_getres(CLOCK_MONOTONIC, &ts);
+	printf("hw.freq=%u resolution=%li:%li\n", hw.freq, ts.tv_sec, ts.tv_nsec);
+
+	count = diffsum = 0;
+	for (;;) {
+		res = deadline_wait(&dl);
+		if (res != 0) {
+			fprintf(stderr, "deadline_wait(): %s\n", strerror(res));
+			exit(EX_UNAVAILABLE);
+		}
+		count++;
+		printf("%i", get_pulse());
+		if (count % hw.freq == 0) {
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			printf(" count=%i missed=%llu lateness=%lli", count,
+			    dl.missed, dl.lateness);
+			if (first_time) {
+				first_time = false;
+			} else {
+				/* add 1 second to old time for predicted value, in ns */
+				diff = ((ts.tv_sec * 1000000000 + ts.tv_nsec) - ((oldts.tv_sec + 1) * 1000000000 + oldts.tv_nsec));
+				diffsum += diff;
+				printf(" ns diff=%lli diffsum=%lli", diff, diffsum);
+			}
+			printf("\n");
+			count = 0;
+			memcpy(&oldts, &ts, sizeof(struct timespec));
+		}
+	}
+
+	deadline_close(&dl);
+#endif
 	cleanup();
 	free(config);
 	return EX_OK;
@@ -0,0 +1,297 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "logindex.h"
+
+#include "binlog.h"
+#include "decode_alarm.h"
+#include "decode_time.h"
+#include "input.h"
+#include "mainloop.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* entries read at once when seeking */
+#define SEEK_ENTRIES 64
+
+static const char restart_line[] = "--new log--";
+
+int64_t
+minute_key(struct tm time)
+{
+	return (((time.tm_year * 100LL + time.tm_mon) * 100 + time.tm_mday) *
+	    100 + time.tm_hour) * 100 + time.tm_min;
+}
+
+/* The index only needs the state of the decoder, not its output */
+static void
+no_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+}
+
+static void
+no_output(struct ML_state *mls)
+{
+}
+
+static void
+no_minute(struct ML_state *mls, int minlen)
+{
+}
+
+static void
+no_alarm(struct ML_state *mls, struct alm alarm)
+{
+}
+
+static void
+no_time(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+}
+
+static void
+no_thirdparty_buffer(struct ML_state *mls, const unsigned tpbuf[])
+{
+}
+
+static const struct ML_callbacks quiet = {
+	get_bit_file_r, no_bit, no_output, no_minute, no_alarm, no_output,
+	no_output, no_time, no_thirdparty_buffer
+};
+
+static int
+read_full(int fd, void *buf, size_t len, off_t offset)
+{
+	ssize_t n;
+
+	n = pread(fd, buf, len, offset);
+	if (n == -1) {
+		return errno;
+	}
+	return (size_t)n == len ? 0 : EINVAL;
+}
+
+static int
+write_full(int fd, const void *buf, size_t len, off_t offset)
+{
+	ssize_t n;
+
+	n = pwrite(fd, buf, len, offset);
+	if (n == -1) {
+		return errno;
+	}
+	return (size_t)n == len ? 0 : EIO;
+}
+
+static off_t
+entry_offset(uint64_t n)
+{
+	return (off_t)(sizeof(struct logindex_header) +
+	    n * sizeof(struct logindex_entry));
+}
+
+static bool
+valid_header(const struct logindex_header * const hdr, off_t size)
+{
+	return memcmp(hdr->magic, LOGINDEX_MAGIC, 8) == 0 &&
+	    hdr->version == LOGINDEX_VERSION &&
+	    hdr->entrysize == sizeof(struct logindex_entry) &&
+	    size >= entry_offset(hdr->nentries);
+}
+
+/* Check if the log file text between from and to contains a restart */
+static bool
+has_restart(const struct logmap * const lm, size_t from, size_t to)
+{
+	const size_t len = sizeof(restart_line) - 1;
+
+	if (lm->data == NULL) {
+		return false;
+	}
+	if (lm->binary) {
+		const size_t hdr = sizeof(struct binlog_file);
+		unsigned long long pos = from;
+		struct binlog_token tok;
+
+		while (pos < to) {
+			binlog_read_token(lm->data + hdr, lm->size - hdr, &pos,
+			    &tok);
+			if (tok.type == ebl_restart) {
+				return true;
+			}
+			if (tok.type == ebl_eof || tok.type == ebl_error) {
+				break;
+			}
+		}
+		return false;
+	}
+	for (size_t i = from; i + len <= to; i++) {
+		if (lm->data[i] == '-' &&
+		    memcmp(lm->data + i, restart_line, len) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int
+update_logindex(const char * const logfilename,
+    const char * const indexfilename)
+{
+	struct logindex_header hdr;
+	struct logindex_entry pending, last;
+	struct ML_state mls;
+	struct stat st;
+	uint64_t logsize;
+	size_t boundary;
+	bool done = false, have_pending = false;
+	int fd, res;
+
+	fd = open(indexfilename, O_RDWR | O_CREAT, 0644);
+	if (fd == -1) {
+		res = errno;
+		perror("open(logindex)");
+		return res;
+	}
+	init_mainloop_state(&mls, NULL);
+	res = set_mode_file_r(&mls.gbs, logfilename);
+	if (res != 0) {
+		(void)close(fd);
+		return res;
+	}
+	if (fstat(fd, &st) == -1 || (mls.gbs.logmap.data == NULL &&
+	    fseek(mls.gbs.logfile, 0, SEEK_END) == -1)) {
+		res = errno;
+		goto out;
+	}
+	/* the size of the log file as far as this update is concerned */
+	logsize = mls.gbs.logmap.data != NULL ? mls.gbs.logmap.size :
+	    (uint64_t)ftell(mls.gbs.logfile);
+
+	memset(&last, 0, sizeof(last));
+	/* offsets in binary log files count bits */
+	if (read_full(fd, &hdr, sizeof(hdr), 0) == 0 &&
+	    valid_header(&hdr, st.st_size) && hdr.logsize <= logsize &&
+	    hdr.tail.fs.offset >= 0 && (uint64_t)hdr.tail.fs.offset <=
+	    hdr.logsize * (mls.gbs.logmap.binary ? 8 : 1) &&
+	    (hdr.nentries == 0 || read_full(fd, &last, sizeof(last),
+	    entry_offset(hdr.nentries - 1)) == 0)) {
+		if (hdr.logsize == logsize) {
+			/* nothing appended */
+			goto out;
+		}
+		res = set_mainloop_checkpoint(&mls, &hdr.tail);
+	} else {
+		/* start anew, also when the log file was truncated */
+		memcpy(hdr.magic, LOGINDEX_MAGIC, 8);
+		hdr.version = LOGINDEX_VERSION;
+		hdr.entrysize = sizeof(struct logindex_entry);
+		hdr.nentries = 0;
+		res = set_file_offset_r(&mls.gbs, 0);
+		get_mainloop_checkpoint(&mls, &hdr.tail);
+		if (res == 0 && ftruncate(fd, entry_offset(0)) == -1) {
+			res = errno;
+		}
+	}
+	hdr.logsize = logsize;
+
+	/*
+	 * The state after a minute is only used once the next bit has been
+	 * read, the log file may end in the middle of a minute line.
+	 */
+	boundary = (size_t)hdr.tail.fs.offset;
+	while (!done && res == 0) {
+		done = mainloop_step_r(&mls, &quiet);
+		if (have_pending && !done) {
+			hdr.tail = pending.cp;
+			if ((pending.key != 0 && pending.key / 100 !=
+			    last.key / 100) || pending.flags != 0) {
+				res = write_full(fd, &pending, sizeof(pending),
+				    entry_offset(hdr.nentries));
+				hdr.nentries++;
+				last = pending;
+			}
+			have_pending = false;
+		}
+		if (!done && get_bitpos_r(&mls.gbs) == 0) {
+			size_t offset = (size_t)get_file_offset_r(&mls.gbs);
+
+			memset(&pending, 0, sizeof(pending));
+			pending.key = mls.init_min == 0 ?
+			    minute_key(mls.curtime) : 0;
+			pending.flags = has_restart(&mls.gbs.logmap, boundary,
+			    offset) ? LOGINDEX_RESTART : 0;
+			get_mainloop_checkpoint(&mls, &pending.cp);
+			have_pending = true;
+			boundary = offset;
+		}
+	}
+	/* entries first, so that a crash leaves a consistent index */
+	if (res == 0) {
+		res = write_full(fd, &hdr, sizeof(hdr), 0);
+	}
+out:
+	cleanup_r(&mls.gbs);
+	if (close(fd) == -1 && res == 0) {
+		res = errno;
+	}
+	return res;
+}
+
+int
+seek_logindex(const char * const indexfilename, int64_t key,
+    struct ML_state * const mls)
+{
+	struct logindex_entry entry[SEEK_ENTRIES], best;
+	struct logindex_header hdr;
+	struct stat st;
+	bool found = false, beyond = false;
+	int fd, res;
+
+	fd = open(indexfilename, O_RDONLY);
+	if (fd == -1) {
+		res = errno;
+		perror("open(logindex)");
+		return res;
+	}
+	if (fstat(fd, &st) == -1) {
+		res = errno;
+		(void)close(fd);
+		return res;
+	}
+	res = read_full(fd, &hdr, sizeof(hdr), 0);
+	if (res == 0 && !valid_header(&hdr, st.st_size)) {
+		res = EINVAL;
+	}
+	for (uint64_t n = 0; res == 0 && !beyond && n < hdr.nentries;
+	    n += SEEK_ENTRIES) {
+		uint64_t count = hdr.nentries - n < SEEK_ENTRIES ?
+		    hdr.nentries - n : SEEK_ENTRIES;
+
+		res = read_full(fd, entry, count * sizeof(entry[0]),
+		    entry_offset(n));
+		for (uint64_t i = 0; res == 0 && i < count; i++) {
+			if (entry[i].key == 0) {
+				continue;
+			}
+			if (entry[i].key >= key) {
+				beyond = true;
+				break;
+			}
+			best = entry[i];
+			found = true;
+		}
+	}
+	(void)close(fd);
+	if (res == 0 && found) {
+		res = set_mainloop_checkpoint(mls, &best.cp);
+	}
+	return res;
+}
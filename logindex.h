@@ -0,0 +1,91 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_LOGINDEX_H
+#define DCF77PI_LOGINDEX_H
+
+#include "mainloop.h"
+
+#include <stdint.h>
+#include <time.h>
+
+/** Magic bytes at the start of an index file */
+#define LOGINDEX_MAGIC "DCF77IDX"
+
+/** Version of the index file format */
+#define LOGINDEX_VERSION 1
+
+/** The entry is at a restart of dcf77pi, a "--new log--" line */
+#define LOGINDEX_RESTART 1
+
+/**
+ * Entry of the index of a log file, written about once per decoded hour and
+ * at each restart. All fields are in host byte order, the index is a cache
+ * which is rebuilt when it does not match.
+ */
+struct logindex_entry {
+	/** decoded time after the minute, see {@link minute_key}, 0 if none */
+	int64_t key;
+	/** {@link LOGINDEX_RESTART} or 0 */
+	uint32_t flags;
+	/** reserved, 0 */
+	uint32_t reserved;
+	/** state of the decoder after the minute */
+	struct ML_checkpoint cp;
+};
+
+/**
+ * Header of an index file, followed by {@link logindex_header.nentries}
+ * entries in the order of the log file.
+ */
+struct logindex_header {
+	/** {@link LOGINDEX_MAGIC}, without the terminating NUL */
+	char magic[8];
+	/** {@link LOGINDEX_VERSION} */
+	uint32_t version;
+	/** size of an entry, which depends on the decoder state */
+	uint32_t entrysize;
+	/** size of the log file when it was indexed */
+	uint64_t logsize;
+	/** number of entries */
+	uint64_t nentries;
+	/** state of the decoder to continue indexing with */
+	struct ML_checkpoint tail;
+};
+
+/**
+ * Convert a decoded time to a number which sorts like the time itself.
+ *
+ * @param time The decoded time, in DCF77 format.
+ * @return The time as YYYYMMDDhhmm.
+ */
+int64_t minute_key(struct tm time);
+
+/**
+ * Bring the index of a log file up to date. Only the part of the log file
+ * which was appended since the previous update is decoded, the index is
+ * rebuilt when the log file has shrunk or the index is not valid.
+ *
+ * @param logfilename The name of the log file.
+ * @param indexfilename The name of the index file, created if needed.
+ * @return Success (0), or errno on error.
+ */
+int update_logindex(const char * const logfilename,
+    const char * const indexfilename);
+
+/**
+ * Continue decoding a log file at the last indexed minute before the given
+ * time, so that the minute with that time is decoded next. The state is left
+ * alone when the index has no such minute, so that the log file is decoded
+ * from the start.
+ *
+ * @param indexfilename The name of the index file, which must be up to date.
+ * @param key The time to decode, see {@link minute_key}.
+ * @param mls The state of the main loop, prepared using
+ * {@link set_mode_file_r}.
+ * @return Success (0), or errno on error.
+ */
+int seek_logindex(const char * const indexfilename, int64_t key,
+    struct ML_state * const mls);
+
+#endif
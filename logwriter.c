@@ -0,0 +1,436 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "logwriter.h"
+
+#include "json_object.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* attempts to find an unused name for a rotated log file */
+#define ROTATE_TRIES 100
+
+/*
+ * The producer fills the chunk at lw->cur in place and commits it at the end
+ * of a minute, so adding text costs no system calls. The last free slot is
+ * kept for the chunk which stops the writing thread. The writing thread owns
+ * the file: it encodes binary log files, synchronizes and rotates.
+ */
+
+static time_t
+monotonic_secs(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+static void
+set_error(struct logwriter * const lw, int error)
+{
+	if (lw->error == 0) {
+		__atomic_store_n(&lw->error, error, __ATOMIC_RELAXED);
+	}
+}
+
+int
+logwriter_policy(struct logwriter_policy * const policy,
+    struct json_object *config)
+{
+	struct json_object *value;
+
+	policy->syncsecs = LOGWRITER_SYNC_NONE;
+	policy->maxsize = 0;
+	policy->maxage = 0;
+	if (config == NULL) {
+		return 0;
+	}
+	if (json_object_object_get_ex(config, "logsync", &value)) {
+		const char *str = json_object_get_string(value);
+		char *end;
+		long secs;
+
+		if (strcmp(str, "minute") == 0) {
+			policy->syncsecs = LOGWRITER_SYNC_MINUTE;
+		} else if (strcmp(str, "none") != 0) {
+			secs = strtol(str, &end, 10);
+			if (end == str || *end != '\0' || secs <= 0 ||
+			    secs > INT_MAX) {
+				fprintf(stderr, "logsync must be \"none\", "
+				    "\"minute\" or a number of seconds\n");
+				return -1;
+			}
+			policy->syncsecs = (int)secs;
+		}
+	}
+	if (json_object_object_get_ex(config, "logrotatemb", &value)) {
+		int mb = json_object_get_int(value);
+
+		if (mb < 0) {
+			fprintf(stderr, "logrotatemb must not be negative\n");
+			return -1;
+		}
+		policy->maxsize = (unsigned long long)mb << 20;
+	}
+	if (json_object_object_get_ex(config, "logrotatehours", &value)) {
+		int hours = json_object_get_int(value);
+
+		if (hours < 0) {
+			fprintf(stderr,
+			    "logrotatehours must not be negative\n");
+			return -1;
+		}
+		policy->maxage = (unsigned long)hours * 3600;
+	}
+	return 0;
+}
+
+/* The format of an existing log file, or the given one for a new file */
+static bool
+is_binary_logfile(const char * const name, bool binary)
+{
+	unsigned char hdr[sizeof(struct binlog_file)];
+	size_t n;
+	FILE *f;
+
+	f = fopen(name, "r");
+	if (f != NULL) {
+		n = fread(hdr, 1, sizeof(hdr), f);
+		(void)fclose(f);
+		if (n > 0) {
+			binary = binlog_version(hdr, n) != 0;
+		}
+	}
+	return binary;
+}
+
+/* Open the log file of the writer, writing the header of a new binary one */
+static int
+open_file(struct logwriter * const lw)
+{
+	int res;
+
+	lw->file = fopen(lw->name, "a");
+	if (lw->file == NULL) {
+		return errno;
+	}
+	if (lw->binary) {
+		res = binlog_open_writer(&lw->binlog, lw->file);
+		if (res != 0) {
+			(void)fclose(lw->file);
+			lw->file = NULL;
+			return res;
+		}
+	}
+	lw->opened = monotonic_secs();
+	lw->synced = lw->opened;
+	return 0;
+}
+
+static int
+sync_file(struct logwriter * const lw)
+{
+	if (fflush(lw->file) == EOF) {
+		return errno;
+	}
+	if (fsync(fileno(lw->file)) == -1) {
+		return errno;
+	}
+	lw->synced = monotonic_secs();
+	return 0;
+}
+
+static int
+close_file(struct logwriter * const lw)
+{
+	int res = 0;
+
+	if (lw->binary) {
+		res = binlog_close_writer(&lw->binlog);
+	}
+	if (res == 0 && lw->policy.syncsecs != LOGWRITER_SYNC_NONE) {
+		res = sync_file(lw);
+	}
+	if (fclose(lw->file) == EOF && res == 0) {
+		res = errno;
+	}
+	lw->file = NULL;
+	return res;
+}
+
+/*
+ * Move the log file aside under its name with the current time appended, and
+ * start a new one. Reception goes on, the chunks wait in the queue.
+ */
+static int
+rotate_file(struct logwriter * const lw)
+{
+	char newname[PATH_MAX], stamp[20];
+	struct tm tm;
+	time_t now;
+	int len, res, reopen;
+
+	res = close_file(lw);
+	now = time(NULL);
+	(void)strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S",
+	    localtime_r(&now, &tm));
+	for (int i = 0; res == 0; i++) {
+		if (i == ROTATE_TRIES) {
+			res = EEXIST;
+			break;
+		}
+		len = i == 0 ?
+		    snprintf(newname, sizeof(newname), "%s.%s", lw->name,
+		    stamp) :
+		    snprintf(newname, sizeof(newname), "%s.%s-%i", lw->name,
+		    stamp, i);
+		if (len < 0 || (size_t)len >= sizeof(newname)) {
+			res = ENAMETOOLONG;
+		} else if (link(lw->name, newname) == 0) {
+			/* never overwrite an older rotated file */
+			res = unlink(lw->name) == -1 ? errno : 0;
+			break;
+		} else if (errno != EEXIST) {
+			res = errno;
+		}
+	}
+	if (res == 0) {
+		__atomic_add_fetch(&lw->rotations, 1, __ATOMIC_RELAXED);
+	}
+	/* keep logging, to the old file if it could not be moved */
+	reopen = open_file(lw);
+	return res != 0 ? res : reopen;
+}
+
+static int
+write_chunk(struct logwriter * const lw, const struct logchunk * const c)
+{
+	if (lw->binary) {
+		return binlog_write_text(&lw->binlog,
+		    (const unsigned char *)c->text, c->len);
+	}
+	return fwrite(c->text, 1, c->len, lw->file) == c->len ? 0 : errno;
+}
+
+/* Rotate the log file after a minute if it is large or old enough */
+static void
+end_minute(struct logwriter * const lw)
+{
+	const struct logwriter_policy * const p = &lw->policy;
+	struct stat st;
+	int res;
+
+	if (p->maxsize == 0 && p->maxage == 0) {
+		return;
+	}
+	/* a binary log file writes out its buffer at the end of a minute */
+	if (p->maxsize > 0 && (fflush(lw->file) == EOF ||
+	    fstat(fileno(lw->file), &st) == -1)) {
+		set_error(lw, errno);
+		return;
+	}
+	if ((p->maxsize == 0 || (unsigned long long)st.st_size < p->maxsize) &&
+	    (p->maxage == 0 ||
+	    (unsigned long)(monotonic_secs() - lw->opened) < p->maxage)) {
+		return;
+	}
+	res = rotate_file(lw);
+	if (res != 0) {
+		set_error(lw, res);
+	}
+	if (lw->file == NULL) {
+		/* nothing left to write to */
+		lw->policy.maxsize = 0;
+		lw->policy.maxage = 0;
+	}
+}
+
+/* Write out a batch of chunks, synchronizing if it completed a minute */
+static void
+end_batch(struct logwriter * const lw, bool eom)
+{
+	const struct logwriter_policy * const p = &lw->policy;
+	int res;
+
+	if (fflush(lw->file) == EOF) {
+		set_error(lw, errno);
+		return;
+	}
+	if (eom && (p->syncsecs == LOGWRITER_SYNC_MINUTE || (p->syncsecs > 0 &&
+	    monotonic_secs() - lw->synced >= p->syncsecs))) {
+		res = sync_file(lw);
+		if (res != 0) {
+			set_error(lw, res);
+		}
+	}
+}
+
+static void *
+write_loop(void *arg)
+{
+	struct logwriter *lw = arg;
+	struct logchunk *c;
+	unsigned short flags = 0;
+
+	while ((flags & LOGCHUNK_STOP) == 0) {
+		bool wait = true, eom = false;
+
+		/* write everything which is queued, then flush once */
+		while ((c = ring_read_slot(&lw->ring, wait)) != NULL) {
+			int res = lw->file != NULL ? write_chunk(lw, c) : EBADF;
+
+			if (res != 0) {
+				set_error(lw, res);
+			}
+			flags = c->flags;
+			ring_release(&lw->ring);
+			if ((flags & LOGCHUNK_STOP) != 0) {
+				break;
+			}
+			if ((flags & LOGCHUNK_EOM) != 0 && lw->file != NULL) {
+				end_minute(lw);
+				eom = true;
+			}
+			wait = false;
+		}
+		if (lw->file != NULL && (flags & LOGCHUNK_STOP) == 0) {
+			end_batch(lw, eom);
+		}
+	}
+	if (lw->file != NULL) {
+		int res = close_file(lw);
+
+		if (res != 0) {
+			set_error(lw, res);
+		}
+	}
+	return NULL;
+}
+
+int
+logwriter_open(struct logwriter * const lw, const char * const name,
+    bool binary, const struct logwriter_policy * const policy)
+{
+	int res;
+
+	if (lw->running) {
+		return EBUSY;
+	}
+	lw->cur = NULL;
+	lw->policy = *policy;
+	lw->overruns = 0;
+	lw->rotations = 0;
+	lw->error = 0;
+	lw->name = strdup(name);
+	if (lw->name == NULL) {
+		return ENOMEM;
+	}
+	lw->binary = is_binary_logfile(name, binary);
+	res = open_file(lw);
+	if (res == 0) {
+		res = ring_init(&lw->ring, LOGWRITER_SLOTS,
+		    sizeof(struct logchunk));
+		if (res != 0) {
+			(void)fclose(lw->file);
+			lw->file = NULL;
+		}
+	}
+	if (res == 0) {
+		res = pthread_create(&lw->thread, NULL, write_loop, lw);
+		if (res != 0) {
+			ring_free(&lw->ring);
+			(void)fclose(lw->file);
+			lw->file = NULL;
+		}
+	}
+	if (res != 0) {
+		free(lw->name);
+		lw->name = NULL;
+		return res;
+	}
+	lw->running = true;
+	return 0;
+}
+
+static void
+commit_chunk(struct logwriter * const lw, unsigned short flags)
+{
+	lw->cur->flags = flags;
+	ring_commit(&lw->ring);
+	lw->cur = NULL;
+}
+
+void
+logwriter_write(struct logwriter * const lw, const char *text, size_t len)
+{
+	while (len > 0) {
+		size_t n;
+
+		/* do not split a minute line between two chunks */
+		if (lw->cur != NULL &&
+		    lw->cur->len + len > LOGWRITER_CHUNK) {
+			commit_chunk(lw, 0);
+		}
+		if (lw->cur == NULL) {
+			if (ring_space(&lw->ring) <= 1) {
+				__atomic_add_fetch(&lw->overruns, 1,
+				    __ATOMIC_RELAXED);
+				return;
+			}
+			lw->cur = ring_write_slot(&lw->ring);
+			lw->cur->len = 0;
+		}
+		n = len < LOGWRITER_CHUNK - lw->cur->len ? len :
+		    LOGWRITER_CHUNK - lw->cur->len;
+		memcpy(lw->cur->text + lw->cur->len, text, n);
+		lw->cur->len += n;
+		if (memchr(text, '\n', n) != NULL) {
+			commit_chunk(lw, LOGCHUNK_EOM);
+		}
+		text += n;
+		len -= n;
+	}
+}
+
+int
+logwriter_close(struct logwriter * const lw)
+{
+	const struct timespec pause = { 0, 10000000 };
+
+	if (!lw->running) {
+		return 0;
+	}
+	if (lw->cur == NULL) {
+		/* the writing thread frees a slot sooner or later */
+		while (ring_space(&lw->ring) == 0) {
+			(void)nanosleep(&pause, NULL);
+		}
+		lw->cur = ring_write_slot(&lw->ring);
+		lw->cur->len = 0;
+	}
+	commit_chunk(lw, LOGCHUNK_STOP);
+	(void)pthread_join(lw->thread, NULL);
+	ring_free(&lw->ring);
+	free(lw->name);
+	lw->name = NULL;
+	lw->running = false;
+	return lw->error;
+}
+
+unsigned long long
+logwriter_overruns(const struct logwriter * const lw)
+{
+	return __atomic_load_n(&lw->overruns, __ATOMIC_RELAXED);
+}
+
+unsigned long
+logwriter_rotations(const struct logwriter * const lw)
+{
+	return __atomic_load_n(&lw->rotations, __ATOMIC_RELAXED);
+}
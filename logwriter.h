@@ -0,0 +1,167 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_LOGWRITER_H
+#define DCF77PI_LOGWRITER_H
+
+#include "binlog.h"
+#include "ring.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+struct json_object;
+
+/** Number of chunks the queue can hold, a chunk is about one minute */
+#define LOGWRITER_SLOTS 64
+
+/** Size of the text of one chunk */
+#define LOGWRITER_CHUNK 248
+
+/** Never synchronize the log file to storage, only write it */
+#define LOGWRITER_SYNC_NONE 0
+
+/** Synchronize the log file to storage after each minute */
+#define LOGWRITER_SYNC_MINUTE (-1)
+
+/**
+ * When to synchronize the log file to its storage and when to rotate it. The
+ * log file is only written, synchronized and rotated at the end of a minute,
+ * or when a minute does not fit in one chunk.
+ */
+struct logwriter_policy {
+	/**
+	 * {@link LOGWRITER_SYNC_NONE}, {@link LOGWRITER_SYNC_MINUTE}, or the
+	 * minimum number of seconds between two synchronizations
+	 */
+	int syncsecs;
+	/** rotate the log file when it is at least this large, 0 for never */
+	unsigned long long maxsize;
+	/**
+	 * rotate the log file when it was opened at least this many seconds
+	 * ago, 0 for never
+	 */
+	unsigned long maxage;
+};
+
+/** Chunk of text in the queue of a log writer */
+struct logchunk {
+	/** number of bytes in {@link logchunk.text} */
+	unsigned short len;
+	/** the text ends a minute, or the writer should stop */
+	unsigned short flags;
+	/** text in the format of a text log file */
+	char text[LOGWRITER_CHUNK];
+};
+
+/** The chunk ends a minute */
+#define LOGCHUNK_EOM 1
+
+/** The chunk is the last one, the writing thread closes the file */
+#define LOGCHUNK_STOP 2
+
+/**
+ * Asynchronous writer of a log file. The bit reader adds text to a chunk
+ * without any system calls, full chunks are passed through a lock-free queue
+ * to a thread which writes them in batches. The fields should be considered
+ * private to logwriter.c
+ */
+struct logwriter {
+	/** queue of chunks (struct logchunk) */
+	struct ring ring;
+	/** chunk being filled by the producer, NULL if none */
+	struct logchunk *cur;
+	/** the writing thread */
+	pthread_t thread;
+	/** the writing thread is running */
+	bool running;
+	/** the name of the log file, the rotated files get a suffix */
+	char *name;
+	/** the log file, only used by the writing thread */
+	FILE *file;
+	/** the log file is a binary log file, see binlog.h */
+	bool binary;
+	/** encoder of a binary log file, only used by the writing thread */
+	struct binlog_writer binlog;
+	/** the synchronization and rotation policy */
+	struct logwriter_policy policy;
+	/** monotonic time when the log file was opened */
+	time_t opened;
+	/** monotonic time of the last synchronization */
+	time_t synced;
+	/** number of chunks dropped because the queue was full */
+	unsigned long long overruns;
+	/** number of rotations, only written by the writing thread */
+	unsigned long rotations;
+	/** first error of the writing thread, 0 if none */
+	int error;
+};
+
+/**
+ * Read the log file policy from the configuration. The optional keys are
+ * "logsync" ("none", "minute" or a number of seconds, default "none"),
+ * "logrotatemb" (size in MB, default 0) and "logrotatehours" (age in hours,
+ * default 0).
+ *
+ * @param policy The policy to fill in.
+ * @param config The JSON object containing the parsed configuration from
+ * config.json , or NULL for the defaults.
+ * @return Success (0), or -1 if a value is invalid.
+ */
+int logwriter_policy(struct logwriter_policy * const policy,
+    struct json_object *config);
+
+/**
+ * Open a log file for appending and start the writing thread.
+ *
+ * @param lw The log writer to initialize.
+ * @param name The name of the log file.
+ * @param binary A new or empty log file becomes a binary log file. An
+ * existing log file is always appended to in its own format.
+ * @param policy The synchronization and rotation policy.
+ * @return Success (0), or errno on error.
+ */
+int logwriter_open(struct logwriter * const lw, const char * const name,
+    bool binary, const struct logwriter_policy * const policy);
+
+/**
+ * Append text to the log file, for the producer. The text is written once its
+ * chunk is full or a minute ends. Text which does not fit in the queue is
+ * dropped and counted as an overrun.
+ *
+ * @param lw The log writer.
+ * @param text The text, in the format of a text log file.
+ * @param len The length of the text in bytes.
+ */
+void logwriter_write(struct logwriter * const lw, const char *text,
+    size_t len);
+
+/**
+ * Write the remaining text, stop the writing thread and close the log file.
+ *
+ * @param lw The log writer.
+ * @return Success (0), or the first error of the writing thread.
+ */
+int logwriter_close(struct logwriter * const lw);
+
+/**
+ * Retrieve the number of chunks which were dropped because the writing thread
+ * did not keep up.
+ *
+ * @param lw The log writer.
+ * @return The number of queue overruns.
+ */
+unsigned long long logwriter_overruns(const struct logwriter * const lw);
+
+/**
+ * Retrieve the number of times the log file was rotated.
+ *
+ * @param lw The log writer.
+ * @return The number of rotations since the log file was opened.
+ */
+unsigned long logwriter_rotations(const struct logwriter * const lw);
+
+#endif
@@ -1,17 +1,190 @@
-// Copyright 2014-2019 René Ladan
+// Copyright 2014-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "mainloop.h"
 
+#include "binlog.h"
 #include "bits1to14.h"
+#include "calendar.h"
 #include "decode_alarm.h"
 #include "decode_time.h"
 #include "input.h"
 #include "setclock.h"
+#include "warmstart.h"
 
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+/* steps between two snapshots of a speculative decoder, about an hour */
+#define SNAPSHOT_STEPS 3600
+/* minimum steps between two snapshots around minutes using the history */
+#define MIN_SNAPSHOT_STEPS 600
+/* more chunks than threads, so that a slow chunk does not stall the others */
+#define CHUNKS_PER_THREAD 4
+/* smallest chunk worth a thread, about 14000 minutes */
+#define MIN_CHUNK_SIZE (1024 * 1024)
+/* write the state file at most this often, in nanoseconds */
+#define SAVE_INTERVAL (600 * 1000000000LL)
+
+/* State of a speculative decoder at some point in its chunk */
+struct ML_snapshot {
+	struct ML_state mls;
+	/* offset in the output of the chunk */
+	long outpos;
+	/* the output since the previous snapshot depends on the time history */
+	bool dirty;
+	/* all input has been processed */
+	bool done;
+};
+
+struct ML_chunk {
+	/* offsets in the log file */
+	size_t start, end;
+	/* speculative output */
+	FILE *out;
+	struct ML_snapshot *snap;
+	size_t nsnap, maxsnap;
+	int res;
+	bool finished;
+};
+
+struct ML_pool {
+	const char *logfilename;
+	const struct ML_callbacks *cb;
+	struct ML_chunk *chunk;
+	unsigned nchunks;
+	/* next chunk to decode */
+	unsigned next;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+static const char *statefile;
+static long long saved_mono = -1;
+
+void
+set_statefile(const char * const filename)
+{
+	statefile = filename;
+}
+
+static long long
+now_ns(clockid_t clock_id)
+{
+	struct timespec now;
+
+	(void)clock_gettime(clock_id, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void
+save_state(struct tm curtime)
+{
+	struct warmstart ws;
+	struct DT_state dts;
+	struct bitinfo bi;
+	long long mono;
+
+	if (statefile == NULL) {
+		return;
+	}
+	mono = now_ns(CLOCK_MONOTONIC);
+	if (saved_mono != -1 && mono - saved_mono < SAVE_INTERVAL) {
+		return;
+	}
+	saved_mono = mono;
+	bi = get_bitinfo();
+	dts = get_time_state();
+	(void)memset(&ws, 0, sizeof(ws));
+	ws.freq = get_hardware_parameters().freq;
+	/* the start of the minute, after the system clock was set */
+	ws.time = now_ns(CLOCK_REALTIME) - (bi.edge_mono == -1 ? 50000000 :
+	    now_ns(CLOCK_MONOTONIC) - bi.edge_mono);
+	ws.realfreq = bi.realfreq;
+	ws.bit0 = bi.bit0;
+	ws.bit20 = bi.bit20;
+	ws.curtime[0] = curtime.tm_year;
+	ws.curtime[1] = curtime.tm_mon;
+	ws.curtime[2] = curtime.tm_mday;
+	ws.curtime[3] = curtime.tm_wday;
+	ws.curtime[4] = curtime.tm_hour;
+	ws.curtime[5] = curtime.tm_min;
+	ws.curtime[6] = curtime.tm_isdst;
+	ws.dst_count = dts.dst_count;
+	ws.leap_count = dts.leap_count;
+	ws.minute_count = dts.minute_count;
+	ws.acc_minlen_partial = dts.acc_minlen_partial;
+	ws.dst_announce = dts.dt_res.dst_announce;
+	ws.leap_announce = dts.dt_res.leap_announce;
+	(void)warmstart_write(statefile, &ws);
+}
+
+void
+restore_state(const struct warmstart * const ws, long long now,
+    struct tm * const curtime)
+{
+	struct DT_state dts;
+	long long elapsed;
+	bool newhour = false;
+
+	curtime->tm_year = ws->curtime[0];
+	curtime->tm_mon = ws->curtime[1];
+	curtime->tm_mday = ws->curtime[2];
+	curtime->tm_wday = ws->curtime[3];
+	curtime->tm_hour = ws->curtime[4];
+	curtime->tm_min = ws->curtime[5];
+	curtime->tm_isdst = ws->curtime[6];
+	/* in milliseconds, like acc_minlen */
+	elapsed = (now - ws->time) / 1000000 + ws->acc_minlen_partial;
+	for (long long m = elapsed / 60000; m > 0; m--) {
+		*curtime = add_minute(*curtime, ws->dst_announce && !newhour);
+		if (curtime->tm_min == 0) {
+			if (ws->dst_announce && !newhour) {
+				/* handle_dst() would have done this */
+				curtime->tm_isdst = 1 - curtime->tm_isdst;
+			}
+			newhour = true;
+		}
+	}
+	init_time_state(&dts);
+	/* the announcements are cleared at the start of each hour */
+	if (!newhour) {
+		dts.dst_count = ws->dst_count;
+		dts.leap_count = ws->leap_count;
+		dts.dt_res.dst_announce = ws->dst_announce;
+		dts.dt_res.leap_announce = ws->leap_announce;
+	}
+	dts.minute_count = ws->minute_count;
+	/* the first minute marker comes within a second, or after a minute */
+	dts.acc_minlen_partial = elapsed % 60000 < 1000 ? 0 :
+	    (unsigned)(elapsed % 60000);
+	set_time_state(&dts);
+}
+
+/*
+ * Continue from the state file if it is recent enough, returning the initial
+ * value of init_min.
+ */
+static unsigned
+read_state(struct tm * const curtime)
+{
+	struct warmstart ws;
+	long long now;
+
+	if (statefile == NULL || warmstart_read(statefile, &ws) != 0) {
+		return 2;
+	}
+	now = now_ns(CLOCK_REALTIME);
+	if (!warmstart_check(&ws, get_hardware_parameters().freq, now)) {
+		return 2;
+	}
+	restore_state(&ws, now, curtime);
+	return 0;
+}
+
 static void
 check_handle_new_minute(struct GB_result bit, struct ML_result *mlr,
     int bitpos, struct tm *curtime, int minlen, bool was_toolong,
@@ -27,6 +200,7 @@ check_handle_new_minute(struct GB_result bit, struct ML_result *mlr,
 	if ((bit.marker == emark_minute || bit.marker == emark_late) &&
 	    !was_toolong) {
 		struct DT_result dt;
+		bool ok;
 
 		display_minute(minlen);
 		dt = decode_time(*init_min, minlen, get_acc_minlen(),
@@ -56,14 +230,26 @@ check_handle_new_minute(struct GB_result bit, struct ML_result *mlr,
 		}
 		display_time(dt, *curtime);
 
+		ok = setclock_ok(*init_min, dt, bit);
+		if (ok) {
+			(void)publish_time(*curtime, get_bitinfo().edge_mono,
+			    get_bitinfo().edge_real,
+			    get_hardware_parameters().group_delay,
+			    dt.leap_announce);
+		}
 		if (mlr->settime) {
 			have_result = true;
-			if (setclock_ok(*init_min, dt, bit)) {
-				mlr->settime_result = setclock(*curtime);
+			if (ok) {
+				mlr->settime_result = adjust_clock(*curtime,
+				    get_bitinfo().edge_mono,
+				    get_hardware_parameters().group_delay);
 			} else {
 				mlr->settime_result = esc_unsafe;
 			}
 		}
+		if (ok) {
+			save_state(*curtime);
+		}
 		if (bit.marker == emark_minute || bit.marker == emark_late) {
 			reset_acc_minlen();
 		}
@@ -98,6 +284,7 @@ mainloop(char *logfilename, struct GB_result (*get_bit)(void),
 	(void)memset(&curtime, 0, sizeof(curtime));
 	(void)memset(&mlr, 0, sizeof(mlr));
 	mlr.logfilename = logfilename;
+	init_min = read_state(&curtime);
 
 	for (;;) {
 		struct GB_result bit;
@@ -152,6 +339,7 @@ mainloop(char *logfilename, struct GB_result (*get_bit)(void),
 		    was_toolong, &init_min, display_minute,
 		    display_thirdparty_buffer, display_alarm, display_unknown,
 		    display_weather, display_time, process_setclock_result);
+		(void)publish_holdover(bit);
 		was_toolong = false;
 		if (bit.done || mlr.quit) {
 			break;
@@ -159,3 +347,496 @@ mainloop(char *logfilename, struct GB_result (*get_bit)(void),
 	}
 	cleanup();
 }
+
+void
+init_mainloop_state(struct ML_state * const mls, FILE *out)
+{
+	init_input_state(&mls->gbs);
+	init_time_state(&mls->dts);
+	init_thirdparty_state(&mls->tps);
+	(void)memset(&mls->curtime, 0, sizeof(mls->curtime));
+	mls->minlen = 0;
+	mls->bitpos = 0;
+	mls->init_min = 2;
+	mls->was_toolong = false;
+	mls->out = out;
+}
+
+static void
+handle_new_minute_r(struct ML_state * const mls,
+    const struct ML_callbacks * const cb, struct GB_result bit)
+{
+	struct DT_result dt;
+
+	if ((bit.marker != emark_minute && bit.marker != emark_late) ||
+	    mls->was_toolong) {
+		return;
+	}
+	cb->display_minute(mls, mls->minlen);
+	dt = decode_time_r(&mls->dts, mls->init_min, mls->minlen,
+	    get_acc_minlen_r(&mls->gbs), get_buffer_r(&mls->gbs),
+	    &mls->curtime);
+
+	if (mls->curtime.tm_min % 3 == 0 && mls->init_min == 0) {
+		const unsigned *tpbuf;
+
+		tpbuf = get_thirdparty_buffer_r(&mls->tps);
+		cb->display_thirdparty_buffer(mls, tpbuf);
+		switch (get_thirdparty_type_r(&mls->tps)) {
+		case eTP_alarm:
+		{
+			struct alm civwarn;
+
+			decode_alarm(tpbuf, &civwarn);
+			cb->display_alarm(mls, civwarn);
+			break;
+		}
+		case eTP_unknown:
+			cb->display_unknown(mls);
+			break;
+		case eTP_weather:
+			cb->display_weather(mls);
+			break;
+		}
+	}
+	cb->display_time(mls, dt, mls->curtime);
+
+	reset_acc_minlen_r(&mls->gbs);
+	if (mls->init_min > 0) {
+		mls->init_min--;
+	}
+}
+
+bool
+mainloop_step_r(struct ML_state * const mls,
+    const struct ML_callbacks * const cb)
+{
+	struct GB_result bit;
+
+	bit = cb->get_bit(&mls->gbs);
+	mls->bitpos = get_bitpos_r(&mls->gbs);
+	if (!bit.skip) {
+		cb->display_bit(mls, bit, mls->bitpos);
+	}
+
+	if (mls->init_min < 2) {
+		fill_thirdparty_buffer_r(&mls->tps, mls->curtime.tm_min,
+		    mls->bitpos, bit);
+	}
+
+	bit = next_bit_r(&mls->gbs);
+	if (mls->minlen == -1) {
+		handle_new_minute_r(mls, cb, bit);
+		mls->was_toolong = true;
+	}
+
+	if (bit.marker == emark_minute) {
+		mls->minlen = mls->bitpos + 1;
+		/* handle the missing bit due to the minute marker */
+	} else if (bit.marker == emark_toolong || bit.marker == emark_late) {
+		mls->minlen = -1;
+		/*
+		 * leave acc_minlen alone, any minute marker already
+		 * processed
+		 */
+		cb->display_long_minute(mls);
+	}
+
+	handle_new_minute_r(mls, cb, bit);
+	mls->was_toolong = false;
+	return bit.done;
+}
+
+static bool
+equal_tm(const struct tm a, const struct tm b)
+{
+	return a.tm_min == b.tm_min && a.tm_hour == b.tm_hour &&
+	    a.tm_mday == b.tm_mday && a.tm_mon == b.tm_mon &&
+	    a.tm_year == b.tm_year && a.tm_wday == b.tm_wday &&
+	    a.tm_isdst == b.tm_isdst;
+}
+
+bool
+equal_mainloop_state(struct ML_state * const a, struct ML_state * const b)
+{
+	return a->minlen == b->minlen && a->bitpos == b->bitpos &&
+	    a->init_min == b->init_min && a->was_toolong == b->was_toolong &&
+	    equal_tm(a->curtime, b->curtime) &&
+	    equal_thirdparty_state(&a->tps, &b->tps) &&
+	    equal_time_state(&a->dts, &b->dts) &&
+	    equal_file_state_r(&a->gbs, &b->gbs);
+}
+
+void
+get_mainloop_checkpoint(struct ML_state * const mls,
+    struct ML_checkpoint * const cp)
+{
+	(void)memset(cp, 0, sizeof(*cp));
+	get_file_state_r(&mls->gbs, &cp->fs);
+	cp->dts = mls->dts;
+	cp->tps = mls->tps;
+	cp->curtime[0] = mls->curtime.tm_year;
+	cp->curtime[1] = mls->curtime.tm_mon;
+	cp->curtime[2] = mls->curtime.tm_mday;
+	cp->curtime[3] = mls->curtime.tm_wday;
+	cp->curtime[4] = mls->curtime.tm_hour;
+	cp->curtime[5] = mls->curtime.tm_min;
+	cp->curtime[6] = mls->curtime.tm_isdst;
+	cp->minlen = mls->minlen;
+	cp->bitpos = mls->bitpos;
+	cp->init_min = mls->init_min;
+	cp->was_toolong = mls->was_toolong;
+}
+
+int
+set_mainloop_checkpoint(struct ML_state * const mls,
+    const struct ML_checkpoint * const cp)
+{
+	mls->dts = cp->dts;
+	mls->tps = cp->tps;
+	(void)memset(&mls->curtime, 0, sizeof(mls->curtime));
+	mls->curtime.tm_year = cp->curtime[0];
+	mls->curtime.tm_mon = cp->curtime[1];
+	mls->curtime.tm_mday = cp->curtime[2];
+	mls->curtime.tm_wday = cp->curtime[3];
+	mls->curtime.tm_hour = cp->curtime[4];
+	mls->curtime.tm_min = cp->curtime[5];
+	mls->curtime.tm_isdst = cp->curtime[6];
+	mls->minlen = cp->minlen;
+	mls->bitpos = cp->bitpos;
+	mls->init_min = cp->init_min;
+	mls->was_toolong = cp->was_toolong;
+	return set_file_state_r(&mls->gbs, &cp->fs);
+}
+
+int
+adopt_mainloop_state(struct ML_state * const mls,
+    const struct ML_state * const then, struct ML_state * const now)
+{
+	mls->curtime = now->curtime;
+	mls->minlen = now->minlen;
+	mls->bitpos = now->bitpos;
+	mls->init_min = now->init_min;
+	mls->was_toolong = now->was_toolong;
+	mls->tps = now->tps;
+	adopt_time_state(&mls->dts, &then->dts, &now->dts);
+	return copy_file_state_r(&mls->gbs, &now->gbs);
+}
+
+static int
+add_snapshot(struct ML_chunk * const ch, const struct ML_state * const mls,
+    long outpos, bool dirty, bool done)
+{
+	struct ML_snapshot *sn;
+
+	if (ch->nsnap == ch->maxsnap) {
+		size_t maxsnap = ch->maxsnap == 0 ? 16 : ch->maxsnap * 2;
+
+		sn = realloc(ch->snap, maxsnap * sizeof(*sn));
+		if (sn == NULL) {
+			return errno;
+		}
+		ch->snap = sn;
+		ch->maxsnap = maxsnap;
+	}
+	sn = &ch->snap[ch->nsnap++];
+	sn->mls = *mls;
+	sn->outpos = outpos;
+	sn->dirty = dirty;
+	sn->done = done;
+	return outpos == -1 ? errno : 0;
+}
+
+/*
+ * Decode a chunk from a fresh state, taking snapshots along the way. The
+ * minutes which use the history of the time decoder are surrounded by
+ * snapshots, unless these would be too close to each other.
+ */
+static int
+decode_chunk(const struct ML_pool * const pool, struct ML_chunk * const ch)
+{
+	struct ML_state mls, mark;
+	unsigned long steps = 0, mark_step = 0, snap_step = 0;
+	long mark_outpos = 0;
+	bool dirty = false, done = false;
+	int res;
+
+	ch->out = tmpfile();
+	if (ch->out == NULL) {
+		res = errno;
+		perror("tmpfile");
+		return res;
+	}
+	init_mainloop_state(&mls, ch->out);
+	res = set_mode_file_r(&mls.gbs, pool->logfilename);
+	if (res != 0) {
+		return res;
+	}
+	/* the offsets of the snapshots are only known for mapped files */
+	res = mls.gbs.logmap.data == NULL ? EINVAL :
+	    set_file_offset_r(&mls.gbs, (long)ch->start);
+	mark = mls;
+	while (res == 0 && !done &&
+	    (size_t)get_file_offset_r(&mls.gbs) < ch->end) {
+		const struct DT_state before = mls.dts;
+
+		done = mainloop_step_r(&mls, pool->cb);
+		steps++;
+		if (get_bitpos_r(&mls.gbs) != 0) {
+			/* no minute was decoded */
+			continue;
+		}
+		if (time_history_used(&before, &mls.dts)) {
+			/* the previous minutes can still be used */
+			if (!dirty && mark_step - snap_step >=
+			    MIN_SNAPSHOT_STEPS) {
+				res = add_snapshot(ch, &mark, mark_outpos,
+				    false, false);
+				snap_step = mark_step;
+			}
+			dirty = true;
+		} else if (steps - snap_step >= (dirty ? MIN_SNAPSHOT_STEPS :
+		    SNAPSHOT_STEPS)) {
+			res = add_snapshot(ch, &mls, ftell(ch->out), dirty,
+			    done);
+			snap_step = steps;
+			dirty = false;
+		}
+		mark = mls;
+		mark_step = steps;
+		mark_outpos = ftell(ch->out);
+	}
+	if (res == 0) {
+		res = add_snapshot(ch, &mls, ftell(ch->out), dirty, done);
+	}
+	if (res == 0 && fflush(ch->out) == EOF) {
+		res = errno;
+	}
+	cleanup_r(&mls.gbs);
+	return res;
+}
+
+static void *
+run_worker(void *arg)
+{
+	struct ML_pool * const pool = arg;
+
+	for (;;) {
+		struct ML_chunk *ch;
+		int res;
+
+		(void)pthread_mutex_lock(&pool->mutex);
+		if (pool->next == pool->nchunks) {
+			(void)pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+		ch = &pool->chunk[pool->next++];
+		(void)pthread_mutex_unlock(&pool->mutex);
+
+		res = decode_chunk(pool, ch);
+
+		(void)pthread_mutex_lock(&pool->mutex);
+		ch->res = res;
+		ch->finished = true;
+		(void)pthread_cond_broadcast(&pool->cond);
+		(void)pthread_mutex_unlock(&pool->mutex);
+	}
+	return NULL;
+}
+
+/*
+ * Split the mapped log file into chunks which start at a new line, or after a
+ * sync frame for binary log files
+ */
+static unsigned
+split_chunks(struct ML_chunk * const chunk, unsigned maxchunks,
+    const struct logmap * const lm)
+{
+	/* the offsets in binary log files are in bits after the header */
+	const size_t hdr = lm->binary ? sizeof(struct binlog_file) : 0;
+	const size_t scale = lm->binary ? 8 : 1;
+	unsigned nchunks = 0;
+	size_t start = hdr;
+
+	while (start < lm->size) {
+		const unsigned char *eol;
+		size_t end;
+
+		end = start + lm->size / maxchunks;
+		if (end >= lm->size || nchunks == maxchunks - 1) {
+			end = lm->size;
+		} else if (lm->binary) {
+			end = binlog_find_sync(lm->data, lm->size, end);
+		} else {
+			eol = memchr(lm->data + end, '\n', lm->size - end);
+			end = eol == NULL ? lm->size :
+			    (size_t)(eol - lm->data) + 1;
+		}
+		(void)memset(&chunk[nchunks], 0, sizeof(chunk[nchunks]));
+		chunk[nchunks].start = (start - hdr) * scale;
+		chunk[nchunks].end = (end - hdr) * scale;
+		nchunks++;
+		start = end;
+	}
+	return nchunks;
+}
+
+static void
+free_chunk(struct ML_chunk * const ch)
+{
+	if (ch->out != NULL) {
+		(void)fclose(ch->out);
+	}
+	free(ch->snap);
+	ch->out = NULL;
+	ch->snap = NULL;
+}
+
+/* Append the output of a chunk between two snapshots to out */
+static int
+copy_output(FILE *out, FILE *in, long from, long to)
+{
+	char buf[BUFSIZ];
+
+	if (fseek(in, from, SEEK_SET) == -1) {
+		return errno;
+	}
+	while (from < to) {
+		size_t n = (size_t)(to - from) < sizeof(buf) ?
+		    (size_t)(to - from) : sizeof(buf);
+
+		if (fread(buf, 1, n, in) != n || fwrite(buf, 1, n, out) != n) {
+			return EIO;
+		}
+		from += (long)n;
+	}
+	return 0;
+}
+
+/*
+ * Decode the log file sequentially, but skip over the parts of a chunk where
+ * the sequential state matches the speculative one, using the speculative
+ * output instead.
+ */
+static int
+stitch_chunks(struct ML_pool * const pool, struct ML_state * const mls)
+{
+	bool done = false;
+	int res = 0;
+
+	for (unsigned c = 0; c < pool->nchunks && !done && res == 0; c++) {
+		struct ML_chunk * const ch = &pool->chunk[c];
+
+		(void)pthread_mutex_lock(&pool->mutex);
+		while (!ch->finished) {
+			(void)pthread_cond_wait(&pool->cond, &pool->mutex);
+		}
+		(void)pthread_mutex_unlock(&pool->mutex);
+
+		/* on failure, the chunk is simply decoded sequentially */
+		for (size_t k = 0; ch->res == 0 && k < ch->nsnap && !done &&
+		    res == 0; k++) {
+			struct ML_snapshot * const sn = &ch->snap[k];
+			size_t j;
+
+			while (!done && get_file_offset_r(&mls->gbs) <
+			    get_file_offset_r(&sn->mls.gbs)) {
+				done = mainloop_step_r(mls, pool->cb);
+			}
+			if (done || !equal_mainloop_state(mls, &sn->mls)) {
+				continue;
+			}
+			for (j = k; j + 1 < ch->nsnap && !ch->snap[j + 1].dirty;
+			    j++) {
+				/* the output up to snapshot j + 1 matches */
+			}
+			if (j == k) {
+				continue;
+			}
+			res = copy_output(mls->out, ch->out, sn->outpos,
+			    ch->snap[j].outpos);
+			if (res == 0) {
+				res = adopt_mainloop_state(mls, &sn->mls,
+				    &ch->snap[j].mls);
+			}
+			done = ch->snap[j].done;
+			k = j;
+		}
+		free_chunk(ch);
+	}
+	while (!done && res == 0) {
+		done = mainloop_step_r(mls, pool->cb);
+	}
+	return res;
+}
+
+int
+mainloop_parallel(const char * const logfilename, unsigned nthreads,
+    const struct ML_callbacks * const cb, FILE *out)
+{
+	struct ML_pool pool;
+	struct ML_state mls;
+	pthread_t *thread;
+	unsigned maxchunks, nthr;
+	int res;
+
+	init_mainloop_state(&mls, out);
+	res = set_mode_file_r(&mls.gbs, logfilename);
+	if (res != 0) {
+		return res;
+	}
+	maxchunks = nthreads * CHUNKS_PER_THREAD;
+	if (mls.gbs.logmap.data != NULL &&
+	    mls.gbs.logmap.size / MIN_CHUNK_SIZE < maxchunks) {
+		maxchunks = (unsigned)(mls.gbs.logmap.size / MIN_CHUNK_SIZE);
+	}
+	if (nthreads < 2 || mls.gbs.logmap.data == NULL || maxchunks < 2) {
+		while (!mainloop_step_r(&mls, cb)) {
+			/* decode sequentially */
+		}
+		cleanup_r(&mls.gbs);
+		return 0;
+	}
+
+	pool.logfilename = logfilename;
+	pool.cb = cb;
+	pool.next = 0;
+	pool.chunk = calloc(maxchunks, sizeof(*pool.chunk));
+	thread = calloc(nthreads, sizeof(*thread));
+	if (pool.chunk == NULL || thread == NULL) {
+		res = errno;
+		free(pool.chunk);
+		free(thread);
+		cleanup_r(&mls.gbs);
+		return res;
+	}
+	pool.nchunks = split_chunks(pool.chunk, maxchunks, &mls.gbs.logmap);
+	(void)pthread_mutex_init(&pool.mutex, NULL);
+	(void)pthread_cond_init(&pool.cond, NULL);
+	for (nthr = 0; nthr < nthreads && nthr < pool.nchunks; nthr++) {
+		if (pthread_create(&thread[nthr], NULL, run_worker, &pool) !=
+		    0) {
+			break;
+		}
+	}
+	if (nthr == 0) {
+		/* no threads after all, decode the chunks up front */
+		(void)run_worker(&pool);
+	}
+
+	res = stitch_chunks(&pool, &mls);
+
+	for (unsigned i = 0; i < nthr; i++) {
+		(void)pthread_join(thread[i], NULL);
+	}
+	/* the chunks which were not needed after an error */
+	for (unsigned c = 0; c < pool.nchunks; c++) {
+		free_chunk(&pool.chunk[c]);
+	}
+	(void)pthread_cond_destroy(&pool.cond);
+	(void)pthread_mutex_destroy(&pool.mutex);
+	free(pool.chunk);
+	free(thread);
+	cleanup_r(&mls.gbs);
+	return res;
+}
@@ -1,17 +1,20 @@
-// Copyright 2014-2018 René Ladan
+// Copyright 2014-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #ifndef DCF77PI_MAINLOOP_H
 #define DCF77PI_MAINLOOP_H
 
+#include "bits1to14.h"
+#include "decode_time.h"
+#include "input.h"
 #include "setclock.h"
+#include "warmstart.h"
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
 
-struct DT_result;
-struct GB_result;
 struct alm;
-struct tm;
 
 /** User input which controls the client */
 struct ML_result {
@@ -73,4 +76,195 @@ void mainloop(char *logfilename,
     struct ML_result (*process_input)(struct ML_result, int),
     struct ML_result (*post_process_input)(struct ML_result, int));
 
+/**
+ * Keep the adaptive state of the bit reader and the time decoder in a file
+ * (see warmstart.h), which {@link mainloop} writes after a minute which is
+ * safe to set the clock from, at most every ten minutes. When the file is
+ * recent, {@link mainloop} continues from it at startup instead of waiting
+ * for two complete minutes, so that the first complete minute can already be
+ * used. The bit lengths are restored by set_mode_live() if the same file is
+ * configured as "statefile".
+ *
+ * @param filename The name of the state file, which must stay valid while
+ * {@link mainloop} runs, or NULL to not use one.
+ */
+void set_statefile(const char * const filename);
+
+/**
+ * Continue decoding from a saved state, as {@link mainloop} does at startup
+ * with init_min set to 0 afterwards. The minutes which passed since the state
+ * was saved are added to the time, clearing the announcements when an hour
+ * started in between, and the remainder is left to decode_time() as a
+ * partial minute.
+ *
+ * @param ws The saved state, which passed warmstart_check().
+ * @param now The current CLOCK_REALTIME time in ns.
+ * @param curtime The time to continue from.
+ */
+void restore_state(const struct warmstart * const ws, long long now,
+    struct tm * const curtime);
+
+/**
+ * State of the main loop for decoding without user interaction, to be used
+ * with {@link mainloop_step_r} so that several log files or parts of one can
+ * be decoded at the same time.
+ */
+struct ML_state {
+	/** the bit reader */
+	struct GB_state gbs;
+	/** the time decoder */
+	struct DT_state dts;
+	/** the third party buffer */
+	struct TP_state tps;
+	/** the decoded time */
+	struct tm curtime;
+	/** length of the current minute in bits, -1 if too long */
+	int minlen;
+	/** position of the last bit */
+	int bitpos;
+	/** 2 = just starting, 1 = first minute marker passed, 0 = normal */
+	unsigned init_min;
+	/** the previous minute was too long */
+	bool was_toolong;
+	/** stream for the callbacks to write to */
+	FILE *out;
+};
+
+/**
+ * State of a main loop decoding a log file, which can be stored to continue
+ * decoding later, see {@link get_mainloop_checkpoint}.
+ */
+struct ML_checkpoint {
+	/** the bit reader */
+	struct GB_filestate fs;
+	/** the time decoder */
+	struct DT_state dts;
+	/** the third party buffer */
+	struct TP_state tps;
+	/** the decoded time: year, month, day, weekday, hour, minute, DST */
+	int curtime[7];
+	/** length of the current minute in bits, -1 if too long */
+	int minlen;
+	/** position of the last bit */
+	int bitpos;
+	/** 2 = just starting, 1 = first minute marker passed, 0 = normal */
+	unsigned init_min;
+	/** the previous minute was too long */
+	bool was_toolong;
+};
+
+/**
+ * Callbacks for {@link mainloop_step_r}, which have the same meaning as the
+ * ones of {@link mainloop} but get the state of the main loop as their first
+ * argument.
+ */
+struct ML_callbacks {
+	/** obtain a bit, for example get_bit_file_r() */
+	struct GB_result (*get_bit)(struct GB_state * const);
+	/** display the currently received bit */
+	void (*display_bit)(struct ML_state *, struct GB_result, int);
+	/** indicate that this minute is too long */
+	void (*display_long_minute)(struct ML_state *);
+	/** display information about the current minute */
+	void (*display_minute)(struct ML_state *, int);
+	/** display third party alarm messages */
+	void (*display_alarm)(struct ML_state *, struct alm);
+	/** display unknown third party messages */
+	void (*display_unknown)(struct ML_state *);
+	/** display third party weather messages */
+	void (*display_weather)(struct ML_state *);
+	/** display the decoded time */
+	void (*display_time)(struct ML_state *, struct DT_result, struct tm);
+	/** display the third party buffer */
+	void (*display_thirdparty_buffer)(struct ML_state *, const unsigned[]);
+};
+
+/**
+ * Initialize the state of a main loop for use with {@link mainloop_step_r}.
+ * The bit reader still needs to be prepared, for example using
+ * {@link set_mode_file_r}.
+ *
+ * @param mls The state to initialize.
+ * @param out The stream for the callbacks to write to.
+ */
+void init_mainloop_state(struct ML_state * const mls, FILE *out);
+
+/**
+ * Process one bit like one iteration of {@link mainloop}, without handling
+ * user input or setting the system clock.
+ *
+ * @param mls The state of the main loop.
+ * @param cb The callbacks to use.
+ * @return All input has been processed.
+ */
+bool mainloop_step_r(struct ML_state * const mls,
+    const struct ML_callbacks * const cb);
+
+/**
+ * Compare the states of two main loops decoding the same log file, see
+ * {@link equal_file_state_r} and {@link equal_time_state}.
+ *
+ * @param a The first main loop state.
+ * @param b The second main loop state.
+ * @return The states are equal apart from the number of correctly decoded
+ * minutes.
+ */
+bool equal_mainloop_state(struct ML_state * const a,
+    struct ML_state * const b);
+
+/**
+ * Continue with the state of another main loop decoding the same log file,
+ * see {@link copy_file_state_r} and {@link adopt_time_state}.
+ *
+ * @param mls The state of the main loop, which must equal then according to
+ * {@link equal_mainloop_state}.
+ * @param then The earlier state of the other main loop.
+ * @param now The current state of the other main loop.
+ * @return Success (0), or errno on error.
+ */
+int adopt_mainloop_state(struct ML_state * const mls,
+    const struct ML_state * const then, struct ML_state * const now);
+
+/**
+ * Retrieve the state of a main loop decoding a log file.
+ *
+ * @param mls The state of the main loop, in file mode.
+ * @param cp The checkpoint to fill in.
+ */
+void get_mainloop_checkpoint(struct ML_state * const mls,
+    struct ML_checkpoint * const cp);
+
+/**
+ * Continue decoding a log file from a checkpoint retrieved earlier using
+ * {@link get_mainloop_checkpoint}, giving the same results as when the file
+ * would have been decoded from the start.
+ *
+ * @param mls The state of the main loop, prepared using
+ * {@link set_mode_file_r}.
+ * @param cp The checkpoint to continue from.
+ * @return Success (0), or errno on error.
+ */
+int set_mainloop_checkpoint(struct ML_state * const mls,
+    const struct ML_checkpoint * const cp);
+
+/**
+ * Decode a log file like repeatedly calling {@link mainloop_step_r} does, but
+ * using several threads. The file is split into chunks at line boundaries
+ * which are decoded speculatively from a fresh state. The results of a chunk
+ * are used as soon as the state of the sequential decoder matches the
+ * speculative one, the parts where the speculative results could differ are
+ * decoded again.
+ *
+ * The file is decoded sequentially if it cannot be memory-mapped.
+ *
+ * @param logfilename The name of the log file to decode.
+ * @param nthreads The number of threads to decode the chunks with.
+ * @param cb The callbacks to use, these are called from several threads but
+ * only write to their given stream.
+ * @param out The stream to write the output to.
+ * @return Success (0), or errno on error.
+ */
+int mainloop_parallel(const char * const logfilename, unsigned nthreads,
+    const struct ML_callbacks * const cb, FILE *out);
+
 #endif
@@ -0,0 +1,292 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "rawcap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* the blocks start after the file header, aligned for their 64-bit fields */
+#define HDRSIZE 64
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+static size_t
+block_size(unsigned freq)
+{
+	return ALIGN8(sizeof(struct rawcap_block) + (freq + 7) / 8);
+}
+
+static struct rawcap_block *
+slot(const struct rawcap * const rc, uint64_t seq)
+{
+	return (struct rawcap_block *)((unsigned char *)rc->file + HDRSIZE +
+	    (seq % rc->file->nblocks) * rc->file->blocksize);
+}
+
+static int
+map_file(struct rawcap * const rc, int fd, size_t size, bool writable)
+{
+	void *map;
+
+	map = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+	    MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap(rawcap)");
+		return errno;
+	}
+	rc->file = map;
+	rc->size = size;
+	rc->writable = writable;
+	rc->buf = NULL;
+	rc->blk = NULL;
+	rc->seq = 0;
+	rc->pos = 0;
+	return 0;
+}
+
+int
+rawcap_open(struct rawcap * const rc, const char * const path,
+    uint64_t nblocks, unsigned freq)
+{
+	struct stat st;
+	size_t size;
+	int fd, res;
+
+	rc->file = NULL;
+	if (nblocks == 0 || freq == 0) {
+		return EINVAL;
+	}
+	size = HDRSIZE + nblocks * block_size(freq);
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd == -1) {
+		perror("open(rawcap)");
+		return errno;
+	}
+	if (fstat(fd, &st) == -1) {
+		res = errno;
+		perror("fstat(rawcap)");
+		(void)close(fd);
+		return res;
+	}
+	if ((size_t)st.st_size == size) {
+		res = map_file(rc, fd, size, true);
+		if (res != 0) {
+			(void)close(fd);
+			return res;
+		}
+		if (memcmp(rc->file->magic, RAWCAP_MAGIC, 8) == 0 &&
+		    rc->file->version == RAWCAP_VERSION &&
+		    rc->file->freq == freq && rc->file->nblocks == nblocks &&
+		    rc->file->blocksize == block_size(freq)) {
+			/* continue the existing capture */
+			(void)close(fd);
+			return 0;
+		}
+		(void)munmap(rc->file, rc->size);
+		rc->file = NULL;
+	}
+	/* start anew, the file reads as zeroes */
+	if (ftruncate(fd, 0) == -1 || ftruncate(fd, (off_t)size) == -1) {
+		res = errno;
+		perror("ftruncate(rawcap)");
+		(void)close(fd);
+		return res;
+	}
+	res = map_file(rc, fd, size, true);
+	(void)close(fd);
+	if (res != 0) {
+		return res;
+	}
+	memcpy(rc->file->magic, RAWCAP_MAGIC, 8);
+	rc->file->version = RAWCAP_VERSION;
+	rc->file->freq = freq;
+	rc->file->blocksize = (uint32_t)block_size(freq);
+	rc->file->nblocks = nblocks;
+	rc->file->head = 0;
+	return 0;
+}
+
+int
+rawcap_open_read(struct rawcap * const rc, const char * const path)
+{
+	const struct rawcap_file *f;
+	struct stat st;
+	int fd, res;
+
+	rc->file = NULL;
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		perror("open(rawcap)");
+		return errno;
+	}
+	if (fstat(fd, &st) == -1) {
+		res = errno;
+		perror("fstat(rawcap)");
+		(void)close(fd);
+		return res;
+	}
+	if ((size_t)st.st_size < HDRSIZE) {
+		(void)close(fd);
+		return EINVAL;
+	}
+	res = map_file(rc, fd, (size_t)st.st_size, false);
+	(void)close(fd);
+	if (res != 0) {
+		return res;
+	}
+	f = rc->file;
+	if (memcmp(f->magic, RAWCAP_MAGIC, 8) != 0 ||
+	    f->version != RAWCAP_VERSION || f->freq == 0 || f->nblocks == 0 ||
+	    f->blocksize != block_size(f->freq) ||
+	    HDRSIZE + f->nblocks * f->blocksize != rc->size) {
+		rawcap_close(rc);
+		return EINVAL;
+	}
+	rc->buf = malloc(f->blocksize);
+	if (rc->buf == NULL) {
+		res = errno;
+		rawcap_close(rc);
+		return res;
+	}
+	if (rawcap_head(rc) > f->nblocks) {
+		rc->seq = rawcap_head(rc) - f->nblocks;
+	}
+	return 0;
+}
+
+/* Copy n samples starting at sample from of src to the start of dst */
+static void
+copy_samples(unsigned char *dst, const unsigned char *src, unsigned from,
+    unsigned n)
+{
+	if ((from & 7) == 0) {
+		memcpy(dst, src + from / 8, (n + 7) / 8);
+	} else {
+		memset(dst, 0, (n + 7) / 8);
+		for (unsigned i = 0; i < n; i++, from++) {
+			if ((src[from / 8] & (1 << (from & 7))) != 0) {
+				dst[i / 8] |= (unsigned char)(1 << (i & 7));
+			}
+		}
+	}
+	/* do not keep stale samples beyond n */
+	if ((n & 7) != 0) {
+		dst[n / 8] &= (unsigned char)((1 << (n & 7)) - 1);
+	}
+}
+
+void
+rawcap_write(struct rawcap * const rc, long long t, bool active_high,
+    const unsigned char * const signal, unsigned nsamples)
+{
+	const unsigned freq = rc->file->freq;
+	unsigned from = 0;
+
+	while (from < nsamples) {
+		struct rawcap_block *blk;
+		uint64_t head = rc->file->head;
+		unsigned n = nsamples - from;
+
+		if (n > freq) {
+			n = freq;
+		}
+		blk = slot(rc, head);
+		/*
+		 * Invalidate the block for readers while it is rewritten, the
+		 * fence keeps the new contents from becoming visible before
+		 */
+		__atomic_store_n(&blk->seq, UINT64_MAX, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		blk->t = t + (long long)from * 1000000000 / freq;
+		blk->freq = freq;
+		blk->nsamples = n;
+		blk->active_high = active_high ? 1 : 0;
+		blk->flags = from > 0 ? RAWCAP_CONT : 0;
+		copy_samples(blk->data, signal, from, n);
+		__atomic_store_n(&blk->seq, head, __ATOMIC_RELEASE);
+		__atomic_store_n(&rc->file->head, head + 1, __ATOMIC_RELEASE);
+		from += n;
+	}
+}
+
+uint64_t
+rawcap_head(const struct rawcap * const rc)
+{
+	return __atomic_load_n(&rc->file->head, __ATOMIC_ACQUIRE);
+}
+
+int
+rawcap_block(const struct rawcap * const rc, uint64_t seq,
+    struct rawcap_block * const dst)
+{
+	const struct rawcap_block *blk;
+	uint64_t head = rawcap_head(rc);
+
+	if (seq >= head || head - seq > rc->file->nblocks) {
+		return -1;
+	}
+	blk = slot(rc, seq);
+	if (__atomic_load_n(&blk->seq, __ATOMIC_ACQUIRE) != seq) {
+		return -1;
+	}
+	memcpy(dst, blk, rc->file->blocksize);
+	/* the copy is only whole if the writer did not start in the meantime */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&blk->seq, __ATOMIC_RELAXED) != seq ||
+	    dst->nsamples > rc->file->freq) {
+		return -1;
+	}
+	return 0;
+}
+
+int
+rawcap_read(struct rawcap * const rc, long long *t)
+{
+	const struct rawcap_block *blk = rc->blk;
+	unsigned pos = rc->pos;
+
+	while (blk == NULL || pos >= blk->nsamples) {
+		uint64_t head = rawcap_head(rc);
+
+		if (rc->seq >= head) {
+			return -1;
+		}
+		if (head - rc->seq > rc->file->nblocks) {
+			/* the writer overtook us */
+			rc->seq = head - rc->file->nblocks;
+		}
+		blk = rawcap_block(rc, rc->seq++, rc->buf) == 0 ? rc->buf :
+		    NULL;
+		pos = 0;
+	}
+	rc->blk = blk;
+	rc->pos = pos + 1;
+	if (t != NULL) {
+		*t = blk->t + (long long)pos * 1000000000 / blk->freq;
+	}
+	return (blk->data[pos / 8] >> (pos & 7)) & 1;
+}
+
+void
+rawcap_close(struct rawcap * const rc)
+{
+	if (rc->file == NULL) {
+		return;
+	}
+	if (rc->writable && msync(rc->file, rc->size, MS_SYNC) == -1) {
+		perror("msync(rawcap)");
+	}
+	if (munmap(rc->file, rc->size) == -1) {
+		perror("munmap(rawcap)");
+	}
+	free(rc->buf);
+	rc->buf = NULL;
+	rc->blk = NULL;
+	rc->file = NULL;
+}
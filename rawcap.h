@@ -0,0 +1,170 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_RAWCAP_H
+#define DCF77PI_RAWCAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Magic bytes at the start of a raw capture file */
+#define RAWCAP_MAGIC "DCF77RAW"
+
+/** Version of the raw capture file format */
+#define RAWCAP_VERSION 1
+
+/**
+ * Header of a raw capture file, followed by {@link rawcap_file.nblocks}
+ * blocks of {@link rawcap_file.blocksize} bytes each which are used as a ring.
+ * All fields are in host byte order.
+ */
+struct rawcap_file {
+	/** {@link RAWCAP_MAGIC}, without the terminating NUL */
+	char magic[8];
+	/** {@link RAWCAP_VERSION} */
+	uint32_t version;
+	/** sample frequency in Hz, which determines the block size */
+	uint32_t freq;
+	/** size of one block in bytes, including its header */
+	uint32_t blocksize;
+	/** reserved, 0 */
+	uint32_t reserved;
+	/** number of blocks in the file */
+	uint64_t nblocks;
+	/**
+	 * number of blocks written since the file was created, block n is
+	 * stored at position n % nblocks
+	 */
+	uint64_t head;
+};
+
+/** The block continues the bit of the previous block */
+#define RAWCAP_CONT 1
+
+/**
+ * Block of at most one second of samples, normally one bit. Bits which take
+ * longer than one second (the minute marker) continue in the next block.
+ */
+struct rawcap_block {
+	/** sequence number of the block, equal to its index in the ring */
+	uint64_t seq;
+	/** monotonic time of the first sample in nanoseconds */
+	int64_t t;
+	/** sample frequency in Hz */
+	uint32_t freq;
+	/** number of samples in this block */
+	uint32_t nsamples;
+	/** the pin value is high (1) or low (0) for active signal */
+	uint8_t active_high;
+	/** {@link RAWCAP_CONT} or 0 */
+	uint8_t flags;
+	/** reserved, 0 */
+	uint8_t reserved[6];
+	/**
+	 * the samples, packed like {@link bitinfo.signal}, (freq + 7) / 8
+	 * bytes
+	 */
+	unsigned char data[];
+};
+
+/**
+ * A memory-mapped raw capture file. The fields should be considered private
+ * to rawcap.c
+ */
+struct rawcap {
+	/** the mapped file, NULL if not opened */
+	struct rawcap_file *file;
+	/** size of the mapping in bytes */
+	size_t size;
+	/** the file is opened for writing */
+	bool writable;
+	/** copy of the block being read, {@link rawcap.buf} or NULL */
+	const struct rawcap_block *blk;
+	/** room for one block when opened for reading, NULL otherwise */
+	struct rawcap_block *buf;
+	/** sequence number of the next block to read */
+	uint64_t seq;
+	/** next sample to read from {@link rawcap.blk} */
+	unsigned pos;
+};
+
+/**
+ * Open a raw capture file for writing, creating it if needed. An existing
+ * file is reused if its sample frequency and number of blocks match, so that
+ * the capture continues where it stopped. Otherwise it is started anew.
+ *
+ * @param rc The raw capture to initialize.
+ * @param path The name of the file.
+ * @param nblocks The number of blocks, about the number of seconds to keep.
+ * @param freq The sample frequency in Hz.
+ * @return The file was opened succesfully (0), or errno on error.
+ */
+int rawcap_open(struct rawcap * const rc, const char * const path,
+    uint64_t nblocks, unsigned freq);
+
+/**
+ * Open a raw capture file for reading, starting at the oldest block which is
+ * still present.
+ *
+ * @param rc The raw capture to initialize.
+ * @param path The name of the file.
+ * @return The file was opened succesfully (0), EINVAL if it is not a raw
+ * capture file, or errno on error.
+ */
+int rawcap_open_read(struct rawcap * const rc, const char * const path);
+
+/**
+ * Append the samples of one bit, which are copied from the packed signal
+ * into one or more blocks. This does not make any system calls.
+ *
+ * @param rc The raw capture, opened for writing.
+ * @param t The monotonic time of the first sample in nanoseconds.
+ * @param active_high The pin value is high for active signal.
+ * @param signal The samples, packed like {@link bitinfo.signal}.
+ * @param nsamples The number of samples.
+ */
+void rawcap_write(struct rawcap * const rc, long long t, bool active_high,
+    const unsigned char * const signal, unsigned nsamples);
+
+/**
+ * Retrieve the number of blocks written so far, the sequence number of the
+ * next block.
+ *
+ * @param rc The raw capture.
+ * @return The number of blocks written.
+ */
+uint64_t rawcap_head(const struct rawcap * const rc);
+
+/**
+ * Copy a block by its sequence number. The block is checked to still have the
+ * same sequence number after copying it, so that the copy is never torn even
+ * if a writer rewrites the block at the same time.
+ *
+ * @param rc The raw capture.
+ * @param seq The sequence number of the block.
+ * @param dst The copy of the block, {@link rawcap_file.blocksize} bytes.
+ * @return Success (0), or -1 if the block was not written yet or is (being)
+ * overwritten.
+ */
+int rawcap_block(const struct rawcap * const rc, uint64_t seq,
+    struct rawcap_block * const dst);
+
+/**
+ * Read the next sample, continuing with the next block present at the end of
+ * a block. Blocks which are overwritten before being read are skipped.
+ *
+ * @param rc The raw capture, opened for reading.
+ * @param t If not NULL, receives the time at which the sample was taken.
+ * @return The sample (0 or 1), or -1 if all blocks written so far are read.
+ */
+int rawcap_read(struct rawcap * const rc, long long *t);
+
+/**
+ * Close the raw capture file, writing back any changes.
+ *
+ * @param rc The raw capture.
+ */
+void rawcap_close(struct rawcap * const rc);
+
+#endif
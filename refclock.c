@@ -0,0 +1,196 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "refclock.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <unistd.h>
+
+volatile struct shm_time *
+refclock_shm_attach(int unit, bool create)
+{
+	void *p;
+	int id;
+
+	/* units 0 and 1 are reserved for root, like ntpd does */
+	id = shmget(REFCLOCK_SHM_KEY + unit, sizeof(struct shm_time),
+	    create ? IPC_CREAT | (unit <= 1 ? 0600 : 0666) : 0);
+	if (id == -1) {
+		return NULL;
+	}
+	p = shmat(id, NULL, 0);
+	return p == (void *)-1 ? NULL : p;
+}
+
+int
+refclock_open(struct refclock * const rc, int unit,
+    const char * const sockpath)
+{
+	memset(rc, 0, sizeof(*rc));
+	rc->sock = -1;
+	if (unit >= 0) {
+		rc->shm = refclock_shm_attach(unit, true);
+		if (rc->shm == NULL) {
+			return -1;
+		}
+	}
+	if (sockpath != NULL) {
+		if (strlen(sockpath) >= sizeof(rc->addr.sun_path)) {
+			refclock_close(rc);
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		rc->addr.sun_family = AF_UNIX;
+		strcpy(rc->addr.sun_path, sockpath);
+		rc->sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+		if (rc->sock == -1) {
+			refclock_close(rc);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void
+write_shm(volatile struct shm_time * const shm,
+    const struct refclock_sample * const sample)
+{
+	/* the reader discards the sample if count changes while reading */
+	shm->mode = 1;
+	shm->valid = 0;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	shm->count++;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	shm->clock_sec = sample->clock.tv_sec;
+	shm->clock_usec = (int)(sample->clock.tv_nsec / 1000);
+	shm->clock_nsec = (unsigned)sample->clock.tv_nsec;
+	shm->receive_sec = sample->receive.tv_sec;
+	shm->receive_usec = (int)(sample->receive.tv_nsec / 1000);
+	shm->receive_nsec = (unsigned)sample->receive.tv_nsec;
+	shm->leap = sample->leap;
+	shm->precision = sample->precision;
+	shm->nsamples = 0;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	shm->count++;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	shm->valid = 1;
+}
+
+static int
+send_sock(struct refclock * const rc,
+    const struct refclock_sample * const sample)
+{
+	struct sock_sample ss;
+
+	memset(&ss, 0, sizeof(ss));
+	ss.tv.tv_sec = sample->receive.tv_sec;
+	ss.tv.tv_usec = sample->receive.tv_nsec / 1000;
+	/* relative to the truncated receive time */
+	ss.offset = (double)(sample->clock.tv_sec - sample->receive.tv_sec) +
+	    (sample->clock.tv_nsec - ss.tv.tv_usec * 1000) / 1e9;
+	ss.leap = sample->leap;
+	ss.magic = REFCLOCK_SOCK_MAGIC;
+	if (sendto(rc->sock, &ss, sizeof(ss), 0,
+	    (const struct sockaddr *)&rc->addr, sizeof(rc->addr)) == -1) {
+		/* chronyd is not running (yet) */
+		return errno == ENOENT || errno == ECONNREFUSED ? 0 : -1;
+	}
+	return 0;
+}
+
+int
+refclock_publish(struct refclock * const rc,
+    const struct refclock_sample * const sample)
+{
+	int res = 0;
+
+	if (rc->shm != NULL) {
+		write_shm(rc->shm, sample);
+	}
+	if (rc->sock != -1) {
+		res = send_sock(rc, sample);
+	}
+	rc->nsamples++;
+	return res;
+}
+
+void
+refclock_close(struct refclock * const rc)
+{
+	if (rc->shm != NULL) {
+		(void)shmdt((const void *)rc->shm);
+		rc->shm = NULL;
+	}
+	if (rc->sock != -1) {
+		(void)close(rc->sock);
+		rc->sock = -1;
+	}
+}
+
+int
+refclock_shm_read(volatile struct shm_time * const shm,
+    struct refclock_sample * const sample)
+{
+	int count, mode;
+
+	if (shm->valid == 0) {
+		return 0;
+	}
+	mode = shm->mode;
+	if (mode != 0 && mode != 1) {
+		return -1;
+	}
+	count = shm->count;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	sample->clock.tv_sec = shm->clock_sec;
+	sample->clock.tv_nsec = shm->clock_nsec;
+	sample->receive.tv_sec = shm->receive_sec;
+	sample->receive.tv_nsec = shm->receive_nsec;
+	/* an old writer which only fills in the microseconds */
+	if (sample->clock.tv_nsec / 1000 != shm->clock_usec ||
+	    sample->receive.tv_nsec / 1000 != shm->receive_usec) {
+		sample->clock.tv_nsec = shm->clock_usec * 1000L;
+		sample->receive.tv_nsec = shm->receive_usec * 1000L;
+	}
+	sample->leap = shm->leap;
+	sample->precision = shm->precision;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (mode == 1 && count != shm->count) {
+		shm->valid = 0;
+		return -1;
+	}
+	shm->valid = 0;
+	return 1;
+}
+
+int
+refclock_sock_decode(const void * const buf, size_t len,
+    struct refclock_sample * const sample)
+{
+	struct sock_sample ss;
+	long long ns;
+
+	if (len != sizeof(ss)) {
+		return -1;
+	}
+	memcpy(&ss, buf, sizeof(ss));
+	if (ss.magic != REFCLOCK_SOCK_MAGIC) {
+		return -1;
+	}
+	sample->receive.tv_sec = ss.tv.tv_sec;
+	sample->receive.tv_nsec = ss.tv.tv_usec * 1000L;
+	ns = ss.tv.tv_usec * 1000LL + (long long)(ss.offset * 1e9 +
+	    (ss.offset < 0 ? -0.5 : 0.5));
+	sample->clock.tv_sec = ss.tv.tv_sec + ns / 1000000000;
+	sample->clock.tv_nsec = ns % 1000000000;
+	if (sample->clock.tv_nsec < 0) {
+		sample->clock.tv_sec--;
+		sample->clock.tv_nsec += 1000000000;
+	}
+	sample->leap = ss.leap;
+	sample->precision = 0;
+	return 0;
+}
@@ -0,0 +1,173 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_REFCLOCK_H
+#define DCF77PI_REFCLOCK_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
+
+/** Base key of the shared memory segments, plus the unit number */
+#define REFCLOCK_SHM_KEY 0x4e545030
+
+/** Magic number of a chrony SOCK sample, "SOCK" */
+#define REFCLOCK_SOCK_MAGIC 0x534f434b
+
+/**
+ * Shared memory segment of the ntpd and chrony SHM reference clock driver,
+ * laid out exactly like struct shmTime of ntpd.
+ */
+struct shm_time {
+	/**
+	 * 0: the reader uses the sample if valid is set, 1: it also checks
+	 * that count did not change while reading it
+	 */
+	int mode;
+	/** incremented before and after writing a sample */
+	volatile int count;
+	/** time of the reference clock, seconds */
+	time_t clock_sec;
+	/** time of the reference clock, microseconds */
+	int clock_usec;
+	/** time of the system clock at clock_sec, seconds */
+	time_t receive_sec;
+	/** time of the system clock at clock_sec, microseconds */
+	int receive_usec;
+	/** leap second indicator, 0 none, 1 insert, 2 delete, 3 alarm */
+	int leap;
+	/** precision of the clock as a power of 2 in seconds */
+	int precision;
+	/** unused */
+	int nsamples;
+	/** set by the writer and cleared by the reader */
+	volatile int valid;
+	/** time of the reference clock, nanoseconds */
+	unsigned clock_nsec;
+	/** time of the system clock at clock_sec, nanoseconds */
+	unsigned receive_nsec;
+	/** reserved */
+	int dummy[8];
+};
+
+/**
+ * Sample of the chrony SOCK reference clock driver, laid out exactly like
+ * struct sock_sample of chrony.
+ */
+struct sock_sample {
+	/** time of the system clock at the measurement */
+	struct timeval tv;
+	/** time of the reference clock minus tv, in seconds */
+	double offset;
+	/** non-zero for a PPS sample, which only has the fraction of offset */
+	int pulse;
+	/** leap second indicator, 0 none, 1 insert, 2 delete */
+	int leap;
+	/** padding */
+	int pad;
+	/** {@link REFCLOCK_SOCK_MAGIC} */
+	int magic;
+};
+
+/**
+ * A time sample passed to an NTP daemon: the reference time, and the time
+ * of the system clock when the reference clock had that time.
+ */
+struct refclock_sample {
+	/** time of the reference clock */
+	struct timespec clock;
+	/** time of the system clock at the same moment */
+	struct timespec receive;
+	/** leap second indicator, 0 none, 1 insert, 2 delete */
+	int leap;
+	/** precision of the clock as a power of 2 in seconds */
+	int precision;
+};
+
+/**
+ * Publisher of time samples to ntpd or chrony, through a shared memory
+ * segment and/or a Unix datagram socket. The fields should be considered
+ * private to refclock.c .
+ */
+struct refclock {
+	/** the attached shared memory segment, NULL if none */
+	volatile struct shm_time *shm;
+	/** the datagram socket, -1 if none */
+	int sock;
+	/** address of the socket of the NTP daemon */
+	struct sockaddr_un addr;
+	/** number of samples published */
+	unsigned long nsamples;
+};
+
+/**
+ * Set up the publisher, without publishing anything yet.
+ *
+ * @param rc The publisher to initialize.
+ * @param unit The unit number of the SHM segment, or -1 to not use it. Units
+ * 0 and 1 are only accessible to root, like with ntpd. The segment is
+ * created if the NTP daemon did not do so yet.
+ * @param sockpath The socket of a chrony SOCK reference clock, or NULL to not
+ * use it. Chrony creates the socket.
+ * @return Success (0), or -1 with errno set.
+ */
+int refclock_open(struct refclock * const rc, int unit,
+    const char * const sockpath);
+
+/**
+ * Publish a sample through the SHM segment (using the mode 1 count/valid
+ * protocol) and the socket. Sending to the socket fails while chrony is not
+ * running, this is ignored.
+ *
+ * @param rc The publisher.
+ * @param sample The sample.
+ * @return Success (0), or -1 with errno set if a socket error other than a
+ * missing reader occurred.
+ */
+int refclock_publish(struct refclock * const rc,
+    const struct refclock_sample * const sample);
+
+/**
+ * Detach the SHM segment and close the socket. The segment itself is kept
+ * for the NTP daemon.
+ *
+ * @param rc The publisher.
+ */
+void refclock_close(struct refclock * const rc);
+
+/**
+ * Attach to a SHM segment, as the writer or as a reader.
+ *
+ * @param unit The unit number of the segment.
+ * @param create Create the segment if it does not exist yet.
+ * @return The segment, or NULL with errno set.
+ */
+volatile struct shm_time *refclock_shm_attach(int unit, bool create);
+
+/**
+ * Read a sample from a SHM segment like the NTP daemon does, and clear its
+ * valid flag.
+ *
+ * @param shm The segment.
+ * @param sample The sample read.
+ * @return 1 if a sample was read, 0 if there is none, or -1 if the writer
+ * changed it while reading or the mode is unknown.
+ */
+int refclock_shm_read(volatile struct shm_time * const shm,
+    struct refclock_sample * const sample);
+
+/**
+ * Decode a sample received on a SOCK socket like chrony does.
+ *
+ * @param buf The datagram.
+ * @param len The length of the datagram.
+ * @param sample The sample decoded.
+ * @return Success (0), or -1 if the size or the magic number is wrong.
+ */
+int refclock_sock_decode(const void * const buf, size_t len,
+    struct refclock_sample * const sample);
+
+#endif
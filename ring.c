@@ -0,0 +1,100 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "ring.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+/*
+ * head and tail only ever increase, so head - tail is the number of committed
+ * slots. Each of them is written by one thread only, the other thread reads
+ * it with acquire semantics to see the contents of the slots. The semaphore
+ * only serves to let the consumer sleep, the producer never waits.
+ */
+
+int
+ring_init(struct ring * const r, unsigned nslots, size_t slotsize)
+{
+	if (nslots == 0 || (nslots & (nslots - 1)) != 0 || slotsize == 0) {
+		return EINVAL;
+	}
+	r->data = calloc(nslots, slotsize);
+	if (r->data == NULL) {
+		return ENOMEM;
+	}
+	if (sem_init(&r->avail, 0, 0) == -1) {
+		free(r->data);
+		r->data = NULL;
+		return errno;
+	}
+	r->slotsize = slotsize;
+	r->nslots = nslots;
+	r->head = 0;
+	r->tail = 0;
+	r->overruns = 0;
+	return 0;
+}
+
+void
+ring_free(struct ring * const r)
+{
+	if (r->data != NULL) {
+		(void)sem_destroy(&r->avail);
+		free(r->data);
+		r->data = NULL;
+	}
+}
+
+void *
+ring_write_slot(struct ring * const r)
+{
+	unsigned long tail;
+
+	tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	if (r->head - tail == r->nslots) {
+		(void)__atomic_add_fetch(&r->overruns, 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	return r->data + (r->head & (r->nslots - 1)) * r->slotsize;
+}
+
+void
+ring_commit(struct ring * const r)
+{
+	__atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+	(void)sem_post(&r->avail);
+}
+
+unsigned
+ring_space(const struct ring * const r)
+{
+	return r->nslots - (unsigned)(r->head -
+	    __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE));
+}
+
+void *
+ring_read_slot(struct ring * const r, bool wait)
+{
+	if (wait) {
+		while (sem_wait(&r->avail) == -1 && errno == EINTR)
+			; /* empty loop */
+	} else if (sem_trywait(&r->avail) == -1) {
+		return NULL;
+	}
+	/* the semaphore never exceeds head - tail, this is just a fence */
+	(void)__atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	return r->data + (r->tail & (r->nslots - 1)) * r->slotsize;
+}
+
+void
+ring_release(struct ring * const r)
+{
+	__atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+unsigned long long
+ring_overruns(const struct ring * const r)
+{
+	return __atomic_load_n(&r->overruns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,100 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_RING_H
+#define DCF77PI_RING_H
+
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Lock-free ring buffer of fixed-size slots for exactly one producer thread
+ * and one consumer thread. The fields should be considered private to
+ * ring.c
+ */
+struct ring {
+	/** storage for the slots */
+	unsigned char *data;
+	/** size of one slot in bytes */
+	size_t slotsize;
+	/** number of slots, a power of two */
+	unsigned nslots;
+	/** number of slots committed, only written by the producer */
+	unsigned long head;
+	/** number of slots released, only written by the consumer */
+	unsigned long tail;
+	/** number of slots which could not be written, the ring being full */
+	unsigned long long overruns;
+	/** number of committed slots, for the consumer to wait on */
+	sem_t avail;
+};
+
+/**
+ * Initialize the ring buffer.
+ *
+ * @param r The ring buffer to initialize.
+ * @param nslots The number of slots, which must be a power of two.
+ * @param slotsize The size of one slot in bytes.
+ * @return The ring buffer was initialized succesfully (0), or errno on error.
+ */
+int ring_init(struct ring * const r, unsigned nslots, size_t slotsize);
+
+/**
+ * Free the storage of the ring buffer.
+ *
+ * @param r The ring buffer.
+ */
+void ring_free(struct ring * const r);
+
+/**
+ * Obtain the next slot to write to, for the producer.
+ *
+ * @param r The ring buffer.
+ * @return The slot, or NULL if the ring buffer is full. In that case the
+ * overrun counter is increased.
+ */
+void *ring_write_slot(struct ring * const r);
+
+/**
+ * Hand the slot obtained from {@link ring_write_slot} to the consumer.
+ *
+ * @param r The ring buffer.
+ */
+void ring_commit(struct ring * const r);
+
+/**
+ * Retrieve the number of free slots, for the producer.
+ *
+ * @param r The ring buffer.
+ * @return The number of slots which can be written before the ring buffer is
+ * full.
+ */
+unsigned ring_space(const struct ring * const r);
+
+/**
+ * Obtain the oldest committed slot, for the consumer.
+ *
+ * @param r The ring buffer.
+ * @param wait Wait until a slot is committed if the ring buffer is empty.
+ * @return The slot, or NULL if the ring buffer is empty and wait is false.
+ */
+void *ring_read_slot(struct ring * const r, bool wait);
+
+/**
+ * Hand the slot obtained from {@link ring_read_slot} back to the producer.
+ *
+ * @param r The ring buffer.
+ */
+void ring_release(struct ring * const r);
+
+/**
+ * Retrieve the number of overruns, which is safe from either thread.
+ *
+ * @param r The ring buffer.
+ * @return The number of slots which could not be written because the ring
+ * buffer was full.
+ */
+unsigned long long ring_overruns(const struct ring * const r);
+
+#endif
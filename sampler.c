@@ -0,0 +1,228 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#if defined(__linux__)
+/* CPU_SET() and pthread_setaffinity_np() */
+#  define _GNU_SOURCE 1
+#endif
+
+#include "sampler.h"
+
+#include "json_object.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#if defined(__FreeBSD__)
+#  include <sys/param.h>
+#  include <sys/cpuset.h>
+#  include <pthread_np.h>
+#endif
+
+/* keep the snapshots aligned in the slots */
+#define ALIGN16(n) (((n) + 15) & ~(size_t)15)
+/* the signal follows the snapshot */
+#define SNAPSIZE ALIGN16(sizeof(struct GB_snapshot))
+
+static struct GB_state gbs_sampler;
+static struct sampler smp_global;
+
+static void
+set_realtime(struct sampler * const smp)
+{
+	int res;
+
+	if (smp->rtpriority > 0) {
+		struct sched_param sp;
+
+		memset(&sp, 0, sizeof(sp));
+		sp.sched_priority = smp->rtpriority;
+		res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+		if (res != 0) {
+			fprintf(stderr,
+			    "pthread_setschedparam(SCHED_FIFO): %s\n",
+			    strerror(res));
+		}
+	}
+	if (smp->cpu >= 0) {
+#if defined(__linux__) || defined(__FreeBSD__)
+#if defined(__linux__)
+		cpu_set_t set;
+#else
+		cpuset_t set;
+#endif
+
+		CPU_ZERO(&set);
+		CPU_SET(smp->cpu, &set);
+		res = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (res != 0) {
+			fprintf(stderr, "pthread_setaffinity_np(%i): %s\n",
+			    smp->cpu, strerror(res));
+		}
+#else
+		fprintf(stderr, "Pinning to a CPU is not supported\n");
+#endif
+	}
+}
+
+static void *
+sample_loop(void *arg)
+{
+	struct sampler *smp = arg;
+
+	set_realtime(smp);
+	while (!__atomic_load_n(&smp->stop, __ATOMIC_ACQUIRE)) {
+		struct GB_snapshot *snap;
+		struct GB_result bit;
+
+		(void)get_bit_live_r(smp->gbs);
+		snap = ring_write_slot(&smp->ring);
+		if (snap != NULL) {
+			snap->bit.signal = (unsigned char *)snap + SNAPSIZE;
+			get_snapshot_r(smp->gbs, snap);
+			snap->dropped = smp->dropped;
+			smp->dropped = 0;
+			ring_commit(&smp->ring);
+		} else {
+			smp->dropped++;
+		}
+		bit = next_bit_r(smp->gbs);
+		/*
+		 * mainloop() resets acc_minlen of its copy after each minute
+		 * marker, do the same here.
+		 */
+		if (bit.marker == emark_minute || bit.marker == emark_late) {
+			reset_acc_minlen_r(smp->gbs);
+		}
+	}
+	return NULL;
+}
+
+int
+start_sampler_r(struct sampler * const smp, struct GB_state * const gbs,
+    struct json_object *config)
+{
+	struct json_object *value;
+	int res;
+
+	smp->gbs = gbs;
+	smp->stop = false;
+	smp->running = false;
+	smp->dropped = 0;
+	smp->rtpriority = 0;
+	smp->cpu = -1;
+	if (config != NULL) {
+		if (json_object_object_get_ex(config, "rtpriority", &value)) {
+			smp->rtpriority = json_object_get_int(value);
+		}
+		if (json_object_object_get_ex(config, "cpu", &value)) {
+			smp->cpu = json_object_get_int(value);
+		}
+		if (json_object_object_get_ex(config, "memlock", &value) &&
+		    json_object_get_boolean(value) &&
+		    mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+			perror("mlockall");
+		}
+	}
+	if (smp->rtpriority < 0 ||
+	    smp->rtpriority > sched_get_priority_max(SCHED_FIFO)) {
+		fprintf(stderr, "rtpriority must be between 0 and %i\n",
+		    sched_get_priority_max(SCHED_FIFO));
+		return -1;
+	}
+
+	res = ring_init(&smp->ring, SAMPLER_SLOTS,
+	    ALIGN16(SNAPSIZE + get_hardware_parameters_r(gbs).freq / 2));
+	if (res != 0) {
+		return res;
+	}
+	res = pthread_create(&smp->thread, NULL, sample_loop, smp);
+	if (res != 0) {
+		ring_free(&smp->ring);
+		return res;
+	}
+	smp->running = true;
+	return 0;
+}
+
+struct GB_result
+get_bit_sampler_r(struct sampler * const smp, struct GB_state * const gbs)
+{
+	struct GB_snapshot *snap;
+	struct GB_result res;
+
+	snap = ring_read_slot(&smp->ring, true);
+	set_snapshot_r(gbs, snap);
+	res = snap->gb_res;
+	ring_release(&smp->ring);
+	return res;
+}
+
+void
+stop_sampler_r(struct sampler * const smp)
+{
+	if (!smp->running) {
+		return;
+	}
+	__atomic_store_n(&smp->stop, true, __ATOMIC_RELEASE);
+	(void)pthread_join(smp->thread, NULL);
+	ring_free(&smp->ring);
+	smp->running = false;
+}
+
+unsigned long long
+get_sampler_overruns_r(const struct sampler * const smp)
+{
+	return ring_overruns(&smp->ring);
+}
+
+int
+start_sampler(struct json_object *config)
+{
+	int res;
+
+	init_input_state(&gbs_sampler);
+	res = set_mode_live_r(&gbs_sampler, config);
+	if (res != 0) {
+		return res;
+	}
+	res = set_mode_snapshot(get_hardware_parameters_r(&gbs_sampler));
+	if (res == 0) {
+		res = start_sampler_r(&smp_global, &gbs_sampler, config);
+	}
+	if (res != 0) {
+		cleanup_r(&gbs_sampler);
+	}
+	return res;
+}
+
+struct GB_result
+get_bit_sampler(void)
+{
+	struct GB_result res;
+	struct GB_snapshot *snap;
+
+	snap = ring_read_slot(&smp_global.ring, true);
+	set_snapshot(snap);
+	res = snap->gb_res;
+	ring_release(&smp_global.ring);
+	return res;
+}
+
+void
+stop_sampler(void)
+{
+	if (smp_global.running) {
+		stop_sampler_r(&smp_global);
+		cleanup_r(&gbs_sampler);
+	}
+}
+
+unsigned long long
+get_sampler_overruns(void)
+{
+	return smp_global.running ? get_sampler_overruns_r(&smp_global) : 0;
+}
@@ -0,0 +1,117 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_SAMPLER_H
+#define DCF77PI_SAMPLER_H
+
+#include "input.h"
+#include "ring.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+
+struct json_object;
+
+/** Number of bits the ring can hold, about one minute */
+#define SAMPLER_SLOTS 64
+
+/**
+ * State of a sampling thread, which reads the live bits on its own and passes
+ * a snapshot of each bit to the decoding thread. The fields should be
+ * considered private to sampler.c
+ */
+struct sampler {
+	/** state of the bit reader, only used by the sampling thread */
+	struct GB_state *gbs;
+	/** snapshots of the bits, each followed by its signal */
+	struct ring ring;
+	/** the sampling thread */
+	pthread_t thread;
+	/** request for the sampling thread to stop */
+	bool stop;
+	/** the sampling thread is running */
+	bool running;
+	/** bits dropped since the last snapshot, used by the sampling thread */
+	unsigned dropped;
+	/** SCHED_FIFO priority of the sampling thread, 0 to disable */
+	int rtpriority;
+	/** CPU to pin the sampling thread to, -1 to disable */
+	int cpu;
+};
+
+/**
+ * Start sampling live bits in a separate thread, using the configuration of
+ * {@link set_mode_live}. The bits are retrieved using
+ * {@link get_bit_sampler}, after which the usual functions like
+ * {@link get_bitinfo} and {@link next_bit} work as if {@link get_bit_live}
+ * was called.
+ *
+ * The optional configuration keys are "rtpriority" for the SCHED_FIFO priority
+ * of the thread (0 for normal scheduling), "cpu" for the CPU to pin the thread
+ * to (-1 for any CPU) and "memlock" to lock the memory of the process.
+ *
+ * @param config The JSON object containing the parsed configuration from
+ * config.json
+ * @return Preparation was succesful (0), -1 or errno otherwise.
+ */
+int start_sampler(struct json_object *config);
+
+/**
+ * Start a sampling thread for a bit reader which is already prepared.
+ *
+ * @param smp The sampler state to initialize.
+ * @param gbs The bit reader, which should not be used by the calling thread
+ * until {@link stop_sampler_r} is called.
+ * @param config The JSON object containing the optional keys described for
+ * {@link start_sampler}, or NULL.
+ * @return Preparation was succesful (0), -1 or errno otherwise.
+ */
+int start_sampler_r(struct sampler * const smp, struct GB_state * const gbs,
+    struct json_object *config);
+
+/**
+ * Retrieve the next bit from the sampling thread, waiting for it if needed.
+ *
+ * @return The bit, as {@link get_bit_live} would have returned it.
+ */
+struct GB_result get_bit_sampler(void);
+
+/**
+ * Reentrant version of {@link get_bit_sampler}.
+ *
+ * @param smp The sampler state.
+ * @param gbs The bit reader to load the bit into, prepared with
+ * {@link set_mode_snapshot_r}.
+ */
+struct GB_result get_bit_sampler_r(struct sampler * const smp,
+    struct GB_state * const gbs);
+
+/**
+ * Stop the sampling thread started by {@link start_sampler}, if any, and
+ * clean up its bit reader.
+ */
+void stop_sampler(void);
+
+/**
+ * Stop the sampling thread.
+ *
+ * @param smp The sampler state.
+ */
+void stop_sampler_r(struct sampler * const smp);
+
+/**
+ * Retrieve the number of bits which were dropped because the decoding thread
+ * did not keep up with the sampling thread.
+ *
+ * @return The number of ring overruns.
+ */
+unsigned long long get_sampler_overruns(void);
+
+/**
+ * Reentrant version of {@link get_sampler_overruns}.
+ *
+ * @param smp The sampler state.
+ */
+unsigned long long get_sampler_overruns_r(const struct sampler * const smp);
+
+#endif
@@ -1,16 +1,36 @@
-// Copyright 2013-2019 René Ladan
+// Copyright 2013-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "setclock.h"
 
 #include "calendar.h"
 #include "decode_time.h"
+#include "discipline.h"
+#include "holdover.h"
 #include "input.h"
+#include "json_object.h"
+#include "refclock.h"
 
 #include <locale.h>
+#include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include <time.h>
 
+/* publish a holdover sample once the last sample is this old, in ns */
+#define HOLDOVER_INTERVAL (61 * 1000000000LL)
+/* largest error bound of a holdover sample unless configured, in ns */
+#define DEFAULT_HOLDOVER_MAXERR (100 * 1000000LL)
+
+static struct discipline disc;
+static bool disc_active;
+static struct refclock refclock;
+static bool refclock_active;
+static struct holdover holdover;
+static bool holdover_ready;
+static long long holdover_maxerr = DEFAULT_HOLDOVER_MAXERR;
+static long long last_publish;
+
 bool
 setclock_ok(unsigned init_min, struct DT_result dt, struct GB_result bit)
 {
@@ -26,10 +46,16 @@ setclock_ok(unsigned init_min, struct DT_result dt, struct GB_result bit)
 
 enum eSC_status
 setclock(struct tm settime)
+{
+	return setclock_at(settime, -1, 0);
+}
+
+/* The time of the system clock at the start of the given minute */
+static enum eSC_status
+get_epoch(struct tm settime, time_t * const sec)
 {
 	time_t epochtime, t1, t2;
 	struct tm it;
-	struct timespec ts;
 
 	/* determine time difference of host to UTC (t1 - t2) */
 	(void)time(&t1);
@@ -52,11 +78,261 @@ setclock(struct tm settime)
 	if (epochtime == -1) {
 		return esc_invalid;
 	}
-	ts.tv_sec = epochtime;
+	*sec = epochtime;
 	/* UTC if t1 == t2, so adjust from local time in that case */
 	if (t1 == t2) {
-		ts.tv_sec -= 3600 * (1 + settime.tm_isdst);
+		*sec -= 3600 * (1 + settime.tm_isdst);
+	}
+	return esc_ok;
+}
+
+/*
+ * The time to set the clock to at monotonic time *mono, which is the time the
+ * function returns if there is no edge.
+ */
+static enum eSC_status
+get_target(struct tm settime, long long edge, long long group_delay,
+    struct timespec * const ts, long long * const mono)
+{
+	struct timespec now;
+
+	if (get_epoch(settime, &ts->tv_sec) != esc_ok) {
+		return esc_invalid;
+	}
+	/* as late as possible, right before setting the clock */
+	(void)clock_gettime(CLOCK_MONOTONIC, &now);
+	*mono = now.tv_sec * 1000000000LL + now.tv_nsec;
+	if (edge == -1) {
+		ts->tv_nsec = 50000000; /* adjust for bit reception algorithm */
+	} else {
+		long long ns;
+
+		ns = *mono - edge + group_delay;
+		ts->tv_sec += ns / 1000000000;
+		ts->tv_nsec = ns % 1000000000;
+		if (ts->tv_nsec < 0) {
+			ts->tv_sec--;
+			ts->tv_nsec += 1000000000;
+		}
+	}
+	return esc_ok;
+}
+
+enum eSC_status
+setclock_at(struct tm settime, long long edge, long long group_delay)
+{
+	struct timespec ts;
+	long long mono;
+	enum eSC_status res;
+
+	res = get_target(settime, edge, group_delay, &ts, &mono);
+	if (res != esc_ok) {
+		return res;
 	}
-	ts.tv_nsec = 50000000; /* adjust for bit reception algorithm */
 	return (clock_settime(CLOCK_REALTIME, &ts) == -1) ? esc_fail : esc_ok;
 }
+
+int
+set_clock_policy(struct json_object *config)
+{
+	struct discipline_policy policy;
+
+	close_clock_policy();
+	if (discipline_policy(&policy, config) != 0) {
+		return -1;
+	}
+	if (policy.mode == edc_step) {
+		discipline_free_policy(&policy);
+		return 0;
+	}
+	if (discipline_init(&disc, &policy, NULL) != 0) {
+		return -1;
+	}
+	disc_active = true;
+	return 0;
+}
+
+void
+close_clock_policy(void)
+{
+	if (disc_active) {
+		discipline_close(&disc);
+		disc_active = false;
+	}
+}
+
+enum eSC_status
+adjust_clock(struct tm settime, long long edge, long long group_delay)
+{
+	struct timespec ts, now;
+	long long mono, offset;
+	enum eSC_status res;
+
+	if (!disc_active) {
+		return setclock_at(settime, edge, group_delay);
+	}
+	res = get_target(settime, edge, group_delay, &ts, &mono);
+	if (res != esc_ok) {
+		return res;
+	}
+	(void)clock_gettime(CLOCK_REALTIME, &now);
+	offset = (ts.tv_sec - now.tv_sec) * 1000000000LL + ts.tv_nsec -
+	    now.tv_nsec;
+	switch (discipline_update(&disc, offset, mono)) {
+	case 0:
+		return esc_slewed;
+	case 1:
+		return esc_ok;
+	default:
+		return esc_fail;
+	}
+}
+
+int
+set_refclock_policy(struct json_object *config)
+{
+	struct json_object *value;
+	const char *sockpath = NULL;
+	int unit = -1;
+
+	close_refclock_policy();
+	holdover_maxerr = DEFAULT_HOLDOVER_MAXERR;
+	holdover_ready = false;
+	if (config == NULL) {
+		return 0;
+	}
+	if (json_object_object_get_ex(config, "refclockshm", &value)) {
+		unit = json_object_get_int(value);
+		if (unit < -1 || unit > 255) {
+			fprintf(stderr, "refclockshm must be between -1 and "
+			    "255\n");
+			return -1;
+		}
+	}
+	if (json_object_object_get_ex(config, "refclocksock", &value)) {
+		sockpath = json_object_get_string(value);
+		if (sockpath != NULL && *sockpath == '\0') {
+			sockpath = NULL;
+		}
+	}
+	if (json_object_object_get_ex(config, "holdovermaxerror", &value)) {
+		int ms = json_object_get_int(value);
+
+		if (ms < 0) {
+			fprintf(stderr,
+			    "holdovermaxerror must not be negative\n");
+			return -1;
+		}
+		holdover_maxerr = ms * 1000000LL;
+	}
+	if (unit == -1 && sockpath == NULL) {
+		return 0;
+	}
+	if (refclock_open(&refclock, unit, sockpath) != 0) {
+		return -1;
+	}
+	refclock_active = true;
+	return 0;
+}
+
+void
+close_refclock_policy(void)
+{
+	if (refclock_active) {
+		refclock_close(&refclock);
+		refclock_active = false;
+	}
+}
+
+/* The power of 2 in seconds which is at least the given time */
+static int
+get_precision(long long ns)
+{
+	return ns <= 0 ? -30 : (int)ceil(log2(ns / 1e9));
+}
+
+static long long
+now_ns(clockid_t clock_id)
+{
+	struct timespec now;
+
+	(void)clock_gettime(clock_id, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int
+publish_sample(long long time, long long real, long long err, bool leap)
+{
+	struct refclock_sample sample;
+
+	memset(&sample, 0, sizeof(sample));
+	sample.clock.tv_sec = time / 1000000000;
+	sample.clock.tv_nsec = time % 1000000000;
+	sample.receive.tv_sec = real / 1000000000;
+	sample.receive.tv_nsec = real % 1000000000;
+	sample.leap = leap ? 1 : 0;
+	sample.precision = get_precision(err);
+	return refclock_publish(&refclock, &sample);
+}
+
+int
+publish_time(struct tm settime, long long edge_mono, long long edge_real,
+    long long group_delay, bool leap)
+{
+	time_t sec;
+	long long time, mono, real, err;
+
+	if (!refclock_active) {
+		return 0;
+	}
+	if (get_epoch(settime, &sec) != esc_ok) {
+		return -1;
+	}
+	time = sec * 1000000000LL;
+	/* when the minute started according to the local clocks */
+	if (edge_mono == -1 || edge_real == -1) {
+		mono = now_ns(CLOCK_MONOTONIC) - 50000000;
+		real = now_ns(CLOCK_REALTIME) - 50000000;
+	} else {
+		mono = edge_mono - group_delay;
+		real = edge_real - group_delay;
+	}
+	/* the resolution of the sampling */
+	err = 1000000000 / get_hardware_parameters().freq;
+	if (holdover_maxerr > 0) {
+		if (!holdover_ready) {
+			holdover_init(&holdover, err);
+			holdover_ready = true;
+		}
+		if (edge_mono != -1) {
+			holdover_add_minute(&holdover, mono, time);
+		}
+		/* continue smoothly from a holdover */
+		(void)holdover_time(&holdover, mono, &time, &err);
+	}
+	last_publish = mono;
+	return publish_sample(time, real, err, leap);
+}
+
+int
+publish_holdover(struct GB_result bit)
+{
+	long long mono, time, err;
+
+	if (!refclock_active || holdover_maxerr == 0 || !holdover_ready) {
+		return 0;
+	}
+	/* the edges of seconds with a trusted bit length */
+	if (bit.hwstat == ehw_ok && bit.bitval != ebv_none &&
+	    !get_bitinfo().freq_reset && get_bitinfo().edge_mono != -1) {
+		holdover_add_edge(&holdover, get_bitinfo().edge_mono);
+	}
+	mono = now_ns(CLOCK_MONOTONIC);
+	if (mono - last_publish < HOLDOVER_INTERVAL ||
+	    holdover_time(&holdover, mono, &time, &err) != 0 ||
+	    err > holdover_maxerr) {
+		return 0;
+	}
+	last_publish = mono;
+	return publish_sample(time, now_ns(CLOCK_REALTIME), err, false);
+}
@@ -1,4 +1,4 @@
-// Copyright 2013-2018 René Ladan
+// Copyright 2013-2026 René Ladan
 // SPDX-License-Identifier: BSD-2-Clause
 
 #ifndef DCF77PI_SETCLOCK_H
@@ -7,6 +7,7 @@
 #include <stdbool.h>
 struct DT_result;
 struct GB_result;
+struct json_object;
 struct tm;
 
 /** State for setting the clock */
@@ -18,7 +19,9 @@ enum eSC_status {
 	/** Settting the clock failed */
 	esc_fail,
 	/** Too early or unsafe to set the time */
-	esc_unsafe
+	esc_unsafe,
+	/** Clock is being slewed towards the time */
+	esc_slewed
 };
 
 /**
@@ -32,11 +35,117 @@ enum eSC_status {
 bool setclock_ok(unsigned init_min, struct DT_result dt, struct GB_result bit);
 
 /**
- * Set the system clock according to the given time.
+ * Set the system clock according to the given time, assuming that the minute
+ * started 50 ms ago.
  *
  * @param settime The time to set the system clock to, in ISO or DCF77 format.
  * @return Whether the clock was set successfully.
  */
 enum eSC_status setclock(struct tm settime);
 
+/**
+ * Set the system clock according to the given time, which started at the
+ * given rising edge. The time elapsed since the edge is added, so the delay
+ * until this function is called does not matter.
+ *
+ * @param settime The time to set the system clock to, in ISO or DCF77 format.
+ * @param edge The CLOCK_MONOTONIC time of the rising edge in nanoseconds,
+ * see {@link bitinfo.edge_mono}, or -1 to behave like {@link setclock}.
+ * @param group_delay The delay of the edge after the start of the minute in
+ * nanoseconds, see {@link hardware.group_delay}.
+ * @return Whether the clock was set successfully.
+ */
+enum eSC_status setclock_at(struct tm settime, long long edge,
+    long long group_delay);
+
+/**
+ * Set how {@link adjust_clock} sets the system clock, see
+ * {@link discipline_policy} for the configuration keys. With "slew" or
+ * "dryrun", the drift file is read and applied immediately.
+ *
+ * @param config The JSON object containing the parsed configuration from
+ * config.json , or NULL to step the clock.
+ * @return Success (0), or -1 if a value is invalid or the clock cannot be
+ * adjusted.
+ */
+int set_clock_policy(struct json_object *config);
+
+/**
+ * Write the drift file and stop disciplining the clock, {@link adjust_clock}
+ * steps the clock again afterwards.
+ */
+void close_clock_policy(void);
+
+/**
+ * Step the system clock like {@link setclock_at}, or feed the offset of the
+ * system clock to the given time into the clock discipline loop, depending
+ * on the policy set by {@link set_clock_policy}.
+ *
+ * @param settime The time to set the system clock to, in ISO or DCF77 format.
+ * @param edge The CLOCK_MONOTONIC time of the rising edge in nanoseconds, or
+ * -1 if unknown.
+ * @param group_delay The delay of the edge after the start of the minute in
+ * nanoseconds.
+ * @return esc_ok if the clock was stepped, esc_slewed if it is being slewed,
+ * or the error.
+ */
+enum eSC_status adjust_clock(struct tm settime, long long edge,
+    long long group_delay);
+
+/**
+ * Set where {@link publish_time} publishes the decoded time for ntpd or
+ * chrony, using the optional keys "refclockshm" (unit number of the SHM
+ * reference clock, default -1 for none), "refclocksock" (socket of a
+ * chrony SOCK reference clock, default empty for none) and
+ * "holdovermaxerror" (largest error bound of the time published by
+ * {@link publish_holdover} in milliseconds, default 100, 0 to disable the
+ * holdover).
+ *
+ * @param config The JSON object containing the parsed configuration from
+ * config.json , or NULL to not publish.
+ * @return Success (0), or -1 if a value is invalid or the SHM segment or
+ * socket cannot be set up.
+ */
+int set_refclock_policy(struct json_object *config);
+
+/**
+ * Stop publishing the decoded time.
+ */
+void close_refclock_policy(void);
+
+/**
+ * Publish the start of a decoded minute as a reference clock sample, if
+ * enabled by {@link set_refclock_policy}. The sample pairs the decoded time
+ * with the time of the system clock at the rising edge which started the
+ * minute. The minute is also added to the holdover state, and if it comes
+ * after a holdover, the published time is slewed from the holdover time to
+ * the decoded time instead of jumping.
+ *
+ * @param settime The decoded time, in ISO or DCF77 format.
+ * @param edge_mono The CLOCK_MONOTONIC time of the rising edge in
+ * nanoseconds, see {@link bitinfo.edge_mono}, or -1 if unknown.
+ * @param edge_real The CLOCK_REALTIME time of the same edge, see
+ * {@link bitinfo.edge_real}, or -1 to assume that the minute started 50 ms
+ * ago.
+ * @param group_delay The delay of the edge after the start of the minute in
+ * nanoseconds.
+ * @param leap A leap second is announced for the end of this hour.
+ * @return Success (0), or -1 with errno set.
+ */
+int publish_time(struct tm settime, long long edge_mono, long long edge_real,
+    long long group_delay, bool leap);
+
+/**
+ * Keep publishing the time when no minute could be decoded for over a
+ * minute, using the local clock corrected for its estimated frequency error
+ * (see holdover.h). The precision of each sample reflects its growing error
+ * bound, and the samples stop once the bound exceeds "holdovermaxerror".
+ * Should be called after each bit, whose rising edge is also used to
+ * estimate the frequency error.
+ *
+ * @param bit The current bit.
+ * @return Success (0), or -1 with errno set.
+ */
+int publish_holdover(struct GB_result bit);
+
 #endif
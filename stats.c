@@ -0,0 +1,385 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char * const field_name[STATS_NFIELDS] = {
+	"minute", "hour", "mday", "wday", "month", "year"
+};
+
+int
+stats_init(struct stats * const st, const char * const bucket, FILE *out,
+    bool json)
+{
+	char *end;
+
+	memset(st, 0, sizeof(*st));
+	st->out = out;
+	st->json = json;
+	if (strcmp(bucket, "all") == 0) {
+		st->type = esb_all;
+	} else if (strcmp(bucket, "year") == 0) {
+		st->type = esb_year;
+	} else if (strcmp(bucket, "month") == 0) {
+		st->type = esb_month;
+	} else if (strcmp(bucket, "day") == 0) {
+		st->width = 1440;
+	} else if (strcmp(bucket, "hour") == 0) {
+		st->width = 60;
+	} else {
+		unsigned long width = strtoul(bucket, &end, 10);
+
+		if (*end != '\0' || width == 0 || 1440 % width != 0) {
+			return -1;
+		}
+		st->width = (unsigned)width;
+	}
+	return 0;
+}
+
+static void
+add_counters(struct stats_counters * const sum,
+    const struct stats_counters * const c)
+{
+	sum->minutes += c->minutes;
+	sum->valid += c->valid;
+	for (int i = 0; i < STATS_NFIELDS; i++) {
+		for (int j = 0; j < 3; j++) {
+			sum->field[i][j] += c->field[i][j];
+		}
+	}
+	for (int i = 0; i < 3; i++) {
+		sum->length[i] += c->length[i];
+		sum->leap[i] += c->leap[i];
+	}
+	for (int i = 0; i < 4; i++) {
+		sum->dst[i] += c->dst[i];
+		sum->hw[i] += c->hw[i];
+	}
+	sum->bit0 += c->bit0;
+	sum->bit20 += c->bit20;
+	sum->long_markers += c->long_markers;
+	sum->bits += c->bits;
+	sum->nobit += c->nobit;
+	sum->resets.freq += c->resets.freq;
+	sum->resets.bitlen += c->resets.bitlen;
+}
+
+/* The first minute of the bucket of the given time */
+static struct tm
+bucket_start(const struct stats * const st, struct tm time)
+{
+	struct tm start;
+	int mod;
+
+	memset(&start, 0, sizeof(start));
+	switch (st->type) {
+	case esb_all:
+		break;
+	case esb_year:
+		start.tm_year = time.tm_year;
+		break;
+	case esb_month:
+		start.tm_year = time.tm_year;
+		start.tm_mon = time.tm_mon;
+		break;
+	case esb_minutes:
+		start.tm_year = time.tm_year;
+		start.tm_mon = time.tm_mon;
+		start.tm_mday = time.tm_mday;
+		mod = time.tm_hour * 60 + time.tm_min;
+		mod -= mod % (int)st->width;
+		start.tm_hour = mod / 60;
+		start.tm_min = mod % 60;
+		break;
+	}
+	return start;
+}
+
+/* A number which sorts like the start of the bucket */
+static int64_t
+bucket_key(struct tm start)
+{
+	return (((start.tm_year * 100LL + start.tm_mon) * 100 +
+	    start.tm_mday) * 100 + start.tm_hour) * 100 + start.tm_min;
+}
+
+static void
+format_bucket(const struct stats * const st, char *buf, size_t len)
+{
+	const struct tm t = st->start;
+
+	if (st->type == esb_all) {
+		(void)snprintf(buf, len, "all");
+	} else if (!st->have_key) {
+		(void)snprintf(buf, len, "unknown");
+	} else if (st->type == esb_year) {
+		(void)snprintf(buf, len, "%04d", t.tm_year);
+	} else if (st->type == esb_month) {
+		(void)snprintf(buf, len, "%04d-%02d", t.tm_year, t.tm_mon);
+	} else if (st->width == 1440) {
+		(void)snprintf(buf, len, "%04d-%02d-%02d", t.tm_year, t.tm_mon,
+		    t.tm_mday);
+	} else {
+		(void)snprintf(buf, len, "%04d-%02d-%02d %02d:%02d", t.tm_year,
+		    t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min);
+	}
+}
+
+static double
+percentage(unsigned long part, unsigned long whole)
+{
+	return whole == 0 ? 0.0 : 100.0 * part / whole;
+}
+
+static void
+print_json(FILE *out, const char * const name,
+    const struct stats_counters * const c)
+{
+	fprintf(out, "{\"bucket\":\"%s\",\"minutes\":%lu,\"valid\":%lu,"
+	    "\"valid_pct\":%.2f", name, c->minutes, c->valid,
+	    percentage(c->valid, c->minutes));
+	for (int i = 0; i < STATS_NFIELDS; i++) {
+		fprintf(out, ",\"%s\":{\"bcd\":%lu,\"parity\":%lu,"
+		    "\"jump\":%lu}", field_name[i], c->field[i][0],
+		    c->field[i][1], c->field[i][2]);
+	}
+	fprintf(out, ",\"short\":%lu,\"long\":%lu,\"long_markers\":%lu,"
+	    "\"bit0\":%lu,\"bit20\":%lu,\"dst_error\":%lu,\"dst_jump\":%lu,"
+	    "\"dst_done\":%lu,\"leap_done\":%lu,\"leap_one\":%lu,"
+	    "\"bits\":%llu,\"receive\":%llu,\"transmit\":%llu,"
+	    "\"random\":%llu,\"nobit\":%llu,\"freq_resets\":%lu,"
+	    "\"bitlen_resets\":%lu",
+	    c->length[emin_short], c->length[emin_long], c->long_markers,
+	    c->bit0, c->bit20, c->dst[eDST_error], c->dst[eDST_jump],
+	    c->dst[eDST_done], c->leap[els_done], c->leap[els_one], c->bits,
+	    c->hw[ehw_receive], c->hw[ehw_transmit], c->hw[ehw_random],
+	    c->nobit, c->resets.freq, c->resets.bitlen);
+}
+
+static void
+print_header(FILE *out)
+{
+	fprintf(out, "%-16s %8s %7s %6s %6s %6s %6s %6s %8s %8s %8s %8s "
+	    "%6s %6s\n", "bucket", "minutes", "valid%", "bcd", "parity",
+	    "jump", "length", "marker", "r", "x", "#", "_", "freq", "bitlen");
+}
+
+/* One line of the table, the errors summed over the fields */
+static void
+print_row(FILE *out, const char * const name,
+    const struct stats_counters * const c)
+{
+	unsigned long err[3] = { 0, 0, 0 };
+
+	for (int i = 0; i < STATS_NFIELDS; i++) {
+		for (int j = 0; j < 3; j++) {
+			err[j] += c->field[i][j];
+		}
+	}
+	fprintf(out, "%-16s %8lu %7.2f %6lu %6lu %6lu %6lu %6lu %8llu %8llu "
+	    "%8llu %8llu %6lu %6lu\n", name, c->minutes,
+	    percentage(c->valid, c->minutes), err[0], err[1], err[2],
+	    c->length[emin_short] + c->length[emin_long],
+	    c->bit0 + c->bit20, c->hw[ehw_receive], c->hw[ehw_transmit],
+	    c->hw[ehw_random], c->nobit, c->resets.freq, c->resets.bitlen);
+}
+
+static void
+flush_bucket(struct stats * const st)
+{
+	char name[32];
+
+	if (!st->have_bucket) {
+		return;
+	}
+	if (st->type != esb_all) {
+		format_bucket(st, name, sizeof(name));
+		if (st->json) {
+			print_json(st->out, name, &st->bucket);
+			fprintf(st->out, "}\n");
+		} else {
+			if (st->nbuckets == 0) {
+				print_header(st->out);
+			}
+			print_row(st->out, name, &st->bucket);
+		}
+		st->nbuckets++;
+	}
+	add_counters(&st->total, &st->bucket);
+	memset(&st->bucket, 0, sizeof(st->bucket));
+	st->have_bucket = false;
+}
+
+void
+stats_add_bit(struct stats * const st, struct GB_result bit)
+{
+	st->minute.bits++;
+	st->minute.hw[bit.hwstat]++;
+	if (bit.hwstat == ehw_ok && bit.bitval == ebv_none) {
+		st->minute.nobit++;
+	}
+}
+
+void
+stats_add_long_minute(struct stats * const st)
+{
+	st->minute.long_markers++;
+}
+
+void
+stats_add_minute(struct stats * const st, struct DT_result dt,
+    struct tm time, struct reset_counts resets)
+{
+	const enum eDT_tval tval[STATS_NFIELDS] = {
+		dt.minute_status, dt.hour_status, dt.mday_status,
+		dt.wday_status, dt.month_status, dt.year_status
+	};
+	struct stats_counters * const c = &st->minute;
+	bool valid;
+
+	/* nothing is decoded before the first minute marker */
+	if (time.tm_year != 0) {
+		const struct tm start = bucket_start(st, time);
+		const int64_t key = bucket_key(start);
+
+		if (st->have_key && key != st->key) {
+			flush_bucket(st);
+		}
+		st->have_key = true;
+		st->key = key;
+		st->start = start;
+	}
+
+	valid = dt.minute_length == emin_ok && dt.bit0_ok && dt.bit20_ok &&
+	    (dt.dst_status == eDST_ok || dt.dst_status == eDST_done) &&
+	    dt.leapsecond_status != els_one;
+	for (int i = 0; i < STATS_NFIELDS; i++) {
+		if (tval[i] != eval_ok) {
+			c->field[i][tval[i] - 1]++;
+			valid = false;
+		}
+	}
+	c->length[dt.minute_length]++;
+	c->dst[dt.dst_status]++;
+	c->leap[dt.leapsecond_status]++;
+	c->bit0 += dt.bit0_ok ? 0 : 1;
+	c->bit20 += dt.bit20_ok ? 0 : 1;
+	c->resets = resets;
+	c->minutes++;
+	if (valid) {
+		if (st->total.valid + st->bucket.valid == 0) {
+			st->first = time;
+		}
+		st->last = time;
+		c->valid++;
+	}
+	if (time.tm_year != 0) {
+		st->hour_minutes[time.tm_hour]++;
+		st->hour_valid[time.tm_hour] += valid ? 1 : 0;
+	}
+
+	add_counters(&st->bucket, c);
+	memset(c, 0, sizeof(*c));
+	st->have_bucket = true;
+}
+
+static void
+print_json_time(FILE *out, const char * const name, bool have, struct tm t)
+{
+	if (have) {
+		fprintf(out, ",\"%s\":\"%04d-%02d-%02d %02d:%02d\"", name,
+		    t.tm_year, t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min);
+	} else {
+		fprintf(out, ",\"%s\":null", name);
+	}
+}
+
+static void
+print_json_hours(FILE *out, const char * const name,
+    const unsigned long hours[])
+{
+	fprintf(out, ",\"%s\":[", name);
+	for (int i = 0; i < 24; i++) {
+		fprintf(out, "%s%lu", i == 0 ? "" : ",", hours[i]);
+	}
+	fprintf(out, "]");
+}
+
+static void
+print_totals(const struct stats * const st)
+{
+	const struct stats_counters * const c = &st->total;
+	FILE * const out = st->out;
+
+	fprintf(out, "minutes %lu\n", c->minutes);
+	fprintf(out, "valid %lu (%.2f%%)\n", c->valid,
+	    percentage(c->valid, c->minutes));
+	if (c->valid > 0) {
+		fprintf(out, "first %04d-%02d-%02d %02d:%02d\n",
+		    st->first.tm_year, st->first.tm_mon, st->first.tm_mday,
+		    st->first.tm_hour, st->first.tm_min);
+		fprintf(out, "last %04d-%02d-%02d %02d:%02d\n",
+		    st->last.tm_year, st->last.tm_mon, st->last.tm_mday,
+		    st->last.tm_hour, st->last.tm_min);
+	}
+	fprintf(out, "too short %lu, too long %lu, missing marker %lu\n",
+	    c->length[emin_short], c->length[emin_long], c->long_markers);
+	fprintf(out, "bit 0 errors %lu, bit 20 errors %lu\n", c->bit0,
+	    c->bit20);
+	fprintf(out, "%-8s %10s %10s %10s\n", "field", "bcd", "parity",
+	    "jump");
+	for (int i = 0; i < STATS_NFIELDS; i++) {
+		fprintf(out, "%-8s %10lu %10lu %10lu\n", field_name[i],
+		    c->field[i][0], c->field[i][1], c->field[i][2]);
+	}
+	fprintf(out, "time offset errors %lu, jumps %lu, changes %lu\n",
+	    c->dst[eDST_error], c->dst[eDST_jump], c->dst[eDST_done]);
+	fprintf(out, "leap seconds %lu, with value 1 %lu\n",
+	    c->leap[els_done], c->leap[els_one]);
+	fprintf(out, "bits %llu, receive errors %llu, transmit errors %llu, "
+	    "random errors %llu, no value %llu\n", c->bits,
+	    c->hw[ehw_receive], c->hw[ehw_transmit], c->hw[ehw_random],
+	    c->nobit);
+	fprintf(out, "frequency resets %lu, bit length resets %lu\n",
+	    c->resets.freq, c->resets.bitlen);
+	fprintf(out, "%-8s %10s %10s\n", "hour", "minutes", "valid%");
+	for (int i = 0; i < 24; i++) {
+		if (st->hour_minutes[i] > 0) {
+			fprintf(out, "%-8d %10lu %10.2f\n", i,
+			    st->hour_minutes[i],
+			    percentage(st->hour_valid[i],
+			    st->hour_minutes[i]));
+		}
+	}
+}
+
+void
+stats_finish(struct stats * const st)
+{
+	/* bits after the last minute marker */
+	if (st->minute.bits > 0 || st->minute.long_markers > 0) {
+		add_counters(&st->bucket, &st->minute);
+		st->have_bucket = true;
+	}
+	memset(&st->minute, 0, sizeof(st->minute));
+	flush_bucket(st);
+	if (st->json) {
+		print_json(st->out, "total", &st->total);
+		print_json_time(st->out, "first", st->total.valid > 0,
+		    st->first);
+		print_json_time(st->out, "last", st->total.valid > 0,
+		    st->last);
+		print_json_hours(st->out, "hour_minutes", st->hour_minutes);
+		print_json_hours(st->out, "hour_valid", st->hour_valid);
+		fprintf(st->out, "}\n");
+	} else {
+		if (st->nbuckets > 0) {
+			fprintf(st->out, "\n");
+		}
+		print_totals(st);
+	}
+}
@@ -0,0 +1,152 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_STATS_H
+#define DCF77PI_STATS_H
+
+#include "decode_time.h"
+#include "input.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/** Number of date and time fields, minute, hour, mday, wday, month, year */
+#define STATS_NFIELDS 6
+
+/** Kind of the time buckets */
+enum eStatsBucket {
+	/** a fixed number of minutes which divides a day */
+	esb_minutes,
+	/** a calendar month */
+	esb_month,
+	/** a calendar year */
+	esb_year,
+	/** everything in one bucket */
+	esb_all
+};
+
+/** Counters of the reception quality over a period */
+struct stats_counters {
+	/** decoded minutes */
+	unsigned long minutes;
+	/** minutes without any error */
+	unsigned long valid;
+	/**
+	 * errors of the date and time fields by {@link eDT_tval} minus one
+	 * (bcd, parity, jump), in the order of {@link STATS_NFIELDS}
+	 */
+	unsigned long field[STATS_NFIELDS][3];
+	/** minutes by {@link eDT_length} */
+	unsigned long length[3];
+	/** minutes by {@link eDT_DST} */
+	unsigned long dst[4];
+	/** minutes by {@link eDT_leapsecond} */
+	unsigned long leap[3];
+	/** minutes with an error in bit 0 */
+	unsigned long bit0;
+	/** minutes with an error in bit 20 */
+	unsigned long bit20;
+	/** minutes split because the minute marker was missing */
+	unsigned long long_markers;
+	/** bits read */
+	unsigned long long bits;
+	/** bits by {@link eGB_HW} */
+	unsigned long long hw[4];
+	/** bits without a value but without a hardware error ('_') */
+	unsigned long long nobit;
+	/** resets of the frequency and of the bit lengths */
+	struct reset_counts resets;
+};
+
+/**
+ * Aggregation of the reception quality into time buckets by the decoded
+ * time, in a single pass over the minutes in the order they are decoded.
+ * Each bucket is written as soon as a minute falls outside of it, so the
+ * memory use is fixed. The fields should be considered private to stats.c .
+ */
+struct stats {
+	/** kind of the buckets */
+	enum eStatsBucket type;
+	/** length of the buckets in minutes for {@link esb_minutes} */
+	unsigned width;
+	/** output of the buckets and the totals */
+	FILE *out;
+	/** write JSON Lines instead of a table */
+	bool json;
+	/** the current bucket has a time */
+	bool have_key;
+	/** key of the current bucket */
+	int64_t key;
+	/** start of the current bucket */
+	struct tm start;
+	/** the current bucket is not empty */
+	bool have_bucket;
+	/** number of buckets written */
+	unsigned long nbuckets;
+	/** counters of the minute being received */
+	struct stats_counters minute;
+	/** counters of the current bucket */
+	struct stats_counters bucket;
+	/** counters of all minutes */
+	struct stats_counters total;
+	/** decoded minutes by hour of the day */
+	unsigned long hour_minutes[24];
+	/** valid minutes by hour of the day */
+	unsigned long hour_valid[24];
+	/** first valid minute */
+	struct tm first;
+	/** last valid minute */
+	struct tm last;
+};
+
+/**
+ * Initialize the aggregation.
+ *
+ * @param st The aggregation state.
+ * @param bucket The size of the buckets: "all", "year", "month", "day",
+ * "hour" or a number of minutes which divides a day.
+ * @param out The output for the buckets and the totals.
+ * @param json Write JSON Lines instead of a table.
+ * @return Success (0), or -1 if the size of the buckets is invalid.
+ */
+int stats_init(struct stats * const st, const char * const bucket,
+    FILE *out, bool json);
+
+/**
+ * Count a bit of the minute being received.
+ *
+ * @param st The aggregation state.
+ * @param bit The bit as returned by the bit reader.
+ */
+void stats_add_bit(struct stats * const st, struct GB_result bit);
+
+/**
+ * Count a minute which was split because its minute marker was missing.
+ *
+ * @param st The aggregation state.
+ */
+void stats_add_long_minute(struct stats * const st);
+
+/**
+ * Count a decoded minute together with its bits, and write the current
+ * bucket if the minute does not belong to it. A minute without a decoded time
+ * (tm_year 0) belongs to the current bucket.
+ *
+ * @param st The aggregation state.
+ * @param dt The decoding result of the minute.
+ * @param time The decoded time of the minute.
+ * @param resets The resets of the bit reader during the minute.
+ */
+void stats_add_minute(struct stats * const st, struct DT_result dt,
+    struct tm time, struct reset_counts resets);
+
+/**
+ * Write the last bucket and the totals.
+ *
+ * @param st The aggregation state.
+ */
+void stats_finish(struct stats * const st);
+
+#endif
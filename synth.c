@@ -0,0 +1,324 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "synth.h"
+
+#include "calendar.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* pulse length of a 0 bit in nanoseconds, twice that for a 1 bit */
+#define PULSE_NS 100000000LL
+
+static unsigned
+xorshift(unsigned *state)
+{
+	unsigned x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* Draw true with probability p */
+static bool
+chance(struct synth * const s, double p)
+{
+	return p > 0 && xorshift(&s->rnd) < p * 4294967296.0;
+}
+
+/* Random number from -max to max inclusive */
+static long long
+spread(struct synth * const s, long long max)
+{
+	if (max == 0) {
+		return 0;
+	}
+	return (long long)(xorshift(&s->rnd) % (2 * max + 1)) - max;
+}
+
+/* The last Sunday of March or October, given any day of that month */
+static int
+last_sunday(struct tm utc)
+{
+	/* both months have 31 days, tm_wday 7 is a Sunday */
+	return 31 - (utc.tm_wday + 31 - utc.tm_mday) % 7;
+}
+
+/* Summer time is in effect at the given UTC time (EU rules) */
+static bool
+is_summer(struct tm utc)
+{
+	int sun;
+
+	if (utc.tm_mon < 3 || utc.tm_mon > 10) {
+		return false;
+	}
+	if (utc.tm_mon > 3 && utc.tm_mon < 10) {
+		return true;
+	}
+	sun = last_sunday(utc);
+	if (utc.tm_mon == 3) {
+		return utc.tm_mday > sun ||
+		    (utc.tm_mday == sun && utc.tm_hour >= 1);
+	}
+	return utc.tm_mday < sun || (utc.tm_mday == sun && utc.tm_hour < 1);
+}
+
+/*
+ * The minute ending at the given UTC time is transmitted in the hour before
+ * a change of summer time, which happens at 01:00 UTC.
+ */
+static bool
+dst_announced(struct tm utc)
+{
+	if ((utc.tm_mon != 3 && utc.tm_mon != 10) ||
+	    utc.tm_mday != last_sunday(utc)) {
+		return false;
+	}
+	return (utc.tm_hour == 0 && utc.tm_min > 0) ||
+	    (utc.tm_hour == 1 && utc.tm_min == 0);
+}
+
+/* A leap second is configured at the end of the given UTC month */
+static bool
+is_leap_month(const struct synth * const s, int year, int mon)
+{
+	for (unsigned i = 0; i < s->cfg.nleap; i++) {
+		if (s->cfg.leap[i].tm_year == year &&
+		    s->cfg.leap[i].tm_mon == mon) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * The minute ending at the given UTC time has a leap second (leap is 2) or
+ * is transmitted in the hour before it (leap is 1).
+ */
+static int
+leap_state(const struct synth * const s, struct tm utc)
+{
+	if (utc.tm_mday == 1 && utc.tm_hour == 0 && utc.tm_min == 0) {
+		return is_leap_month(s, utc.tm_mon == 1 ? utc.tm_year - 1 :
+		    utc.tm_year, utc.tm_mon == 1 ? 12 : utc.tm_mon - 1) ?
+		    2 : 0;
+	}
+	return utc.tm_mday == lastday(utc) && utc.tm_hour == 23 &&
+	    is_leap_month(s, utc.tm_year, utc.tm_mon) ? 1 : 0;
+}
+
+static void
+set_bcd(int bits[], int start, int len, int val)
+{
+	val = val / 10 * 16 + val % 10;
+	for (int i = 0; i < len; i++) {
+		bits[start + i] = (val >> i) & 1;
+	}
+}
+
+static int
+parity(const int bits[], int start, int stop)
+{
+	int par = 0;
+
+	for (int i = start; i <= stop; i++) {
+		par ^= bits[i];
+	}
+	return par;
+}
+
+/* Encode the current time and add the noise to the text of the minute */
+static void
+encode_minute(struct synth * const s)
+{
+	const struct synth_noise * const n = &s->cfg.noise;
+	const struct tm t = s->time;
+	int leap = leap_state(s, s->utc);
+
+	memset(s->bits, 0, sizeof(s->bits));
+	for (int i = 1; s->cfg.thirdparty && i <= 14; i++) {
+		s->bits[i] = (int)(xorshift(&s->rnd) & 1);
+	}
+	s->bits[16] = dst_announced(s->utc) ? 1 : 0;
+	s->bits[17] = t.tm_isdst == 1 ? 1 : 0;
+	s->bits[18] = t.tm_isdst == 1 ? 0 : 1;
+	s->bits[19] = leap != 0 ? 1 : 0;
+	s->bits[20] = 1;
+	set_bcd(s->bits, 21, 7, t.tm_min);
+	s->bits[28] = parity(s->bits, 21, 27);
+	set_bcd(s->bits, 29, 6, t.tm_hour);
+	s->bits[35] = parity(s->bits, 29, 34);
+	set_bcd(s->bits, 36, 6, t.tm_mday);
+	set_bcd(s->bits, 42, 3, t.tm_wday);
+	set_bcd(s->bits, 45, 5, t.tm_mon);
+	set_bcd(s->bits, 50, 8, t.tm_year % 100);
+	s->bits[58] = parity(s->bits, 36, 57);
+	/* the leap second itself is bit 59, always 0 */
+	s->minlen = leap == 2 ? 60 : 59;
+
+	for (int i = 0; i < s->minlen; i++) {
+		char c = (char)('0' + s->bits[i]);
+
+		if (chance(s, n->flip)) {
+			c = c == '0' ? '1' : '0';
+		}
+		if (s->dropout_left == 0 && chance(s, n->dropout)) {
+			s->dropout_left = n->dropout_len;
+		}
+		if (s->burst_left == 0 && chance(s, n->burst)) {
+			s->burst_left = n->burst_len;
+		}
+		if (s->dropout_left > 0) {
+			s->dropout_left--;
+			c = 'x';
+		} else if (s->burst_left > 0) {
+			s->burst_left--;
+			c = (xorshift(&s->rnd) & 1) != 0 ? 'r' : '#';
+		}
+		s->text[i] = c;
+	}
+	s->text[s->minlen] = '\0';
+	s->acc_minlen = (unsigned)((s->minlen + 1) * 1000 +
+	    spread(s, n->jitter / 1000));
+}
+
+int
+synth_init(struct synth * const s, const struct synth_config * const cfg)
+{
+	struct tm iso, cent;
+	const int y = cfg->start.tm_year, m = cfg->start.tm_mon;
+	const int yy = m < 3 ? y - 1 : y;
+	/* offsets of the months for the day of the week */
+	static const int mdays[12] = {
+		0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4
+	};
+
+	memset(s, 0, sizeof(*s));
+	s->cfg = *cfg;
+	if (y < base_year || y >= base_year + 400 || m < 1 || m > 12 ||
+	    cfg->start.tm_mday < 1 || cfg->start.tm_hour < 0 ||
+	    cfg->start.tm_hour > 23 || cfg->start.tm_min < 0 ||
+	    cfg->start.tm_min > 59 || cfg->nleap > SYNTH_MAXLEAP ||
+	    cfg->noise.jitter > SYNTH_MAXJITTER) {
+		return -1;
+	}
+
+	/* ISO format, with tm_wday 0 being a Sunday (Sakamoto's method) */
+	memset(&iso, 0, sizeof(iso));
+	iso.tm_year = y - 1900;
+	iso.tm_mon = m - 1;
+	iso.tm_mday = cfg->start.tm_mday;
+	iso.tm_hour = cfg->start.tm_hour;
+	iso.tm_min = cfg->start.tm_min;
+	iso.tm_wday = (yy + yy / 4 - yy / 100 + yy / 400 + mdays[m - 1] +
+	    iso.tm_mday) % 7;
+	s->time = get_dcftime(iso);
+	if (s->time.tm_mday > lastday(s->time)) {
+		return -1;
+	}
+	/* the decoder derives the century from the day of the week */
+	cent = s->time;
+	cent.tm_year %= 100;
+	if (century_offset(cent) != (s->time.tm_year - base_year) / 100) {
+		return -1;
+	}
+
+	s->time.tm_isdst = 0;
+	s->utc = get_utctime(s->time);
+	if (is_summer(s->utc)) {
+		s->time.tm_isdst = 1;
+		s->utc = get_utctime(s->time);
+	}
+	s->rnd = cfg->seed != 0 ? cfg->seed : 1;
+	s->t0 = 1000000000LL;
+	encode_minute(s);
+	return 0;
+}
+
+bool
+synth_next(struct synth * const s)
+{
+	bool change;
+
+	if (s->cfg.minutes != 0 && s->minute + 1 >= s->cfg.minutes) {
+		return false;
+	}
+	s->t0 += (s->minlen + 1) * 1000000000LL;
+	s->minute++;
+	s->utc = add_minute(s->utc, false);
+	/* add_minute() moves the hour at a change of summer time */
+	change = is_summer(s->utc) != (s->time.tm_isdst == 1);
+	s->time = add_minute(s->time, change);
+	if (change) {
+		s->time.tm_isdst = 1 - s->time.tm_isdst;
+	}
+	encode_minute(s);
+	return true;
+}
+
+size_t
+synth_log_line(const struct synth * const s, char *buf, size_t len)
+{
+	int res;
+
+	res = snprintf(buf, len, "%sa%uc%6.4f\n", s->text, s->acc_minlen,
+	    1.9950);
+	return res < 0 ? 0 : (size_t)res < len ? (size_t)res : len - 1;
+}
+
+/* Prepare the edges of the current second */
+static void
+second_edges(struct synth * const s)
+{
+	const long long t = s->t0 + s->sec * 1000000000LL;
+	const long long j = (long long)s->cfg.noise.jitter * 1000;
+	char c = s->sec < s->minlen ? s->text[s->sec] : 'm';
+
+	s->nedges = 0;
+	s->iedge = 0;
+	if (c == '0' || c == '1') {
+		s->edge[0].t = t + spread(s, j);
+		s->edge[0].level = 1;
+		s->edge[1].t = t + (c - '0' + 1) * PULSE_NS + spread(s, j);
+		s->edge[1].level = 0;
+		s->nedges = 2;
+	} else if (c == 'r' || c == '#') {
+		/* short random pulses spread over the second */
+		long long u = t;
+		int pairs = 2 + (int)(xorshift(&s->rnd) % 6);
+
+		for (int i = 0; i < pairs; i++) {
+			u += 1 + xorshift(&s->rnd) % (1000000000 / (2 * pairs));
+			s->edge[s->nedges].t = u;
+			s->edge[s->nedges++].level = 1;
+			u += 1 + xorshift(&s->rnd) % (1000000000 / (2 * pairs));
+			s->edge[s->nedges].t = u;
+			s->edge[s->nedges++].level = 0;
+		}
+	}
+	/* no pulse for a dropout or the minute marker */
+}
+
+int
+synth_edge(void *arg, struct edge *e)
+{
+	struct synth *s = arg;
+
+	while (s->iedge == s->nedges) {
+		if (s->sec > s->minlen) {
+			if (!synth_next(s)) {
+				return -1;
+			}
+			s->sec = 0;
+		}
+		second_edges(s);
+		s->sec++;
+	}
+	*e = s->edge[s->iedge++];
+	return 0;
+}
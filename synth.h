@@ -0,0 +1,148 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_SYNTH_H
+#define DCF77PI_SYNTH_H
+
+#include "edge.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/** Maximum number of leap seconds which can be configured */
+#define SYNTH_MAXLEAP 16
+
+/** Maximum jitter of the edges in microseconds */
+#define SYNTH_MAXJITTER 50000
+
+/** Noise added to the generated signal or log file */
+struct synth_noise {
+	/** probability per second that a bit is received inverted */
+	double flip;
+	/** probability per second that a dropout starts */
+	double dropout;
+	/** length of a dropout in seconds, during which there are no pulses */
+	unsigned dropout_len;
+	/** probability per second that a burst of interference starts */
+	double burst;
+	/** length of a burst in seconds, with random pulses */
+	unsigned burst_len;
+	/**
+	 * maximum deviation of each edge in microseconds, at most
+	 * {@link SYNTH_MAXJITTER}, which also varies the minute lengths in log
+	 * files
+	 */
+	unsigned jitter;
+};
+
+/** Configuration of the generator */
+struct synth_config {
+	/**
+	 * the time encoded by the first minute (the first decoded time), in
+	 * DCF77 format as local time, only the year, month, day, hour and
+	 * minute are used
+	 */
+	struct tm start;
+	/** number of minutes to generate, 0 for no limit */
+	unsigned long minutes;
+	/** seed of the pseudo-random numbers, the output only depends on it */
+	unsigned seed;
+	/** random third party bits (1-14) instead of 0 */
+	bool thirdparty;
+	/** number of leap seconds in {@link synth_config.leap} */
+	unsigned nleap;
+	/**
+	 * UTC months (tm_year as full year and tm_mon 1-12) at the end of
+	 * which a leap second is inserted
+	 */
+	struct tm leap[SYNTH_MAXLEAP];
+	/** the noise to add */
+	struct synth_noise noise;
+};
+
+/**
+ * State of the generator. The current minute is transmitted before the
+ * minute marker of {@link synth.time}. The fields should be considered
+ * private to synth.c , except for reading the current minute.
+ */
+struct synth {
+	/** the configuration */
+	struct synth_config cfg;
+	/** the time encoded by the current minute, in DCF77 format */
+	struct tm time;
+	/** {@link synth.time} in UTC */
+	struct tm utc;
+	/** the bits of the current minute, without noise */
+	int bits[60];
+	/** number of bits of the current minute, 59 or 60 */
+	int minlen;
+	/**
+	 * the current minute as written to a log file: '0' and '1' for bits,
+	 * 'x' for a dropout and 'r' or '#' for interference
+	 */
+	char text[61];
+	/** length of the current minute in milliseconds for a log file */
+	unsigned acc_minlen;
+	/** number of minutes generated before the current one */
+	unsigned long minute;
+	/** state of the pseudo-random numbers */
+	unsigned rnd;
+	/** remaining seconds of the current dropout */
+	unsigned dropout_left;
+	/** remaining seconds of the current burst */
+	unsigned burst_left;
+	/** time of the start of the current minute in nanoseconds */
+	long long t0;
+	/** the second of the current minute of which the edges are pending */
+	int sec;
+	/** the pending edges */
+	struct edge edge[16];
+	/** number of pending edges */
+	int nedges;
+	/** next pending edge to return */
+	int iedge;
+};
+
+/**
+ * Initialize the generator and generate the first minute.
+ *
+ * @param s The generator state.
+ * @param cfg The configuration.
+ * @return Success (0), or -1 if the start time is invalid or cannot be
+ * decoded (a year outside 1900-2299), or the noise is out of range.
+ */
+int synth_init(struct synth * const s, const struct synth_config * const cfg);
+
+/**
+ * Generate the next minute.
+ *
+ * @param s The generator state.
+ * @return There is a next minute (true), or the configured number of minutes
+ * has been generated (false).
+ */
+bool synth_next(struct synth * const s);
+
+/**
+ * Format the current minute as a line of a text log file, including the
+ * minute length and cutoff value at its end.
+ *
+ * @param s The generator state.
+ * @param buf The buffer to write to.
+ * @param len The size of the buffer, 128 bytes is enough.
+ * @return The length of the line.
+ */
+size_t synth_log_line(const struct synth * const s, char *buf, size_t len);
+
+/**
+ * Provide the edges of the signal, starting at the current minute and
+ * continuing with the next ones, for {@link set_mode_synthetic}. Each minute
+ * starts at a whole second and the stream starts at 1 second.
+ *
+ * @param arg The generator state (struct synth *).
+ * @param e The next edge.
+ * @return 0 on success, -1 when all minutes have been generated.
+ */
+int synth_edge(void *arg, struct edge *e);
+
+#endif
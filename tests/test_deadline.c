@@ -0,0 +1,99 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "deadline.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sysexits.h>
+#include <time.h>
+
+#define PERIOD 1000000LL	/* 1 ms */
+#define NWAIT 200
+
+static long long
+now(void)
+{
+	struct timespec tp;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
+static void
+busy(long long ns)
+{
+	long long t;
+
+	t = now();
+	while (now() - t < ns)
+		; /* empty loop */
+}
+
+static int
+test_deadline(bool use_timerfd)
+{
+	struct deadline dl;
+	long long start, elapsed;
+	int res;
+
+	res = deadline_init(&dl, PERIOD, use_timerfd);
+	if (res != 0) {
+		printf("deadline_init(%i): %i\n", use_timerfd, res);
+		return 1;
+	}
+	/*
+	 * Work for a third of each period, which would make relative sleeps
+	 * take a third longer.
+	 */
+	start = now();
+	for (int i = 0; i < NWAIT; i++) {
+		busy(PERIOD / 3);
+		if (deadline_wait(&dl) != 0) {
+			printf("deadline_wait(%i) failed\n", use_timerfd);
+			deadline_close(&dl);
+			return 1;
+		}
+	}
+	elapsed = now() - start;
+	/* allow a scheduling hiccup or two */
+	if (elapsed < NWAIT * PERIOD || elapsed > (NWAIT + 50) * PERIOD) {
+		printf("%i: %i waits took %lli ns\n", use_timerfd, NWAIT,
+		    elapsed);
+		deadline_close(&dl);
+		return 1;
+	}
+
+	/* overrunning a period counts as a miss and resynchronizes */
+	busy(3 * PERIOD);
+	(void)deadline_wait(&dl);
+	if (dl.missed == 0 || dl.lateness < 2 * PERIOD) {
+		printf("%i: missed=%llu lateness=%lli\n", use_timerfd,
+		    dl.missed, dl.lateness);
+		deadline_close(&dl);
+		return 1;
+	}
+	start = now();
+	(void)deadline_wait(&dl);
+	elapsed = now() - start;
+	if (elapsed < PERIOD / 2) {
+		printf("%i: no wait after resynchronizing (%lli ns)\n",
+		    use_timerfd, elapsed);
+		deadline_close(&dl);
+		return 1;
+	}
+	deadline_close(&dl);
+	return 0;
+}
+
+int
+main(void)
+{
+	int res;
+
+	res = test_deadline(false);
+#if defined(__linux__)
+	res += test_deadline(true);
+#endif
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,223 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "discipline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+/* Simulated clock which runs nat ppm too fast without correction */
+static double nat, sim_freq;
+/* time of the reference minus the time of the clock, in ns */
+static double sim_offset;
+static long long mono;
+static unsigned long seed = 1;
+
+static int
+sim_set_freq(double freq)
+{
+	sim_freq = freq;
+	return 0;
+}
+
+static int
+sim_step(long long offset)
+{
+	sim_offset -= offset;
+	return 0;
+}
+
+static const struct discipline_backend sim = { sim_set_freq, sim_step };
+
+/* Measurement noise of up to 0.3 ms, like edges sampled at 1000 Hz */
+static long long
+noise(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (long long)((seed >> 16) % 600001) - 300000;
+}
+
+/*
+ * Let the given number of minutes pass, feeding the offset into the loop
+ * each minute, and return the largest offset during the last hour.
+ */
+static double
+run(struct discipline * const dc, int minutes)
+{
+	double max = 0;
+
+	for (int i = 0; i < minutes; i++) {
+		sim_offset -= (nat + sim_freq) * 60 * 1000;
+		mono += 60 * 1000000000LL;
+		if (discipline_update(dc, (long long)sim_offset + noise(),
+		    mono) == -1) {
+			return 1e18;
+		}
+		if (i >= minutes - 60 && (sim_offset > max ||
+		    -sim_offset > max)) {
+			max = sim_offset > 0 ? sim_offset : -sim_offset;
+		}
+	}
+	return max;
+}
+
+static void
+make_policy(struct discipline_policy * const policy, enum eDiscipline mode,
+    const char * const driftfile, const char * const logfile)
+{
+	(void)discipline_policy(policy, NULL);
+	policy->mode = mode;
+	policy->driftfile = driftfile == NULL ? NULL : strdup(driftfile);
+	policy->logfile = logfile == NULL ? NULL : strdup(logfile);
+}
+
+/* Lock onto a clock without a drift file, and restart with it */
+static int
+check_lock(const char * const driftfile)
+{
+	struct discipline dc;
+	struct discipline_policy policy;
+	double max;
+	int res = 0;
+
+	nat = 40;
+	sim_freq = 0;
+	sim_offset = 20000000;
+	make_policy(&policy, edc_slew, driftfile, NULL);
+	if (discipline_init(&dc, &policy, &sim) != 0) {
+		printf("lock: init failed\n");
+		return -1;
+	}
+	max = run(&dc, 12 * 60);
+	if (dc.nstep != 0 || dc.drift < -40.5 || dc.drift > -39.5 ||
+	    max > 200000) {
+		printf("lock: %lu steps, drift %.3f ppm, offset %.0f ns\n",
+		    dc.nstep, dc.drift, max);
+		res = -1;
+	}
+	discipline_close(&dc);
+
+	/* the drift is applied before the first measurement */
+	sim_freq = 0;
+	sim_offset = 0;
+	make_policy(&policy, edc_slew, driftfile, NULL);
+	if (discipline_init(&dc, &policy, &sim) != 0) {
+		printf("restart: init failed\n");
+		return -1;
+	}
+	if (!dc.drift_known || sim_freq < -40.5 || sim_freq > -39.5) {
+		printf("restart: frequency %.3f ppm\n", sim_freq);
+		res = -1;
+	}
+	max = run(&dc, 60);
+	if (max > 200000) {
+		printf("restart: offset %.0f ns\n", max);
+		res = -1;
+	}
+	discipline_close(&dc);
+	return res;
+}
+
+/* Large offsets are stepped away */
+static int
+check_step(void)
+{
+	struct discipline dc;
+	struct discipline_policy policy;
+	int res = 0;
+
+	nat = -10;
+	sim_freq = 0;
+	sim_offset = -1500000000;
+	make_policy(&policy, edc_slew, NULL, NULL);
+	if (discipline_init(&dc, &policy, &sim) != 0) {
+		printf("step: init failed\n");
+		return -1;
+	}
+	(void)run(&dc, 1);
+	if (dc.nstep != 1 || dc.nslew != 0 || sim_offset > 1000000 ||
+	    sim_offset < -1000000) {
+		printf("step: %lu steps, offset %.0f ns\n", dc.nstep,
+		    sim_offset);
+		res = -1;
+	}
+	(void)run(&dc, 10);
+	if (dc.nstep != 1 || dc.nslew != 10) {
+		printf("step: %lu steps afterwards\n", dc.nstep - 1);
+		res = -1;
+	}
+	discipline_close(&dc);
+	return res;
+}
+
+/* A dry run only logs the adjustments */
+static int
+check_dryrun(const char * const driftfile, const char * const logfile)
+{
+	struct discipline dc;
+	struct discipline_policy policy;
+	FILE *f;
+	char line[256];
+	int nupdate = 0, nstep = 0, res = 0;
+
+	make_policy(&policy, edc_dryrun, driftfile, logfile);
+	if (discipline_init(&dc, &policy, NULL) != 0 ||
+	    dc.backend != &discipline_dryrun) {
+		printf("dryrun: init failed\n");
+		return -1;
+	}
+	for (int i = 0; i < 30; i++) {
+		mono += 60 * 1000000000LL;
+		(void)discipline_update(&dc, i == 0 ? 200000000 : i * 2000,
+		    mono);
+	}
+	discipline_close(&dc);
+
+	f = fopen(logfile, "r");
+	if (f == NULL) {
+		perror("dryrun: fopen");
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		nstep += strstr(line, " step") != NULL;
+		nupdate += strstr(line, " freq ") != NULL;
+	}
+	(void)fclose(f);
+	if (nstep != 1 || nupdate != 29 || access(driftfile, F_OK) == 0) {
+		printf("dryrun: %i steps and %i updates logged\n", nstep,
+		    nupdate);
+		res = -1;
+	}
+	return res;
+}
+
+int
+main(void)
+{
+	char dir[] = "/tmp/test_discipline.XXXXXX";
+	char driftfile[64], logfile[64];
+	int res = 0;
+
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return EX_SOFTWARE;
+	}
+	snprintf(driftfile, sizeof(driftfile), "%s/drift", dir);
+	snprintf(logfile, sizeof(logfile), "%s/log", dir);
+	if (check_lock(driftfile) != 0) {
+		res++;
+	}
+	if (check_step() != 0) {
+		res++;
+	}
+	(void)unlink(driftfile);
+	if (check_dryrun(driftfile, logfile) != 0) {
+		res++;
+	}
+	(void)unlink(logfile);
+	(void)rmdir(dir);
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,250 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "edge.h"
+#include "input.h"
+#include "sampler.h"
+
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#define FREQ 1000
+#define MINUTES 4
+
+struct synth {
+	int minute[59];
+	long long second;
+	int phase;
+	bool glitches;
+	sem_t *credits;
+};
+
+static void
+take_credit(struct synth * const s)
+{
+	sem_t *credits = __atomic_load_n(&s->credits, __ATOMIC_ACQUIRE);
+
+	if (credits != NULL) {
+		while (sem_wait(credits) == -1)
+			; /* empty loop */
+	}
+}
+
+/*
+ * Emit the edges of a DCF77-like signal which starts 300 ms into the stream.
+ * From the second minute on, 5 ms spikes are added to the passive part and
+ * 5 ms dropouts to the active part of each second. If credits is set, each
+ * second takes one credit from it.
+ */
+static int
+next_edge(void *arg, struct edge *e)
+{
+	struct synth *s = arg;
+	long long start;
+	int bitpos;
+
+	for (;;) {
+		bitpos = (int)(s->second % 60);
+		start = s->second * 1000000000LL + 300000000LL;
+		if (s->second >= MINUTES * 60) {
+			take_credit(s);
+			return -1;
+		}
+		if (bitpos == 59 || s->phase == (s->glitches ? 6 : 2)) {
+			s->second++;
+			s->phase = 0;
+			s->glitches = s->second >= 60;
+			continue;
+		}
+		break;
+	}
+	if (s->phase == 0) {
+		take_credit(s);
+	}
+	e->level = (s->phase & 1) == 0 ? 1 : 0;
+	if (!s->glitches) {
+		e->t = start + (s->phase == 0 ? 0 :
+		    (s->minute[bitpos] + 1) * 100000000LL);
+	} else {
+		switch (s->phase) {
+		case 0:
+			e->t = start;
+			break;
+		case 1:
+			e->t = start + 50000000LL;
+			break;
+		case 2:
+			e->t = start + 55000000LL;
+			break;
+		case 3:
+			e->t = start + (s->minute[bitpos] + 1) * 100000000LL;
+			break;
+		case 4:
+			e->t = start + 500000000LL;
+			break;
+		case 5:
+			e->t = start + 505000000LL;
+			break;
+		}
+	}
+	s->phase++;
+	return 0;
+}
+
+/* Check the bit just decoded by gbs, returns false on mismatch */
+static bool
+check_bit(struct GB_state * const gbs, const struct synth * const s,
+    struct GB_result bit, bool *synced, const char *name)
+{
+	struct bitinfo bi;
+	int bitpos;
+
+	bi = get_bitinfo_r(gbs);
+	bitpos = get_bitpos_r(gbs);
+	if (*synced) {
+		if (bit.hwstat != ehw_ok ||
+		    bit.bitval != (s->minute[bitpos] == 1 ? ebv_1 : ebv_0)) {
+			printf("%s: bit %i: value %i state %i must be %i\n",
+			    name, bitpos, bit.bitval, bit.hwstat,
+			    s->minute[bitpos]);
+			return false;
+		}
+		if ((bit.marker == emark_minute) != (bitpos == 58)) {
+			printf("%s: bit %i: marker %i\n", name, bitpos,
+			    bit.marker);
+			return false;
+		}
+		/* the dropouts shorten the active part a bit */
+		if (abs(bi.tlow - 100 * (s->minute[bitpos] + 1)) > 5 ||
+		    abs((int)bi.t - (bitpos == 58 ? 2 * FREQ : FREQ)) > 2) {
+			printf("%s: bit %i: tlow %i t %u\n", name, bitpos,
+			    bi.tlow, bi.t);
+			return false;
+		}
+	}
+	if (bit.marker == emark_minute) {
+		*synced = true;
+	}
+	return true;
+}
+
+/*
+ * Run the sampling decoder, the edge decoder and the sampling decoder in a
+ * separate thread side by side within one process, each with its own state
+ * and signal.
+ */
+int
+main(int argc, char *argv[])
+{
+	const char * const name[3] = { "sampled", "edges", "thread" };
+	struct GB_state gbs[3], prod;
+	struct sampler smp;
+	struct synth s[3];
+	bool synced[3] = { false, false, false };
+	sem_t credits;
+	int res;
+
+	srand(1); /* INSECURE random function, but C99-compliant */
+	memset(&s[0], 0, sizeof(s[0]));
+	for (int i = 0; i < 59; i++) {
+		s[0].minute[i] = rand() % 2;
+	}
+	s[0].minute[0] = 0;
+	s[0].minute[20] = 1;
+	s[1] = s[0];
+	s[2] = s[0];
+	/* keep the sampling thread from overrunning the ring */
+	if (sem_init(&credits, 0, SAMPLER_SLOTS / 2) == -1) {
+		perror("sem_init");
+		return EX_SOFTWARE;
+	}
+	s[2].credits = &credits;
+
+	for (int i = 0; i < 3; i++) {
+		init_input_state(&gbs[i]);
+	}
+	init_input_state(&prod);
+	res = set_mode_synthetic_r(&gbs[0], FREQ, false, next_edge, &s[0]);
+	if (res == 0) {
+		res = set_mode_synthetic_r(&gbs[1], FREQ, true, next_edge,
+		    &s[1]);
+	}
+	if (res == 0) {
+		res = set_mode_synthetic_r(&prod, FREQ, false, next_edge,
+		    &s[2]);
+	}
+	if (res == 0) {
+		res = set_mode_snapshot_r(&gbs[2],
+		    get_hardware_parameters_r(&prod));
+	}
+	if (res == 0) {
+		res = start_sampler_r(&smp, &prod, NULL);
+	}
+	if (res != 0) {
+		printf("%s: preparation failed: %i\n", argv[0], res);
+		return EX_SOFTWARE;
+	}
+
+	for (;;) {
+		struct GB_result bit[3];
+		struct bitinfo bi0, bi2;
+
+		for (int i = 0; i < 2; i++) {
+			bit[i] = get_bit_live_r(&gbs[i]);
+		}
+		bit[2] = get_bit_sampler_r(&smp, &gbs[2]);
+		(void)sem_post(&credits);
+		if (bit[0].bad_io != bit[1].bad_io ||
+		    bit[0].bad_io != bit[2].bad_io) {
+			printf("%s: streams ended at different bits\n",
+			    argv[0]);
+			return EX_SOFTWARE;
+		}
+		if (bit[0].bad_io) {
+			/* end of the synthetic streams */
+			break;
+		}
+		for (int i = 0; i < 3; i++) {
+			if (!check_bit(&gbs[i], &s[i], bit[i], &synced[i],
+			    name[i])) {
+				return EX_SOFTWARE;
+			}
+		}
+		/* the thread must not change the results */
+		bi0 = get_bitinfo_r(&gbs[0]);
+		bi2 = get_bitinfo_r(&gbs[2]);
+		if (bi0.tlow != bi2.tlow || bi0.t != bi2.t ||
+		    bi0.realfreq != bi2.realfreq ||
+		    memcmp(bi0.signal, bi2.signal, FREQ / 2) != 0) {
+			printf("%s: bit %i: thread differs\n", argv[0],
+			    get_bitpos_r(&gbs[0]));
+			return EX_SOFTWARE;
+		}
+		for (int i = 0; i < 3; i++) {
+			(void)next_bit_r(&gbs[i]);
+		}
+	}
+	if (!synced[0] || !synced[1] || !synced[2]) {
+		printf("%s: no minute marker found\n", argv[0]);
+		return EX_SOFTWARE;
+	}
+	if (get_sampler_overruns_r(&smp) != 0) {
+		printf("%s: %llu ring overruns\n", argv[0],
+		    get_sampler_overruns_r(&smp));
+		return EX_SOFTWARE;
+	}
+	/* let the sampling thread run freely, it might wait for a credit */
+	__atomic_store_n(&s[2].credits, NULL, __ATOMIC_RELEASE);
+	(void)sem_post(&credits);
+	stop_sampler_r(&smp);
+	cleanup_r(&prod);
+	for (int i = 0; i < 3; i++) {
+		cleanup_r(&gbs[i]);
+	}
+	(void)sem_destroy(&credits);
+	return EX_OK;
+}
@@ -0,0 +1,80 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "heatmap.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+static struct heatmap hm;
+
+/* A minute of bits with the given hardware state at position pos */
+static void
+add_bits(int pos, enum eGB_HW hwstat)
+{
+	struct GB_result bit;
+
+	for (int i = 0; i < 59; i++) {
+		memset(&bit, 0, sizeof(bit));
+		bit.bitval = ebv_0;
+		if (i == pos) {
+			bit.hwstat = hwstat;
+			bit.bitval = ebv_none;
+		}
+		heatmap_add_bit(&hm, bit, i);
+	}
+}
+
+int
+main(void)
+{
+	struct DT_result dt;
+	struct tm time;
+	int res = 0;
+
+	memset(&dt, 0, sizeof(dt));
+	memset(&time, 0, sizeof(time));
+	heatmap_init(&hm);
+
+	/* without a decoded time, the bits are dropped */
+	add_bits(5, ehw_transmit);
+	heatmap_add_minute(&hm, dt, time);
+
+	/* received during 10:59, so counted for hour 10 */
+	time.tm_year = 2026;
+	time.tm_mon = 3;
+	time.tm_mday = 1;
+	time.tm_wday = 7;
+	time.tm_hour = 11;
+	add_bits(7, ehw_random);
+	dt.hour_status = eval_parity;
+	heatmap_add_minute(&hm, dt, time);
+	dt.hour_status = eval_ok;
+
+	/* a minute which is not decoded does not count for the next one */
+	add_bits(3, ehw_receive);
+	add_bits(4, ehw_ok);
+	time.tm_min = 1;
+	heatmap_add_minute(&hm, dt, time);
+
+	if (hm.minutes[10] != 1 || hm.minutes[11] != 1 ||
+	    hm.count[ehm_transmit][0][5] != 0 ||
+	    hm.count[ehm_random][10][7] != 1 ||
+	    hm.count[ehm_receive][11][3] != 0 ||
+	    hm.count[ehm_none][11][4] != 1) {
+		printf("bits counted wrong\n");
+		res++;
+	}
+	for (int i = 0; i < HEATMAP_NBITS; i++) {
+		if (hm.count[ehm_parity][10][i] != (i >= 29 && i <= 35) ||
+		    hm.count[ehm_parity][11][i] != 0) {
+			printf("parity of bit %i counted wrong\n", i);
+			res++;
+			break;
+		}
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
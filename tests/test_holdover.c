@@ -0,0 +1,153 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "holdover.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sysexits.h>
+
+/* local clock running 20 ppm fast, edges timestamped within 0.5 ms */
+#define NAT 20.0
+#define T0 1772366400000000000LL
+
+static unsigned long seed = 1;
+
+static long long
+noise(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (long long)((seed >> 16) % 1000001) - 500000;
+}
+
+/* The local time at the given number of seconds after T0 */
+static long long
+local(double sec)
+{
+	return (long long)(sec * 1e9 * (1 + NAT / 1e6)) + 123456789;
+}
+
+static void
+add_minutes(struct holdover * const ho, int from, int to)
+{
+	for (int m = from; m < to; m++) {
+		holdover_add_minute(ho, local(m * 60.0) + noise(),
+		    T0 + m * 60 * 1000000000LL);
+	}
+}
+
+/* The time continues during a holdover, within the error bound */
+static int
+check_holdover(void)
+{
+	struct holdover ho;
+	long long time, err, prev_err = 0;
+	int res = 0;
+
+	holdover_init(&ho, 500000);
+	if (holdover_time(&ho, local(0), &time, &err) != -1) {
+		printf("holdover: time without any minute\n");
+		res = -1;
+	}
+	add_minutes(&ho, 0, 60);
+	if (ho.freq < NAT - 0.5 || ho.freq > NAT + 0.5 || ho.unc > 0.5) {
+		printf("holdover: frequency %.3f +- %.3f ppm\n", ho.freq,
+		    ho.unc);
+		res = -1;
+	}
+	/* no reception for six hours */
+	for (int h = 1; h <= 6; h++) {
+		const double sec = 59 * 60.0 + h * 3600;
+
+		(void)holdover_time(&ho, local(sec), &time, &err);
+		if (llabs(time - T0 - (long long)(sec * 1e9)) > err ||
+		    err <= prev_err) {
+			printf("holdover: after %i h off by %lli ns, bound "
+			    "%lli ns\n", h, time - T0 - (long long)(sec * 1e9),
+			    err);
+			res = -1;
+		}
+		prev_err = err;
+	}
+	return res;
+}
+
+/* Without enough minutes, the frequency comes from the edges */
+static int
+check_edges(void)
+{
+	struct holdover ho;
+	int res = 0;
+
+	holdover_init(&ho, 1000000);
+	add_minutes(&ho, 0, 1);
+	for (int s = 0; s < 600; s++) {
+		/* no edge for the minute marker, and some lost ones */
+		if (s % 60 == 59 || s % 37 == 0) {
+			continue;
+		}
+		/* a spurious edge starts a new series */
+		if (s == 100) {
+			holdover_add_edge(&ho, local(s + 0.3));
+		}
+		holdover_add_edge(&ho, local(s) + noise());
+	}
+	if (ho.nedge != 500 - 9 - 14 || ho.edge_sec != 498) {
+		printf("edges: %u edges over %lli s\n", ho.nedge,
+		    ho.edge_sec);
+		res = -1;
+	}
+	if (ho.freq < NAT - 2 || ho.freq > NAT + 2 || ho.unc > 10) {
+		printf("edges: frequency %.3f +- %.3f ppm\n", ho.freq,
+		    ho.unc);
+		res = -1;
+	}
+	return res;
+}
+
+/* After the reception returns, the difference is slewed away */
+static int
+check_reconcile(void)
+{
+	struct holdover ho;
+	long long before, after, err, later, m;
+	int res = 0;
+
+	holdover_init(&ho, 500000);
+	add_minutes(&ho, 0, 30);
+	/* back after an hour, but 10 ms later than predicted */
+	m = local(90 * 60.0) - 10000000;
+	(void)holdover_time(&ho, m, &before, &err);
+	holdover_add_minute(&ho, m, T0 + 90 * 60 * 1000000000LL);
+	(void)holdover_time(&ho, m, &after, &err);
+	if (llabs(after - before) > 10000) {
+		printf("reconcile: time jumped by %lli ns\n", after - before);
+		res = -1;
+	}
+	/* 10 ms at 500 ppm takes 20 seconds */
+	(void)holdover_time(&ho, m + 21000000000LL, &later, &err);
+	if (llabs(later - (T0 + 90 * 60 * 1000000000LL + 21000000000LL)) >
+	    1000000) {
+		printf("reconcile: still off by %lli ns\n", later -
+		    (T0 + 90 * 60 * 1000000000LL + 21000000000LL));
+		res = -1;
+	}
+	return res;
+}
+
+int
+main(void)
+{
+	int res = 0;
+
+	if (check_holdover() != 0) {
+		res++;
+	}
+	if (check_edges() != 0) {
+		res++;
+	}
+	if (check_reconcile() != 0) {
+		res++;
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
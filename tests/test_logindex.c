@@ -0,0 +1,236 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "decode_alarm.h"
+#include "decode_time.h"
+#include "input.h"
+#include "logindex.h"
+#include "mainloop.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+/* minutes in the log file, and in the part written first */
+#define MINUTES 6000
+#define FIRST 3500
+
+static void
+set_bcd(int bits[], int start, int len, int val)
+{
+	val = val / 10 * 16 + val % 10;
+	for (int i = 0; i < len; i++) {
+		bits[start + i] = val >> i & 1;
+	}
+}
+
+static int
+parity(const int bits[], int start, int stop)
+{
+	int par = 0;
+
+	for (int i = start; i <= stop; i++) {
+		par ^= bits[i];
+	}
+	return par;
+}
+
+/* Write minutes from up to to of a log file starting at 2026-03-02 00:00 */
+static int
+write_log(const char * const path, int from, int to)
+{
+	FILE *f;
+
+	f = fopen(path, from == 0 ? "w" : "a");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	for (int m = from; m < to; m++) {
+		int bits[59] = { 0 };
+		/* the time of the next minute */
+		int t = m + 1, day = 2 + t / 1440;
+
+		bits[18] = 1;
+		bits[20] = 1;
+		set_bcd(bits, 21, 7, t % 60);
+		bits[28] = parity(bits, 21, 27);
+		set_bcd(bits, 29, 6, t / 60 % 24);
+		bits[35] = parity(bits, 29, 34);
+		set_bcd(bits, 36, 6, day);
+		/* 2026-03-02 is a Monday */
+		set_bcd(bits, 42, 3, (day - 2) % 7 + 1);
+		set_bcd(bits, 45, 5, 3);
+		set_bcd(bits, 50, 8, 26);
+		bits[58] = parity(bits, 36, 57);
+		if (m % 1000 == 999) {
+			fprintf(f, "\n--new log--\n\n");
+		}
+		for (int i = 0; i < 59; i++) {
+			fputc('0' + bits[i], f);
+		}
+		fprintf(f, "a%uc1.9950\n", 59995 + m % 10);
+	}
+	if (fclose(f) == EOF) {
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static int64_t times[MINUTES + 1];
+static int ntimes;
+
+static void
+no_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+}
+
+static void
+no_output(struct ML_state *mls)
+{
+}
+
+static void
+no_minute(struct ML_state *mls, int minlen)
+{
+}
+
+static void
+no_alarm(struct ML_state *mls, struct alm alarm)
+{
+}
+
+static void
+record_time(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	if (ntimes <= MINUTES) {
+		times[ntimes++] = minute_key(time) * 2 +
+		    (dt.minute_status == eval_ok ? 0 : 1);
+	}
+}
+
+static void
+no_thirdparty_buffer(struct ML_state *mls, const unsigned tpbuf[])
+{
+}
+
+static const struct ML_callbacks cb = {
+	get_bit_file_r, no_bit, no_output, no_minute, no_alarm, no_output,
+	no_output, record_time, no_thirdparty_buffer
+};
+
+/* Decode the log file, possibly seeking to the given time first */
+static int
+decode(const char * const path, const char * const index, int64_t key)
+{
+	struct ML_state mls;
+
+	ntimes = 0;
+	init_mainloop_state(&mls, stdout);
+	if (set_mode_file_r(&mls.gbs, path) != 0) {
+		return -1;
+	}
+	if (index != NULL && seek_logindex(index, key, &mls) != 0) {
+		cleanup_r(&mls.gbs);
+		return -1;
+	}
+	while (!mainloop_step_r(&mls, &cb)) {
+		/* decode until the end */
+	}
+	cleanup_r(&mls.gbs);
+	return ntimes;
+}
+
+static int
+same_file(const char * const a, const char * const b)
+{
+	char bufa[BUFSIZ], bufb[BUFSIZ];
+	FILE *fa, *fb;
+	size_t na, nb;
+	int res = 1;
+
+	fa = fopen(a, "r");
+	fb = fopen(b, "r");
+	if (fa == NULL || fb == NULL) {
+		res = 0;
+	}
+	while (res == 1) {
+		na = fread(bufa, 1, sizeof(bufa), fa);
+		nb = fread(bufb, 1, sizeof(bufb), fb);
+		if (na != nb || memcmp(bufa, bufb, na) != 0) {
+			res = 0;
+		} else if (na == 0) {
+			break;
+		}
+	}
+	if (fa != NULL) {
+		(void)fclose(fa);
+	}
+	if (fb != NULL) {
+		(void)fclose(fb);
+	}
+	return res;
+}
+
+int
+main(void)
+{
+	char path[2][28] = { "/tmp/test_logindex.XXXXXX",
+	    "/tmp/test_logindex.XXXXXX" };
+	char index[2][32];
+	static int64_t all[MINUTES + 1];
+	int nall, n, res = 0;
+
+	for (int i = 0; i < 2; i++) {
+		int fd = mkstemp(path[i]);
+
+		if (fd == -1) {
+			perror("mkstemp");
+			return EX_SOFTWARE;
+		}
+		(void)close(fd);
+		snprintf(index[i], sizeof(index[i]), "%s.idx", path[i]);
+	}
+
+	/* index the first part, append the rest and update the index */
+	if (write_log(path[0], 0, FIRST) != 0 ||
+	    update_logindex(path[0], index[0]) != 0 ||
+	    write_log(path[0], FIRST, MINUTES) != 0 ||
+	    update_logindex(path[0], index[0]) != 0 ||
+	    write_log(path[1], 0, MINUTES) != 0 ||
+	    update_logindex(path[1], index[1]) != 0) {
+		printf("indexing failed\n");
+		res++;
+	} else if (!same_file(index[0], index[1])) {
+		printf("updated index differs from the full one\n");
+		res++;
+	}
+
+	nall = decode(path[1], NULL, 0);
+	memcpy(all, times, sizeof(all));
+	if (nall < MINUTES) {
+		printf("%i minutes decoded\n", nall);
+		res++;
+	}
+	/* 2026-03-03 13:07, after the first restart, within the hour before */
+	n = decode(path[1], index[1], 202603031307);
+	if (n < 0 || n >= nall || times[0] / 2 >= 202603031307 ||
+	    times[0] / 2 < 202603031207 ||
+	    memcmp(times, all + nall - n, n * sizeof(times[0])) != 0) {
+		printf("seeking failed: %i minutes, first %lli\n", n,
+		    (long long)(n > 0 ? times[0] / 2 : 0));
+		res++;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		(void)unlink(path[i]);
+		(void)unlink(index[i]);
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,275 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "binlog.h"
+#include "input.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#define MAXBITS 400
+
+struct trace {
+	struct GB_result bit[MAXBITS];
+	int bitpos[MAXBITS];
+	unsigned acc_minlen[MAXBITS];
+	int cutoff[MAXBITS];
+	int n;
+	struct reset_counts resets;
+};
+
+/*
+ * Log files, including broken ones, which both parsers must read alike, also
+ * after converting them to binary log files
+ */
+static const struct {
+	const char *text;
+	size_t len;
+} input[] = {
+#define T(s) { s, sizeof(s) - 1 }
+	T("0000000000000000000100001001010100001100001010000011100110\n"
+	    "0001000000001000100100000000010000110000101000001011001100\n"),
+	T("0101011100100111100110101101000100001100001000000101100110"
+	    "a59990c1.9998\n"
+	    "00x0001r000##0100100_0010001*00001100001010000011100110"
+	    "a60010c2.0010\n"),
+	T("0101\r\n0110\r\n\r\n0111\r0011\r\r\n01\r"),
+	T("01 01;\t01\0 01\xff\x80z01\n\n\n01"),
+	T("0101a\n12301a-5 01a+01a12345678901234\n01ax01a"),
+	T("0101c1.9011c1.9"),
+	T("0101cX.12340c1.2 340c\n1.2301"),
+	T("0101c1.2"),
+	T(""),
+	T("\r"),
+	T("0a"),
+	T("\n--new log--\n\n01<1>0!1a0c0.0000\n--new log\n-1a00a4294967295"
+	    "c9.9999\n0a4294967296c0.00001\n"),
+	T("0101a60000c1.9950\n0_x\0r#*a0c1.0001\n01\0")
+#undef T
+};
+
+static void
+run(const char *path, bool stdio_only, struct trace *tr)
+{
+	struct GB_state gbs;
+
+	memset(tr, 0, sizeof(*tr));
+	init_input_state(&gbs);
+	set_stdio_only_r(&gbs, stdio_only);
+	if (set_mode_file_r(&gbs, path) != 0) {
+		tr->n = -1;
+		return;
+	}
+	/* like mainloop() */
+	while (tr->n < MAXBITS) {
+		struct GB_result bit;
+
+		bit = get_bit_file_r(&gbs);
+		tr->bitpos[tr->n] = get_bitpos_r(&gbs);
+		bit = next_bit_r(&gbs);
+		tr->bit[tr->n] = bit;
+		tr->acc_minlen[tr->n] = get_acc_minlen_r(&gbs);
+		tr->cutoff[tr->n] = get_cutoff_r(&gbs);
+		tr->n++;
+		if (bit.done) {
+			break;
+		}
+	}
+	tr->resets = get_reset_counts_r(&gbs);
+	cleanup_r(&gbs);
+}
+
+static bool
+same_result(struct GB_result a, struct GB_result b)
+{
+	return a.bad_io == b.bad_io && a.bitval == b.bitval &&
+	    a.marker == b.marker && a.hwstat == b.hwstat &&
+	    a.done == b.done && a.skip == b.skip;
+}
+
+static int
+compare(unsigned i, const char * const what, const struct trace * const a,
+    const struct trace * const b)
+{
+	if (a->n != b->n || a->n < 1) {
+		printf("input %u: %i bits mapped, %i %s\n", i, a->n, b->n,
+		    what);
+		return 1;
+	}
+	for (int j = 0; j < a->n; j++) {
+		if (!same_result(a->bit[j], b->bit[j]) ||
+		    a->bitpos[j] != b->bitpos[j] ||
+		    a->acc_minlen[j] != b->acc_minlen[j] ||
+		    a->cutoff[j] != b->cutoff[j]) {
+			printf("input %u: bit %i differs %s\n", i, j, what);
+			return 1;
+		}
+	}
+	if (a->resets.freq != b->resets.freq ||
+	    a->resets.bitlen != b->resets.bitlen) {
+		printf("input %u: resets differ %s\n", i, what);
+		return 1;
+	}
+	return 0;
+}
+
+/* The number of characters of the text which are in set */
+static unsigned long
+count_chars(const char * const text, size_t len, const char * const set)
+{
+	unsigned long n = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		n += text[i] != '\0' && strchr(set, text[i]) != NULL ? 1 : 0;
+	}
+	return n;
+}
+
+/* Check that the file contains exactly the given text */
+static bool
+same_text(const char * const path, const char * const text, size_t len)
+{
+	char buf[BUFSIZ];
+	size_t n;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		return false;
+	}
+	n = fread(buf, 1, sizeof(buf), f);
+	(void)fclose(f);
+	return n == len && memcmp(buf, text, len) == 0;
+}
+
+/* minutes written by check_writer, enough for a few sync frames */
+#define WRITER_MINUTES 150
+
+/*
+ * Write a log file like dcf77pi does, one bit at a time, both as text and
+ * through a binary log writer, and check that converting the text gives the
+ * same binary log file.
+ */
+static int
+check_writer(const char * const textpath, const char * const binpath,
+    const char * const convpath)
+{
+	static unsigned char buf[2][WRITER_MINUTES * 80];
+	struct binlog_writer w;
+	FILE *ft, *fb, *f;
+	size_t n[2];
+	int res = 0;
+
+	ft = fopen(textpath, "w");
+	fb = fopen(binpath, "w");
+	if (ft == NULL || fb == NULL || binlog_open_writer(&w, fb) != 0) {
+		printf("writer: cannot open files\n");
+		res = 1;
+	}
+	for (int m = 0; res == 0 && m < WRITER_MINUTES; m++) {
+		char text[32];
+
+		for (int i = 0; res == 0 && i < 59; i++) {
+			text[0] = "01_x"[(m * 7 + i * i) % 4];
+			fputc(text[0], ft);
+			res = binlog_write_text(&w, (unsigned char *)text, 1);
+		}
+		snprintf(text, sizeof(text), "a%uc%6.4f\n", 59950 + m,
+		    1.99 + m / 10000.0);
+		fputs(text, ft);
+		if (res == 0) {
+			res = binlog_write_text(&w, (unsigned char *)text,
+			    strlen(text));
+		}
+	}
+	if (ft != NULL && fclose(ft) == EOF) {
+		res = 1;
+	}
+	if (fb != NULL && (binlog_close_writer(&w) != 0 ||
+	    fclose(fb) == EOF)) {
+		res = 1;
+	}
+	if (res != 0 || convert_logfile(textpath, convpath) != 0) {
+		printf("writer: writing failed\n");
+		return 1;
+	}
+	for (int i = 0; i < 2; i++) {
+		f = fopen(i == 0 ? binpath : convpath, "r");
+		n[i] = f != NULL ? fread(buf[i], 1, sizeof(buf[i]), f) : 0;
+		if (f != NULL) {
+			(void)fclose(f);
+		}
+	}
+	if (n[0] == 0 || n[0] != n[1] || memcmp(buf[0], buf[1], n[0]) != 0) {
+		printf("writer: %zu bytes written, %zu converted\n", n[0],
+		    n[1]);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main(void)
+{
+	static struct trace tr[3];
+	char path[3][26] = { "/tmp/test_logparse.XXXXXX",
+	    "/tmp/test_logparse.XXXXXX", "/tmp/test_logparse.XXXXXX" };
+	int fd, res = 0;
+
+	for (int i = 0; i < 3; i++) {
+		fd = mkstemp(path[i]);
+		if (fd == -1) {
+			perror("mkstemp");
+			return EX_SOFTWARE;
+		}
+		(void)close(fd);
+	}
+
+	for (unsigned i = 0; i < sizeof(input) / sizeof(input[0]); i++) {
+		FILE *f;
+
+		f = fopen(path[0], "w");
+		if (f == NULL || fwrite(input[i].text, 1, input[i].len, f) !=
+		    input[i].len || fclose(f) == EOF) {
+			perror(path[0]);
+			res = -1;
+			break;
+		}
+		run(path[0], false, &tr[0]);
+		run(path[0], true, &tr[1]);
+		res += compare(i, "using stdio", &tr[0], &tr[1]);
+		if (tr[0].resets.freq != count_chars(input[i].text,
+		    input[i].len, "<>") || tr[0].resets.bitlen !=
+		    count_chars(input[i].text, input[i].len, "!")) {
+			printf("input %u: %lu frequency and %lu bit length "
+			    "resets\n", i, tr[0].resets.freq,
+			    tr[0].resets.bitlen);
+			res++;
+		}
+
+		/* to a binary log file and back */
+		if (convert_logfile(path[0], path[1]) != 0 ||
+		    convert_logfile(path[1], path[2]) != 0) {
+			printf("input %u: conversion failed\n", i);
+			res++;
+			continue;
+		}
+		if (!same_text(path[2], input[i].text, input[i].len)) {
+			printf("input %u: converted back differently\n", i);
+			res++;
+		}
+		run(path[1], false, &tr[2]);
+		res += compare(i, "in binary", &tr[0], &tr[2]);
+	}
+	if (res >= 0) {
+		res += check_writer(path[0], path[1], path[2]);
+	}
+	for (int i = 0; i < 3; i++) {
+		(void)unlink(path[i]);
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
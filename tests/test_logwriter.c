@@ -0,0 +1,171 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "binlog.h"
+#include "logwriter.h"
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+/* fewer minutes than queue slots, so that nothing is dropped */
+#define MINUTES 40
+
+/* Write the minutes one bit at a time, like the bit reader does */
+static int
+write_minutes(const char * const name, bool binary, unsigned long long maxsize)
+{
+	struct logwriter_policy policy;
+	struct logwriter lw;
+	int res;
+
+	memset(&lw, 0, sizeof(lw));
+	(void)logwriter_policy(&policy, NULL);
+	policy.syncsecs = LOGWRITER_SYNC_MINUTE;
+	policy.maxsize = maxsize;
+	res = logwriter_open(&lw, name, binary, &policy);
+	if (res != 0) {
+		printf("logwriter_open: %i\n", res);
+		return -1;
+	}
+	logwriter_write(&lw, "\n--new log--\n\n", 14);
+	for (int m = 0; m < MINUTES; m++) {
+		char text[32];
+
+		for (int i = 0; i < 59; i++) {
+			logwriter_write(&lw, &"01_x"[(m + i * i) % 4], 1);
+		}
+		snprintf(text, sizeof(text), "a%uc%6.4f\n", 60000 + m,
+		    1.99 + m / 10000.0);
+		logwriter_write(&lw, text, strlen(text));
+	}
+	if (logwriter_overruns(&lw) != 0) {
+		printf("%llu overruns\n", logwriter_overruns(&lw));
+		res = -1;
+	}
+	if (logwriter_close(&lw) != 0) {
+		printf("logwriter_close failed\n");
+		res = -1;
+	}
+	/* the writing thread has finished */
+	if (logwriter_rotations(&lw) < 3) {
+		printf("%lu rotations\n", logwriter_rotations(&lw));
+		res = -1;
+	}
+	return res;
+}
+
+/* Check the minutes in one (rotated) text log file */
+static int
+check_file(const char * const path, int seen[])
+{
+	char line[128];
+	unsigned acc;
+	int prev = -1, res = 0;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		size_t len = strlen(line);
+
+		if (line[len - 1] != '\n') {
+			printf("%s: incomplete line\n", path);
+			res = -1;
+		} else if (len == 73 && sscanf(line + 59, "a%u", &acc) == 1 &&
+		    acc >= 60000 && acc < 60000 + MINUTES) {
+			if ((int)acc <= prev) {
+				printf("%s: minutes out of order\n", path);
+				res = -1;
+			}
+			prev = (int)acc;
+			seen[acc - 60000]++;
+		} else if (strcmp(line, "\n") != 0 &&
+		    strcmp(line, "--new log--\n") != 0) {
+			printf("%s: unexpected line %s", path, line);
+			res = -1;
+		}
+	}
+	(void)fclose(f);
+	return res;
+}
+
+/* Check that the files in the directory hold each minute once */
+static int
+check_dir(const char * const dir, bool binary)
+{
+	char path[512], text[512];
+	int seen[MINUTES] = { 0 };
+	struct dirent *de;
+	DIR *d;
+	int res = 0, nfiles = 0;
+
+	d = opendir(dir);
+	if (d == NULL) {
+		perror(dir);
+		return -1;
+	}
+	while ((de = readdir(d)) != NULL) {
+		if (strncmp(de->d_name, "log", 3) != 0) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		snprintf(text, sizeof(text), "%s/text", dir);
+		if (binary && convert_logfile(path, text) != 0) {
+			printf("%s: not a binary log file\n", path);
+			res = -1;
+		} else if (check_file(binary ? text : path, seen) != 0) {
+			res = -1;
+		}
+		(void)unlink(path);
+		nfiles++;
+	}
+	(void)closedir(d);
+	(void)unlink(text);
+	for (int m = 0; m < MINUTES; m++) {
+		if (seen[m] != 1) {
+			printf("minute %i written %i times\n", m, seen[m]);
+			res = -1;
+			break;
+		}
+	}
+	if (nfiles < 4) {
+		printf("%i log files\n", nfiles);
+		res = -1;
+	}
+	return res;
+}
+
+int
+main(void)
+{
+	char dir[] = "/tmp/test_logwriter.XXXXXX";
+	char name[64];
+	int res = 0;
+
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return EX_SOFTWARE;
+	}
+	snprintf(name, sizeof(name), "%s/log", dir);
+	/* a minute takes 73 bytes as text and about 20 bytes as binary */
+	if (write_minutes(name, false, 500) != 0 ||
+	    check_dir(dir, false) != 0) {
+		printf("text log file failed\n");
+		res++;
+	}
+	if (write_minutes(name, true, 100) != 0 ||
+	    check_dir(dir, true) != 0) {
+		printf("binary log file failed\n");
+		res++;
+	}
+	(void)rmdir(dir);
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
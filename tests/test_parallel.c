@@ -0,0 +1,310 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "decode_alarm.h"
+#include "decode_time.h"
+#include "input.h"
+#include "mainloop.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+/* about 3 MB, enough for a few chunks */
+#define MINUTES 40000
+
+static unsigned
+xorshift(unsigned *state)
+{
+	unsigned x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void
+set_bcd(int bits[], int start, int len, int val)
+{
+	val = val / 10 * 16 + val % 10;
+	for (int i = 0; i < len; i++) {
+		bits[start + i] = val >> i & 1;
+	}
+}
+
+static int
+parity(const int bits[], int start, int stop)
+{
+	int par = 0;
+
+	for (int i = start; i <= stop; i++) {
+		par ^= bits[i];
+	}
+	return par;
+}
+
+/* Encode the minute at the given time like DCF77 does */
+static void
+encode(int bits[], const struct tm * const tm, unsigned *seed)
+{
+	for (int i = 1; i < 15; i++) {
+		bits[i] = (int)(xorshift(seed) & 1);
+	}
+	bits[0] = 0;
+	bits[15] = 0;
+	/* announcements for a while each day, which never happen */
+	bits[16] = tm->tm_hour == 1 && tm->tm_mday % 3 == 0;
+	bits[17] = 0;
+	bits[18] = 1;
+	bits[19] = tm->tm_hour == 2 && tm->tm_mday % 5 == 0;
+	bits[20] = 1;
+	set_bcd(bits, 21, 7, tm->tm_min);
+	bits[28] = parity(bits, 21, 27);
+	set_bcd(bits, 29, 6, tm->tm_hour);
+	bits[35] = parity(bits, 29, 34);
+	set_bcd(bits, 36, 6, tm->tm_mday);
+	set_bcd(bits, 42, 3, tm->tm_wday == 0 ? 7 : tm->tm_wday);
+	set_bcd(bits, 45, 5, tm->tm_mon);
+	set_bcd(bits, 50, 8, tm->tm_year);
+	bits[58] = parity(bits, 36, 57);
+}
+
+static void
+next_minute(struct tm * const tm)
+{
+	const int mdays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	if (++tm->tm_min < 60) {
+		return;
+	}
+	tm->tm_min = 0;
+	if (++tm->tm_hour < 24) {
+		return;
+	}
+	tm->tm_hour = 0;
+	tm->tm_wday = (tm->tm_wday + 1) % 7;
+	if (++tm->tm_mday <= mdays[tm->tm_mon - 1] +
+	    (tm->tm_mon == 2 && tm->tm_year % 4 == 0)) {
+		return;
+	}
+	tm->tm_mday = 1;
+	if (++tm->tm_mon <= 12) {
+		return;
+	}
+	tm->tm_mon = 1;
+	tm->tm_year++;
+}
+
+/*
+ * Write a log file with reception errors, split and missing minutes and
+ * restarts of dcf77pi, so that the decoder goes through most of its states.
+ */
+static int
+write_log(const char * const path)
+{
+	const char bad[] = "x_r#*";
+	struct tm tm;
+	unsigned seed = 1;
+	FILE *f;
+
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_year = 26;
+	tm.tm_mon = 1;
+	tm.tm_mday = 1;
+	tm.tm_wday = 4;
+	f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "\n--new log--\n\n");
+	for (int m = 0; m < MINUTES; m++) {
+		int bits[59];
+		unsigned r = xorshift(&seed) % 1000, split = 0, len = 59;
+
+		encode(bits, &tm, &seed);
+		next_minute(&tm);
+		if (r < 5) {
+			fprintf(f, "\n--new log--\n\n");
+		} else if (r < 10) {
+			/* a minute split in two */
+			split = 1 + xorshift(&seed) % 57;
+		} else if (r < 15) {
+			len = 59 - 1 - xorshift(&seed) % 10;
+		} else if (r < 20) {
+			/* a missed minute marker */
+			continue;
+		}
+		for (unsigned i = 0; i < len; i++) {
+			unsigned n = xorshift(&seed);
+
+			if (n % 300 == 0) {
+				fputc(bad[n / 300 % 5], f);
+			} else if (n % 300 == 1) {
+				fputc('0' + 1 - bits[i], f);
+			} else {
+				fputc('0' + bits[i], f);
+			}
+			if (i + 1 == split) {
+				fprintf(f, "a%uc1.9876\n", split * 1000);
+			}
+		}
+		if (xorshift(&seed) % 10 == 0) {
+			fputc('\n', f);
+		} else {
+			fprintf(f, "a%uc%6.4f\n", split > 0 ? (len - split) *
+			    1000 : 59990 + xorshift(&seed) % 40,
+			    1.99 + xorshift(&seed) % 200 / 10000.0);
+		}
+	}
+	if (fclose(f) == EOF) {
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+display_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+	fprintf(mls->out, "%i%i%i", bit.hwstat, bit.bitval,
+	    get_buffer_r(&mls->gbs)[bitpos]);
+}
+
+static void
+display_long_minute(struct ML_state *mls)
+{
+	fprintf(mls->out, "L");
+}
+
+static void
+display_minute(struct ML_state *mls, int minlen)
+{
+	fprintf(mls->out, " %u %i %i\n", get_acc_minlen_r(&mls->gbs), minlen,
+	    get_cutoff_r(&mls->gbs));
+}
+
+static void
+display_alarm(struct ML_state *mls, struct alm alarm)
+{
+	fprintf(mls->out, "alarm %x\n", alarm.region[0].r1);
+}
+
+static void
+display_unknown(struct ML_state *mls)
+{
+	fprintf(mls->out, "unknown\n");
+}
+
+static void
+display_weather(struct ML_state *mls)
+{
+	fprintf(mls->out, "weather\n");
+}
+
+static void
+display_time(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	fprintf(mls->out, "%i %i-%i-%i %i %i:%i %i%i%i %i %i%i%i%i%i%i %i %i "
+	    "%i%i\n", time.tm_isdst, time.tm_year, time.tm_mon, time.tm_mday,
+	    time.tm_wday, time.tm_hour, time.tm_min, dt.bit0_ok,
+	    dt.transmit_call, dt.bit20_ok, dt.minute_length,
+	    dt.minute_status, dt.hour_status, dt.mday_status,
+	    dt.wday_status, dt.month_status, dt.year_status, dt.dst_status,
+	    dt.leapsecond_status, dt.dst_announce, dt.leap_announce);
+}
+
+static void
+display_thirdparty_buffer(struct ML_state *mls, const unsigned tpbuf[])
+{
+	fprintf(mls->out, "tp %u%u%u\n", tpbuf[0], tpbuf[1], tpbuf[2]);
+}
+
+static const struct ML_callbacks cb = {
+	get_bit_file_r, display_bit, display_long_minute, display_minute,
+	display_alarm, display_unknown, display_weather, display_time,
+	display_thirdparty_buffer
+};
+
+/* Compare the output of two decoders, return 0 if it is the same */
+static int
+compare(FILE *a, FILE *b)
+{
+	char bufa[BUFSIZ], bufb[BUFSIZ];
+	size_t na, nb;
+	long total = 0;
+
+	rewind(a);
+	rewind(b);
+	do {
+		na = fread(bufa, 1, sizeof(bufa), a);
+		nb = fread(bufb, 1, sizeof(bufb), b);
+		if (na != nb || memcmp(bufa, bufb, na) != 0) {
+			printf("output differs after %li bytes\n", total);
+			return 1;
+		}
+		total += (long)na;
+	} while (na > 0);
+	if (total == 0) {
+		printf("no output\n");
+		return 1;
+	}
+	return 0;
+}
+
+int
+main(void)
+{
+	char path[] = "/tmp/test_parallel.XXXXXX";
+	struct ML_state mls;
+	FILE *seq;
+	int fd, res = 0;
+
+	fd = mkstemp(path);
+	if (fd == -1) {
+		perror("mkstemp");
+		return EX_SOFTWARE;
+	}
+	(void)close(fd);
+	seq = tmpfile();
+	if (seq == NULL || write_log(path) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+
+	init_mainloop_state(&mls, seq);
+	if (set_mode_file_r(&mls.gbs, path) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+	while (!mainloop_step_r(&mls, &cb)) {
+		/* decode sequentially */
+	}
+	cleanup_r(&mls.gbs);
+
+	for (unsigned nthreads = 2; nthreads <= 5; nthreads += 3) {
+		FILE *par;
+
+		par = tmpfile();
+		if (par == NULL ||
+		    mainloop_parallel(path, nthreads, &cb, par) != 0) {
+			printf("%u threads: failed\n", nthreads);
+			res++;
+		} else if (compare(seq, par) != 0) {
+			printf("%u threads: wrong output\n", nthreads);
+			res++;
+		}
+		if (par != NULL) {
+			(void)fclose(par);
+		}
+	}
+	(void)fclose(seq);
+	(void)unlink(path);
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,252 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "rawcap.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#define FREQ 500
+#define NBLOCKS 8
+/* bits written while reading concurrently */
+#define NCONCURRENT 200000
+
+static bool
+sample(const unsigned char *signal, unsigned i)
+{
+	return (signal[i / 8] & (1 << (i & 7))) != 0;
+}
+
+/* Fill a bit with a pattern which differs per bit and per sample */
+static void
+fill(unsigned char *signal, unsigned nsamples, unsigned bit)
+{
+	memset(signal, 0, (nsamples + 7) / 8);
+	for (unsigned i = 0; i < nsamples; i++) {
+		if ((i * 7 + bit) % 3 == 0) {
+			signal[i / 8] |= (unsigned char)(1 << (i & 7));
+		}
+	}
+}
+
+/* Check that blk is block seq with samples from up to from + n of a bit */
+static int
+check_block(const struct rawcap_block * const blk, uint64_t seq,
+    unsigned bit, unsigned from, unsigned n, long long t)
+{
+	unsigned char signal[FREQ / 2];
+
+	if (blk->seq != seq || blk->freq != FREQ || blk->nsamples != n ||
+	    blk->active_high != 1 || blk->t != t ||
+	    blk->flags != (from > 0 ? RAWCAP_CONT : 0)) {
+		printf("block %llu: header seq=%llu n=%u t=%lli flags=%u\n",
+		    (unsigned long long)seq, (unsigned long long)blk->seq,
+		    blk->nsamples, (long long)blk->t, blk->flags);
+		return 1;
+	}
+	fill(signal, FREQ * 4, bit);
+	for (unsigned i = 0; i < n; i++) {
+		if (sample(blk->data, i) != sample(signal, from + i)) {
+			printf("block %llu: sample %u differs\n",
+			    (unsigned long long)seq, i);
+			return 1;
+		}
+	}
+	/* the unused bits of the last byte are cleared */
+	for (unsigned i = n; i < (n + 7) / 8 * 8; i++) {
+		if (sample(blk->data, i)) {
+			printf("block %llu: stale sample %u\n",
+			    (unsigned long long)seq, i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static bool
+present(const struct rawcap *rc, uint64_t seq)
+{
+	struct rawcap_block *blk;
+	bool res;
+
+	blk = malloc(rc->file->blocksize);
+	res = blk != NULL && rawcap_block(rc, seq, blk) == 0;
+	free(blk);
+	return res;
+}
+
+/* Check that block seq holds samples from up to from + n of the given bit */
+static int
+check(const struct rawcap *rc, uint64_t seq, unsigned bit, unsigned from,
+    unsigned n, long long t)
+{
+	struct rawcap_block *blk;
+	int res;
+
+	blk = malloc(rc->file->blocksize);
+	if (blk == NULL) {
+		perror("malloc");
+		return 1;
+	}
+	if (rawcap_block(rc, seq, blk) != 0) {
+		printf("block %llu missing\n", (unsigned long long)seq);
+		free(blk);
+		return 1;
+	}
+	res = check_block(blk, seq, bit, from, n, t);
+	free(blk);
+	return res;
+}
+
+/* Write bits of a varying length, each bit with its own time and pattern */
+static void *
+write_bits(void *arg)
+{
+	struct rawcap * const rc = arg;
+	unsigned char signal[FREQ / 8 + 1];
+
+	for (unsigned bit = 0; bit < NCONCURRENT; bit++) {
+		fill(signal, 1 + bit % FREQ, bit);
+		rawcap_write(rc, bit, true, signal, 1 + bit % FREQ);
+	}
+	return NULL;
+}
+
+/* A reader never sees a block of which the writer changed a part */
+static int
+check_concurrent(const char * const path)
+{
+	struct rawcap rc, rd;
+	struct rawcap_block *blk;
+	pthread_t writer;
+	unsigned long copied = 0;
+	int res = 0;
+
+	if (rawcap_open(&rc, path, NBLOCKS, FREQ) != 0) {
+		return 1;
+	}
+	if (rawcap_open_read(&rd, path) != 0) {
+		rawcap_close(&rc);
+		return 1;
+	}
+	blk = malloc(rd.file->blocksize);
+	if (blk == NULL || pthread_create(&writer, NULL, write_bits,
+	    &rc) != 0) {
+		perror("check_concurrent");
+		free(blk);
+		rawcap_close(&rd);
+		rawcap_close(&rc);
+		return 1;
+	}
+	while (res == 0 && rawcap_head(&rd) < NCONCURRENT) {
+		const uint64_t head = rawcap_head(&rd);
+		/* the oldest block is the one which is rewritten next */
+		const uint64_t seq = head > NBLOCKS ? head - NBLOCKS : 0;
+
+		if (rawcap_block(&rd, seq, blk) == 0) {
+			res = check_block(blk, seq, (unsigned)blk->t, 0,
+			    1 + (unsigned)blk->t % FREQ, blk->t);
+			copied++;
+		}
+	}
+	(void)pthread_join(writer, NULL);
+	if (copied == 0) {
+		printf("concurrent: no block read\n");
+		res = 1;
+	}
+	free(blk);
+	rawcap_close(&rd);
+	rawcap_close(&rc);
+	return res;
+}
+
+int
+main(void)
+{
+	char path[] = "/tmp/test_rawcap.XXXXXX";
+	unsigned char signal[FREQ / 2];
+	struct rawcap rc;
+	int fd, res = 0;
+
+	fd = mkstemp(path);
+	if (fd == -1) {
+		perror("mkstemp");
+		return EX_SOFTWARE;
+	}
+	(void)close(fd);
+
+	if (rawcap_open(&rc, path, NBLOCKS, FREQ) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+	/* blocks 0-3 are ordinary bits, 4-5 and 6-7 minute markers */
+	for (unsigned bit = 0; bit < 4; bit++) {
+		fill(signal, FREQ - 3, bit);
+		rawcap_write(&rc, bit * 1000000000LL, true, signal, FREQ - 3);
+	}
+	fill(signal, FREQ + 13, 4);
+	rawcap_write(&rc, 4000000000LL, true, signal, FREQ + 13);
+	fill(signal, FREQ * 2, 5);
+	rawcap_write(&rc, 6000000000LL, true, signal, FREQ * 2);
+	if (rawcap_head(&rc) != 8) {
+		printf("head %llu\n", (unsigned long long)rawcap_head(&rc));
+		res++;
+	}
+	res += check(&rc, 4, 4, 0, FREQ, 4000000000LL);
+	res += check(&rc, 5, 4, FREQ, 13, 5000000000LL);
+	res += check(&rc, 7, 5, FREQ, FREQ, 7000000000LL);
+
+	/* wrap around, overwriting blocks 0 and 1 */
+	fill(signal, FREQ - 3, 8);
+	rawcap_write(&rc, 8000000000LL, true, signal, FREQ - 3);
+	fill(signal, 5, 9);
+	rawcap_write(&rc, 9000000000LL, true, signal, 5);
+	if (present(&rc, 1) || present(&rc, 10)) {
+		printf("overwritten or future block present\n");
+		res++;
+	}
+	res += check(&rc, 2, 2, 0, FREQ - 3, 2000000000LL);
+	res += check(&rc, 8, 8, 0, FREQ - 3, 8000000000LL);
+	res += check(&rc, 9, 9, 0, 5, 9000000000LL);
+	rawcap_close(&rc);
+
+	/* the capture continues after reopening it */
+	if (rawcap_open(&rc, path, NBLOCKS, FREQ) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+	if (rawcap_head(&rc) != 10) {
+		printf("head %llu after reopening\n",
+		    (unsigned long long)rawcap_head(&rc));
+		res++;
+	}
+	rawcap_close(&rc);
+
+	if (rawcap_open_read(&rc, path) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+	res += check(&rc, 9, 9, 0, 5, 9000000000LL);
+	rawcap_close(&rc);
+
+	/* a different geometry starts anew */
+	if (rawcap_open(&rc, path, NBLOCKS * 2, FREQ) != 0) {
+		(void)unlink(path);
+		return EX_SOFTWARE;
+	}
+	if (rawcap_head(&rc) != 0) {
+		printf("head %llu after resizing\n",
+		    (unsigned long long)rawcap_head(&rc));
+		res++;
+	}
+	rawcap_close(&rc);
+
+	res += check_concurrent(path);
+	(void)unlink(path);
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,156 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "refclock.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+static bool
+same_sample(const struct refclock_sample * const a,
+    const struct refclock_sample * const b)
+{
+	return a->clock.tv_sec == b->clock.tv_sec &&
+	    a->clock.tv_nsec == b->clock.tv_nsec &&
+	    a->receive.tv_sec == b->receive.tv_sec &&
+	    a->receive.tv_nsec == b->receive.tv_nsec && a->leap == b->leap;
+}
+
+/* Write and read a sample like ntpd does, with the mode 1 protocol */
+static int
+check_shm(const struct refclock_sample * const sample)
+{
+	struct refclock rc;
+	struct refclock_sample got;
+	volatile struct shm_time *shm;
+	int unit, count, res = 0;
+
+	/* a unit which is unlikely to be used by a real NTP daemon */
+	unit = 200 + getpid() % 50;
+	if (refclock_open(&rc, unit, NULL) != 0) {
+		perror("shm: refclock_open");
+		return -1;
+	}
+	shm = refclock_shm_attach(unit, false);
+	if (shm == NULL) {
+		perror("shm: refclock_shm_attach");
+		refclock_close(&rc);
+		return -1;
+	}
+	count = shm->count;
+	if (refclock_shm_read(shm, &got) != 0) {
+		printf("shm: sample before publishing\n");
+		res = -1;
+	}
+	(void)refclock_publish(&rc, sample);
+	if (shm->mode != 1 || shm->count != count + 2 ||
+	    refclock_shm_read(shm, &got) != 1 || !same_sample(sample, &got) ||
+	    got.precision != sample->precision ||
+	    shm->clock_usec != sample->clock.tv_nsec / 1000) {
+		printf("shm: sample read wrong\n");
+		res = -1;
+	}
+	/* the reader cleared valid, so the sample is only used once */
+	if (refclock_shm_read(shm, &got) != 0) {
+		printf("shm: sample read twice\n");
+		res = -1;
+	}
+	(void)shmctl(shmget(REFCLOCK_SHM_KEY + unit, 0, 0), IPC_RMID, NULL);
+	(void)shmdt((const void *)shm);
+	refclock_close(&rc);
+	return res;
+}
+
+/* Send a sample to a socket created like chronyd does */
+static int
+check_sock(const struct refclock_sample * const sample)
+{
+	struct refclock rc;
+	struct refclock_sample got;
+	struct sockaddr_un addr;
+	struct sock_sample ss;
+	char buf[256];
+	ssize_t len;
+	int fd, res = 0;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path),
+	    "/tmp/test_refclock.%i", (int)getpid());
+	/* publishing without chronyd is not an error */
+	if (refclock_open(&rc, -1, addr.sun_path) != 0 ||
+	    refclock_publish(&rc, sample) != 0) {
+		perror("sock: refclock_publish without reader");
+		return -1;
+	}
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd == -1 || bind(fd, (const struct sockaddr *)&addr,
+	    sizeof(addr)) == -1) {
+		perror("sock: bind");
+		refclock_close(&rc);
+		return -1;
+	}
+	if (refclock_publish(&rc, sample) != 0) {
+		perror("sock: refclock_publish");
+		res = -1;
+	}
+	len = recv(fd, buf, sizeof(buf), 0);
+	memcpy(&ss, buf, sizeof(ss));
+	if (len != sizeof(ss) || ss.magic != REFCLOCK_SOCK_MAGIC ||
+	    ss.pulse != 0 ||
+	    refclock_sock_decode(buf, (size_t)len, &got) != 0) {
+		printf("sock: sample of %zi bytes invalid\n", len);
+		res = -1;
+	} else if (got.clock.tv_sec != sample->clock.tv_sec ||
+	    got.clock.tv_nsec != sample->clock.tv_nsec ||
+	    got.receive.tv_nsec != sample->receive.tv_nsec / 1000 * 1000 ||
+	    got.leap != sample->leap) {
+		/* the receive time only has microseconds */
+		printf("sock: sample decoded wrong, %lli.%09li\n",
+		    (long long)got.clock.tv_sec, got.clock.tv_nsec);
+		res = -1;
+	}
+	ss.magic = 0;
+	if (refclock_sock_decode(&ss, sizeof(ss), &got) == 0) {
+		printf("sock: wrong magic number accepted\n");
+		res = -1;
+	}
+	(void)close(fd);
+	(void)unlink(addr.sun_path);
+	refclock_close(&rc);
+	return res;
+}
+
+int
+main(void)
+{
+	struct refclock_sample sample;
+	int res = 0;
+
+	/* 2026-03-01 12:00 UTC, seen 3.5 ms late by the system clock */
+	memset(&sample, 0, sizeof(sample));
+	sample.clock.tv_sec = 1772366400;
+	sample.receive.tv_sec = 1772366400;
+	sample.receive.tv_nsec = 3500123;
+	sample.leap = 1;
+	sample.precision = -10;
+	/* the layout of ntpd on 64-bit systems */
+	if (sizeof(time_t) == 8 && sizeof(struct shm_time) != 96) {
+		printf("struct shm_time has %zu bytes\n",
+		    sizeof(struct shm_time));
+		res++;
+	}
+	if (check_shm(&sample) != 0) {
+		res++;
+	}
+	if (check_sock(&sample) != 0) {
+		res++;
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
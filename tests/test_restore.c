@@ -0,0 +1,213 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "decode_time.h"
+#include "input.h"
+#include "mainloop.h"
+#include "setclock.h"
+#include "warmstart.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+/* 2026-03-29 01:55 CET, DST starts at 02:00 */
+#define T0 1774745700000000000LL
+
+static void
+set_bcd(int bits[], int start, int len, int val)
+{
+	val = val / 10 * 16 + val % 10;
+	for (int i = 0; i < len; i++) {
+		bits[start + i] = val >> i & 1;
+	}
+}
+
+static int
+parity(const int bits[], int start, int stop)
+{
+	int par = 0;
+
+	for (int i = start; i <= stop; i++) {
+		par ^= bits[i];
+	}
+	return par;
+}
+
+/* Encode a minute of 2026-03-29 like DCF77 does */
+static void
+encode(int bits[], int hour, int min, bool dst)
+{
+	memset(bits, 0, 60 * sizeof(bits[0]));
+	bits[17] = dst;
+	bits[18] = !dst;
+	bits[20] = 1;
+	set_bcd(bits, 21, 7, min);
+	bits[28] = parity(bits, 21, 27);
+	set_bcd(bits, 29, 6, hour);
+	bits[35] = parity(bits, 29, 34);
+	set_bcd(bits, 36, 6, 29);
+	set_bcd(bits, 42, 3, 7);
+	set_bcd(bits, 45, 5, 3);
+	set_bcd(bits, 50, 8, 26);
+	bits[58] = parity(bits, 36, 57);
+}
+
+/* The state saved at the start of 01:55, with the DST change announced */
+static void
+fill_state(struct warmstart * const ws)
+{
+	const int curtime[7] = { 2026, 3, 29, 7, 1, 55, 0 };
+
+	memset(ws, 0, sizeof(*ws));
+	ws->freq = 1000;
+	ws->time = T0;
+	ws->realfreq = 999980000;
+	ws->bit0 = 98000000;
+	ws->bit20 = 195000000;
+	memcpy(ws->curtime, curtime, sizeof(curtime));
+	ws->dst_count = 50;
+	ws->minute_count = 55;
+	ws->dst_announce = true;
+}
+
+static bool
+check_time(const char * const name, const struct tm * const tm, int hour,
+    int min, int isdst)
+{
+	if (tm->tm_year != 2026 || tm->tm_mon != 3 || tm->tm_mday != 29 ||
+	    tm->tm_wday != 7 || tm->tm_hour != hour || tm->tm_min != min ||
+	    tm->tm_isdst != isdst) {
+		printf("%s: got %02i:%02i isdst %i, expected %02i:%02i isdst "
+		    "%i\n", name, tm->tm_hour, tm->tm_min, tm->tm_isdst, hour,
+		    min, isdst);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Decode the partial minute up to the first minute marker after the restart
+ * and the complete minute after it, which must be safe to set the clock from.
+ */
+static int
+decode_minutes(const char * const name, struct tm * const curtime,
+    unsigned partial, int hour, int min, bool dst)
+{
+	struct GB_result bit;
+	struct DT_result dt;
+	int bits[60];
+	int res = 0;
+
+	memset(&bit, 0, sizeof(bit));
+	bit.bitval = ebv_0;
+	bit.marker = emark_minute;
+	bit.hwstat = ehw_ok;
+
+	/* only the end of a minute, the bits are not at their place */
+	memset(bits, 0, sizeof(bits));
+	(void)decode_time(0, (int)(partial / 1000), partial, bits, curtime);
+	if (!check_time(name, curtime, min == 0 ? hour - 2 : hour,
+	    min == 0 ? 59 : min - 1, min == 0 ? !dst : dst)) {
+		res = -1;
+	}
+	encode(bits, hour, min, dst);
+	dt = decode_time(0, 59, 60000, bits, curtime);
+	if (!check_time(name, curtime, hour, min, dst)) {
+		res = -1;
+	}
+	if (!setclock_ok(0, dt, bit)) {
+		printf("%s: first complete minute not usable, minute %i hour "
+		    "%i dst %i\n", name, dt.minute_status, dt.hour_status,
+		    dt.dst_status);
+		res = -1;
+	}
+	return res;
+}
+
+/* Restarted at 03:02:30.5 CEST, after the DST change */
+static int
+check_newhour(void)
+{
+	struct warmstart ws;
+	struct DT_state dts;
+	struct tm curtime;
+	int res = 0;
+
+	fill_state(&ws);
+	ws.acc_minlen_partial = 500;
+	if (!warmstart_check(&ws, 1000, T0 + 450000000000LL)) {
+		printf("newhour: state rejected\n");
+		return -1;
+	}
+	memset(&curtime, 0, sizeof(curtime));
+	restore_state(&ws, T0 + 450000000000LL, &curtime);
+	if (!check_time("newhour", &curtime, 3, 2, 1)) {
+		res = -1;
+	}
+	dts = get_time_state();
+	if (dts.dst_count != 0 || dts.dt_res.dst_announce ||
+	    dts.minute_count != 55) {
+		printf("newhour: announcement not cleared, count %i of %i\n",
+		    dts.dst_count, dts.minute_count);
+		res = -1;
+	}
+	if (dts.acc_minlen_partial != 30500) {
+		printf("newhour: partial minute %u ms\n",
+		    dts.acc_minlen_partial);
+		res = -1;
+	}
+	if (decode_minutes("newhour", &curtime, 29500, 3, 4, true) != 0) {
+		res = -1;
+	}
+	return res;
+}
+
+/* Restarted at 01:58:00.4 CET, just after a minute marker */
+static int
+check_marker(void)
+{
+	struct warmstart ws;
+	struct DT_state dts;
+	struct tm curtime;
+	int res = 0;
+
+	fill_state(&ws);
+	memset(&curtime, 0, sizeof(curtime));
+	restore_state(&ws, T0 + 180400000000LL, &curtime);
+	if (!check_time("marker", &curtime, 1, 58, 0)) {
+		res = -1;
+	}
+	dts = get_time_state();
+	if (dts.dst_count != 50 || !dts.dt_res.dst_announce) {
+		printf("marker: announcement lost\n");
+		res = -1;
+	}
+	/* the marker passed, the next one is almost a minute away */
+	if (dts.acc_minlen_partial != 0) {
+		printf("marker: partial minute %u ms\n",
+		    dts.acc_minlen_partial);
+		res = -1;
+	}
+	/* 01:59 CET is followed by 03:00 CEST */
+	if (decode_minutes("marker", &curtime, 59600, 3, 0, true) != 0) {
+		res = -1;
+	}
+	return res;
+}
+
+int
+main(void)
+{
+	int res = 0;
+
+	if (check_newhour() != 0) {
+		res++;
+	}
+	if (check_marker() != 0) {
+		res++;
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,119 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "stats.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+static struct tm
+make_time(int year, int mon, int mday, int hour, int min)
+{
+	struct tm time;
+
+	memset(&time, 0, sizeof(time));
+	time.tm_year = year;
+	time.tm_mon = mon;
+	time.tm_mday = mday;
+	time.tm_hour = hour;
+	time.tm_min = min;
+	return time;
+}
+
+/* A full minute of bits, the first n of which are received in error */
+static void
+add_bits(struct stats * const st, int n)
+{
+	struct GB_result bit;
+
+	memset(&bit, 0, sizeof(bit));
+	for (int i = 0; i < 59; i++) {
+		bit.hwstat = i < n ? ehw_transmit : ehw_ok;
+		bit.bitval = i < n ? ebv_none : ebv_0;
+		stats_add_bit(st, bit);
+	}
+}
+
+static int
+check_buckets(void)
+{
+	struct stats st;
+	struct DT_result dt, bad;
+	struct reset_counts none = { 0, 0 }, one = { 1, 2 };
+	FILE *out;
+	int res = 0;
+
+	out = tmpfile();
+	if (out == NULL) {
+		perror("tmpfile");
+		return -1;
+	}
+	memset(&dt, 0, sizeof(dt));
+	dt.bit0_ok = dt.bit20_ok = true;
+	bad = dt;
+	bad.hour_status = eval_parity;
+	(void)stats_init(&st, "hour", out, true);
+
+	/* the first minute has no time yet and joins the first bucket */
+	add_bits(&st, 59);
+	stats_add_minute(&st, bad, make_time(0, 0, 0, 0, 0), none);
+	add_bits(&st, 0);
+	stats_add_minute(&st, dt, make_time(2026, 3, 1, 10, 58), none);
+	add_bits(&st, 3);
+	stats_add_minute(&st, bad, make_time(2026, 3, 1, 10, 59), one);
+	if (st.nbuckets != 0 || st.bucket.minutes != 3) {
+		printf("buckets: %lu written, %lu minutes pending\n",
+		    st.nbuckets, st.bucket.minutes);
+		res = -1;
+	}
+	add_bits(&st, 0);
+	stats_add_minute(&st, dt, make_time(2026, 3, 1, 11, 0), none);
+	if (st.nbuckets != 1 || st.total.minutes != 3 ||
+	    st.total.valid != 1 || st.total.field[1][eval_parity - 1] != 2 ||
+	    st.total.hw[ehw_transmit] != 62 || st.total.nobit != 0 ||
+	    st.total.resets.freq != 1 || st.total.resets.bitlen != 2) {
+		printf("buckets: first bucket counted wrong\n");
+		res = -1;
+	}
+	/* bits after the last minute marker */
+	add_bits(&st, 10);
+	stats_finish(&st);
+	if (st.nbuckets != 2 || st.total.minutes != 4 ||
+	    st.total.bits != 5 * 59 || st.hour_minutes[10] != 2 ||
+	    st.hour_valid[10] != 1 || st.hour_minutes[11] != 1) {
+		printf("buckets: totals counted wrong\n");
+		res = -1;
+	}
+	(void)fclose(out);
+	return res;
+}
+
+int
+main(void)
+{
+	struct stats st;
+	const char * const good[] = { "all", "year", "month", "day", "hour",
+	    "1", "15", "1440" };
+	const char * const bad[] = { "", "week", "0", "7", "2880", "15m" };
+	int res = 0;
+
+	for (unsigned i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+		if (stats_init(&st, good[i], stdout, false) != 0) {
+			printf("bucket \"%s\" rejected\n", good[i]);
+			res++;
+		}
+	}
+	for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+		if (stats_init(&st, bad[i], stdout, false) == 0) {
+			printf("bucket \"%s\" accepted\n", bad[i]);
+			res++;
+		}
+	}
+	if (check_buckets() != 0) {
+		res++;
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
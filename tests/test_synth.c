@@ -0,0 +1,357 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "decode_alarm.h"
+#include "decode_time.h"
+#include "input.h"
+#include "mainloop.h"
+#include "synth.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAXMIN 200
+
+static struct tm times[MAXMIN];
+static int ntimes, ndst, nleap;
+
+static void
+no_bit(struct ML_state *mls, struct GB_result bit, int bitpos)
+{
+}
+
+static void
+no_output(struct ML_state *mls)
+{
+}
+
+static void
+no_minute(struct ML_state *mls, int minlen)
+{
+}
+
+static void
+no_alarm(struct ML_state *mls, struct alm alarm)
+{
+}
+
+static void
+record_time(struct ML_state *mls, struct DT_result dt, struct tm time)
+{
+	/* nothing is decoded before the first minute marker */
+	if (time.tm_year != 0 && ntimes < MAXMIN) {
+		times[ntimes++] = time;
+	}
+	if (dt.dst_status == eDST_done) {
+		ndst++;
+	}
+	if (dt.leapsecond_status == els_done) {
+		nleap++;
+	}
+}
+
+static void
+no_thirdparty_buffer(struct ML_state *mls, const unsigned tpbuf[])
+{
+}
+
+static struct ML_callbacks cb = {
+	get_bit_file_r, no_bit, no_output, no_minute, no_alarm, no_output,
+	no_output, record_time, no_thirdparty_buffer
+};
+
+static bool
+same_time(struct tm a, struct tm b)
+{
+	return a.tm_year == b.tm_year && a.tm_mon == b.tm_mon &&
+	    a.tm_mday == b.tm_mday && a.tm_wday == b.tm_wday &&
+	    a.tm_hour == b.tm_hour && a.tm_min == b.tm_min &&
+	    a.tm_isdst == b.tm_isdst;
+}
+
+static void
+set_config(struct synth_config * const cfg, const char * const start,
+    unsigned long minutes)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	(void)sscanf(start, "%d-%d-%d %d:%d", &cfg->start.tm_year,
+	    &cfg->start.tm_mon, &cfg->start.tm_mday, &cfg->start.tm_hour,
+	    &cfg->start.tm_min);
+	cfg->minutes = minutes;
+	cfg->seed = 42;
+	cfg->thirdparty = true;
+}
+
+/*
+ * Compare the decoded times with the ones the generator encoded, skipping the
+ * given number of minutes at the start and at the end.
+ */
+static int
+check_times(const char * const name, const struct synth_config * const cfg,
+    int skip, int dst, int leap)
+{
+	struct synth s;
+	int res = 0;
+
+	(void)synth_init(&s, cfg);
+	for (int i = 0; i < skip; i++) {
+		(void)synth_next(&s);
+	}
+	if (ntimes != (int)cfg->minutes - 2 * skip) {
+		printf("%s: %i of %lu minutes decoded\n", name, ntimes,
+		    cfg->minutes);
+		res = -1;
+	}
+	for (int i = 0; i < ntimes; i++) {
+		if (!same_time(times[i], s.time)) {
+			printf("%s: minute %i decoded as %04i-%02i-%02i "
+			    "%02i:%02i\n", name, i, times[i].tm_year,
+			    times[i].tm_mon, times[i].tm_mday,
+			    times[i].tm_hour, times[i].tm_min);
+			res = -1;
+			break;
+		}
+		(void)synth_next(&s);
+	}
+	if (ndst != dst || nleap != leap) {
+		printf("%s: %i summer time changes, %i leap seconds\n", name,
+		    ndst, nleap);
+		res = -1;
+	}
+	return res;
+}
+
+/* Generate a log file and decode it */
+static int
+check_log(const char * const name, const struct synth_config * const cfg,
+    int dst, int leap)
+{
+	char path[] = "/tmp/test_synth.XXXXXX", line[128];
+	struct ML_state mls;
+	struct synth s;
+	FILE *f;
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd == -1 || (f = fdopen(fd, "w")) == NULL) {
+		perror("mkstemp");
+		return -1;
+	}
+	if (synth_init(&s, cfg) != 0) {
+		printf("%s: synth_init failed\n", name);
+		(void)fclose(f);
+		(void)unlink(path);
+		return -1;
+	}
+	fputs("\n--new log--\n\n", f);
+	do {
+		fwrite(line, 1, synth_log_line(&s, line, sizeof(line)), f);
+	} while (synth_next(&s));
+	(void)fclose(f);
+
+	ntimes = ndst = nleap = 0;
+	cb.get_bit = get_bit_file_r;
+	init_mainloop_state(&mls, stdout);
+	if (set_mode_file_r(&mls.gbs, path) != 0) {
+		(void)unlink(path);
+		return -1;
+	}
+	while (!mainloop_step_r(&mls, &cb)) {
+		/* decode until the end */
+	}
+	cleanup_r(&mls.gbs);
+	(void)unlink(path);
+	return check_times(name, cfg, 0, dst, leap);
+}
+
+/* Decode the generated edges, sampled like a receiver would */
+static int
+check_edges(const char * const name, const struct synth_config * const cfg,
+    int dst, int leap)
+{
+	struct ML_state mls;
+	struct synth s;
+
+	if (synth_init(&s, cfg) != 0) {
+		printf("%s: synth_init failed\n", name);
+		return -1;
+	}
+	ntimes = ndst = nleap = 0;
+	cb.get_bit = get_bit_live_r;
+	init_mainloop_state(&mls, stdout);
+	if (set_mode_synthetic_r(&mls.gbs, 1000, false, synth_edge, &s) !=
+	    0) {
+		return -1;
+	}
+	while (!mainloop_step_r(&mls, &cb)) {
+		/* decode until the end */
+	}
+	cleanup_r(&mls.gbs);
+	/* the stream starts and ends without a minute marker */
+	return check_times(name, cfg, 1, dst, leap);
+}
+
+/*
+ * The timestamps of the rising edges are within half a sample period of the
+ * generated edges, which start at whole seconds.
+ */
+static int
+check_edge_times(unsigned freq, bool edge_decoder)
+{
+	struct GB_state gbs;
+	struct synth_config cfg;
+	struct synth s;
+	long long slack;
+	int nedge = 0;
+
+	set_config(&cfg, "2026-01-01 00:00", 3);
+	if (synth_init(&s, &cfg) != 0) {
+		printf("edge times: synth_init failed\n");
+		return -1;
+	}
+	init_input_state(&gbs);
+	if (set_mode_synthetic_r(&gbs, freq, edge_decoder, synth_edge, &s) !=
+	    0) {
+		return -1;
+	}
+	slack = 1000000000LL / freq / 2 + 1000;
+	for (;;) {
+		struct GB_result bit;
+		struct bitinfo bi;
+		long long dt;
+
+		bit = get_bit_live_r(&gbs);
+		if (bit.done) {
+			break;
+		}
+		bi = get_bitinfo_r(&gbs);
+		if (bi.edge_mono != -1) {
+			nedge++;
+			dt = (bi.edge_mono + 500000000) % 1000000000 -
+			    500000000;
+			if (dt < -slack || dt > slack || bi.edge_real != -1) {
+				printf("edge times %u%s: edge at %lli\n", freq,
+				    edge_decoder ? " (edges)" : "",
+				    bi.edge_mono);
+				cleanup_r(&gbs);
+				return -1;
+			}
+		}
+		(void)next_bit_r(&gbs);
+	}
+	cleanup_r(&gbs);
+	if (nedge < 150) {
+		printf("edge times %u%s: only %i edges\n", freq,
+		    edge_decoder ? " (edges)" : "", nedge);
+		return -1;
+	}
+	return 0;
+}
+
+/* The noise depends on the seed only, and stays within its bounds */
+static int
+check_noise(void)
+{
+	struct synth_config cfg;
+	struct synth s[2];
+	struct edge e[2];
+	int nx = 0, nburst = 0, res = 0;
+	long long prev = 0;
+
+	set_config(&cfg, "2026-01-01 00:00", 100);
+	cfg.noise.flip = 0.01;
+	cfg.noise.dropout = 0.002;
+	cfg.noise.dropout_len = 5;
+	cfg.noise.burst = 0.002;
+	cfg.noise.burst_len = 3;
+	cfg.noise.jitter = 2000;
+	if (synth_init(&s[0], &cfg) != 0 || synth_init(&s[1], &cfg) != 0) {
+		printf("noise: synth_init failed\n");
+		return -1;
+	}
+	do {
+		for (int i = 0; i < s[0].minlen; i++) {
+			nx += s[0].text[i] == 'x';
+			nburst += s[0].text[i] == 'r' || s[0].text[i] == '#';
+		}
+	} while (synth_next(&s[0]));
+	if (nx == 0 || nburst == 0) {
+		printf("noise: %i dropouts, %i bursts\n", nx, nburst);
+		res = -1;
+	}
+
+	(void)synth_init(&s[0], &cfg);
+	while (synth_edge(&s[0], &e[0]) == 0) {
+		long long dt;
+		char c;
+
+		if (synth_edge(&s[1], &e[1]) != 0 || e[0].t != e[1].t ||
+		    e[0].level != e[1].level) {
+			printf("noise: streams differ\n");
+			return -1;
+		}
+		/* pulses start near a whole second, except for bursts */
+		c = s[0].text[s[0].sec - 1];
+		dt = (e[0].t + 500000000) % 1000000000 - 500000000;
+		if (e[0].t < prev || (e[0].level == 1 && c != 'r' && c != '#' &&
+		    (dt < -2000000 || dt > 2000000))) {
+			printf("noise: edge at %lli out of place\n", e[0].t);
+			return -1;
+		}
+		prev = e[0].t;
+	}
+	return res;
+}
+
+int
+main(void)
+{
+	static struct synth s;
+	struct synth_config cfg;
+	int res = 0;
+
+	/* summer time starts at 02:00 CET, and ends at 03:00 CEST */
+	set_config(&cfg, "2026-03-29 01:00", 120);
+	if (check_log("spring", &cfg, 1, 0) != 0) {
+		res++;
+	}
+	set_config(&cfg, "2026-10-25 01:30", 120);
+	if (check_log("autumn", &cfg, 1, 0) != 0) {
+		res++;
+	}
+	/* a leap second at 02:00 CEST */
+	set_config(&cfg, "2026-07-01 00:30", 120);
+	cfg.nleap = 1;
+	cfg.leap[0].tm_year = 2026;
+	cfg.leap[0].tm_mon = 6;
+	if (check_log("leap", &cfg, 0, 1) != 0) {
+		res++;
+	}
+	if (check_edges("leap edges", &cfg, 0, 1) != 0) {
+		res++;
+	}
+	set_config(&cfg, "2026-03-29 01:50", 20);
+	if (check_edges("spring edges", &cfg, 1, 0) != 0) {
+		res++;
+	}
+	if (check_edge_times(1000, false) != 0 ||
+	    check_edge_times(10000, false) != 0 ||
+	    check_edge_times(1000, true) != 0) {
+		res++;
+	}
+	if (check_noise() != 0) {
+		res++;
+	}
+	/* the generator refuses years the decoder cannot tell apart */
+	set_config(&cfg, "2400-01-01 00:00", 10);
+	if (synth_init(&s, &cfg) == 0) {
+		printf("year 2400 accepted\n");
+		res++;
+	}
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,143 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "warmstart.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+/* 2026-03-01 13:00 CET */
+#define T0 1772366400000000000LL
+
+static void
+fill_state(struct warmstart * const ws)
+{
+	const int curtime[7] = { 2026, 3, 1, 7, 13, 0, 0 };
+
+	memset(ws, 0, sizeof(*ws));
+	ws->freq = 1000;
+	ws->time = T0;
+	/* sampling 20 ppm slower than nominal */
+	ws->realfreq = 999980000;
+	ws->bit0 = 98000000;
+	ws->bit20 = 195000000;
+	memcpy(ws->curtime, curtime, sizeof(curtime));
+	ws->dst_count = 3;
+	ws->leap_count = 1;
+	ws->minute_count = 42;
+	ws->acc_minlen_partial = 1234;
+	ws->dst_announce = true;
+}
+
+/* The state is read back as written */
+static int
+check_roundtrip(const char * const filename)
+{
+	struct warmstart ws, got;
+
+	fill_state(&ws);
+	if (warmstart_write(filename, &ws) != 0) {
+		perror("roundtrip: warmstart_write");
+		return -1;
+	}
+	if (warmstart_read(filename, &got) != 0) {
+		printf("roundtrip: cannot read the state back\n");
+		return -1;
+	}
+	if (memcmp(&ws, &got, sizeof(ws)) != 0) {
+		printf("roundtrip: state read differs\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* Old, foreign or damaged state is not used */
+static int
+check_sanity(void)
+{
+	struct warmstart ws;
+	int res = 0;
+
+	fill_state(&ws);
+	if (!warmstart_check(&ws, 1000, T0 + 90 * 1000000000LL)) {
+		printf("sanity: recent state rejected\n");
+		res = -1;
+	}
+	if (warmstart_check(&ws, 1000, T0 + (WARMSTART_MAXAGE + 1) *
+	    1000000000LL) || warmstart_check(&ws, 1000, T0 - 1000000000LL)) {
+		printf("sanity: state from another time accepted\n");
+		res = -1;
+	}
+	if (warmstart_check(&ws, 2000, T0)) {
+		printf("sanity: state for another frequency accepted\n");
+		res = -1;
+	}
+	ws.realfreq = 1000000001;
+	if (warmstart_check(&ws, 1000, T0)) {
+		printf("sanity: too high realfreq accepted\n");
+		res = -1;
+	}
+	fill_state(&ws);
+	ws.bit20 = ws.bit0;
+	if (warmstart_check(&ws, 1000, T0)) {
+		printf("sanity: bit20 equal to bit0 accepted\n");
+		res = -1;
+	}
+	fill_state(&ws);
+	ws.curtime[6] = -1;
+	if (warmstart_check(&ws, 1000, T0)) {
+		printf("sanity: unknown DST accepted\n");
+		res = -1;
+	}
+	return res;
+}
+
+/* A file of another format or version is not read */
+static int
+check_format(const char * const filename)
+{
+	struct warmstart ws;
+	FILE *f;
+	int res = 0;
+
+	f = fopen(filename, "w");
+	if (f == NULL) {
+		perror("format: fopen");
+		return -1;
+	}
+	fprintf(f, "version %i\nfreq 1000\n", WARMSTART_VERSION + 1);
+	(void)fclose(f);
+	if (warmstart_read(filename, &ws) == 0) {
+		printf("format: other version read\n");
+		res = -1;
+	}
+	(void)unlink(filename);
+	if (warmstart_read(filename, &ws) == 0) {
+		printf("format: missing file read\n");
+		res = -1;
+	}
+	return res;
+}
+
+int
+main(void)
+{
+	char filename[64];
+	int res = 0;
+
+	snprintf(filename, sizeof(filename), "/tmp/test_warmstart.%i",
+	    (int)getpid());
+	if (check_roundtrip(filename) != 0) {
+		res++;
+	}
+	if (check_sanity() != 0) {
+		res++;
+	}
+	if (check_format(filename) != 0) {
+		res++;
+	}
+	(void)unlink(filename);
+	return res == 0 ? EX_OK : EX_SOFTWARE;
+}
@@ -0,0 +1,127 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "warmstart.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int
+warmstart_write(const char * const filename,
+    const struct warmstart * const ws)
+{
+	FILE *f;
+	char *tmp;
+	size_t len;
+	int res;
+
+	/* write a new file and rename it, so that it is never half-written */
+	len = strlen(filename) + sizeof(".tmp");
+	tmp = malloc(len);
+	if (tmp == NULL) {
+		return -1;
+	}
+	(void)snprintf(tmp, len, "%s.tmp", filename);
+	f = fopen(tmp, "w");
+	if (f == NULL) {
+		free(tmp);
+		return -1;
+	}
+	fprintf(f, "version %i\nfreq %u\ntime %lli\n", WARMSTART_VERSION,
+	    ws->freq, ws->time);
+	fprintf(f, "realfreq %llu\nbit0 %llu\nbit20 %llu\n", ws->realfreq,
+	    ws->bit0, ws->bit20);
+	fprintf(f, "curtime %i %i %i %i %i %i %i\n", ws->curtime[0],
+	    ws->curtime[1], ws->curtime[2], ws->curtime[3], ws->curtime[4],
+	    ws->curtime[5], ws->curtime[6]);
+	fprintf(f, "dst %i %i\nleap %i %i\nminutes %i\npartial %u\n",
+	    ws->dst_count, ws->dst_announce ? 1 : 0, ws->leap_count,
+	    ws->leap_announce ? 1 : 0, ws->minute_count,
+	    ws->acc_minlen_partial);
+	res = ferror(f) ? -1 : 0;
+	if (fclose(f) == EOF) {
+		res = -1;
+	}
+	if (res == 0) {
+		res = rename(tmp, filename);
+	}
+	if (res == -1) {
+		(void)remove(tmp);
+	}
+	free(tmp);
+	return res;
+}
+
+int
+warmstart_read(const char * const filename, struct warmstart * const ws)
+{
+	FILE *f;
+	int version, dst_announce, leap_announce, n;
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		/* not written yet */
+		return -1;
+	}
+	memset(ws, 0, sizeof(*ws));
+	n = fscanf(f, " version %i freq %u time %lli realfreq %llu bit0 %llu "
+	    "bit20 %llu curtime %i %i %i %i %i %i %i dst %i %i leap %i %i "
+	    "minutes %i partial %u", &version, &ws->freq, &ws->time,
+	    &ws->realfreq, &ws->bit0, &ws->bit20, &ws->curtime[0],
+	    &ws->curtime[1], &ws->curtime[2], &ws->curtime[3],
+	    &ws->curtime[4], &ws->curtime[5], &ws->curtime[6],
+	    &ws->dst_count, &dst_announce, &ws->leap_count, &leap_announce,
+	    &ws->minute_count, &ws->acc_minlen_partial);
+	(void)fclose(f);
+	if (n != 19 || version != WARMSTART_VERSION) {
+		return -1;
+	}
+	ws->dst_announce = dst_announce != 0;
+	ws->leap_announce = leap_announce != 0;
+	return 0;
+}
+
+/* The same limits as get_bit_live() uses to reset realfreq, bit0 and bit20 */
+static bool
+check_bitlen(const struct warmstart * const ws)
+{
+	unsigned long long avg;
+
+	if (ws->realfreq <= ws->freq * 500000ULL ||
+	    ws->realfreq > ws->freq * 1000000ULL) {
+		return false;
+	}
+	if (2 * ws->bit20 < ws->bit0 * 3 || ws->bit20 > ws->bit0 * 3) {
+		return false;
+	}
+	avg = (ws->bit20 - ws->bit0) / 2;
+	return ws->bit0 + avg >= ws->realfreq / 10 &&
+	    ws->bit0 - avg <= ws->realfreq / 10 &&
+	    ws->bit20 + avg >= ws->realfreq / 5 &&
+	    ws->bit20 - avg <= ws->realfreq / 5;
+}
+
+static bool
+check_time(const struct warmstart * const ws)
+{
+	const int * const t = ws->curtime;
+
+	return t[0] >= 1900 && t[0] <= 2299 && t[1] >= 1 && t[1] <= 12 &&
+	    t[2] >= 1 && t[2] <= 31 && t[3] >= 1 && t[3] <= 7 &&
+	    t[4] >= 0 && t[4] <= 23 && t[5] >= 0 && t[5] <= 59 &&
+	    (t[6] == 0 || t[6] == 1) &&
+	    ws->minute_count >= 0 && ws->minute_count < 60 &&
+	    ws->dst_count >= 0 && ws->dst_count <= 60 &&
+	    ws->leap_count >= 0 && ws->leap_count <= 60 &&
+	    ws->acc_minlen_partial < 60000;
+}
+
+bool
+warmstart_check(const struct warmstart * const ws, unsigned freq,
+    long long now)
+{
+	return ws->freq == freq && ws->time <= now &&
+	    now - ws->time <= WARMSTART_MAXAGE * 1000000000LL &&
+	    check_bitlen(ws) && check_time(ws);
+}
@@ -0,0 +1,83 @@
+// Copyright 2026 René Ladan
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef DCF77PI_WARMSTART_H
+#define DCF77PI_WARMSTART_H
+
+#include <stdbool.h>
+
+/** Version of the state file written by {@link warmstart_write} */
+#define WARMSTART_VERSION 1
+
+/**
+ * Largest age of a state file in seconds which is still used, older state
+ * is likely to be wrong about the DST and leap second announcements.
+ */
+#define WARMSTART_MAXAGE 3600
+
+/**
+ * The adaptive state of the bit reader and the time decoder at the start of
+ * a decoded minute, kept in a small file so that a restarted client does not
+ * need to learn it again.
+ */
+struct warmstart {
+	/** sample frequency in Hz for which realfreq, bit0 and bit20 hold */
+	unsigned freq;
+	/** CLOCK_REALTIME time of the start of the minute in ns */
+	long long time;
+	/** see {@link bitinfo.realfreq} */
+	unsigned long long realfreq;
+	/** see {@link bitinfo.bit0} */
+	unsigned long long bit0;
+	/** see {@link bitinfo.bit20} */
+	unsigned long long bit20;
+	/** the decoded time: year, month, day, weekday, hour, minute, DST */
+	int curtime[7];
+	/** see {@link DT_state.dst_count} */
+	int dst_count;
+	/** see {@link DT_state.leap_count} */
+	int leap_count;
+	/** see {@link DT_state.minute_count} */
+	int minute_count;
+	/** see {@link DT_state.acc_minlen_partial} */
+	unsigned acc_minlen_partial;
+	/** see {@link DT_result.dst_announce} */
+	bool dst_announce;
+	/** see {@link DT_result.leap_announce} */
+	bool leap_announce;
+};
+
+/**
+ * Write the state to a file. The file is replaced atomically, so a crash
+ * while writing leaves the previous state in place.
+ *
+ * @param filename The name of the state file.
+ * @param ws The state to write.
+ * @return Success (0), or -1 with errno set.
+ */
+int warmstart_write(const char * const filename,
+    const struct warmstart * const ws);
+
+/**
+ * Read the state from a file written by {@link warmstart_write}.
+ *
+ * @param filename The name of the state file.
+ * @param ws The state to fill in.
+ * @return Success (0), or -1 if the file cannot be read or has the wrong
+ * format or version.
+ */
+int warmstart_read(const char * const filename, struct warmstart * const ws);
+
+/**
+ * Check whether the state can be used to continue decoding right away.
+ *
+ * @param ws The state read by {@link warmstart_read}.
+ * @param freq The current sample frequency in Hz.
+ * @param now The current CLOCK_REALTIME time in ns.
+ * @return The state is recent and for the same frequency, and its values are
+ * within the ranges which the bit reader and time decoder accept.
+ */
+bool warmstart_check(const struct warmstart * const ws, unsigned freq,
+    long long now);
+
+#endif